@@ -0,0 +1,46 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(local_size_x = 64) in;
+
+// VkDrawIndexedIndirectCommand followed by the batch the draw is compacted into
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+    uint batchIndex;
+    uint batchFirstDraw;
+    uint padding;
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer DrawCommandBuffer{
+    DrawCommand commands[];
+} drawCommands;
+layout(std430, set = 0, binding = 4) writeonly buffer CompactedDrawCommandBuffer{
+    DrawCommand commands[];
+} compactedDrawCommands;
+layout(std430, set = 0, binding = 5) buffer DrawCountBuffer{
+    uint counts[];
+} drawCounts;
+
+layout(push_constant) uniform CullingPushConstant{
+    uint instanceCount;
+    uint drawCount;
+} inCullingPushConstant;
+
+void main() {
+    uint drawIndex = gl_GlobalInvocationID.x;
+    if (drawIndex >= inCullingPushConstant.drawCount) {
+        return;
+    }
+
+    // Draws with no visible instance are left out, the others are appended to the range of their batch
+    DrawCommand command = drawCommands.commands[drawIndex];
+    if (command.instanceCount == 0) {
+        return;
+    }
+    uint slot = atomicAdd(drawCounts.counts[command.batchIndex], 1);
+    compactedDrawCommands.commands[command.batchFirstDraw + slot] = command;
+}
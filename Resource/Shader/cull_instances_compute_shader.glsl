@@ -0,0 +1,70 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(local_size_x = 64) in;
+
+// Same layout as the static vertex shaders
+struct InstanceInput {
+    mat4 transformation;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvOffsetScale;
+    // Center in xyz and radius in w, in model space
+    vec4 boundingSphere;
+    uint textureIndex;
+    uint drawIndex;
+};
+// VkDrawIndexedIndirectCommand followed by the batch the draw is compacted into
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+    uint batchIndex;
+    uint batchFirstDraw;
+    uint padding;
+};
+
+layout(set = 0, binding = 0) uniform CullingInput{
+    vec4 frustumPlanes[6];
+} inCulling;
+layout(std430, set = 0, binding = 1) readonly buffer InstanceBufferInput{
+    InstanceInput instances[];
+} inInstances;
+layout(std430, set = 0, binding = 2) buffer DrawCommandBuffer{
+    DrawCommand commands[];
+} drawCommands;
+layout(std430, set = 0, binding = 3) writeonly buffer VisibleInstanceBuffer{
+    uint indices[];
+} visibleInstances;
+
+layout(push_constant) uniform CullingPushConstant{
+    uint instanceCount;
+    uint drawCount;
+} inCullingPushConstant;
+
+void main() {
+    uint instanceIndex = gl_GlobalInvocationID.x;
+    if (instanceIndex >= inCullingPushConstant.instanceCount) {
+        return;
+    }
+
+    InstanceInput instance = inInstances.instances[instanceIndex];
+    vec3 center = (instance.transformation * vec4(instance.boundingSphere.xyz, 1.0)).xyz;
+    float scale = max(max(
+        length(instance.transformation[0].xyz),
+        length(instance.transformation[1].xyz)),
+        length(instance.transformation[2].xyz));
+    float radius = instance.boundingSphere.w * scale;
+    for (int i = 0; i < 6; i++) {
+        if (dot(inCulling.frustumPlanes[i].xyz, center) + inCulling.frustumPlanes[i].w < -radius) {
+            return;
+        }
+    }
+
+    // The visible instances of a draw are packed at the start of its instance range, in any order
+    uint drawIndex = instance.drawIndex;
+    uint slot = atomicAdd(drawCommands.commands[drawIndex].instanceCount, 1);
+    visibleInstances.indices[drawCommands.commands[drawIndex].firstInstance + slot] = instanceIndex;
+}
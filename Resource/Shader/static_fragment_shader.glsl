@@ -1,8 +1,16 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+#ifdef BINDLESS_TEXTURES
+// Every entity texture is in one array, the texture is selected with the index in the instance input,
+// which is the same for every instance of a draw
+layout(set = 1, binding = 0) uniform texture2D inTextures[BINDLESS_TEXTURE_CAPACITY];
+layout(set = 1, binding = 1) uniform samplerCube inSamplerEnvMap;
+layout(set = 1, binding = 2) uniform sampler inTextureSampler;
+#else
 layout(set = 1, binding = 0) uniform sampler2D inSampler;
 layout(set = 1, binding = 1) uniform samplerCube inSamplerEnvMap;
+#endif
 
 layout(location = 0) in vec2 fUV;
 layout(location = 1) in vec4 fNormal;
@@ -11,6 +19,9 @@ layout(location = 3) in vec4 fEyePosition;
 layout(location = 4) in vec4 fLightPosition;
 layout(location = 5) in float fVisibility;
 layout(location = 6) in vec3 fFogColor;
+#ifdef BINDLESS_TEXTURES
+layout(location = 7) flat in uint fTextureIndex;
+#endif
 
 layout(location = 0) out vec4 outColor;
 
@@ -22,7 +33,11 @@ const float specularStrength = 0.5;
 const float ambientStrength = 0.35;
 
 void main() {
+#ifdef BINDLESS_TEXTURES
+    vec4 objectColor = texture(sampler2D(inTextures[fTextureIndex], inTextureSampler), fUV);
+#else
     vec4 objectColor = texture(inSampler, fUV);
+#endif
     if (objectColor.a < 1)
         discard;
 
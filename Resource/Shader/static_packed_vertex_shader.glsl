@@ -0,0 +1,77 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(set = 0, binding = 0) uniform UniformBufferInput{
+    mat4 view;
+    mat4 projection;
+    vec3 eyePosition;
+    vec3 lightPosition;
+} inUniform;
+// Instance inputs of the drawn entities in draw order, the instances of each draw follow each other
+struct InstanceInput {
+    mat4 transformation;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvOffsetScale;
+    // Only read by the culling compute shader
+    vec4 boundingSphere;
+    uint textureIndex;
+    uint drawIndex;
+};
+layout(std430, set = 2, binding = 0) readonly buffer InstanceBufferInput{
+    InstanceInput instances[];
+} inInstances;
+// Instances left by the frustum culling, the visible instances of each draw start at its first instance
+layout(std430, set = 2, binding = 1) readonly buffer VisibleInstanceBuffer{
+    uint indices[];
+} inVisibleInstances;
+
+// Packed vertex, the normalized values are restored with the mesh ranges in the instance buffer
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inUV;
+
+layout(location = 0) out vec2 fUV;
+layout(location = 1) out vec4 fNormal;
+layout(location = 2) out vec4 fWorldPosition;
+layout(location = 3) out vec4 fEyePosition;
+layout(location = 4) out vec4 fLightPosition;
+layout(location = 5) out float fVisibility;
+layout(location = 6) out vec3 fFogColor;
+layout(location = 7) flat out uint fTextureIndex;
+
+layout(push_constant) uniform MeshPushContant{
+    float fogDensity;
+    float fogGradient;
+    vec3 fogColor;
+} inMeshPushConstant;
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (normal.z < 0.0) {
+        normal.xy = (1.0 - abs(encoded.yx)) * vec2(encoded.x >= 0.0 ? 1.0 : -1.0, encoded.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(normal);
+}
+
+void main() {
+    InstanceInput inInstance = inInstances.instances[inVisibleInstances.indices[gl_InstanceIndex]];
+    vec3 position = inInstance.positionOffset.xyz + inPosition.xyz * inInstance.positionScale.xyz;
+    vec3 normal = decodeOctahedral(inNormal);
+
+    fUV = inInstance.uvOffsetScale.xy + inUV * inInstance.uvOffsetScale.zw;
+    fNormal = inInstance.transformation * vec4(normal, 0.0);
+
+    fEyePosition = vec4(inUniform.eyePosition, 1.0);
+    fLightPosition = vec4(inUniform.lightPosition, 1.0);
+
+    fWorldPosition = inInstance.transformation * vec4(position, 1.0);
+    vec4 fCameraLocalPosition = inUniform.view * fWorldPosition;
+    float distance = length(fCameraLocalPosition.xyz);
+    fVisibility = exp(-pow(distance * inMeshPushConstant.fogDensity, inMeshPushConstant.fogGradient));
+    fVisibility = clamp(fVisibility, 0.0, 1.0);
+    fFogColor = inMeshPushConstant.fogColor;
+    fTextureIndex = inInstance.textureIndex;
+
+    gl_Position = inUniform.projection * fCameraLocalPosition;
+}
\ No newline at end of file
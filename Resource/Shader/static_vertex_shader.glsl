@@ -7,9 +7,24 @@ layout(set = 0, binding = 0) uniform UniformBufferInput{
     vec3 eyePosition;
     vec3 lightPosition;
 } inUniform;
-layout(set = 2, binding = 0) uniform InstanceBufferInput{
+// Same layout as the packed vertex shader, the mesh ranges are not used
+struct InstanceInput {
     mat4 transformation;
-} inInstance;
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvOffsetScale;
+    // Only read by the culling compute shader
+    vec4 boundingSphere;
+    uint textureIndex;
+    uint drawIndex;
+};
+layout(std430, set = 2, binding = 0) readonly buffer InstanceBufferInput{
+    InstanceInput instances[];
+} inInstances;
+// Instances left by the frustum culling, the visible instances of each draw start at its first instance
+layout(std430, set = 2, binding = 1) readonly buffer VisibleInstanceBuffer{
+    uint indices[];
+} inVisibleInstances;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
@@ -22,6 +37,7 @@ layout(location = 3) out vec4 fEyePosition;
 layout(location = 4) out vec4 fLightPosition;
 layout(location = 5) out float fVisibility;
 layout(location = 6) out vec3 fFogColor;
+layout(location = 7) flat out uint fTextureIndex;
 
 layout(push_constant) uniform MeshPushContant{
     float fogDensity;
@@ -30,6 +46,8 @@ layout(push_constant) uniform MeshPushContant{
 } inMeshPushConstant;
 
 void main() {
+    InstanceInput inInstance = inInstances.instances[inVisibleInstances.indices[gl_InstanceIndex]];
+
     fUV = inUV;
     fNormal = inInstance.transformation * vec4(inNormal, 0.0);
 
@@ -42,6 +60,7 @@ void main() {
     fVisibility = exp(-pow(distance * inMeshPushConstant.fogDensity, inMeshPushConstant.fogGradient));
     fVisibility = clamp(fVisibility, 0.0, 1.0);
     fFogColor = inMeshPushConstant.fogColor;
+    fTextureIndex = inInstance.textureIndex;
 
     gl_Position = inUniform.projection * fCameraLocalPosition;
 }
\ No newline at end of file
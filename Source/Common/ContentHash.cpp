@@ -0,0 +1,90 @@
+#include <cstring>
+
+#include "ContentHash.h"
+
+uint64_t ContentHash::Compute(const void *data, size_t size, uint64_t seed)
+{
+    const uint8_t *input = static_cast<const uint8_t *>(data);
+    const uint8_t *end = input + size;
+    uint64_t hash;
+
+    if (size >= 32)
+    {
+        // Four independent lanes over 32-byte stripes
+        uint64_t accumulators[4] = { seed + PRIME_1 + PRIME_2, seed + PRIME_2, seed, seed - PRIME_1 };
+        const uint8_t *stripeEnd = end - 32;
+        do
+        {
+            for (uint64_t &accumulator : accumulators)
+            {
+                accumulator = Round(accumulator, Read64(input));
+                input += 8;
+            }
+        } while (input <= stripeEnd);
+
+        hash = RotateLeft(accumulators[0], 1) + RotateLeft(accumulators[1], 7)
+            + RotateLeft(accumulators[2], 12) + RotateLeft(accumulators[3], 18);
+        for (uint64_t accumulator : accumulators)
+        {
+            hash = MergeRound(hash, accumulator);
+        }
+    }
+    else
+    {
+        hash = seed + PRIME_5;
+    }
+
+    hash += static_cast<uint64_t>(size);
+
+    for (; input + 8 <= end; input += 8)
+    {
+        hash ^= Round(0, Read64(input));
+        hash = RotateLeft(hash, 27) * PRIME_1 + PRIME_4;
+    }
+    if (input + 4 <= end)
+    {
+        hash ^= static_cast<uint64_t>(Read32(input)) * PRIME_1;
+        hash = RotateLeft(hash, 23) * PRIME_2 + PRIME_3;
+        input += 4;
+    }
+    for (; input < end; input++)
+    {
+        hash ^= (*input) * PRIME_5;
+        hash = RotateLeft(hash, 11) * PRIME_1;
+    }
+
+    // Final mix so that every input bit affects every output bit
+    hash ^= hash >> 33;
+    hash *= PRIME_2;
+    hash ^= hash >> 29;
+    hash *= PRIME_3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t ContentHash::Round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * PRIME_2;
+    accumulator = RotateLeft(accumulator, 31);
+    return accumulator * PRIME_1;
+}
+
+uint64_t ContentHash::MergeRound(uint64_t hash, uint64_t accumulator)
+{
+    hash ^= Round(0, accumulator);
+    return hash * PRIME_1 + PRIME_4;
+}
+
+uint64_t ContentHash::Read64(const uint8_t *data)
+{
+    uint64_t value;
+    memcpy(&value, data, sizeof(uint64_t));
+    return value;
+}
+
+uint32_t ContentHash::Read32(const uint8_t *data)
+{
+    uint32_t value;
+    memcpy(&value, data, sizeof(uint32_t));
+    return value;
+}
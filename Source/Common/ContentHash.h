@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit xxHash of a block of bytes, fast enough to identify loaded resources by their content
+// Several blocks are hashed together by passing the hash of the previous block as the seed
+class ContentHash
+{
+public:
+    static uint64_t Compute(const void *data, size_t size, uint64_t seed = 0);
+
+private:
+    static constexpr uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+    static constexpr uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+    static constexpr uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+    static constexpr uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+    static constexpr uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+    static uint64_t RotateLeft(uint64_t value, int bits) { return (value << bits) | (value >> (64 - bits)); }
+    static uint64_t Round(uint64_t accumulator, uint64_t input);
+    static uint64_t MergeRound(uint64_t hash, uint64_t accumulator);
+    static uint64_t Read64(const uint8_t *data);
+    static uint32_t Read32(const uint8_t *data);
+};
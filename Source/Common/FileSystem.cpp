@@ -64,6 +64,14 @@ std::string FileSystem::GetModelFile(const std::string &baseDirectory, const std
     return (std::filesystem::path(baseDirectory) / MODEL_DIRECTORY_NAME / modelFileName).string();
 }
 
+std::string FileSystem::GetModelCacheFile(const std::string &modelFilePath)
+{
+    // Cache files are flat in the cache directory, named after the hash of the full model path
+    std::string absolutePath = std::filesystem::absolute(modelFilePath).string();
+    std::string cacheFileName = std::to_string(std::hash<std::string>()(absolutePath)) + ".mesh";
+    return (baseDirectory / CACHE_DIRECTORY_NAME / MODEL_DIRECTORY_NAME / cacheFileName).string();
+}
+
 std::string FileSystem::GetSettingsFile()
 {
     return (baseDirectory / SETTINGS_FILE_NAME).string();
@@ -74,6 +82,33 @@ std::string FileSystem::GetTextureFile(const std::string &baseDirectory, const s
     return (std::filesystem::path(baseDirectory) / TEXTURE_DIRECTORY_NAME / textureFileName).string();
 }
 
+std::string FileSystem::GetCompressedTextureFile(
+    const std::string &baseDirectory,
+    const std::string &textureFileName,
+    bool compressionSupported)
+{
+    std::filesystem::path textureFilePath = GetTextureFile(baseDirectory, textureFileName);
+    if (!compressionSupported)
+    {
+        return textureFilePath.string();
+    }
+    std::filesystem::path compressedFilePath = textureFilePath;
+    compressedFilePath.replace_extension(COMPRESSED_TEXTURE_EXTENSION);
+
+    std::error_code fileError;
+    auto compressedModifiedTime = std::filesystem::last_write_time(compressedFilePath, fileError);
+    if (fileError)
+    {
+        return textureFilePath.string();
+    }
+    auto textureModifiedTime = std::filesystem::last_write_time(textureFilePath, fileError);
+    if (!fileError && textureModifiedTime > compressedModifiedTime)
+    {
+        return textureFilePath.string();
+    }
+    return compressedFilePath.string();
+}
+
 std::string FileSystem::GetVehicleFile(const std::string &vehicleBaseDirectory)
 {
     return (std::filesystem::path(vehicleBaseDirectory) / VEHICLE_FILE_NAME).string();
@@ -11,6 +11,7 @@ public:
     static constexpr char *SETTINGS_FILE_NAME = "settings.json";
     static constexpr char *VEHICLE_FILE_NAME = "vehicle.json";
 
+    static constexpr char *CACHE_DIRECTORY_NAME = "cache";
     static constexpr char *FONT_DIRECTORY_NAME = "fonts";
     static constexpr char *HEIGHT_MAP_DIRECTORY_NAME = "heightmaps";
     static constexpr char *MAP_DIRECTORY_NAME = "maps";
@@ -20,6 +21,8 @@ public:
     static constexpr char *TEXTURE_DIRECTORY_NAME = "textures";
     static constexpr char *VEHICLE_DIRECTORY_NAME = "vehicles";
 
+    static constexpr char *COMPRESSED_TEXTURE_EXTENSION = ".dds";
+
     static std::string MainDirectory();
 
     static std::string MapDirectory();
@@ -32,8 +35,15 @@ public:
     static std::string GetRoadObjectFile(const std::string &objectFileName);
     static std::string GetStaticObjectFile(const std::string &objectFileName);
     static std::string GetModelFile(const std::string &baseDirectory, const std::string &modelFileName);
+    static std::string GetModelCacheFile(const std::string &modelFilePath);
     static std::string GetSettingsFile();
     static std::string GetTextureFile(const std::string &baseDirectory, const std::string &textureFileName);
+    // Prefers the block compressed DDS file next to the texture, unless it is older than the texture
+    // or the device cannot sample block compressed formats
+    static std::string GetCompressedTextureFile(
+        const std::string &baseDirectory,
+        const std::string &textureFileName,
+        bool compressionSupported);
     static std::string GetVehicleFile(const std::string &vehicleBaseDirectory);
 
 private:
@@ -26,6 +26,8 @@ void ConfigReader::RegisterConfigMapping()
     JsonParser::RegisterMapper(&StaticObjectConfig::name, "name");
     JsonParser::RegisterMapper(&StaticObjectConfig::mesh, "mesh");
     JsonParser::RegisterMapper(&StaticObjectConfig::material, "material");
+    JsonParser::RegisterMapper(&StaticObjectConfig::occluder, "occluder");
+    JsonParser::RegisterMapper(&StaticObjectConfig::occludee, "occludee");
 
     JsonParser::RegisterMapper(&RoadMeshInfo::startPosition, "startPosition");
     JsonParser::RegisterMapper(&RoadMeshInfo::startTextureCoord, "startTextureCoord");
@@ -33,8 +35,13 @@ void ConfigReader::RegisterConfigMapping()
     JsonParser::RegisterMapper(&RoadMeshInfo::endTextureCoord, "endTextureCoord");
     JsonParser::RegisterMapper(&RoadMeshInfo::material, "material");
 
+    JsonParser::RegisterMapper(&RoadLaneConfig::offset, "offset");
+    JsonParser::RegisterMapper(&RoadLaneConfig::width, "width");
+    JsonParser::RegisterMapper(&RoadLaneConfig::forward, "forward");
+
     JsonParser::RegisterMapper(&RoadObjectConfig::name, "name");
     JsonParser::RegisterMapper(&RoadObjectConfig::meshes, "meshes");
+    JsonParser::RegisterMapper(&RoadObjectConfig::lanes, "lanes");
 
     JsonParser::RegisterMapper(&EntityConfig::id, "id");
     JsonParser::RegisterMapper(&EntityConfig::position, "position");
@@ -100,12 +107,20 @@ void ConfigReader::RegisterConfigMapping()
     JsonParser::RegisterMapper(&GraphicsSettings::maxViewableDistance, "maxViewableDistance");
     JsonParser::RegisterMapper(&GraphicsSettings::screenWidth, "screenWidth");
     JsonParser::RegisterMapper(&GraphicsSettings::screenHeight, "screenHeight");
+    JsonParser::RegisterMapper(&GraphicsSettings::usePackedVertices, "usePackedVertices");
+    JsonParser::RegisterMapper(&GraphicsSettings::useGpuCulling, "useGpuCulling");
+    JsonParser::RegisterMapper(&GraphicsSettings::gpuMemoryBudgetMB, "gpuMemoryBudgetMB");
+    JsonParser::RegisterMapper(&GraphicsSettings::renderWorkerCount, "renderWorkerCount");
+    JsonParser::RegisterMapper(&GraphicsSettings::useOcclusionCulling, "useOcclusionCulling");
 
     JsonParser::RegisterMapper(&ControlSettings::cameraMovementSpeed, "cameraMovementSpeed");
     JsonParser::RegisterMapper(&ControlSettings::cameraAngleChangeSensitivity, "cameraAngleChangeSensitivity");
     JsonParser::RegisterMapper(&ControlSettings::cameraZoomSensitivity, "cameraZoomSensitivity");
 
     JsonParser::RegisterMapper(&MapLoadSettings::maxAdjacentBlocks, "maxAdjacentBlocks");
+    JsonParser::RegisterMapper(&MapLoadSettings::roadMaxSegmentAngle, "roadMaxSegmentAngle");
+    JsonParser::RegisterMapper(&MapLoadSettings::roadMaxChordalError, "roadMaxChordalError");
+    JsonParser::RegisterMapper(&MapLoadSettings::meshLodTriangleRatios, "meshLodTriangleRatios");
 
     JsonParser::RegisterMapper(&GameSettings::generalSettings, "generalSettings");
     JsonParser::RegisterMapper(&GameSettings::controlSettings, "controlSettings");
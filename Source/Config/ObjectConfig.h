@@ -20,10 +20,20 @@ struct RoadMeshInfo
     MaterialConfig material;
 };
 
+// Lateral offset of the lane center from the road reference line, and whether
+// the lane runs in the same direction as the road was laid
+struct RoadLaneConfig
+{
+    float offset;
+    float width;
+    bool forward;
+};
+
 struct RoadObjectConfig
 {
     std::string name;
     std::vector<RoadMeshInfo> meshes;
+    std::vector<RoadLaneConfig> lanes;
 };
 
 struct StaticObjectConfig
@@ -31,4 +41,8 @@ struct StaticObjectConfig
     std::string name;
     std::string mesh;
     MaterialConfig material;
+    // Hides the objects behind it in the occlusion culling, for large closed meshes such as buildings
+    bool occluder = false;
+    // Culled when hidden behind the occluders, disabled for the objects seen through the gaps between them
+    bool occludee = true;
 };
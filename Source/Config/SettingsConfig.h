@@ -2,6 +2,7 @@
 
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 struct KeyBindings
 {
@@ -28,11 +29,27 @@ struct GraphicsSettings
     int maxViewableDistance;
     int screenWidth;
     int screenHeight;
+    // Draw static meshes with the 16-byte PackedVertex instead of the full precision Vertex
+    bool usePackedVertices = false;
+    // Cull the static meshes against the view frustum with a compute shader and draw them with indirect draws,
+    // they are culled on the CPU when disabled or not supported by the device
+    bool useGpuCulling = true;
+    // Caps the GPU memory budget to simulate a device with less memory, the budget of the device is used when 0
+    int gpuMemoryBudgetMB = 0;
+    // Threads recording the draw commands, one less than the hardware threads when 0
+    int renderWorkerCount = 0;
+    // Cull the static meshes hidden behind the occluders of the map, from a depth buffer rendered on the CPU
+    bool useOcclusionCulling = true;
 };
 
 struct MapLoadSettings
 {
     int maxAdjacentBlocks;
+    // Road tessellation, a curve is split until both limits are satisfied
+    float roadMaxSegmentAngle = 5.0f;
+    float roadMaxChordalError = 0.02f;
+    // Static object levels of detail, as ratios of the full detail triangle count
+    std::vector<float> meshLodTriangleRatios = { 0.5f, 0.25f, 0.1f };
 };
 
 struct GameSettings
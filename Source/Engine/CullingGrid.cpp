@@ -0,0 +1,246 @@
+#include <cmath>
+
+#include "CullingGrid.h"
+
+CullingGrid::CullingGrid()
+    : stats{}
+{
+}
+
+CullingGrid::~CullingGrid()
+{
+}
+
+void CullingGrid::Insert(uint32_t id, const BoundingBox &box)
+{
+    if (locations.count(id) > 0)
+    {
+        Update(id, box);
+        return;
+    }
+
+    uint64_t cellKey = GetCellKey(box);
+    auto [cellIterator, created] = cells.try_emplace(cellKey);
+    Cell &cell = cellIterator->second;
+    if (created || cell.ids.empty())
+    {
+        cell.bounds = box;
+    }
+    else if (!cell.boundsOutdated)
+    {
+        cell.bounds.min = glm::min(cell.bounds.min, box.min);
+        cell.bounds.max = glm::max(cell.bounds.max, box.max);
+    }
+
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    locations[id] = { cellKey, static_cast<uint32_t>(cell.ids.size()) };
+    cell.ids.push_back(id);
+    cell.centerX.push_back(center.x);
+    cell.centerY.push_back(center.y);
+    cell.centerZ.push_back(center.z);
+    cell.extentX.push_back(extent.x);
+    cell.extentY.push_back(extent.y);
+    cell.extentZ.push_back(extent.z);
+    cell.visible.push_back(1);
+}
+
+void CullingGrid::Update(uint32_t id, const BoundingBox &box)
+{
+    auto location = locations.find(id);
+    if (location == locations.end())
+    {
+        Insert(id, box);
+        return;
+    }
+
+    // Moved to another cell
+    uint64_t cellKey = GetCellKey(box);
+    if (cellKey != location->second.cellKey)
+    {
+        Remove(id);
+        Insert(id, box);
+        return;
+    }
+
+    Cell &cell = cells[cellKey];
+    uint32_t index = location->second.index;
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    cell.centerX[index] = center.x;
+    cell.centerY[index] = center.y;
+    cell.centerZ[index] = center.z;
+    cell.extentX[index] = extent.x;
+    cell.extentY[index] = extent.y;
+    cell.extentZ[index] = extent.z;
+    cell.boundsOutdated = true;
+}
+
+void CullingGrid::Remove(uint32_t id)
+{
+    auto location = locations.find(id);
+    if (location == locations.end())
+    {
+        return;
+    }
+
+    auto cellIterator = cells.find(location->second.cellKey);
+    Cell &cell = cellIterator->second;
+    uint32_t index = location->second.index;
+    uint32_t lastIndex = static_cast<uint32_t>(cell.ids.size() - 1);
+    locations.erase(location);
+
+    // The last entity of the cell takes the place of the removed one
+    if (index != lastIndex)
+    {
+        cell.ids[index] = cell.ids[lastIndex];
+        cell.centerX[index] = cell.centerX[lastIndex];
+        cell.centerY[index] = cell.centerY[lastIndex];
+        cell.centerZ[index] = cell.centerZ[lastIndex];
+        cell.extentX[index] = cell.extentX[lastIndex];
+        cell.extentY[index] = cell.extentY[lastIndex];
+        cell.extentZ[index] = cell.extentZ[lastIndex];
+        cell.visible[index] = cell.visible[lastIndex];
+        locations[cell.ids[index]].index = index;
+    }
+    cell.ids.pop_back();
+    cell.centerX.pop_back();
+    cell.centerY.pop_back();
+    cell.centerZ.pop_back();
+    cell.extentX.pop_back();
+    cell.extentY.pop_back();
+    cell.extentZ.pop_back();
+    cell.visible.pop_back();
+
+    if (cell.ids.empty())
+    {
+        cells.erase(cellIterator);
+    }
+    else
+    {
+        cell.boundsOutdated = true;
+    }
+}
+
+void CullingGrid::Clear()
+{
+    cells.clear();
+    locations.clear();
+    stats = {};
+}
+
+void CullingGrid::Cull(
+    const std::array<glm::vec4, Frustum::PLANE_COUNT> &planes,
+    std::vector<std::pair<uint32_t, bool>> &visibilityChanges)
+{
+    stats = {};
+    stats.cellCount = static_cast<uint32_t>(cells.size());
+    for (auto &[cellKey, cell] : cells)
+    {
+        if (cell.boundsOutdated)
+        {
+            UpdateCellBounds(cell);
+        }
+
+        uint32_t entityCount = static_cast<uint32_t>(cell.ids.size());
+        if (!Frustum::IntersectsBox(planes, cell.bounds))
+        {
+            SetCellVisibility(cell, false, visibilityChanges);
+            stats.culledCount += entityCount;
+            stats.culledCellCount++;
+            continue;
+        }
+        if (Frustum::ContainsBox(planes, cell.bounds))
+        {
+            SetCellVisibility(cell, true, visibilityChanges);
+            stats.visibleCount += entityCount;
+            continue;
+        }
+
+        intersects.resize(entityCount);
+        uint32_t visibleCount = Frustum::IntersectBoxes(
+            planes,
+            cell.centerX.data(),
+            cell.centerY.data(),
+            cell.centerZ.data(),
+            cell.extentX.data(),
+            cell.extentY.data(),
+            cell.extentZ.data(),
+            entityCount,
+            intersects.data());
+        for (uint32_t i = 0; i < entityCount; i++)
+        {
+            if (cell.visible[i] != intersects[i])
+            {
+                cell.visible[i] = intersects[i];
+                visibilityChanges.push_back({ cell.ids[i], intersects[i] != 0 });
+            }
+        }
+        stats.visibleCount += visibleCount;
+        stats.culledCount += entityCount - visibleCount;
+    }
+}
+
+bool CullingGrid::IsVisible(uint32_t id) const
+{
+    auto location = locations.find(id);
+    if (location == locations.end())
+    {
+        return false;
+    }
+    return cells.at(location->second.cellKey).visible[location->second.index] != 0;
+}
+
+void CullingGrid::GetVisibleIds(std::vector<uint32_t> &visibleIds) const
+{
+    for (const auto &[cellKey, cell] : cells)
+    {
+        for (size_t i = 0; i < cell.ids.size(); i++)
+        {
+            if (cell.visible[i])
+            {
+                visibleIds.push_back(cell.ids[i]);
+            }
+        }
+    }
+}
+
+uint64_t CullingGrid::GetCellKey(const BoundingBox &box)
+{
+    // The Y axis points up, the cells are laid out along X and Z
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    int32_t cellX = static_cast<int32_t>(std::floor(center.x / CELL_SIZE));
+    int32_t cellZ = static_cast<int32_t>(std::floor(center.z / CELL_SIZE));
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellZ);
+}
+
+void CullingGrid::UpdateCellBounds(Cell &cell)
+{
+    glm::vec3 minPosition(cell.centerX[0] - cell.extentX[0], cell.centerY[0] - cell.extentY[0], cell.centerZ[0] - cell.extentZ[0]);
+    glm::vec3 maxPosition(cell.centerX[0] + cell.extentX[0], cell.centerY[0] + cell.extentY[0], cell.centerZ[0] + cell.extentZ[0]);
+    for (size_t i = 1; i < cell.ids.size(); i++)
+    {
+        glm::vec3 center(cell.centerX[i], cell.centerY[i], cell.centerZ[i]);
+        glm::vec3 extent(cell.extentX[i], cell.extentY[i], cell.extentZ[i]);
+        minPosition = glm::min(minPosition, center - extent);
+        maxPosition = glm::max(maxPosition, center + extent);
+    }
+    cell.bounds = { minPosition, maxPosition };
+    cell.boundsOutdated = false;
+}
+
+void CullingGrid::SetCellVisibility(
+    Cell &cell,
+    bool visible,
+    std::vector<std::pair<uint32_t, bool>> &visibilityChanges)
+{
+    uint8_t value = visible ? 1 : 0;
+    for (size_t i = 0; i < cell.ids.size(); i++)
+    {
+        if (cell.visible[i] != value)
+        {
+            cell.visible[i] = value;
+            visibilityChanges.push_back({ cell.ids[i], visible });
+        }
+    }
+}
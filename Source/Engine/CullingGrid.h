@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+// Bounds of the entities grouped by the cell of a horizontal grid their centers are in, so that the frustum culling
+// rejects or accepts the whole cell before testing its entities, and only tests the entities of the cells crossing it.
+// The bounds of each cell are kept as arrays of centers and extents so that its entities are tested four at a time
+class CullingGrid
+{
+public:
+    // A quarter of the side of a map block, so that the cells next to the camera are still culled
+    static constexpr float CELL_SIZE = 250.0f;
+
+    struct Stats
+    {
+        uint32_t visibleCount;
+        uint32_t culledCount;
+        uint32_t cellCount;
+        // Cells rejected without testing their entities
+        uint32_t culledCellCount;
+    };
+
+    CullingGrid();
+    ~CullingGrid();
+
+    // World space bounds, the entity is visible until the next culling
+    void Insert(uint32_t id, const BoundingBox &box);
+    void Update(uint32_t id, const BoundingBox &box);
+    void Remove(uint32_t id);
+    void Clear();
+
+    // Returns the entities whose visibility changed since the last culling, with their new visibility
+    void Cull(
+        const std::array<glm::vec4, Frustum::PLANE_COUNT> &planes,
+        std::vector<std::pair<uint32_t, bool>> &visibilityChanges);
+
+    // Visible at the last culling
+    bool IsVisible(uint32_t id) const;
+    void GetVisibleIds(std::vector<uint32_t> &visibleIds) const;
+    Stats GetStats() const { return stats; }
+
+private:
+    struct Cell
+    {
+        BoundingBox bounds;
+        // The bounds only grow as entities are added, they are computed again after a removal
+        bool boundsOutdated;
+        std::vector<uint32_t> ids;
+        std::vector<float> centerX;
+        std::vector<float> centerY;
+        std::vector<float> centerZ;
+        std::vector<float> extentX;
+        std::vector<float> extentY;
+        std::vector<float> extentZ;
+        std::vector<uint8_t> visible;
+    };
+
+    struct Location
+    {
+        uint64_t cellKey;
+        uint32_t index;
+    };
+
+    static uint64_t GetCellKey(const BoundingBox &box);
+    void UpdateCellBounds(Cell &cell);
+    void SetCellVisibility(Cell &cell, bool visible, std::vector<std::pair<uint32_t, bool>> &visibilityChanges);
+
+    std::unordered_map<uint64_t, Cell> cells;
+    std::unordered_map<uint32_t, Location> locations;
+    // Result of the test of the entities of one cell
+    std::vector<uint8_t> intersects;
+    Stats stats;
+};
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <fstream>
+
+#include "DDSFile.h"
+
+bool DDSFile::Read(
+    const std::string &filename,
+    ImageFormat &format,
+    uint32_t &width,
+    uint32_t &height,
+    std::vector<ImageMipLevel> &mipLevels,
+    std::vector<uint8_t> &data)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    uint32_t magic = 0;
+    Header header{};
+    file.read(reinterpret_cast<char *>(&magic), sizeof(uint32_t));
+    file.read(reinterpret_cast<char *>(&header), sizeof(Header));
+    if (!file
+        || magic != MAGIC
+        || header.size != HEADER_SIZE
+        || header.pixelFormat.size != PIXEL_FORMAT_SIZE
+        || !(header.pixelFormat.flags & PIXEL_FORMAT_FLAGS_FOURCC)
+        || header.width == 0
+        || header.height == 0)
+    {
+        return false;
+    }
+
+    switch (header.pixelFormat.fourCC)
+    {
+    case FOURCC_DXT1:
+        format = ImageFormat::BC1;
+        break;
+    case FOURCC_DXT5:
+        format = ImageFormat::BC3;
+        break;
+    case FOURCC_ATI2:
+    case FOURCC_BC5U:
+        format = ImageFormat::BC5;
+        break;
+    case FOURCC_DX10:
+    {
+        HeaderDX10 headerDX10{};
+        file.read(reinterpret_cast<char *>(&headerDX10), sizeof(HeaderDX10));
+        if (!file
+            || headerDX10.resourceDimension != DX10_RESOURCE_DIMENSION_TEXTURE2D
+            || headerDX10.arraySize > 1)
+        {
+            return false;
+        }
+
+        switch (headerDX10.dxgiFormat)
+        {
+        case DXGI_FORMAT_BC1_UNORM:
+        case DXGI_FORMAT_BC1_UNORM_SRGB:
+            format = ImageFormat::BC1;
+            break;
+        case DXGI_FORMAT_BC3_UNORM:
+        case DXGI_FORMAT_BC3_UNORM_SRGB:
+            format = ImageFormat::BC3;
+            break;
+        case DXGI_FORMAT_BC5_UNORM:
+            format = ImageFormat::BC5;
+            break;
+        case DXGI_FORMAT_BC7_UNORM:
+        case DXGI_FORMAT_BC7_UNORM_SRGB:
+            format = ImageFormat::BC7;
+            break;
+        default:
+            return false;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    width = header.width;
+    height = header.height;
+    uint32_t mipLevelCount = (header.flags & HEADER_FLAGS_MIP_MAP_COUNT) ? std::max(header.mipMapCount, 1U) : 1U;
+
+    mipLevels.clear();
+    size_t dataSize = 0;
+    uint32_t mipWidth = width, mipHeight = height;
+    for (uint32_t level = 0; level < mipLevelCount; level++)
+    {
+        ImageMipLevel mipLevel{};
+        mipLevel.width = mipWidth;
+        mipLevel.height = mipHeight;
+        mipLevel.offset = dataSize;
+        mipLevel.size = GetMipLevelSize(format, mipWidth, mipHeight);
+        mipLevels.push_back(mipLevel);
+
+        dataSize += mipLevel.size;
+        if (mipWidth == 1 && mipHeight == 1)
+        {
+            break;
+        }
+        mipWidth = std::max(mipWidth / 2, 1U);
+        mipHeight = std::max(mipHeight / 2, 1U);
+    }
+
+    data.resize(dataSize);
+    file.read(reinterpret_cast<char *>(data.data()), dataSize);
+    return static_cast<bool>(file);
+}
+
+bool DDSFile::Write(
+    const std::string &filename,
+    ImageFormat format,
+    uint32_t width,
+    uint32_t height,
+    const std::vector<ImageMipLevel> &mipLevels,
+    const std::vector<uint8_t> &data)
+{
+    if (format == ImageFormat::Uncompressed || mipLevels.empty())
+    {
+        return false;
+    }
+
+    Header header{};
+    header.size = HEADER_SIZE;
+    header.flags = HEADER_FLAGS_CAPS | HEADER_FLAGS_HEIGHT | HEADER_FLAGS_WIDTH
+        | HEADER_FLAGS_PIXEL_FORMAT | HEADER_FLAGS_MIP_MAP_COUNT | HEADER_FLAGS_LINEAR_SIZE;
+    header.height = height;
+    header.width = width;
+    header.pitchOrLinearSize = static_cast<uint32_t>(mipLevels[0].size);
+    header.mipMapCount = static_cast<uint32_t>(mipLevels.size());
+    header.pixelFormat.size = PIXEL_FORMAT_SIZE;
+    header.pixelFormat.flags = PIXEL_FORMAT_FLAGS_FOURCC;
+    header.caps = CAPS_TEXTURE | (mipLevels.size() > 1 ? CAPS_COMPLEX | CAPS_MIP_MAP : 0);
+
+    HeaderDX10 headerDX10{};
+    switch (format)
+    {
+    case ImageFormat::BC1:
+        header.pixelFormat.fourCC = FOURCC_DXT1;
+        break;
+    case ImageFormat::BC3:
+        header.pixelFormat.fourCC = FOURCC_DXT5;
+        break;
+    case ImageFormat::BC5:
+        header.pixelFormat.fourCC = FOURCC_ATI2;
+        break;
+    case ImageFormat::BC7:
+    default:
+        header.pixelFormat.fourCC = FOURCC_DX10;
+        headerDX10.dxgiFormat = DXGI_FORMAT_BC7_UNORM_SRGB;
+        headerDX10.resourceDimension = DX10_RESOURCE_DIMENSION_TEXTURE2D;
+        headerDX10.arraySize = 1;
+        break;
+    }
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    uint32_t magic = MAGIC;
+    file.write(reinterpret_cast<const char *>(&magic), sizeof(uint32_t));
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+    if (header.pixelFormat.fourCC == FOURCC_DX10)
+    {
+        file.write(reinterpret_cast<const char *>(&headerDX10), sizeof(HeaderDX10));
+    }
+    file.write(reinterpret_cast<const char *>(data.data()), data.size());
+    return static_cast<bool>(file);
+}
+
+uint32_t DDSFile::GetBlockSize(ImageFormat format)
+{
+    return format == ImageFormat::BC1 ? 8 : 16;
+}
+
+size_t DDSFile::GetMipLevelSize(ImageFormat format, uint32_t width, uint32_t height)
+{
+    // Every format here stores 4x4 texel blocks, partial blocks at the edges are padded
+    size_t blocksWide = std::max((width + 3) / 4, 1U);
+    size_t blocksHigh = std::max((height + 3) / 4, 1U);
+    return blocksWide * blocksHigh * GetBlockSize(format);
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Image.h"
+
+// Reads and writes block compressed DDS files, only 2D textures with a full or partial mip chain are supported
+// The legacy header is used for BC1, BC3 and BC5, and the DX10 extended header for BC7
+class DDSFile
+{
+public:
+    static constexpr const char *FILE_EXTENSION = ".dds";
+
+    static bool Read(
+        const std::string &filename,
+        ImageFormat &format,
+        uint32_t &width,
+        uint32_t &height,
+        std::vector<ImageMipLevel> &mipLevels,
+        std::vector<uint8_t> &data);
+    static bool Write(
+        const std::string &filename,
+        ImageFormat format,
+        uint32_t width,
+        uint32_t height,
+        const std::vector<ImageMipLevel> &mipLevels,
+        const std::vector<uint8_t> &data);
+
+    static uint32_t GetBlockSize(ImageFormat format);
+    static size_t GetMipLevelSize(ImageFormat format, uint32_t width, uint32_t height);
+
+private:
+    static constexpr uint32_t MAGIC = 0x20534444; // "DDS "
+    static constexpr uint32_t HEADER_SIZE = 124;
+    static constexpr uint32_t PIXEL_FORMAT_SIZE = 32;
+
+    static constexpr uint32_t HEADER_FLAGS_CAPS = 0x1;
+    static constexpr uint32_t HEADER_FLAGS_HEIGHT = 0x2;
+    static constexpr uint32_t HEADER_FLAGS_WIDTH = 0x4;
+    static constexpr uint32_t HEADER_FLAGS_PIXEL_FORMAT = 0x1000;
+    static constexpr uint32_t HEADER_FLAGS_MIP_MAP_COUNT = 0x20000;
+    static constexpr uint32_t HEADER_FLAGS_LINEAR_SIZE = 0x80000;
+    static constexpr uint32_t PIXEL_FORMAT_FLAGS_FOURCC = 0x4;
+    static constexpr uint32_t CAPS_COMPLEX = 0x8;
+    static constexpr uint32_t CAPS_TEXTURE = 0x1000;
+    static constexpr uint32_t CAPS_MIP_MAP = 0x400000;
+
+    static constexpr uint32_t FOURCC_DXT1 = 0x31545844;
+    static constexpr uint32_t FOURCC_DXT5 = 0x35545844;
+    static constexpr uint32_t FOURCC_ATI2 = 0x32495441;
+    static constexpr uint32_t FOURCC_BC5U = 0x55354342;
+    static constexpr uint32_t FOURCC_DX10 = 0x30315844;
+
+    // DXGI_FORMAT values of the DX10 header
+    static constexpr uint32_t DXGI_FORMAT_BC1_UNORM = 71;
+    static constexpr uint32_t DXGI_FORMAT_BC1_UNORM_SRGB = 72;
+    static constexpr uint32_t DXGI_FORMAT_BC3_UNORM = 77;
+    static constexpr uint32_t DXGI_FORMAT_BC3_UNORM_SRGB = 78;
+    static constexpr uint32_t DXGI_FORMAT_BC5_UNORM = 83;
+    static constexpr uint32_t DXGI_FORMAT_BC7_UNORM = 98;
+    static constexpr uint32_t DXGI_FORMAT_BC7_UNORM_SRGB = 99;
+    static constexpr uint32_t DX10_RESOURCE_DIMENSION_TEXTURE2D = 3;
+
+    struct PixelFormat
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t fourCC;
+        uint32_t rgbBitCount;
+        uint32_t rBitMask;
+        uint32_t gBitMask;
+        uint32_t bBitMask;
+        uint32_t aBitMask;
+    };
+
+    struct Header
+    {
+        uint32_t size;
+        uint32_t flags;
+        uint32_t height;
+        uint32_t width;
+        uint32_t pitchOrLinearSize;
+        uint32_t depth;
+        uint32_t mipMapCount;
+        uint32_t reserved1[11];
+        PixelFormat pixelFormat;
+        uint32_t caps;
+        uint32_t caps2;
+        uint32_t caps3;
+        uint32_t caps4;
+        uint32_t reserved2;
+    };
+
+    struct HeaderDX10
+    {
+        uint32_t dxgiFormat;
+        uint32_t resourceDimension;
+        uint32_t miscFlag;
+        uint32_t arraySize;
+        uint32_t miscFlags2;
+    };
+};
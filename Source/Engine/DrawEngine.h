@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 class Camera;
 struct CubeMap;
 struct EntityTransformation;
@@ -8,6 +10,89 @@ struct LineSegmentVertex;
 struct Terrain;
 struct ScreenMesh;
 
+struct TextureResidencyStats
+{
+    uint32_t streamedTextureCount;
+    // Streamed textures with fewer mip levels resident than the camera needs
+    uint32_t pendingTextureCount;
+    uint64_t residentMemorySize;
+    // Approximate texture memory if every mip level was resident
+    uint64_t fullMemorySize;
+    // Device local memory used by the whole renderer, against the budget the textures are downgraded to stay under
+    uint64_t deviceMemoryUsage;
+    uint64_t deviceMemoryBudget;
+};
+
+// Loads that found the same content already on the GPU, and the size that was not uploaded again
+struct ResourceSharingStats
+{
+    uint32_t sharedMeshCount;
+    uint64_t savedMeshSize;
+    uint32_t sharedTextureCount;
+    uint64_t savedTextureSize;
+};
+
+// Draws of the last submitted frame, entities sharing a mesh and texture are instances of one draw
+struct DrawCallStats
+{
+    uint32_t drawCount;
+    uint32_t instanceCount;
+    // Binds of the last submitted frame, the entity draws are sorted so that they share as many as they can
+    uint32_t pipelineBindCount;
+    uint32_t descriptorSetBindCount;
+    // Time taken by the last recording of the commands, they are only recorded again when the scene changes,
+    // and only for the layers (entities, terrain, screen objects...) whose data changed
+    float recordTimeMs;
+    uint32_t recordedLayerCount;
+    // Recordings since the start
+    uint64_t recordCount;
+    // Threads recording the commands, from command pools of their own which are created once for each frame buffer
+    uint32_t renderWorkerCount;
+    uint32_t commandPoolCount;
+    uint32_t secondaryCommandBufferCount;
+};
+
+// Pooled vertex and index buffers the meshes are suballocated from
+struct GeometryBufferStats
+{
+    uint32_t meshCount;
+    uint32_t bufferCount;
+    uint64_t usedSize;
+    uint64_t capacity;
+    // Share of the free space outside of the largest free range of each buffer
+    float fragmentation;
+    // Vertex and index buffer binds of the last submitted frame
+    uint32_t bindCount;
+};
+
+// Resources released by the unloads and destroyed once the frames using them are complete
+struct DeferredDestructionStats
+{
+    uint32_t pendingCount;
+    // Waits for the whole device to be idle since the start, which the unloads no longer need
+    uint64_t deviceWaitCount;
+};
+
+// Culling of the last frame on the CPU, the entities are still counted by the frustum test of the CPU
+// when they are culled on the GPU
+struct CullingStats
+{
+    uint32_t visibleEntityCount;
+    uint32_t culledEntityCount;
+    // Cells of entities rejected without testing the entities
+    uint32_t culledCellCount;
+    uint32_t cellCount;
+    uint32_t visibleTerrainCount;
+    uint32_t culledTerrainCount;
+    // Occluders rendered into the depth buffer of the occlusion culling, and the entities found behind them
+    uint32_t occluderCount;
+    uint32_t occluderTriangleCount;
+    uint32_t occludedEntityCount;
+    float occlusionTimeMs;
+    // Including the occlusion culling
+    float cullTimeMs;
+};
+
 class DrawEngine
 {
 public:
@@ -15,6 +100,16 @@ public:
 
     virtual void Destroy() = 0;
     virtual void DrawFrame() = 0;
+    // Triangles in the last submitted frame, after the level of detail selection
+    virtual uint64_t GetSubmittedTriangleCount() const = 0;
+    virtual TextureResidencyStats GetTextureResidencyStats() const = 0;
+    virtual ResourceSharingStats GetResourceSharingStats() const = 0;
+    virtual GeometryBufferStats GetGeometryBufferStats() const = 0;
+    virtual DrawCallStats GetDrawCallStats() const = 0;
+    virtual DeferredDestructionStats GetDeferredDestructionStats() const = 0;
+    virtual CullingStats GetCullingStats() const = 0;
+    // Whether the DDS textures can be loaded, only known once initialized
+    virtual bool SupportsBlockCompressedTextures() const = 0;
     virtual void Initialize() = 0;
     virtual void LoadCubeMap(CubeMap &cubemap) = 0;
     virtual void LoadEntity(const Entity &entity) = 0;
@@ -22,6 +22,9 @@ struct Entity
     glm::vec3 translation;
     glm::vec3 rotation;
     glm::vec3 scale;
+    // Roles in the occlusion culling
+    bool isOccluder = false;
+    bool isOccludee = true;
 };
 
 enum class EntityTransformationMode
@@ -0,0 +1,138 @@
+#include <cmath>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE 1
+#include <xmmintrin.h>
+#else
+#define FRUSTUM_USE_SSE 0
+#endif
+
+#include "Frustum.h"
+
+std::array<glm::vec4, Frustum::PLANE_COUNT> Frustum::ExtractPlanes(const glm::mat4 &viewProjection)
+{
+    // Rows of the matrix, glm stores the columns
+    glm::mat4 rows = glm::transpose(viewProjection);
+    std::array<glm::vec4, PLANE_COUNT> planes =
+    {
+        rows[3] + rows[0],
+        rows[3] - rows[0],
+        rows[3] + rows[1],
+        rows[3] - rows[1],
+        rows[2],
+        rows[3] - rows[2]
+    };
+    for (glm::vec4 &plane : planes)
+    {
+        plane /= glm::length(glm::vec3(plane));
+    }
+    return planes;
+}
+
+BoundingBox Frustum::TransformBox(const BoundingBox &box, const glm::mat4 &transformation)
+{
+    // The extent along each world axis is the sum of the model extents projected on it
+    glm::vec3 center = glm::vec3(transformation * glm::vec4((box.min + box.max) * 0.5f, 1.0f));
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    glm::mat3 absoluteRotation = glm::mat3(transformation);
+    for (int column = 0; column < 3; column++)
+    {
+        absoluteRotation[column] = glm::abs(absoluteRotation[column]);
+    }
+    glm::vec3 worldExtent = absoluteRotation * extent;
+    return { center - worldExtent, center + worldExtent };
+}
+
+bool Frustum::IntersectsBox(const std::array<glm::vec4, PLANE_COUNT> &planes, const BoundingBox &box)
+{
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    for (const glm::vec4 &plane : planes)
+    {
+        glm::vec3 normal = glm::vec3(plane);
+        if (glm::dot(normal, center) + plane.w < -glm::dot(glm::abs(normal), extent))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::ContainsBox(const std::array<glm::vec4, PLANE_COUNT> &planes, const BoundingBox &box)
+{
+    glm::vec3 center = (box.min + box.max) * 0.5f;
+    glm::vec3 extent = (box.max - box.min) * 0.5f;
+    for (const glm::vec4 &plane : planes)
+    {
+        glm::vec3 normal = glm::vec3(plane);
+        if (glm::dot(normal, center) + plane.w < glm::dot(glm::abs(normal), extent))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t Frustum::IntersectBoxes(
+    const std::array<glm::vec4, PLANE_COUNT> &planes,
+    const float *centerX,
+    const float *centerY,
+    const float *centerZ,
+    const float *extentX,
+    const float *extentY,
+    const float *extentZ,
+    uint32_t count,
+    uint8_t *intersects)
+{
+    uint32_t intersectCount = 0;
+    uint32_t i = 0;
+#if FRUSTUM_USE_SSE
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(centerX + i);
+        __m128 y = _mm_loadu_ps(centerY + i);
+        __m128 z = _mm_loadu_ps(centerZ + i);
+        __m128 ex = _mm_loadu_ps(extentX + i);
+        __m128 ey = _mm_loadu_ps(extentY + i);
+        __m128 ez = _mm_loadu_ps(extentZ + i);
+        // All bits set in the lanes of the boxes not yet outside of a plane
+        __m128 inside = _mm_cmpeq_ps(zero, zero);
+        for (const glm::vec4 &plane : planes)
+        {
+            __m128 distance = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            __m128 radius = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::abs(plane.x))), _mm_mul_ps(ey, _mm_set1_ps(std::abs(plane.y)))),
+                _mm_mul_ps(ez, _mm_set1_ps(std::abs(plane.z))));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (uint32_t lane = 0; lane < 4; lane++)
+        {
+            intersects[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+        intersectCount += (mask & 1) + ((mask >> 1) & 1) + ((mask >> 2) & 1) + ((mask >> 3) & 1);
+    }
+#endif
+    // Remaining boxes, or every box without SSE
+    for (; i < count; i++)
+    {
+        bool inside = true;
+        for (const glm::vec4 &plane : planes)
+        {
+            float distance = centerX[i] * plane.x + centerY[i] * plane.y + centerZ[i] * plane.z + plane.w;
+            float radius = extentX[i] * std::abs(plane.x) + extentY[i] * std::abs(plane.y) + extentZ[i] * std::abs(plane.z);
+            if (distance + radius < 0.0f)
+            {
+                inside = false;
+                break;
+            }
+        }
+        intersects[i] = inside ? 1 : 0;
+        intersectCount += inside ? 1 : 0;
+    }
+    return intersectCount;
+}
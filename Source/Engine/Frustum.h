@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+
+#include <glm/glm.hpp>
+
+// Axis aligned box
+struct BoundingBox
+{
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+// Planes of the view frustum, the normals point inside and a point is inside a plane when dot(normal, point) + w >= 0
+class Frustum
+{
+public:
+    static constexpr uint32_t PLANE_COUNT = 6;
+
+    // The projection maps the depth to [0, 1], as the projection of the Vulkan draw engine does
+    static std::array<glm::vec4, PLANE_COUNT> ExtractPlanes(const glm::mat4 &viewProjection);
+    // World space box around the model space box once transformed
+    static BoundingBox TransformBox(const BoundingBox &box, const glm::mat4 &transformation);
+    static bool IntersectsBox(const std::array<glm::vec4, PLANE_COUNT> &planes, const BoundingBox &box);
+    static bool ContainsBox(const std::array<glm::vec4, PLANE_COUNT> &planes, const BoundingBox &box);
+    // Tests the boxes given by their centers and half extents, four at a time with SSE when the compiler targets it.
+    // Writes 1 for each box intersecting the frustum and 0 otherwise, and returns the number of intersecting boxes
+    static uint32_t IntersectBoxes(
+        const std::array<glm::vec4, PLANE_COUNT> &planes,
+        const float *centerX,
+        const float *centerY,
+        const float *centerZ,
+        const float *extentX,
+        const float *extentY,
+        const float *extentZ,
+        uint32_t count,
+        uint8_t *intersects);
+};
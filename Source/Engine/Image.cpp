@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <filesystem>
 #include <stdio.h>
 #include <stdexcept>
 
@@ -7,13 +8,16 @@
 #define STB_IMAGE_RESIZE_IMPLEMENTATION
 #include <stb_image_resize.h>
 
+#include "Common/ContentHash.h"
+#include "DDSFile.h"
 #include "Image.h"
 
 Image::Image()
     : pixels(nullptr),
       width(0),
       height(0),
-      channels(0)
+      channels(0),
+      format(ImageFormat::Uncompressed)
 {
 }
 
@@ -29,7 +33,8 @@ Image::Image(const std::string &path, ImageColor color)
 Image::Image(const uint8_t *srcPixels, int width, int height)
     : width(width),
       height(height),
-      channels(4)
+      channels(4),
+      format(ImageFormat::Uncompressed)
 {
     uint32_t pixelSize = channels * width * height;
     pixels = (uint8_t *) malloc(pixelSize);
@@ -49,7 +54,11 @@ void Image::Destroy()
     if (pixels)
     {
         stbi_image_free(pixels);
+        pixels = nullptr;
     }
+    format = ImageFormat::Uncompressed;
+    mipLevels.clear();
+    compressedData.clear();
 }
 
 std::vector<uint8_t> Image::GetDominantColor() const
@@ -70,10 +79,46 @@ std::vector<uint8_t> Image::GetDominantColor() const
     return dominantColor;
 }
 
+size_t Image::GetDataSize() const
+{
+    if (IsCompressed())
+    {
+        return compressedData.size();
+    }
+    return pixels ? static_cast<size_t>(width) * height * channels : 0;
+}
+
+uint64_t Image::ComputeContentHash(uint64_t seed) const
+{
+    // The layout is part of the content, the same bytes may describe a differently shaped image
+    int32_t header[4] = { static_cast<int32_t>(format), width, height, channels };
+    uint64_t hash = ContentHash::Compute(header, sizeof(header), seed);
+    if (IsCompressed())
+    {
+        return ContentHash::Compute(compressedData.data(), compressedData.size(), hash);
+    }
+    return ContentHash::Compute(pixels, GetDataSize(), hash);
+}
+
 bool Image::Load(const std::string &path, ImageColor color)
 {
     Destroy();
 
+    if (std::filesystem::path(path).extension() == DDSFile::FILE_EXTENSION)
+    {
+        uint32_t imageWidth = 0, imageHeight = 0;
+        if (!DDSFile::Read(path, format, imageWidth, imageHeight, mipLevels, compressedData))
+        {
+            format = ImageFormat::Uncompressed;
+            return false;
+        }
+        this->width = static_cast<int>(imageWidth);
+        this->height = static_cast<int>(imageHeight);
+        this->channels = 4;
+        this->path = path;
+        return true;
+    }
+
     this->pixels = stbi_load(
         path.c_str(),
         &width,
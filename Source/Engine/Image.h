@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -9,6 +10,25 @@ enum class ImageColor
     Grayscale
 };
 
+// Block compressed formats are only loaded from DDS files, with their whole mip chain
+enum class ImageFormat
+{
+    Uncompressed,
+    BC1,
+    BC3,
+    BC5,
+    BC7
+};
+
+struct ImageMipLevel
+{
+    uint32_t width;
+    uint32_t height;
+    // Location of the level in the compressed data
+    size_t offset;
+    size_t size;
+};
+
 class Image
 {
 public:
@@ -21,6 +41,15 @@ public:
     int GetWidth() const { return width; }
     int GetHeight() const { return height; }
     uint8_t *GetPixels() const { return pixels; }
+    ImageFormat GetFormat() const { return format; }
+    bool IsCompressed() const { return format != ImageFormat::Uncompressed; }
+    const std::vector<ImageMipLevel> &GetMipLevels() const { return mipLevels; }
+    const std::vector<uint8_t> &GetCompressedData() const { return compressedData; }
+    // Size of the pixels, or of the compressed data with all of its levels
+    size_t GetDataSize() const;
+    // Identifies images with the same content, whatever file they were loaded from
+    uint64_t ComputeContentHash(uint64_t seed = 0) const;
+    // DDS files are loaded as compressed images, and have no pixels
     bool Load(const std::string &path, ImageColor color);
 
 private:
@@ -32,4 +61,8 @@ private:
     int channels;
 
     uint8_t *pixels;
+
+    ImageFormat format;
+    std::vector<ImageMipLevel> mipLevels;
+    std::vector<uint8_t> compressedData;
 };
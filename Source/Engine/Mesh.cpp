@@ -1,14 +1,45 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <thread>
 #include <unordered_map>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "Common/FileSystem.h"
 #include "Common/Logger.h"
 #include "Mesh.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
 #include "Vertex.h"
 
+static constexpr uint32_t MESH_IMPORT_FLAGS = aiProcess_Triangulate | aiProcess_JoinIdenticalVertices;
+
 MeshLoader::MeshLoader()
+    : lodTriangleRatios(),
+      cacheStats()
+{
+}
+
+MeshLoader::MeshLoader(const std::vector<float> &lodTriangleRatios)
+    : lodTriangleRatios(),
+      cacheStats()
 {
+    // A ratio of 0 or less has no triangles to target, and 1 or more is the full detail mesh again
+    for (float ratio : lodTriangleRatios)
+    {
+        if (ratio > 0.0f && ratio < 1.0f)
+        {
+            this->lodTriangleRatios.push_back(ratio);
+        }
+        else
+        {
+            Logger::Log(LogLevel::Warning, "Ignoring mesh level of detail triangle ratio {}, must be between 0 and 1", ratio);
+        }
+    }
 }
 
 MeshLoader::~MeshLoader()
@@ -17,15 +48,212 @@ MeshLoader::~MeshLoader()
 
 bool MeshLoader::LoadFromFile(const std::string filename, Mesh &mesh)
 {
-    std::unordered_map<Vertex, uint32_t> uniqueVertices;
+    // The cache is invalidated whenever the model file is modified, or the import flags are changed
+    std::error_code fileError;
+    uint64_t sourceFileSize = std::filesystem::file_size(filename, fileError);
+    if (fileError)
+    {
+        return ImportFromFile(filename, mesh);
+    }
+    auto sourceModifiedTime = std::filesystem::last_write_time(filename, fileError);
+    if (fileError)
+    {
+        return ImportFromFile(filename, mesh);
+    }
+
+    MeshCacheHeader header{};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.importFlags = MESH_IMPORT_FLAGS;
+    header.sourceFileSize = sourceFileSize;
+    header.sourceModifiedTime = static_cast<int64_t>(sourceModifiedTime.time_since_epoch().count());
+    // FNV-1a of the ratios, so that changing the level of detail settings regenerates the cache
+    header.lodRatiosHash = 2166136261u;
+    for (float ratio : lodTriangleRatios)
+    {
+        const uint8_t *ratioBytes = reinterpret_cast<const uint8_t *>(&ratio);
+        for (size_t i = 0; i < sizeof(float); i++)
+        {
+            header.lodRatiosHash = (header.lodRatiosHash ^ ratioBytes[i]) * 16777619u;
+        }
+    }
+
+    std::string cacheFilePath = FileSystem::GetModelCacheFile(filename);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    if (ReadFromCache(cacheFilePath, header, mesh))
+    {
+        float readTimeMs = std::chrono::duration<float, std::milli>(
+            std::chrono::high_resolution_clock::now() - startTime).count();
+        cacheStats.hits++;
+        cacheStats.importTimeSavedMs += std::max(0.0f, header.importTimeMs - readTimeMs);
+        Logger::Log(LogLevel::Debug, "Mesh cache hit for {} in {:.2f} ms "
+            "(running totals: {} hits, {} misses, {:.1f} ms import time saved)",
+            filename, readTimeMs, cacheStats.hits, cacheStats.misses, cacheStats.importTimeSavedMs);
+        return true;
+    }
+
+    if (!ImportFromFile(filename, mesh))
+    {
+        return false;
+    }
+
+    header.importTimeMs = std::chrono::duration<float, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    header.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    header.indexCount = static_cast<uint32_t>(mesh.indices.size());
+    header.lodCount = static_cast<uint32_t>(mesh.lods.size());
+    WriteToCache(cacheFilePath, header, mesh);
+
+    cacheStats.misses++;
+    Logger::Log(LogLevel::Debug, "Mesh cache miss for {}, imported in {:.2f} ms (running totals: {} hits, {} misses)",
+        filename, header.importTimeMs, cacheStats.hits, cacheStats.misses);
+    return true;
+}
+
+bool MeshLoader::ReadFromCache(const std::string &filename, MeshCacheHeader &expectedHeader, Mesh &mesh)
+{
+    std::ifstream cacheFile(filename, std::ios::binary | std::ios::ate);
+    if (!cacheFile.is_open())
+    {
+        return false;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(cacheFile.tellg());
+    cacheFile.seekg(0);
+
+    MeshCacheHeader header{};
+    cacheFile.read(reinterpret_cast<char *>(&header), sizeof(MeshCacheHeader));
+    if (!cacheFile
+        || header.magic != expectedHeader.magic
+        || header.version != expectedHeader.version
+        || header.importFlags != expectedHeader.importFlags
+        || header.lodRatiosHash != expectedHeader.lodRatiosHash
+        || header.sourceFileSize != expectedHeader.sourceFileSize
+        || header.sourceModifiedTime != expectedHeader.sourceModifiedTime)
+    {
+        return false;
+    }
+
+    // The counts are checked against the file size before anything is allocated,
+    // so that a corrupt file falls back to the import instead of a huge allocation
+    uint64_t meshSize = sizeof(MeshCacheHeader)
+        + sizeof(Vertex) * static_cast<uint64_t>(header.vertexCount)
+        + sizeof(uint32_t) * static_cast<uint64_t>(header.indexCount);
+    uint64_t lodHeadersSize = (sizeof(uint32_t) + sizeof(float)) * static_cast<uint64_t>(header.lodCount);
+    if (meshSize + lodHeadersSize > fileSize)
+    {
+        Logger::Log(LogLevel::Warning, "Mesh cache file {} is truncated", filename);
+        return false;
+    }
+
+    std::vector<Vertex> vertices(header.vertexCount);
+    std::vector<uint32_t> indices(header.indexCount);
+    cacheFile.read(reinterpret_cast<char *>(vertices.data()), sizeof(Vertex) * vertices.size());
+    cacheFile.read(reinterpret_cast<char *>(indices.data()), sizeof(uint32_t) * indices.size());
+    if (!cacheFile)
+    {
+        Logger::Log(LogLevel::Warning, "Mesh cache file {} is truncated", filename);
+        return false;
+    }
+
+    // The indices are uploaded as is, an index past the vertices would read the next mesh of the vertex arena
+    auto areIndicesInRange = [&header](const std::vector<uint32_t> &checkedIndices)
+    {
+        return checkedIndices.empty()
+            || *std::max_element(checkedIndices.begin(), checkedIndices.end()) < header.vertexCount;
+    };
+    if (!areIndicesInRange(indices))
+    {
+        Logger::Log(LogLevel::Warning, "Mesh cache file {} has indices out of range", filename);
+        return false;
+    }
+
+    std::vector<MeshLod> lods(header.lodCount);
+    for (MeshLod &lod : lods)
+    {
+        uint32_t lodIndexCount = 0;
+        cacheFile.read(reinterpret_cast<char *>(&lodIndexCount), sizeof(uint32_t));
+        cacheFile.read(reinterpret_cast<char *>(&lod.error), sizeof(float));
+        if (!cacheFile || lodIndexCount > header.indexCount)
+        {
+            cacheFile.setstate(std::ios::failbit);
+            break;
+        }
+        lod.indices.resize(lodIndexCount);
+        cacheFile.read(reinterpret_cast<char *>(lod.indices.data()), sizeof(uint32_t) * lod.indices.size());
+        if (!cacheFile)
+        {
+            break;
+        }
+        if (!areIndicesInRange(lod.indices))
+        {
+            Logger::Log(LogLevel::Warning, "Mesh cache file {} has level of detail indices out of range", filename);
+            return false;
+        }
+    }
+    if (!cacheFile)
+    {
+        Logger::Log(LogLevel::Warning, "Mesh cache file {} is truncated", filename);
+        return false;
+    }
+
+    mesh.vertices = std::move(vertices);
+    mesh.indices = std::move(indices);
+    mesh.lods = std::move(lods);
+    ComputeBounds(mesh);
+    ComputeUVDensity(mesh);
+    expectedHeader.importTimeMs = header.importTimeMs;
+    return true;
+}
+
+void MeshLoader::WriteToCache(const std::string &filename, const MeshCacheHeader &header, const Mesh &mesh)
+{
+    std::error_code fileError;
+    std::filesystem::create_directories(std::filesystem::path(filename).parent_path(), fileError);
+
+    // Write into a temporary file first, since another loader could be reading the same model
+    std::string temporaryFilename = filename + "."
+        + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    {
+        std::ofstream cacheFile(temporaryFilename, std::ios::binary | std::ios::trunc);
+        if (!cacheFile.is_open())
+        {
+            Logger::Log(LogLevel::Warning, "Failed to create mesh cache file {}", temporaryFilename);
+            return;
+        }
+
+        cacheFile.write(reinterpret_cast<const char *>(&header), sizeof(MeshCacheHeader));
+        cacheFile.write(reinterpret_cast<const char *>(mesh.vertices.data()), sizeof(Vertex) * mesh.vertices.size());
+        cacheFile.write(reinterpret_cast<const char *>(mesh.indices.data()), sizeof(uint32_t) * mesh.indices.size());
+        for (const MeshLod &lod : mesh.lods)
+        {
+            uint32_t lodIndexCount = static_cast<uint32_t>(lod.indices.size());
+            cacheFile.write(reinterpret_cast<const char *>(&lodIndexCount), sizeof(uint32_t));
+            cacheFile.write(reinterpret_cast<const char *>(&lod.error), sizeof(float));
+            cacheFile.write(reinterpret_cast<const char *>(lod.indices.data()), sizeof(uint32_t) * lod.indices.size());
+        }
+        if (!cacheFile)
+        {
+            Logger::Log(LogLevel::Warning, "Failed to write mesh cache file {}", temporaryFilename);
+            cacheFile.close();
+            std::filesystem::remove(temporaryFilename, fileError);
+            return;
+        }
+    }
+
+    std::filesystem::rename(temporaryFilename, filename, fileError);
+    if (fileError)
+    {
+        std::filesystem::remove(temporaryFilename, fileError);
+    }
+}
+
+bool MeshLoader::ImportFromFile(const std::string &filename, Mesh &mesh)
+{
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
 
     Assimp::Importer importer;
-    const aiScene *scene = importer.ReadFile(
-        filename,
-        aiProcess_Triangulate
-        | aiProcess_JoinIdenticalVertices);
+    const aiScene *scene = importer.ReadFile(filename, MESH_IMPORT_FLAGS);
     if (scene == nullptr)
     {
         const char *importError = importer.GetErrorString();
@@ -76,8 +304,86 @@ bool MeshLoader::LoadFromFile(const std::string filename, Mesh &mesh)
         indexOffset += numVertices;
     } 
 
-    mesh.vertices = vertices;
-    mesh.indices = indices;
+    // Optimized before caching, so that the cost is only paid once per model file
+    MeshOptimizationStats statsBefore = MeshOptimizer::Analyze(vertices, indices, sizeof(uint32_t));
+    MeshOptimizer::Optimize(vertices, indices);
+    MeshOptimizationStats statsAfter = MeshOptimizer::Analyze(
+        vertices, indices, MeshOptimizer::GetIndexSize(vertices.size()));
+    MeshOptimizer::LogStats(filename, statsBefore, statsAfter);
+
+    mesh.vertices = std::move(vertices);
+    mesh.indices = std::move(indices);
+    GenerateLods(filename, mesh);
+    ComputeBounds(mesh);
+    ComputeUVDensity(mesh);
 
     return true;
 }
+
+void MeshLoader::GenerateLods(const std::string &filename, Mesh &mesh)
+{
+    mesh.lods.clear();
+    size_t previousIndexCount = mesh.indices.size();
+    for (float ratio : lodTriangleRatios)
+    {
+        // Always simplified from the full detail mesh, so that the errors do not add up across levels
+        size_t targetIndexCount = static_cast<size_t>(mesh.indices.size() / 3 * ratio) * 3;
+        MeshLod lod{};
+        lod.indices = MeshSimplifier::Simplify(mesh.vertices, mesh.indices, targetIndexCount, lod.error);
+        if (lod.indices.empty()
+            || lod.indices.size() > previousIndexCount * (1.0f - MIN_LOD_REDUCTION))
+        {
+            break;
+        }
+
+        MeshOptimizer::OptimizeVertexCache(lod.indices, mesh.vertices.size());
+        previousIndexCount = lod.indices.size();
+        Logger::Log(LogLevel::Debug, "Mesh {} level of detail {}: {} of {} triangles, error {:.4f}",
+            filename, mesh.lods.size() + 1, lod.indices.size() / 3, mesh.indices.size() / 3, lod.error);
+        mesh.lods.push_back(std::move(lod));
+    }
+}
+
+void MeshLoader::ComputeBounds(Mesh &mesh)
+{
+    mesh.boundingCenter = glm::vec3(0.0f);
+    mesh.boundingRadius = 0.0f;
+    mesh.boundingMin = glm::vec3(0.0f);
+    mesh.boundingMax = glm::vec3(0.0f);
+    if (mesh.vertices.empty())
+    {
+        return;
+    }
+
+    // Centered on the bounding box, which is close enough for the level of detail distances
+    glm::vec3 minPosition = mesh.vertices[0].position;
+    glm::vec3 maxPosition = mesh.vertices[0].position;
+    for (const Vertex &vertex : mesh.vertices)
+    {
+        minPosition = glm::min(minPosition, vertex.position);
+        maxPosition = glm::max(maxPosition, vertex.position);
+    }
+    mesh.boundingMin = minPosition;
+    mesh.boundingMax = maxPosition;
+    mesh.boundingCenter = (minPosition + maxPosition) * 0.5f;
+    for (const Vertex &vertex : mesh.vertices)
+    {
+        mesh.boundingRadius = std::max(mesh.boundingRadius, glm::distance(mesh.boundingCenter, vertex.position));
+    }
+}
+
+void MeshLoader::ComputeUVDensity(Mesh &mesh)
+{
+    // Ratio of the texture and surface areas, so that the texel density of a texture on the mesh can be estimated
+    double uvArea = 0.0, surfaceArea = 0.0;
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+    {
+        const Vertex &v0 = mesh.vertices[mesh.indices[i]];
+        const Vertex &v1 = mesh.vertices[mesh.indices[i + 1]];
+        const Vertex &v2 = mesh.vertices[mesh.indices[i + 2]];
+        glm::vec2 uvEdge1 = v1.uv - v0.uv, uvEdge2 = v2.uv - v0.uv;
+        uvArea += 0.5 * std::abs(uvEdge1.x * uvEdge2.y - uvEdge1.y * uvEdge2.x);
+        surfaceArea += 0.5 * glm::length(glm::cross(v1.position - v0.position, v2.position - v0.position));
+    }
+    mesh.uvDensity = surfaceArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / surfaceArea)) : 0.0f;
+}
@@ -9,11 +9,28 @@
 class Image;
 struct Material;
 
+// Simplified level of detail, shares the vertices of the full detail mesh
+struct MeshLod
+{
+    std::vector<uint32_t> indices;
+    // Largest distance between the simplified and the full detail surface, in model units
+    float error;
+};
+
 struct Mesh
 {
     uint32_t id;
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    // Ordered from the most to the least detailed, empty if no levels of detail are generated
+    std::vector<MeshLod> lods;
+    // Bounding sphere and box in model space, computed by the loader
+    glm::vec3 boundingCenter;
+    float boundingRadius;
+    glm::vec3 boundingMin;
+    glm::vec3 boundingMax;
+    // Texture coordinate units per model unit, averaged over the surface, 0 when unknown
+    float uvDensity;
     std::shared_ptr<Material> material;
 };
 
@@ -24,13 +41,57 @@ struct ScreenMesh
     std::shared_ptr<Image> image;
 };
 
+struct MeshCacheStats
+{
+    uint32_t hits;
+    uint32_t misses;
+    // Sum of the original import times of the cache hits minus the time to read them
+    float importTimeSavedMs;
+};
+
 class MeshLoader
 {
 public:
     MeshLoader();
+    // Generates a level of detail for each ratio of the full detail triangle count
+    MeshLoader(const std::vector<float> &lodTriangleRatios);
     ~MeshLoader();
 
+    MeshCacheStats GetCacheStats() const { return cacheStats; }
+
     bool LoadFromFile(const std::string filename, Mesh &mesh);
 
+    // Also needed by the meshes generated at runtime, which are not loaded from files
+    static void ComputeBounds(Mesh &mesh);
+    static void ComputeUVDensity(Mesh &mesh);
+
 private:
+    // Bump whenever the cache layout or the import post-processing changes
+    static constexpr uint32_t CACHE_VERSION = 3;
+    static constexpr uint32_t CACHE_MAGIC = 0x4853454D;
+
+    struct MeshCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t importFlags;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t lodCount;
+        uint32_t lodRatiosHash;
+        float importTimeMs;
+        uint64_t sourceFileSize;
+        int64_t sourceModifiedTime;
+    };
+
+    // Stop adding levels of detail once a level removes less than this share of the triangles of the previous one
+    static constexpr float MIN_LOD_REDUCTION = 0.1f;
+
+    bool ImportFromFile(const std::string &filename, Mesh &mesh);
+    void GenerateLods(const std::string &filename, Mesh &mesh);
+    bool ReadFromCache(const std::string &filename, MeshCacheHeader &expectedHeader, Mesh &mesh);
+    void WriteToCache(const std::string &filename, const MeshCacheHeader &header, const Mesh &mesh);
+
+    std::vector<float> lodTriangleRatios;
+    MeshCacheStats cacheStats;
 };
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "Common/Logger.h"
+#include "MeshOptimizer.h"
+
+MeshOptimizationStats MeshOptimizer::Analyze(
+    const std::vector<Vertex> &vertices,
+    const std::vector<uint32_t> &indices,
+    uint32_t indexSize)
+{
+    MeshOptimizationStats stats{};
+    stats.indexBytes = static_cast<uint64_t>(indices.size()) * indexSize;
+
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertices.empty())
+    {
+        return stats;
+    }
+
+    // A vertex is in the FIFO cache when less than ANALYZE_CACHE_SIZE vertices were transformed after it
+    std::vector<uint32_t> cacheTimestamps(vertices.size(), 0);
+    uint32_t timestamp = ANALYZE_CACHE_SIZE + 1;
+    std::vector<int64_t> fetchCacheLines(FETCH_CACHE_LINES, -1);
+    std::vector<bool> referenced(vertices.size(), false);
+
+    uint32_t transformedVertices = 0,
+             uniqueVertices = 0;
+    uint64_t fetchedBytes = 0;
+    for (uint32_t index : indices)
+    {
+        if (!referenced[index])
+        {
+            referenced[index] = true;
+            uniqueVertices++;
+        }
+
+        if (timestamp - cacheTimestamps[index] <= ANALYZE_CACHE_SIZE)
+        {
+            continue;
+        }
+        cacheTimestamps[index] = timestamp++;
+        transformedVertices++;
+
+        // Every transformed vertex is fetched from memory, which may hit a line fetched by a nearby vertex
+        uint64_t startByte = static_cast<uint64_t>(index) * sizeof(Vertex);
+        uint64_t endByte = startByte + sizeof(Vertex);
+        for (uint64_t line = startByte / FETCH_CACHE_LINE_SIZE; line <= (endByte - 1) / FETCH_CACHE_LINE_SIZE; line++)
+        {
+            int64_t &cachedLine = fetchCacheLines[line % FETCH_CACHE_LINES];
+            if (cachedLine != static_cast<int64_t>(line))
+            {
+                cachedLine = static_cast<int64_t>(line);
+                fetchedBytes += FETCH_CACHE_LINE_SIZE;
+            }
+        }
+    }
+
+    stats.acmr = static_cast<float>(transformedVertices) / triangleCount;
+    stats.atvr = static_cast<float>(transformedVertices) / uniqueVertices;
+    stats.vertexFetchRatio = static_cast<float>(fetchedBytes) / (sizeof(Vertex) * vertices.size());
+    return stats;
+}
+
+void MeshOptimizer::Optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    // The order matters: the overdraw pass keeps the cache friendly clusters of the first pass,
+    // and the vertex fetch pass follows whatever triangle order is final
+    OptimizeVertexCache(indices, vertices.size());
+    OptimizeOverdraw(vertices, indices);
+    OptimizeVertexFetch(vertices, indices);
+}
+
+void MeshOptimizer::LogStats(const std::string &meshName, const MeshOptimizationStats &before, const MeshOptimizationStats &after)
+{
+    Logger::Log(LogLevel::Debug, "Optimized mesh {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}, "
+        "vertex fetch ratio {:.3f} -> {:.3f}, index memory {} -> {} bytes",
+        meshName, before.acmr, after.acmr, before.atvr, after.atvr,
+        before.vertexFetchRatio, after.vertexFetchRatio, before.indexBytes, after.indexBytes);
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Triangles adjacent to each vertex, the first remainingTriangles[v] entries are the ones not emitted yet
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (uint32_t index : indices)
+    {
+        remainingTriangles[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyOffsets[v + 1] = adjacencyOffsets[v] + remainingTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            adjacency[adjacencyFill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<int> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        vertexScores[v] = GetVertexScore(-1, remainingTriangles[v]);
+    }
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    int64_t bestTriangle = -1;
+    float bestScore = -std::numeric_limits<float>::max();
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        triangleScores[t] = vertexScores[indices[t * 3]]
+            + vertexScores[indices[t * 3 + 1]]
+            + vertexScores[indices[t * 3 + 2]];
+        if (triangleScores[t] > bestScore)
+        {
+            bestScore = triangleScores[t];
+            bestTriangle = static_cast<int64_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(VERTEX_CACHE_SIZE + 3);
+    newCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+    std::vector<uint32_t> optimizedIndices;
+    optimizedIndices.reserve(triangleCount * 3);
+    size_t scanPosition = 0;
+    while (optimizedIndices.size() < triangleCount * 3)
+    {
+        if (bestTriangle < 0)
+        {
+            // Nothing left around the cached vertices, continue from the input order
+            while (emitted[scanPosition])
+            {
+                scanPosition++;
+            }
+            bestTriangle = static_cast<int64_t>(scanPosition);
+        }
+
+        size_t triangle = static_cast<size_t>(bestTriangle);
+        emitted[triangle] = true;
+        newCache.clear();
+        for (size_t k = 0; k < 3; k++)
+        {
+            uint32_t vertex = indices[triangle * 3 + k];
+            optimizedIndices.push_back(vertex);
+
+            // Remove the triangle from the remaining adjacent triangles of the vertex
+            uint32_t *vertexTriangles = adjacency.data() + adjacencyOffsets[vertex];
+            uint32_t *lastTriangle = vertexTriangles + remainingTriangles[vertex] - 1;
+            uint32_t *found = std::find(vertexTriangles, lastTriangle + 1, static_cast<uint32_t>(triangle));
+            if (found <= lastTriangle)
+            {
+                std::swap(*found, *lastTriangle);
+                remainingTriangles[vertex]--;
+            }
+
+            if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+            {
+                newCache.push_back(vertex);
+            }
+        }
+        for (uint32_t vertex : cache)
+        {
+            if (std::find(newCache.begin(), newCache.end(), vertex) == newCache.end())
+            {
+                newCache.push_back(vertex);
+            }
+        }
+
+        // Vertices pushed out of the cache are rescored as well, before the cache is truncated
+        for (size_t i = 0; i < newCache.size(); i++)
+        {
+            uint32_t vertex = newCache[i];
+            int cachePosition = i < VERTEX_CACHE_SIZE ? static_cast<int>(i) : -1;
+            cachePositions[vertex] = cachePosition;
+
+            float score = GetVertexScore(cachePosition, remainingTriangles[vertex]);
+            float scoreDelta = score - vertexScores[vertex];
+            vertexScores[vertex] = score;
+            for (uint32_t j = 0; j < remainingTriangles[vertex]; j++)
+            {
+                triangleScores[adjacency[adjacencyOffsets[vertex] + j]] += scoreDelta;
+            }
+        }
+        if (newCache.size() > VERTEX_CACHE_SIZE)
+        {
+            newCache.resize(VERTEX_CACHE_SIZE);
+        }
+        std::swap(cache, newCache);
+
+        // Only the triangles around the cached vertices are candidates for the next one
+        bestTriangle = -1;
+        bestScore = -std::numeric_limits<float>::max();
+        for (uint32_t vertex : cache)
+        {
+            for (uint32_t j = 0; j < remainingTriangles[vertex]; j++)
+            {
+                uint32_t candidate = adjacency[adjacencyOffsets[vertex] + j];
+                if (triangleScores[candidate] > bestScore)
+                {
+                    bestScore = triangleScores[candidate];
+                    bestTriangle = candidate;
+                }
+            }
+        }
+    }
+
+    indices = std::move(optimizedIndices);
+}
+
+void MeshOptimizer::OptimizeOverdraw(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0)
+    {
+        return;
+    }
+
+    // Split the triangles into clusters where the FIFO cache starts over (all three vertices missed),
+    // so that reordering the clusters keeps the cache efficiency within each of them
+    std::vector<size_t> clusterStarts;
+    std::vector<uint32_t> cacheTimestamps(vertices.size(), 0);
+    uint32_t timestamp = ANALYZE_CACHE_SIZE + 1;
+    for (size_t t = 0; t < triangleCount; t++)
+    {
+        int misses = 0;
+        for (size_t k = 0; k < 3; k++)
+        {
+            uint32_t index = indices[t * 3 + k];
+            if (timestamp - cacheTimestamps[index] > ANALYZE_CACHE_SIZE)
+            {
+                cacheTimestamps[index] = timestamp++;
+                misses++;
+            }
+        }
+        if (t == 0 || misses == 3)
+        {
+            clusterStarts.push_back(t);
+        }
+    }
+    if (clusterStarts.size() < 2)
+    {
+        return;
+    }
+
+    glm::vec3 meshCentroid{ 0.0f };
+    float meshArea = 0.0f;
+    struct Cluster
+    {
+        size_t start;
+        size_t end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+    std::vector<Cluster> clusters(clusterStarts.size());
+    for (size_t c = 0; c < clusterStarts.size(); c++)
+    {
+        Cluster &cluster = clusters[c];
+        cluster.start = clusterStarts[c];
+        cluster.end = c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount;
+        cluster.centroid = glm::vec3{ 0.0f };
+        cluster.normal = glm::vec3{ 0.0f };
+
+        float clusterArea = 0.0f;
+        for (size_t t = cluster.start; t < cluster.end; t++)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+
+            cluster.centroid += (p0 + p1 + p2) * (area / 3.0f);
+            cluster.normal += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += cluster.centroid;
+        meshArea += clusterArea;
+        cluster.centroid = clusterArea > 0.0f ? cluster.centroid / clusterArea : vertices[indices[cluster.start * 3]].position;
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3{ 0.0f };
+
+    // Clusters facing away from the mesh center are more likely to occlude the others, so draw them first
+    for (Cluster &cluster : clusters)
+    {
+        float normalLength = glm::length(cluster.normal);
+        cluster.sortKey = normalLength > 0.0f
+            ? glm::dot(cluster.centroid - meshCentroid, cluster.normal / normalLength)
+            : 0.0f;
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster &a, const Cluster &b)
+        {
+            return a.sortKey > b.sortKey;
+        });
+
+    std::vector<uint32_t> sortedIndices;
+    sortedIndices.reserve(indices.size());
+    for (const Cluster &cluster : clusters)
+    {
+        sortedIndices.insert(sortedIndices.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    }
+    indices = std::move(sortedIndices);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices)
+{
+    // Store the vertices in the order they are first used, unreferenced vertices are dropped
+    std::vector<uint32_t> remap(vertices.size(), std::numeric_limits<uint32_t>::max());
+    std::vector<Vertex> reorderedVertices;
+    reorderedVertices.reserve(vertices.size());
+    for (uint32_t &index : indices)
+    {
+        if (remap[index] == std::numeric_limits<uint32_t>::max())
+        {
+            remap[index] = static_cast<uint32_t>(reorderedVertices.size());
+            reorderedVertices.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices = std::move(reorderedVertices);
+}
+
+float MeshOptimizer::GetVertexScore(int cachePosition, uint32_t remainingTriangles)
+{
+    if (remainingTriangles == 0)
+    {
+        return -1.0f;
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        // The vertices of the last triangle get a fixed score, so that the next triangle does not
+        // simply reuse the same edge and create long strips
+        if (cachePosition < 3)
+        {
+            score = LAST_TRIANGLE_SCORE;
+        }
+        else
+        {
+            float scale = 1.0f / (VERTEX_CACHE_SIZE - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, CACHE_DECAY_POWER);
+        }
+    }
+
+    // Boost vertices with few triangles left, so that they are finished off and leave the cache
+    score += VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -VALENCE_BOOST_POWER);
+    return score;
+}
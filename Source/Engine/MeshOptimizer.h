@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Vertex.h"
+
+struct MeshOptimizationStats
+{
+    // Average cache miss ratio, transformed vertices per triangle (0.5 is the best case for a grid)
+    float acmr;
+    // Average transform to vertex ratio, transformed vertices per unique vertex (1.0 is the best case)
+    float atvr;
+    // Bytes fetched through the vertex cache lines divided by the vertex buffer size (1.0 is the best case)
+    float vertexFetchRatio;
+    uint64_t indexBytes;
+};
+
+// Reorders the triangles and vertices of an indexed triangle list for the GPU,
+// only the order changes so the result renders exactly the same as the input
+class MeshOptimizer
+{
+public:
+    // Meshes with fewer vertices than this are drawn with 16-bit indices
+    static constexpr uint32_t MAX_16_BIT_INDEX_VERTICES = 65536;
+
+    static bool Use16BitIndices(size_t vertexCount) { return vertexCount < MAX_16_BIT_INDEX_VERTICES; }
+    static uint32_t GetIndexSize(size_t vertexCount) { return Use16BitIndices(vertexCount) ? 2 : 4; }
+
+    static MeshOptimizationStats Analyze(
+        const std::vector<Vertex> &vertices,
+        const std::vector<uint32_t> &indices,
+        uint32_t indexSize);
+    static void Optimize(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+    static void LogStats(const std::string &meshName, const MeshOptimizationStats &before, const MeshOptimizationStats &after);
+
+    static void OptimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+    static void OptimizeOverdraw(const std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+    static void OptimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+private:
+    // Post-transform cache model used when reordering (Forsyth's linear-speed vertex cache optimization)
+    static constexpr int VERTEX_CACHE_SIZE = 32;
+    static constexpr float CACHE_DECAY_POWER = 1.5f;
+    static constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    static constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    static constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    // FIFO cache used for the statistics, close to the hardware of the last decade
+    static constexpr int ANALYZE_CACHE_SIZE = 16;
+    // Direct-mapped cache used to estimate the vertex fetch ratio
+    static constexpr uint32_t FETCH_CACHE_LINE_SIZE = 64;
+    static constexpr uint32_t FETCH_CACHE_LINES = 256;
+
+    static float GetVertexScore(int cachePosition, uint32_t remainingTriangles);
+};
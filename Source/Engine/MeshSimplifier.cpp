@@ -0,0 +1,287 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+#include "MeshSimplifier.h"
+
+std::vector<uint32_t> MeshSimplifier::Simplify(
+    const std::vector<Vertex> &vertices,
+    const std::vector<uint32_t> &indices,
+    size_t targetIndexCount,
+    float &error)
+{
+    error = 0.0f;
+    std::vector<uint32_t> simplifiedIndices(indices);
+    size_t vertexCount = vertices.size();
+    if (simplifiedIndices.size() <= targetIndexCount || vertexCount == 0)
+    {
+        return simplifiedIndices;
+    }
+
+    // Vertices on open or non-manifold edges are locked, which also covers the texture and normal seams
+    // since the vertices are split there, so that the outline and the seams of the mesh stay intact
+    std::unordered_map<uint64_t, uint32_t> edgeTriangleCounts;
+    for (size_t i = 0; i < simplifiedIndices.size(); i += 3)
+    {
+        for (size_t k = 0; k < 3; k++)
+        {
+            uint32_t a = simplifiedIndices[i + k];
+            uint32_t b = simplifiedIndices[i + (k + 1) % 3];
+            uint64_t edgeKey = (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+            edgeTriangleCounts[edgeKey]++;
+        }
+    }
+    std::vector<bool> locked(vertexCount, false);
+    for (const auto &[edgeKey, triangleCount] : edgeTriangleCounts)
+    {
+        if (triangleCount != 2)
+        {
+            locked[static_cast<uint32_t>(edgeKey >> 32)] = true;
+            locked[static_cast<uint32_t>(edgeKey & 0xFFFFFFFF)] = true;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (size_t i = 0; i < simplifiedIndices.size(); i += 3)
+    {
+        Quadric planeQuadric = GetPlaneQuadric(
+            vertices[simplifiedIndices[i]].position,
+            vertices[simplifiedIndices[i + 1]].position,
+            vertices[simplifiedIndices[i + 2]].position);
+        for (size_t k = 0; k < 3; k++)
+        {
+            quadrics[simplifiedIndices[i + k]].Add(planeQuadric);
+        }
+    }
+
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint32_t> collapseTargets(vertexCount);
+    std::vector<float> collapseCosts(vertexCount);
+    std::vector<uint32_t> candidates;
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+
+    float maxCost = 0.0f;
+    for (int pass = 0; pass < MAX_PASSES && simplifiedIndices.size() > targetIndexCount; pass++)
+    {
+        size_t triangleCount = simplifiedIndices.size() / 3;
+
+        // Triangles around each vertex
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : simplifiedIndices)
+        {
+            adjacencyOffsets[index + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(simplifiedIndices.size());
+        std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                adjacency[adjacencyFill[simplifiedIndices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+            }
+        }
+
+        // Cheapest collapse of each vertex into one of its neighbors, the neighbor keeps its position
+        std::iota(collapseTargets.begin(), collapseTargets.end(), 0);
+        std::fill(collapseCosts.begin(), collapseCosts.end(), std::numeric_limits<float>::max());
+        for (size_t i = 0; i < simplifiedIndices.size(); i += 3)
+        {
+            for (size_t k = 0; k < 3; k++)
+            {
+                uint32_t a = simplifiedIndices[i + k];
+                uint32_t b = simplifiedIndices[i + (k + 1) % 3];
+                for (auto [from, to] : { std::make_pair(a, b), std::make_pair(b, a) })
+                {
+                    if (locked[from])
+                    {
+                        continue;
+                    }
+                    Quadric combined = quadrics[from];
+                    combined.Add(quadrics[to]);
+                    float cost = combined.Evaluate(vertices[to].position);
+                    if (cost < collapseCosts[from])
+                    {
+                        collapseCosts[from] = cost;
+                        collapseTargets[from] = to;
+                    }
+                }
+            }
+        }
+
+        candidates.clear();
+        for (uint32_t v = 0; v < vertexCount; v++)
+        {
+            if (collapseTargets[v] != v)
+            {
+                candidates.push_back(v);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b)
+            {
+                return collapseCosts[a] < collapseCosts[b];
+            });
+
+        // Each collapse removes about two triangles, and a vertex can only be part of
+        // one collapse per pass so that the flip checks see the current geometry
+        size_t collapsesWanted = (triangleCount - targetIndexCount / 3) / 2 + 1;
+        size_t collapses = 0;
+        std::iota(remap.begin(), remap.end(), 0);
+        std::fill(touched.begin(), touched.end(), false);
+        for (uint32_t collapsedVertex : candidates)
+        {
+            if (collapses >= collapsesWanted)
+            {
+                break;
+            }
+
+            uint32_t targetVertex = collapseTargets[collapsedVertex];
+            if (touched[collapsedVertex] || touched[targetVertex])
+            {
+                continue;
+            }
+
+            const uint32_t *vertexTriangles = adjacency.data() + adjacencyOffsets[collapsedVertex];
+            uint32_t vertexTriangleCount = adjacencyOffsets[collapsedVertex + 1] - adjacencyOffsets[collapsedVertex];
+            bool flips = false;
+            for (uint32_t j = 0; j < vertexTriangleCount && !flips; j++)
+            {
+                flips = FlipsTriangle(vertices, &simplifiedIndices[vertexTriangles[j] * 3], collapsedVertex, targetVertex);
+            }
+            if (flips)
+            {
+                continue;
+            }
+
+            remap[collapsedVertex] = targetVertex;
+            quadrics[targetVertex].Add(quadrics[collapsedVertex]);
+            maxCost = std::max(maxCost, collapseCosts[collapsedVertex]);
+            for (uint32_t j = 0; j < vertexTriangleCount; j++)
+            {
+                for (size_t k = 0; k < 3; k++)
+                {
+                    touched[simplifiedIndices[vertexTriangles[j] * 3 + k]] = true;
+                }
+            }
+            collapses++;
+        }
+
+        if (collapses == 0)
+        {
+            break;
+        }
+
+        size_t writeIndex = 0;
+        for (size_t i = 0; i < simplifiedIndices.size(); i += 3)
+        {
+            uint32_t a = remap[simplifiedIndices[i]],
+                     b = remap[simplifiedIndices[i + 1]],
+                     c = remap[simplifiedIndices[i + 2]];
+            if (a != b && b != c && a != c)
+            {
+                simplifiedIndices[writeIndex++] = a;
+                simplifiedIndices[writeIndex++] = b;
+                simplifiedIndices[writeIndex++] = c;
+            }
+        }
+        simplifiedIndices.resize(writeIndex);
+    }
+
+    error = std::sqrt(maxCost);
+    return simplifiedIndices;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric &other)
+{
+    a2 += other.a2;
+    b2 += other.b2;
+    c2 += other.c2;
+    ab += other.ab;
+    ac += other.ac;
+    bc += other.bc;
+    ad += other.ad;
+    bd += other.bd;
+    cd += other.cd;
+    d2 += other.d2;
+    weight += other.weight;
+}
+
+float MeshSimplifier::Quadric::Evaluate(const glm::vec3 &position) const
+{
+    if (weight <= 0.0f)
+    {
+        return 0.0f;
+    }
+
+    // Mean squared distance from the position to the planes
+    const float x = position.x, y = position.y, z = position.z;
+    float result = a2 * x * x + b2 * y * y + c2 * z * z
+        + 2.0f * (ab * x * y + ac * x * z + bc * y * z)
+        + 2.0f * (ad * x + bd * y + cd * z)
+        + d2;
+    return std::max(result, 0.0f) / weight;
+}
+
+MeshSimplifier::Quadric MeshSimplifier::GetPlaneQuadric(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2)
+{
+    Quadric quadric{};
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+    float length = glm::length(normal);
+    if (length == 0.0f)
+    {
+        return quadric;
+    }
+
+    float area = length * 0.5f;
+    normal /= length;
+    float d = -glm::dot(normal, p0);
+
+    quadric.a2 = normal.x * normal.x * area;
+    quadric.b2 = normal.y * normal.y * area;
+    quadric.c2 = normal.z * normal.z * area;
+    quadric.ab = normal.x * normal.y * area;
+    quadric.ac = normal.x * normal.z * area;
+    quadric.bc = normal.y * normal.z * area;
+    quadric.ad = normal.x * d * area;
+    quadric.bd = normal.y * d * area;
+    quadric.cd = normal.z * d * area;
+    quadric.d2 = d * d * area;
+    quadric.weight = area;
+    return quadric;
+}
+
+bool MeshSimplifier::FlipsTriangle(
+    const std::vector<Vertex> &vertices,
+    const uint32_t *triangle,
+    uint32_t collapsedVertex,
+    uint32_t targetVertex)
+{
+    // Triangles containing both vertices are removed by the collapse
+    if (triangle[0] == targetVertex || triangle[1] == targetVertex || triangle[2] == targetVertex)
+    {
+        return false;
+    }
+
+    glm::vec3 positions[3];
+    glm::vec3 collapsedPositions[3];
+    for (int k = 0; k < 3; k++)
+    {
+        positions[k] = vertices[triangle[k]].position;
+        collapsedPositions[k] = triangle[k] == collapsedVertex ? vertices[targetVertex].position : positions[k];
+    }
+
+    glm::vec3 normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+    glm::vec3 collapsedNormal = glm::cross(
+        collapsedPositions[1] - collapsedPositions[0],
+        collapsedPositions[2] - collapsedPositions[0]);
+    float lengths = glm::length(normal) * glm::length(collapsedNormal);
+    if (lengths == 0.0f)
+    {
+        return true;
+    }
+    return glm::dot(normal, collapsedNormal) < MIN_NORMAL_COSINE * lengths;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Vertex.h"
+
+// Quadric error edge-collapse simplification (Garland and Heckbert), only the indices are simplified
+// so that every level of detail can share the vertex buffer of the full detail mesh
+class MeshSimplifier
+{
+public:
+    // Returns the simplified indices, stops early when no more edges can be collapsed
+    // The error is the largest distance from a removed vertex to the surface it collapsed into
+    static std::vector<uint32_t> Simplify(
+        const std::vector<Vertex> &vertices,
+        const std::vector<uint32_t> &indices,
+        size_t targetIndexCount,
+        float &error);
+
+private:
+    static constexpr int MAX_PASSES = 100;
+    // Reject a collapse if it turns any triangle around by more than this (cosine of the angle)
+    static constexpr float MIN_NORMAL_COSINE = 0.2f;
+
+    // Symmetric 4x4 matrix of the plane equations around a vertex, weighted by triangle area
+    struct Quadric
+    {
+        float a2, b2, c2, ab, ac, bc, ad, bd, cd, d2;
+        float weight;
+
+        void Add(const Quadric &other);
+        float Evaluate(const glm::vec3 &position) const;
+    };
+
+    static Quadric GetPlaneQuadric(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2);
+    static bool FlipsTriangle(
+        const std::vector<Vertex> &vertices,
+        const uint32_t *triangle,
+        uint32_t collapsedVertex,
+        uint32_t targetVertex);
+};
@@ -0,0 +1,314 @@
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <execution>
+#include <numeric>
+
+#include "OcclusionCuller.h"
+
+OcclusionCuller::OcclusionCuller()
+    : viewProjection(1.0f),
+      stats{}
+{
+    uint32_t width = DEPTH_BUFFER_WIDTH, height = DEPTH_BUFFER_HEIGHT;
+    while (true)
+    {
+        depthLevelSizes.push_back({ width, height });
+        depthLevels.emplace_back(width * height, 1.0f);
+        if (width == 1 && height == 1)
+        {
+            break;
+        }
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void OcclusionCuller::AddOccluder(
+    uint64_t occluderId,
+    std::shared_ptr<const OccluderMesh> mesh,
+    const glm::mat4 &transformation,
+    const BoundingBox &bounds)
+{
+    occluders[occluderId] = { std::move(mesh), transformation, bounds };
+}
+
+void OcclusionCuller::UpdateOccluder(uint64_t occluderId, const glm::mat4 &transformation, const BoundingBox &bounds)
+{
+    auto occluder = occluders.find(occluderId);
+    if (occluder != occluders.end())
+    {
+        occluder->second.transformation = transformation;
+        occluder->second.bounds = bounds;
+    }
+}
+
+void OcclusionCuller::RemoveOccluder(uint64_t occluderId)
+{
+    occluders.erase(occluderId);
+}
+
+void OcclusionCuller::Render(
+    const glm::mat4 &viewProjection,
+    const std::array<glm::vec4, Frustum::PLANE_COUNT> &planes,
+    const glm::vec3 &cameraPosition)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    this->viewProjection = viewProjection;
+    stats = {};
+
+    // The nearest occluders hide the most, distances are measured to the closest point of their bounds
+    renderedOccluders.clear();
+    for (const auto &[occluderId, occluder] : occluders)
+    {
+        if (Frustum::IntersectsBox(planes, occluder.bounds))
+        {
+            glm::vec3 closestPoint = glm::clamp(cameraPosition, occluder.bounds.min, occluder.bounds.max);
+            renderedOccluders.push_back({ glm::distance(closestPoint, cameraPosition), &occluder });
+        }
+    }
+    if (renderedOccluders.size() > MAX_OCCLUDER_COUNT)
+    {
+        std::nth_element(
+            renderedOccluders.begin(),
+            renderedOccluders.begin() + MAX_OCCLUDER_COUNT,
+            renderedOccluders.end(),
+            [](const auto &a, const auto &b) { return a.first < b.first; });
+        renderedOccluders.resize(MAX_OCCLUDER_COUNT);
+    }
+
+    occluderTriangles.resize(renderedOccluders.size());
+    std::vector<uint32_t> occluderIndices(renderedOccluders.size());
+    std::iota(occluderIndices.begin(), occluderIndices.end(), 0);
+    std::for_each(
+        std::execution::par,
+        occluderIndices.begin(),
+        occluderIndices.end(),
+        [&](uint32_t occluderIndex)
+        {
+            SetUpTriangles(*renderedOccluders[occluderIndex].second, occluderTriangles[occluderIndex]);
+        });
+
+    std::vector<float> &depthBuffer = depthLevels[0];
+    std::fill(depthBuffer.begin(), depthBuffer.end(), 1.0f);
+    std::vector<uint32_t> bandRows;
+    for (uint32_t row = 0; row < DEPTH_BUFFER_HEIGHT; row += BAND_HEIGHT)
+    {
+        bandRows.push_back(row);
+    }
+    // Each band only writes its own rows, so no two threads write the same depth
+    std::for_each(
+        std::execution::par,
+        bandRows.begin(),
+        bandRows.end(),
+        [&](uint32_t firstRow)
+        {
+            RasterizeBand(firstRow, std::min(firstRow + BAND_HEIGHT, DEPTH_BUFFER_HEIGHT) - 1);
+        });
+    BuildDepthLevels();
+
+    stats.occluderCount = static_cast<uint32_t>(renderedOccluders.size());
+    for (uint32_t i = 0; i < renderedOccluders.size(); i++)
+    {
+        stats.triangleCount += static_cast<uint32_t>(occluderTriangles[i].size());
+    }
+    stats.renderTimeMs = std::chrono::duration<float, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+bool OcclusionCuller::IsOccluded(const BoundingBox &bounds) const
+{
+    glm::vec2 minScreen(FLT_MAX), maxScreen(-FLT_MAX);
+    float minDepth = FLT_MAX;
+    for (uint32_t corner = 0; corner < 8; corner++)
+    {
+        glm::vec4 position(
+            corner & 1 ? bounds.max.x : bounds.min.x,
+            corner & 2 ? bounds.max.y : bounds.min.y,
+            corner & 4 ? bounds.max.z : bounds.min.z,
+            1.0f);
+        glm::vec4 clipPosition = viewProjection * position;
+        if (clipPosition.w < MIN_CLIP_W)
+        {
+            return false;
+        }
+        glm::vec3 ndcPosition = glm::vec3(clipPosition) / clipPosition.w;
+        glm::vec2 screenPosition(
+            (ndcPosition.x * 0.5f + 0.5f) * DEPTH_BUFFER_WIDTH,
+            (ndcPosition.y * 0.5f + 0.5f) * DEPTH_BUFFER_HEIGHT);
+        minScreen = glm::min(minScreen, screenPosition);
+        maxScreen = glm::max(maxScreen, screenPosition);
+        minDepth = std::min(minDepth, ndcPosition.z);
+    }
+
+    // Boxes partly off screen are not tested, the frustum culling already handles them
+    if (minScreen.x < 0.0f || minScreen.y < 0.0f
+        || maxScreen.x >= DEPTH_BUFFER_WIDTH || maxScreen.y >= DEPTH_BUFFER_HEIGHT)
+    {
+        return false;
+    }
+
+    // Coarsest level where the box still covers only a few tiles, each tile covers the pixels the box touches
+    uint32_t minX = static_cast<uint32_t>(minScreen.x), maxX = static_cast<uint32_t>(maxScreen.x);
+    uint32_t minY = static_cast<uint32_t>(minScreen.y), maxY = static_cast<uint32_t>(maxScreen.y);
+    uint32_t level = 0;
+    while (level + 1 < depthLevels.size()
+        && std::max(maxX - minX, maxY - minY) >= MAX_TESTED_TILE_SPAN)
+    {
+        level++;
+        minX /= 2;
+        maxX /= 2;
+        minY /= 2;
+        maxY /= 2;
+    }
+
+    const std::vector<float> &depths = depthLevels[level];
+    uint32_t levelWidth = depthLevelSizes[level].first, levelHeight = depthLevelSizes[level].second;
+    for (uint32_t y = minY; y <= std::min(maxY, levelHeight - 1); y++)
+    {
+        for (uint32_t x = minX; x <= std::min(maxX, levelWidth - 1); x++)
+        {
+            if (depths[y * levelWidth + x] >= minDepth)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void OcclusionCuller::SetUpTriangles(const Occluder &occluder, std::vector<ScreenTriangle> &triangles) const
+{
+    triangles.clear();
+    const std::vector<glm::vec3> &positions = occluder.mesh->positions;
+    const std::vector<uint32_t> &indices = occluder.mesh->indices;
+    glm::mat4 transformation = viewProjection * occluder.transformation;
+
+    std::vector<glm::vec4> clipPositions(positions.size());
+    for (size_t i = 0; i < positions.size(); i++)
+    {
+        clipPositions[i] = transformation * glm::vec4(positions[i], 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        ScreenTriangle triangle{};
+        bool inFront = true;
+        for (uint32_t v = 0; v < 3; v++)
+        {
+            const glm::vec4 &clipPosition = clipPositions[indices[i + v]];
+            // Leaving out the triangles crossing the near plane only hides less
+            if (clipPosition.w < MIN_CLIP_W)
+            {
+                inFront = false;
+                break;
+            }
+            glm::vec3 ndcPosition = glm::vec3(clipPosition) / clipPosition.w;
+            triangle.vertices[v] =
+            {
+                (ndcPosition.x * 0.5f + 0.5f) * DEPTH_BUFFER_WIDTH,
+                (ndcPosition.y * 0.5f + 0.5f) * DEPTH_BUFFER_HEIGHT,
+                ndcPosition.z
+            };
+        }
+        if (!inFront)
+        {
+            continue;
+        }
+
+        // Both faces are rendered, the winding is made counterclockwise for the edge functions
+        glm::vec3 &v0 = triangle.vertices[0], &v1 = triangle.vertices[1], &v2 = triangle.vertices[2];
+        float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+        if (area == 0.0f)
+        {
+            continue;
+        }
+        if (area < 0.0f)
+        {
+            std::swap(v1, v2);
+        }
+
+        // Pixels whose centers are inside the bounds of the triangle
+        float minX = std::min({ v0.x, v1.x, v2.x }), maxX = std::max({ v0.x, v1.x, v2.x });
+        float minY = std::min({ v0.y, v1.y, v2.y }), maxY = std::max({ v0.y, v1.y, v2.y });
+        triangle.minX = std::max(static_cast<int32_t>(std::ceil(minX - 0.5f)), 0);
+        triangle.maxX = std::min(static_cast<int32_t>(std::floor(maxX - 0.5f)), static_cast<int32_t>(DEPTH_BUFFER_WIDTH) - 1);
+        triangle.minY = std::max(static_cast<int32_t>(std::ceil(minY - 0.5f)), 0);
+        triangle.maxY = std::min(static_cast<int32_t>(std::floor(maxY - 0.5f)), static_cast<int32_t>(DEPTH_BUFFER_HEIGHT) - 1);
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        {
+            continue;
+        }
+        triangles.push_back(triangle);
+    }
+}
+
+void OcclusionCuller::RasterizeBand(uint32_t firstRow, uint32_t lastRow)
+{
+    std::vector<float> &depthBuffer = depthLevels[0];
+    for (const std::vector<ScreenTriangle> &triangles : occluderTriangles)
+    {
+        for (const ScreenTriangle &triangle : triangles)
+        {
+            int32_t minY = std::max(triangle.minY, static_cast<int32_t>(firstRow));
+            int32_t maxY = std::min(triangle.maxY, static_cast<int32_t>(lastRow));
+            if (minY > maxY)
+            {
+                continue;
+            }
+
+            const glm::vec3 &v0 = triangle.vertices[0], &v1 = triangle.vertices[1], &v2 = triangle.vertices[2];
+            float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+            for (int32_t y = minY; y <= maxY; y++)
+            {
+                float py = y + 0.5f;
+                for (int32_t x = triangle.minX; x <= triangle.maxX; x++)
+                {
+                    float px = x + 0.5f;
+                    // Each weight is the area of the triangle made by the pixel and the opposite edge
+                    float w0 = (v2.x - v1.x) * (py - v1.y) - (v2.y - v1.y) * (px - v1.x);
+                    float w1 = (v0.x - v2.x) * (py - v2.y) - (v0.y - v2.y) * (px - v2.x);
+                    float w2 = (v1.x - v0.x) * (py - v0.y) - (v1.y - v0.y) * (px - v0.x);
+                    if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f)
+                    {
+                        continue;
+                    }
+
+                    // The depth after the perspective division is linear in screen space
+                    float depth = (w0 * v0.z + w1 * v1.z + w2 * v2.z) / area;
+                    float &storedDepth = depthBuffer[y * DEPTH_BUFFER_WIDTH + x];
+                    storedDepth = std::min(storedDepth, depth);
+                }
+            }
+        }
+    }
+}
+
+void OcclusionCuller::BuildDepthLevels()
+{
+    for (size_t level = 1; level < depthLevels.size(); level++)
+    {
+        const std::vector<float> &finerDepths = depthLevels[level - 1];
+        std::vector<float> &depths = depthLevels[level];
+        uint32_t finerWidth = depthLevelSizes[level - 1].first, finerHeight = depthLevelSizes[level - 1].second;
+        uint32_t width = depthLevelSizes[level].first, height = depthLevelSizes[level].second;
+        for (uint32_t y = 0; y < height; y++)
+        {
+            uint32_t y0 = std::min(y * 2, finerHeight - 1), y1 = std::min(y * 2 + 1, finerHeight - 1);
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint32_t x0 = std::min(x * 2, finerWidth - 1), x1 = std::min(x * 2 + 1, finerWidth - 1);
+                depths[y * width + x] = std::max({
+                    finerDepths[y0 * finerWidth + x0],
+                    finerDepths[y0 * finerWidth + x1],
+                    finerDepths[y1 * finerWidth + x0],
+                    finerDepths[y1 * finerWidth + x1] });
+            }
+        }
+    }
+}
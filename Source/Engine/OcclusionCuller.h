@@ -0,0 +1,103 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Frustum.h"
+
+// Triangles of an occluder in model space, shared by the occluders with the same mesh
+struct OccluderMesh
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+};
+
+// Renders the occluders nearest to the camera into a small depth buffer on the CPU, then tests the bounding boxes
+// of the entities against the farthest depths of the tiles they cover, so that the entities hidden behind large
+// buildings are left out of the recorded draws. Uses no GPU resources, the depths are in [0, 1] with 0 at the near plane
+class OcclusionCuller
+{
+public:
+    static constexpr uint32_t DEPTH_BUFFER_WIDTH = 256;
+    static constexpr uint32_t DEPTH_BUFFER_HEIGHT = 128;
+    // Nearest occluders in the view frustum rendered each frame
+    static constexpr uint32_t MAX_OCCLUDER_COUNT = 64;
+
+    struct Stats
+    {
+        uint32_t occluderCount;
+        uint32_t triangleCount;
+        float renderTimeMs;
+    };
+
+    OcclusionCuller();
+    ~OcclusionCuller();
+
+    // The bounds are in world space, used to select the occluders in the view frustum
+    void AddOccluder(
+        uint64_t occluderId,
+        std::shared_ptr<const OccluderMesh> mesh,
+        const glm::mat4 &transformation,
+        const BoundingBox &bounds);
+    void UpdateOccluder(uint64_t occluderId, const glm::mat4 &transformation, const BoundingBox &bounds);
+    void RemoveOccluder(uint64_t occluderId);
+    bool HasOccluders() const { return !occluders.empty(); }
+
+    // Renders the depths of the nearest occluders, the triangles are set up per occluder and rasterized per band
+    // of rows on the threads of the standard parallel algorithms
+    void Render(
+        const glm::mat4 &viewProjection,
+        const std::array<glm::vec4, Frustum::PLANE_COUNT> &planes,
+        const glm::vec3 &cameraPosition);
+    // Whether the world space box is behind the occluders rendered last, boxes crossing the near plane never are
+    bool IsOccluded(const BoundingBox &bounds) const;
+
+    const std::vector<float> &GetDepthBuffer() const { return depthLevels[0]; }
+    Stats GetStats() const { return stats; }
+
+private:
+    // Rows of the depth buffer rasterized by each thread
+    static constexpr uint32_t BAND_HEIGHT = 16;
+    // Triangles closer than this distance to the camera plane are left out instead of clipped
+    static constexpr float MIN_CLIP_W = 1e-3f;
+    // Width in tiles of the box below which its tiles are tested at the level of the hierarchy
+    static constexpr uint32_t MAX_TESTED_TILE_SPAN = 4;
+
+    struct Occluder
+    {
+        std::shared_ptr<const OccluderMesh> mesh;
+        glm::mat4 transformation;
+        BoundingBox bounds;
+    };
+
+    // In pixels, with the depth of each vertex, counterclockwise
+    struct ScreenTriangle
+    {
+        glm::vec3 vertices[3];
+        int32_t minX;
+        int32_t maxX;
+        int32_t minY;
+        int32_t maxY;
+    };
+
+    void SetUpTriangles(const Occluder &occluder, std::vector<ScreenTriangle> &triangles) const;
+    void RasterizeBand(uint32_t firstRow, uint32_t lastRow);
+    // Each level keeps the farthest depth of the 2x2 tiles of the level below
+    void BuildDepthLevels();
+
+    std::unordered_map<uint64_t, Occluder> occluders;
+    // Distance and occluder of the occluders in the view frustum
+    std::vector<std::pair<float, const Occluder *>> renderedOccluders;
+    std::vector<std::vector<ScreenTriangle>> occluderTriangles;
+    // The full size depth buffer first, then every level down to a single tile
+    std::vector<std::vector<float>> depthLevels;
+    std::vector<std::pair<uint32_t, uint32_t>> depthLevelSizes;
+    glm::mat4 viewProjection;
+    Stats stats;
+};
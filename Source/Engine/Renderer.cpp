@@ -35,7 +35,13 @@ void Renderer::DrawScene()
     drawEngine->DrawFrame();
 }
 
-void Renderer::Initialize(Screen *screen)
+void Renderer::Initialize(
+    Screen *screen,
+    bool usePackedVertices,
+    bool useGpuCulling,
+    uint64_t memoryBudgetCap,
+    uint32_t renderWorkerCount,
+    bool useOcclusionCulling)
 {
     assert(("Screen must be defined for the renderer", screen != nullptr));
 
@@ -45,7 +51,14 @@ void Renderer::Initialize(Screen *screen)
 #else
     bool enableDebugging = false;
 #endif
-    drawEngine = std::make_unique<VulkanDrawEngine>(screen, enableDebugging);
+    drawEngine = std::make_unique<VulkanDrawEngine>(
+        screen,
+        enableDebugging,
+        usePackedVertices,
+        useGpuCulling,
+        memoryBudgetCap,
+        renderWorkerCount,
+        useOcclusionCulling);
     drawEngine->Initialize();
 }
 
@@ -67,6 +80,46 @@ void Renderer::RemoveEntity(uint32_t entityId)
     drawEngine->UnloadEntity(entityId);
 }
 
+uint64_t Renderer::GetSubmittedTriangleCount() const
+{
+    return drawEngine->GetSubmittedTriangleCount();
+}
+
+TextureResidencyStats Renderer::GetTextureResidencyStats() const
+{
+    return drawEngine->GetTextureResidencyStats();
+}
+
+ResourceSharingStats Renderer::GetResourceSharingStats() const
+{
+    return drawEngine->GetResourceSharingStats();
+}
+
+DrawCallStats Renderer::GetDrawCallStats() const
+{
+    return drawEngine->GetDrawCallStats();
+}
+
+DeferredDestructionStats Renderer::GetDeferredDestructionStats() const
+{
+    return drawEngine->GetDeferredDestructionStats();
+}
+
+CullingStats Renderer::GetCullingStats() const
+{
+    return drawEngine->GetCullingStats();
+}
+
+bool Renderer::SupportsBlockCompressedTextures() const
+{
+    return drawEngine->SupportsBlockCompressedTextures();
+}
+
+GeometryBufferStats Renderer::GetGeometryBufferStats() const
+{
+    return drawEngine->GetGeometryBufferStats();
+}
+
 void Renderer::PutText(const Text &text)
 {
     ScreenMesh screenMesh;
@@ -159,7 +212,9 @@ void Renderer::LoadBlock(uint32_t blockId, Terrain &terrain, std::vector<Entity>
 void Renderer::RemoveText(uint32_t textMeshId)
 {
     uint32_t screenMeshId = Identifier::GenerateIdentifier(IdentifierType::ScreenObject, textMeshId);
+    uint64_t deviceWaitCount = drawEngine->GetDeferredDestructionStats().deviceWaitCount;
     drawEngine->UnloadScreenObject(screenMeshId);
+    CheckNoDeviceWait(deviceWaitCount, "text");
 }
 
 void Renderer::UnloadBlock(uint32_t blockId)
@@ -169,6 +224,7 @@ void Renderer::UnloadBlock(uint32_t blockId)
         return;
     }
 
+    uint64_t deviceWaitCount = drawEngine->GetDeferredDestructionStats().deviceWaitCount;
     std::list<uint32_t> &entityIds = blockIdEntityIdsMap[blockId];
     Logger::Log(LogLevel::Info, "Unloading {} objects from buffer", entityIds.size());
     for (uint32_t entityId : entityIds)
@@ -180,6 +236,19 @@ void Renderer::UnloadBlock(uint32_t blockId)
     Logger::Log(LogLevel::Info, "Unloading terrain from buffer");
     drawEngine->UnloadTerrain(blockId);
     Logger::Log(LogLevel::Info, "Finished unloading terrain from buffer");
+    CheckNoDeviceWait(deviceWaitCount, "block");
 
     blockIdEntityIdsMap.erase(blockId);
 }
+
+void Renderer::CheckNoDeviceWait(uint64_t previousDeviceWaitCount, const char *unloadedName) const
+{
+    // The unloaded resources are destroyed once the frames using them complete, waiting for the device would
+    // stall the frames in flight
+    uint64_t deviceWaitCount = drawEngine->GetDeferredDestructionStats().deviceWaitCount;
+    if (deviceWaitCount != previousDeviceWaitCount)
+    {
+        Logger::Log(LogLevel::Warning, "Waited {} times for the device to be idle while unloading a {}",
+            deviceWaitCount - previousDeviceWaitCount, unloadedName);
+    }
+}
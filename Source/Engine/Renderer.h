@@ -6,13 +6,13 @@
 #include <unordered_map>
 #include <unordered_set>
 
+#include "DrawEngine.h"
 #include "Entity.h"
 #include "Mesh.h"
 #include "Text.h"
 #include "Terrain.h"
 
 class Camera;
-class DrawEngine;
 class Screen;
 
 class Renderer
@@ -23,7 +23,14 @@ public:
 
     void Cleanup();
     void DrawScene();
-    void Initialize(Screen *screen);
+    // The memory budget of the device is used when the cap is 0
+    void Initialize(
+        Screen *screen,
+        bool usePackedVertices,
+        bool useGpuCulling,
+        uint64_t memoryBudgetCap,
+        uint32_t renderWorkerCount,
+        bool useOcclusionCulling);
     
     void LoadBackground(const std::string &skyBoxImageFilePath, bool enableFog);
     void DrawDebugLines(std::vector<LineSegmentVertex> &lines);
@@ -38,7 +45,18 @@ public:
     void PutText(const Text &text);
     void RemoveText(uint32_t textId);
 
+    uint64_t GetSubmittedTriangleCount() const;
+    TextureResidencyStats GetTextureResidencyStats() const;
+    ResourceSharingStats GetResourceSharingStats() const;
+    GeometryBufferStats GetGeometryBufferStats() const;
+    DrawCallStats GetDrawCallStats() const;
+    DeferredDestructionStats GetDeferredDestructionStats() const;
+    CullingStats GetCullingStats() const;
+    bool SupportsBlockCompressedTextures() const;
+
 private:
+    void CheckNoDeviceWait(uint64_t previousDeviceWaitCount, const char *unloadedName) const;
+
     Camera *camera;
     FontManager fontManager;
     std::unique_ptr<DrawEngine> drawEngine;
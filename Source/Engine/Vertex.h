@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <glm/gtx/hash.hpp>
@@ -18,6 +20,26 @@ struct Vertex
     }
 };
 
+// Compact 16-byte layout for static meshes, decoded in the vertex shader (see VertexPacker)
+struct PackedVertex
+{
+    // Normalized within the mesh bounds, w is unused
+    uint16_t position[4];
+    // Octahedral encoded unit normal
+    int16_t normal[2];
+    // Normalized within the texture coordinate range of the mesh
+    uint16_t uv[2];
+};
+
+// Per-mesh ranges to restore a PackedVertex, matches the std140 layout of the instance buffer
+struct PackedVertexDecode
+{
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
+    // Offset in xy and scale in zw
+    glm::vec4 uvOffsetScale;
+};
+
 struct ScreenObjectVertex
 {
     glm::vec3 color;
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "VertexPacker.h"
+
+PackedVertexDecode VertexPacker::Pack(const std::vector<Vertex> &vertices, std::vector<PackedVertex> &packedVertices)
+{
+    glm::vec3 minPosition{ std::numeric_limits<float>::max() };
+    glm::vec3 maxPosition{ -std::numeric_limits<float>::max() };
+    glm::vec2 minUV{ std::numeric_limits<float>::max() };
+    glm::vec2 maxUV{ -std::numeric_limits<float>::max() };
+    for (const Vertex &vertex : vertices)
+    {
+        minPosition = glm::min(minPosition, vertex.position);
+        maxPosition = glm::max(maxPosition, vertex.position);
+        minUV = glm::min(minUV, vertex.uv);
+        maxUV = glm::max(maxUV, vertex.uv);
+    }
+
+    PackedVertexDecode decode{};
+    if (vertices.empty())
+    {
+        packedVertices.clear();
+        return decode;
+    }
+    decode.positionOffset = glm::vec4(minPosition, 0.0f);
+    decode.positionScale = glm::vec4(maxPosition - minPosition, 0.0f);
+    decode.uvOffsetScale = glm::vec4(minUV, maxUV - minUV);
+
+    packedVertices.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const Vertex &vertex = vertices[i];
+        PackedVertex &packedVertex = packedVertices[i];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            packedVertex.position[axis] = QuantizeUnorm(
+                vertex.position[axis], decode.positionOffset[axis], decode.positionScale[axis]);
+        }
+        packedVertex.position[3] = 0;
+
+        glm::vec2 encodedNormal = EncodeOctahedral(vertex.normal);
+        packedVertex.normal[0] = static_cast<int16_t>(std::round(std::clamp(encodedNormal.x, -1.0f, 1.0f) * SNORM16_MAX));
+        packedVertex.normal[1] = static_cast<int16_t>(std::round(std::clamp(encodedNormal.y, -1.0f, 1.0f) * SNORM16_MAX));
+
+        packedVertex.uv[0] = QuantizeUnorm(vertex.uv.x, decode.uvOffsetScale.x, decode.uvOffsetScale.z);
+        packedVertex.uv[1] = QuantizeUnorm(vertex.uv.y, decode.uvOffsetScale.y, decode.uvOffsetScale.w);
+    }
+
+    return decode;
+}
+
+Vertex VertexPacker::Unpack(const PackedVertex &packedVertex, const PackedVertexDecode &decode)
+{
+    glm::vec3 position
+    {
+        packedVertex.position[0] / UNORM16_MAX,
+        packedVertex.position[1] / UNORM16_MAX,
+        packedVertex.position[2] / UNORM16_MAX
+    };
+    // SNORM conversion rule of Vulkan, -32768 is clamped to -1
+    glm::vec2 encodedNormal
+    {
+        std::max(packedVertex.normal[0] / SNORM16_MAX, -1.0f),
+        std::max(packedVertex.normal[1] / SNORM16_MAX, -1.0f)
+    };
+    glm::vec2 uv
+    {
+        packedVertex.uv[0] / UNORM16_MAX,
+        packedVertex.uv[1] / UNORM16_MAX
+    };
+
+    Vertex vertex{};
+    vertex.position = glm::vec3(decode.positionOffset) + position * glm::vec3(decode.positionScale);
+    vertex.normal = DecodeOctahedral(encodedNormal);
+    vertex.uv = glm::vec2(decode.uvOffsetScale.x, decode.uvOffsetScale.y)
+        + uv * glm::vec2(decode.uvOffsetScale.z, decode.uvOffsetScale.w);
+    return vertex;
+}
+
+VertexPackingError VertexPacker::MeasureError(
+    const std::vector<Vertex> &vertices,
+    const std::vector<PackedVertex> &packedVertices,
+    const PackedVertexDecode &decode)
+{
+    VertexPackingError error{};
+    for (size_t i = 0; i < vertices.size() && i < packedVertices.size(); i++)
+    {
+        const Vertex &vertex = vertices[i];
+        Vertex unpackedVertex = Unpack(packedVertices[i], decode);
+        error.maxPositionError = std::max(error.maxPositionError, glm::length(vertex.position - unpackedVertex.position));
+        error.maxUVError = std::max(error.maxUVError, glm::length(vertex.uv - unpackedVertex.uv));
+
+        float normalLength = glm::length(vertex.normal);
+        if (normalLength > 0.0f)
+        {
+            float cosine = std::clamp(glm::dot(vertex.normal / normalLength, unpackedVertex.normal), -1.0f, 1.0f);
+            error.maxNormalError = std::max(error.maxNormalError, glm::degrees(std::acos(cosine)));
+        }
+    }
+    return error;
+}
+
+uint16_t VertexPacker::QuantizeUnorm(float value, float offset, float scale)
+{
+    if (scale <= 0.0f)
+    {
+        return 0;
+    }
+    float normalized = std::clamp((value - offset) / scale, 0.0f, 1.0f);
+    return static_cast<uint16_t>(std::round(normalized * UNORM16_MAX));
+}
+
+glm::vec2 VertexPacker::EncodeOctahedral(const glm::vec3 &normal)
+{
+    // Project onto the octahedron, then fold the lower half over the diagonals
+    float l1Norm = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1Norm == 0.0f)
+    {
+        return { 0.0f, 0.0f };
+    }
+    glm::vec3 projected = normal / l1Norm;
+    glm::vec2 encoded{ projected.x, projected.y };
+    if (projected.z < 0.0f)
+    {
+        encoded = glm::vec2
+        {
+            (1.0f - std::abs(projected.y)) * (projected.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::abs(projected.x)) * (projected.y >= 0.0f ? 1.0f : -1.0f)
+        };
+    }
+    return encoded;
+}
+
+glm::vec3 VertexPacker::DecodeOctahedral(const glm::vec2 &encoded)
+{
+    glm::vec3 normal{ encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y) };
+    if (normal.z < 0.0f)
+    {
+        normal.x = (1.0f - std::abs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f);
+        normal.y = (1.0f - std::abs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return glm::normalize(normal);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+#include "Vertex.h"
+
+struct VertexPackingError
+{
+    float maxPositionError;
+    // In degrees
+    float maxNormalError;
+    float maxUVError;
+};
+
+class VertexPacker
+{
+public:
+    static PackedVertexDecode Pack(const std::vector<Vertex> &vertices, std::vector<PackedVertex> &packedVertices);
+    // Same decoding as the packed static vertex shader, used to compare with the full precision vertices
+    static Vertex Unpack(const PackedVertex &packedVertex, const PackedVertexDecode &decode);
+    static VertexPackingError MeasureError(
+        const std::vector<Vertex> &vertices,
+        const std::vector<PackedVertex> &packedVertices,
+        const PackedVertexDecode &decode);
+
+private:
+    static constexpr float UNORM16_MAX = 65535.0f;
+    static constexpr float SNORM16_MAX = 32767.0f;
+
+    static uint16_t QuantizeUnorm(float value, float offset, float scale);
+    static glm::vec2 EncodeOctahedral(const glm::vec3 &normal);
+    static glm::vec3 DecodeOctahedral(const glm::vec2 &encoded);
+};
@@ -1,12 +1,14 @@
 #include "Engine/Vulkan/VulkanCommon.h"
+#include "Engine/Vulkan/VulkanDeletionQueue.h"
 #include "VulkanBuffer.h"
+#include "VulkanUploadManager.h"
 
 VulkanBuffer::VulkanBuffer(
     VulkanContext *context,
-    VkCommandPool &commandPool,
+    VulkanUploadManager *uploadManager,
     VmaAllocator &allocator)
     : context(context),
-      commandPool(commandPool),
+      uploadManager(uploadManager),
       allocator(allocator),
       allocation(),
       descriptorSet(VK_NULL_HANDLE),
@@ -14,6 +16,7 @@ VulkanBuffer::VulkanBuffer(
       usage(VK_NULL_HANDLE),
       buffer(),
       loaded(false),
+      inUse(false),
       mappedMemory(nullptr),
       capacity(0),
       size(0)
@@ -101,27 +104,12 @@ void VulkanBuffer::Update(void *data, uint32_t size)
         return;
     }
 
-    // Create another buffer for staging, and will be destroyed right after the
-    // data is copied into the actual buffer
-    VkBuffer stagingBuffer;
-    VmaAllocation stagingAllocation;
-    VulkanBuffer::CreateBuffer(
-        allocator,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        size,
-        stagingBuffer,
-        stagingAllocation);
-
-    void *mappedData;
-    vmaMapMemory(allocator, stagingAllocation, &mappedData);
-    memcpy(mappedData, data, size);
-    vmaUnmapMemory(allocator, stagingAllocation);
-
-    CopyBuffer(stagingBuffer, buffer, size);
-
-    vmaDestroyBuffer(allocator, stagingBuffer, stagingAllocation);
+    // The copy is batched with the other uploads of the frame and runs before the next frame is drawn
+    VulkanStagingRegion stagingRegion = uploadManager->AllocateStagingRegion(size);
+    memcpy(stagingRegion.mappedData, data, size);
+    uploadManager->CopyToBuffer(stagingRegion, buffer, size, usage, inUse);
 
+    this->inUse = true;
     this->size = size;
     this->loaded = true;
 }
@@ -145,10 +133,19 @@ void VulkanBuffer::UpdateFast(void *data, uint32_t size)
     }
     memcpy(mappedMemory, data, size);
 
+    this->inUse = true;
     this->size = size;
     this->loaded = true;
 }
 
+void VulkanBuffer::Write(const void *data, uint32_t offset, uint32_t size)
+{
+    VulkanStagingRegion stagingRegion = uploadManager->AllocateStagingRegion(size);
+    memcpy(stagingRegion.mappedData, data, size);
+    uploadManager->CopyToBuffer(stagingRegion, buffer, size, usage, false, offset);
+    this->inUse = true;
+}
+
 void VulkanBuffer::Unload()
 {
     if (!loaded)
@@ -159,50 +156,23 @@ void VulkanBuffer::Unload()
     if (mappedMemory != nullptr)
     {
         vmaUnmapMemory(allocator, allocation);
+        mappedMemory = nullptr;
     }
 
-    context->WaitIdle();
-    vmaDestroyBuffer(allocator, buffer, allocation);
+    // A copy into the buffer may still be waiting in the current upload batch, it is submitted before the next frame
+    // and the buffer is destroyed once that frame is complete
+    uploadManager->Flush();
+    VmaAllocator bufferAllocator = allocator;
+    VkBuffer unloadedBuffer = buffer;
+    VmaAllocation unloadedAllocation = allocation;
+    context->GetDeletionQueue()->Defer([bufferAllocator, unloadedBuffer, unloadedAllocation]()
+        {
+            vmaDestroyBuffer(bufferAllocator, unloadedBuffer, unloadedAllocation);
+        });
 
     this->size = 0;
     this->loaded = false;
-}
-
-void VulkanBuffer::CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
-{
-    VkDevice logicalDevice = context->GetLogicalDevice();
-    VkQueue graphicsQueue = context->GetGraphicsQueue();
-
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-    VkBufferCopy copyRegion{};
-    copyRegion.size = size;
-    vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
-
-    vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
+    this->inUse = false;
 }
 
 void VulkanBuffer::CreateBuffer(
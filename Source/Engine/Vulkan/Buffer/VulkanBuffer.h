@@ -5,12 +5,14 @@
 
 #include "Engine/Vulkan/VulkanContext.h"
 
+class VulkanUploadManager;
+
 class VulkanBuffer
 {
 public:
     VulkanBuffer(
         VulkanContext *context,
-        VkCommandPool &commandPool,
+        VulkanUploadManager *uploadManager,
         VmaAllocator &allocator);
     ~VulkanBuffer();
 
@@ -32,6 +34,8 @@ public:
         uint32_t reservedSize = 0);
     void Update(void *data, uint32_t size);
     void UpdateFast(void *data, uint32_t size);
+    // Copies into a range of the loaded buffer that no submitted frame reads, e.g. a new suballocation
+    void Write(const void *data, uint32_t offset, uint32_t size);
     void Unload();
 
     static void CreateBuffer(
@@ -43,11 +47,11 @@ public:
         VmaAllocation &allocation);
 
 private:
-    void CopyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-
     uint32_t size;
     uint32_t capacity;
     bool loaded;
+    // Set once the buffer has data that frames may read, later copies must wait for those frames
+    bool inUse;
     void *mappedMemory;
 
     VkBufferUsageFlags usage;
@@ -57,7 +61,7 @@ private:
     VmaAllocation allocation;
 
     VulkanContext *context;
-    VkCommandPool &commandPool;
+    VulkanUploadManager *uploadManager;
     VkBuffer buffer;
 
     VkDescriptorSet descriptorSet;
@@ -0,0 +1,185 @@
+#include <algorithm>
+
+#include "Common/Logger.h"
+#include "VulkanBuffer.h"
+#include "VulkanBufferArena.h"
+
+VulkanBufferArena::VulkanBufferArena(
+    VulkanContext *context,
+    VulkanUploadManager *uploadManager,
+    VmaAllocator &allocator,
+    VkBufferUsageFlags usage,
+    VkDeviceSize bufferSize)
+    : context(context),
+      uploadManager(uploadManager),
+      allocator(allocator),
+      usage(usage),
+      bufferSize(bufferSize)
+{
+}
+
+VulkanBufferArena::~VulkanBufferArena()
+{
+}
+
+void VulkanBufferArena::Destroy()
+{
+    for (std::unique_ptr<ArenaBuffer> &arenaBuffer : buffers)
+    {
+        if (arenaBuffer)
+        {
+            arenaBuffer->buffer->Unload();
+        }
+    }
+    buffers.clear();
+}
+
+VulkanArenaAllocation VulkanBufferArena::Allocate(const void *data, VkDeviceSize size, VkDeviceSize alignment)
+{
+    VulkanArenaAllocation allocation{};
+    allocation.size = size;
+
+    bool allocated = false;
+    for (uint32_t i = 0; i < buffers.size() && !allocated; i++)
+    {
+        if (buffers[i] && TryAllocate(*buffers[i], size, alignment, allocation.offset))
+        {
+            allocation.bufferIndex = i;
+            allocated = true;
+        }
+    }
+
+    if (!allocated)
+    {
+        // Meshes larger than the buffer size get a buffer of their own size
+        std::unique_ptr<ArenaBuffer> arenaBuffer = std::make_unique<ArenaBuffer>();
+        arenaBuffer->capacity = std::max(bufferSize, size);
+        arenaBuffer->usedSize = 0;
+        arenaBuffer->allocationCount = 0;
+        arenaBuffer->freeRanges[0] = arenaBuffer->capacity;
+        arenaBuffer->buffer = std::make_unique<VulkanBuffer>(context, uploadManager, allocator);
+        arenaBuffer->buffer->Load(
+            usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            nullptr,
+            0,
+            static_cast<uint32_t>(arenaBuffer->capacity));
+        TryAllocate(*arenaBuffer, size, alignment, allocation.offset);
+
+        auto emptySlot = std::find(buffers.begin(), buffers.end(), nullptr);
+        allocation.bufferIndex = static_cast<uint32_t>(emptySlot - buffers.begin());
+        if (emptySlot == buffers.end())
+        {
+            buffers.push_back(std::move(arenaBuffer));
+        }
+        else
+        {
+            *emptySlot = std::move(arenaBuffer);
+        }
+
+        Logger::Log(LogLevel::Debug, "Created arena buffer {} of {:.1f} MB",
+            allocation.bufferIndex, buffers[allocation.bufferIndex]->capacity / (1024.0f * 1024.0f));
+    }
+
+    allocation.buffer = buffers[allocation.bufferIndex]->buffer.get();
+    allocation.buffer->Write(data, static_cast<uint32_t>(allocation.offset), static_cast<uint32_t>(size));
+    return allocation;
+}
+
+void VulkanBufferArena::Free(const VulkanArenaAllocation &allocation)
+{
+    ArenaBuffer &arenaBuffer = *buffers[allocation.bufferIndex];
+    arenaBuffer.usedSize -= allocation.size;
+    arenaBuffer.allocationCount--;
+
+    if (arenaBuffer.allocationCount == 0 && allocation.bufferIndex > 0)
+    {
+        arenaBuffer.buffer->Unload();
+        buffers[allocation.bufferIndex].reset();
+        return;
+    }
+
+    // Merge with the free ranges right before and after the freed one
+    VkDeviceSize offset = allocation.offset;
+    VkDeviceSize size = allocation.size;
+    auto next = arenaBuffer.freeRanges.lower_bound(offset);
+    if (next != arenaBuffer.freeRanges.begin())
+    {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset)
+        {
+            offset = previous->first;
+            size += previous->second;
+            arenaBuffer.freeRanges.erase(previous);
+        }
+    }
+    if (next != arenaBuffer.freeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        arenaBuffer.freeRanges.erase(next);
+    }
+    arenaBuffer.freeRanges[offset] = size;
+}
+
+VulkanArenaStats VulkanBufferArena::GetStats() const
+{
+    VulkanArenaStats stats{};
+    for (const std::unique_ptr<ArenaBuffer> &arenaBuffer : buffers)
+    {
+        if (!arenaBuffer)
+        {
+            continue;
+        }
+
+        stats.allocationCount += arenaBuffer->allocationCount;
+        stats.bufferCount++;
+        stats.usedSize += arenaBuffer->usedSize;
+        stats.capacity += arenaBuffer->capacity;
+        for (const auto &[offset, size] : arenaBuffer->freeRanges)
+        {
+            stats.largestFreeSize = std::max(stats.largestFreeSize, size);
+        }
+    }
+    return stats;
+}
+
+bool VulkanBufferArena::TryAllocate(
+    ArenaBuffer &arenaBuffer,
+    VkDeviceSize size,
+    VkDeviceSize alignment,
+    VkDeviceSize &offset)
+{
+    auto bestRange = arenaBuffer.freeRanges.end();
+    VkDeviceSize bestRangeSize = 0;
+    for (auto range = arenaBuffer.freeRanges.begin(); range != arenaBuffer.freeRanges.end(); range++)
+    {
+        VkDeviceSize padding = (alignment - range->first % alignment) % alignment;
+        if (range->second >= size + padding && (bestRange == arenaBuffer.freeRanges.end() || range->second < bestRangeSize))
+        {
+            bestRange = range;
+            bestRangeSize = range->second;
+        }
+    }
+    if (bestRange == arenaBuffer.freeRanges.end())
+    {
+        return false;
+    }
+
+    // The padding before the aligned offset and the space after the allocation stay free
+    VkDeviceSize rangeOffset = bestRange->first;
+    VkDeviceSize rangeSize = bestRange->second;
+    arenaBuffer.freeRanges.erase(bestRange);
+    offset = rangeOffset + (alignment - rangeOffset % alignment) % alignment;
+    if (offset > rangeOffset)
+    {
+        arenaBuffer.freeRanges[rangeOffset] = offset - rangeOffset;
+    }
+    if (rangeOffset + rangeSize > offset + size)
+    {
+        arenaBuffer.freeRanges[offset + size] = rangeOffset + rangeSize - offset - size;
+    }
+
+    arenaBuffer.usedSize += size;
+    arenaBuffer.allocationCount++;
+    return true;
+}
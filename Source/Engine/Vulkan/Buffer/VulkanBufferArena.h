@@ -0,0 +1,78 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "vk_mem_alloc.hpp"
+
+class VulkanBuffer;
+class VulkanContext;
+class VulkanUploadManager;
+
+// Range of one of the buffers of an arena
+struct VulkanArenaAllocation
+{
+    VulkanBuffer *buffer;
+    uint32_t bufferIndex;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+};
+
+struct VulkanArenaStats
+{
+    uint32_t allocationCount;
+    uint32_t bufferCount;
+    VkDeviceSize usedSize;
+    VkDeviceSize capacity;
+    // Largest free range of all the buffers, the rest of the free space is too fragmented for a larger allocation
+    VkDeviceSize largestFreeSize;
+};
+
+// Suballocates the ranges of many meshes from a few large device local buffers, so that the draws share
+// the vertex and index buffers they bind. Free ranges are kept sorted by offset in each buffer,
+// allocated with the best fit and merged with their neighbors when freed.
+// Ranges are only freed once no submitted frame reads them any more
+class VulkanBufferArena
+{
+public:
+    VulkanBufferArena(
+        VulkanContext *context,
+        VulkanUploadManager *uploadManager,
+        VmaAllocator &allocator,
+        VkBufferUsageFlags usage,
+        VkDeviceSize bufferSize);
+    ~VulkanBufferArena();
+
+    void Destroy();
+
+    // The offset is a multiple of the alignment, so that it can be converted to a vertex or index offset
+    VulkanArenaAllocation Allocate(const void *data, VkDeviceSize size, VkDeviceSize alignment);
+    void Free(const VulkanArenaAllocation &allocation);
+
+    VulkanArenaStats GetStats() const;
+
+private:
+    struct ArenaBuffer
+    {
+        std::unique_ptr<VulkanBuffer> buffer;
+        // Offset to size of each free range
+        std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+        VkDeviceSize capacity;
+        VkDeviceSize usedSize;
+        uint32_t allocationCount;
+    };
+
+    bool TryAllocate(ArenaBuffer &arenaBuffer, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize &offset);
+
+    VulkanContext *context;
+    VulkanUploadManager *uploadManager;
+    VmaAllocator &allocator;
+    VkBufferUsageFlags usage;
+    VkDeviceSize bufferSize;
+
+    // Empty buffers other than the first are released, and their slots reused by the next buffers
+    std::vector<std::unique_ptr<ArenaBuffer>> buffers;
+};
@@ -1,35 +1,57 @@
+#include <algorithm>
 #include <assert.h>
+#include <chrono>
+#include <cstddef>
+#include <queue>
 
 #define VMA_IMPLEMENTATION
 
+#include "Common/ContentHash.h"
+#include "Common/Logger.h"
 #include "Engine/Image.h"
 #include "Engine/Material.h"
 #include "Engine/Mesh.h"
+#include "Engine/MeshOptimizer.h"
 #include "Engine/Terrain.h"
+#include "Engine/VertexPacker.h"
 #include "Engine/Vulkan/VulkanContext.h"
+#include "Engine/Vulkan/VulkanDeletionQueue.h"
 #include "Engine/Vulkan/VulkanRenderPass.h"
 #include "Engine/Vulkan/Command/VulkanCommand.h"
+#include "Engine/Vulkan/Culling/VulkanGpuCulling.h"
 #include "Engine/Vulkan/Image/VulkanImage.h"
 #include "Engine/Vulkan/Image/VulkanTexture.h"
+#include "Engine/Vulkan/Image/VulkanTextureTable.h"
 #include "Engine/Vulkan/Pipeline/VulkanPipeline.h"
 #include "VulkanBuffer.h"
+#include "VulkanBufferArena.h"
 #include "VulkanBufferManager.h"
+#include "VulkanMemoryBudget.h"
+#include "VulkanUploadManager.h"
 
 VulkanBufferManager::VulkanBufferManager(
     VulkanContext *context,
     VulkanRenderPass *renderPass,
     VulkanDrawingPipelines pipelines,
-    VkCommandPool commandPool,
-    uint32_t frameBufferSize)
+    uint32_t frameBufferSize,
+    bool usePackedVertices,
+    bool useGpuCulling,
+    VkDeviceSize memoryBudgetCap)
     : context(context),
       renderPass(renderPass),
       pipelines(pipelines),
       frameBufferSize(frameBufferSize),
-      commandPool(commandPool),
+      usePackedVertices(usePackedVertices),
+      useGpuCulling(useGpuCulling),
+      memoryBudgetCap(memoryBudgetCap),
+      textureMemoryBudgetExceeded(false),
+      sortKeysOverflowed(false),
       cubeMapBufferLoaded(false),
+      totalTextureMemorySize(0),
       entityBufferCache{},
       terrainBufferCache{},
-      cubeMapBufferCache{}
+      cubeMapBufferCache{},
+      drawingBuffer{}
 {
 }
 
@@ -41,48 +63,248 @@ void VulkanBufferManager::Create()
 {
     CreateDescriptorPool();
     CreateMemoryAllocator();
+    memoryBudget = std::make_unique<VulkanMemoryBudget>(context, memoryBudgetCap);
+    memoryBudget->AddAllocator(vmaAllocator);
+    memoryBudget->AddAllocator(imageVmaAllocator);
+    memoryBudget->Update();
+    uploadManager = std::make_unique<VulkanUploadManager>(context, vmaAllocator);
+    uploadManager->Create();
+    vertexArena = std::make_unique<VulkanBufferArena>(
+        context, uploadManager.get(), vmaAllocator, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VERTEX_ARENA_BUFFER_SIZE);
+    indexArena = std::make_unique<VulkanBufferArena>(
+        context, uploadManager.get(), vmaAllocator, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, INDEX_ARENA_BUFFER_SIZE);
     CreateUniformBuffers();
+    if (useGpuCulling)
+    {
+        gpuCulling = std::make_unique<VulkanGpuCulling>(
+            context, uploadManager.get(), vmaAllocator, descriptorPool, pipelines, frameBufferSize);
+        gpuCulling->Create();
+    }
+    CreateInstanceBuffers();
     CreateScreenBuffers();
     CreateLineBuffer();
+
+    if (context->SupportsBindlessTextures())
+    {
+        textureTable = std::make_unique<VulkanTextureTable>(
+            context,
+            pipelines.staticPipeline->GetImageDescriptorSetLayout());
+        textureTable->Create();
+    }
 }
 
 void VulkanBufferManager::Destroy()
 {
     DestroyScreenBuffers();
     DestroyUniformBuffers();
+    DestroyInstanceBuffers();
+    if (gpuCulling)
+    {
+        gpuCulling->Destroy();
+    }
     DestroyCubeMapBuffer();
     DestroyLineBuffer();
+    // Runs the range frees and texture removals still waiting in the deletion queue before their owners go away
+    context->WaitIdle();
+    vertexArena->Destroy();
+    indexArena->Destroy();
 
     // Destroying the descriptor pool will automatically free the descriptor sets
     // created using the pool, so no need to explicitly free each descriptor set
     vkDestroyDescriptorPool(context->GetLogicalDevice(), descriptorPool, nullptr);
+    if (textureTable)
+    {
+        textureTable->Destroy();
+    }
 
+    uploadManager->Destroy();
+    // The buffers and images unloaded above are destroyed before their allocators
+    context->GetDeletionQueue()->ReleaseAll();
     vmaDestroyAllocator(vmaAllocator);
     vmaDestroyAllocator(imageVmaAllocator);
 }
 
-VulkanDrawingBuffer VulkanBufferManager::GetDrawingBuffer(uint32_t imageIndex)
+const VulkanDrawingBuffer &VulkanBufferManager::GetDrawingBuffer(
+    uint32_t imageIndex,
+    const glm::vec3 &cameraPosition,
+    const VulkanRenderLayerUpdates &layersUpdated)
 {
-    VulkanDrawingBuffer drawingBuffer{};
     drawingBuffer.cubeMapBuffer = cubeMapBufferCache;
     drawingBuffer.uniformBuffer = uniformBuffers[imageIndex].get();
     drawingBuffer.lineBuffer.vertexBuffer = lineVertexBuffer.get();
     drawingBuffer.screenBuffer = screenBuffers[imageIndex].get();
-    for (auto &entry : entityBufferCache)
+    drawingBuffer.instanceDescriptorSet = instanceDescriptorSets[imageIndex];
+    drawingBuffer.gpuCulling = gpuCulling.get();
+    drawingBuffer.textureTable = textureTable.get();
+
+    // The entity draws of the image only change with its static layer, the cached commands of the layer keep drawing
+    // them otherwise, so its instance order and culling inputs must stay the ones they were recorded with
+    if (layersUpdated[static_cast<uint32_t>(VulkanRenderLayer::Static)])
     {
-        drawingBuffer.entityBuffers.push_back(entry.second);
+        BuildEntityDraws(imageIndex, cameraPosition);
     }
-    for (auto &entry : terrainBufferCache)
+    if (layersUpdated[static_cast<uint32_t>(VulkanRenderLayer::Terrain)])
     {
-        drawingBuffer.terrainBuffers.push_back(entry.second);
+        drawingBuffer.terrainBuffers.clear();
+        for (auto &entry : terrainBufferCache)
+        {
+            if (entry.second.visible)
+            {
+                drawingBuffer.terrainBuffers.push_back(entry.second);
+            }
+        }
     }
-    for (auto &entry : screenObjectBufferCache)
+    if (layersUpdated[static_cast<uint32_t>(VulkanRenderLayer::Screen)])
     {
-        drawingBuffer.screenObjectBuffers.push_back(entry.second);
+        drawingBuffer.screenObjectBuffers.clear();
+        for (auto &entry : screenObjectBufferCache)
+        {
+            drawingBuffer.screenObjectBuffers.push_back(entry.second);
+        }
     }
     return drawingBuffer;
 }
 
+void VulkanBufferManager::BuildEntityDraws(uint32_t imageIndex, const glm::vec3 &cameraPosition)
+{
+    // The frame of the image is done and its commands are recorded again, so its instance buffer can be replaced
+    uint32_t instanceCount = static_cast<uint32_t>(entityBufferCache.size());
+    if (instanceCount > instanceBufferCapacities[imageIndex])
+    {
+        uint32_t capacity = instanceBufferCapacities[imageIndex];
+        while (capacity < instanceCount)
+        {
+            capacity *= 2;
+        }
+
+        instanceBuffers[imageIndex]->Unload();
+        visibleInstanceBuffers[imageIndex]->Unload();
+        LoadInstanceBuffers(imageIndex, capacity);
+        UpdateInstanceDescriptorSet(imageIndex);
+
+        Logger::Log(LogLevel::Debug, "Grew instance buffer {} to {} entities", imageIndex, capacity);
+    }
+
+    // Entities drawn from the same pooled buffers follow each other in the queue, so that the buffers are bound once
+    // for all of them, and entities with the same mesh range and texture are drawn as instances of one draw.
+    // With the texture table the texture is read from the instance input, so that it does not split the batches
+    renderQueue.Clear();
+    uint32_t unsortedEntityCount = 0;
+    for (const auto &[instanceId, entityBuffer] : entityBufferCache)
+    {
+        // The GPU culling draws every entity it is given and culls the instances each frame,
+        // only the entities hidden behind the occluders are left out before it
+        if (!entityBuffer.visible)
+        {
+            continue;
+        }
+
+        glm::vec3 position = instanceInputs[entityBuffer.instanceIndex].transformation[3];
+        uint64_t sortKey;
+        if (!VulkanRenderQueue::TryMakeSortKey(
+            entityBuffer.vertexBufferIndex,
+            entityBuffer.indexBufferIndex,
+            entityBuffer.indexInfo.indexType,
+            entityBuffer.materialIndex,
+            entityBuffer.indexInfo.firstIndex,
+            glm::distance(position, cameraPosition),
+            sortKey))
+        {
+            unsortedEntityCount++;
+        }
+        renderQueue.Push(sortKey, &entityBuffer);
+    }
+    renderQueue.Sort();
+
+    bool sortKeysOverflow = unsortedEntityCount > 0;
+    if (sortKeysOverflow && !sortKeysOverflowed)
+    {
+        Logger::Log(LogLevel::Warning, "{} entities have a material index or mesh range past the bits of the sort key, "
+            "they are drawn unsorted after the others", unsortedEntityCount);
+    }
+    sortKeysOverflowed = sortKeysOverflow;
+
+    // The instance buffer of the frame is written in the same order, so that the instances of each draw follow each other
+    // The keys only order the entities, the draws and batches are told apart by the buffers and ranges themselves
+    // in case some of their key fields were truncated
+    const bool bindlessTextures = textureTable != nullptr;
+    std::vector<uint32_t> &frameInstanceIndices = drawInstanceIndices[imageIndex];
+    std::vector<uint32_t> &frameInstanceDrawIndices = drawInstanceDrawIndices[imageIndex];
+    frameInstanceIndices.clear();
+    frameInstanceDrawIndices.clear();
+    drawingBuffer.entityDraws.clear();
+    drawingBuffer.entityDrawBatches.clear();
+    const VulkanEntityBuffer *previousEntityBuffer = nullptr;
+    for (const VulkanRenderQueueItem &item : renderQueue.GetItems())
+    {
+        const VulkanEntityBuffer *entityBuffer = item.entityBuffer;
+        uint32_t firstInstance = static_cast<uint32_t>(frameInstanceIndices.size());
+        bool sameBatch = previousEntityBuffer
+            && entityBuffer->vertexBuffer == previousEntityBuffer->vertexBuffer
+            && entityBuffer->indexBuffer == previousEntityBuffer->indexBuffer
+            && entityBuffer->indexInfo.indexType == previousEntityBuffer->indexInfo.indexType
+            && (bindlessTextures || entityBuffer->textureBuffer == previousEntityBuffer->textureBuffer);
+        bool sameDraw = sameBatch
+            && entityBuffer->vertexOffset == previousEntityBuffer->vertexOffset
+            && entityBuffer->indexInfo.firstIndex == previousEntityBuffer->indexInfo.firstIndex
+            && entityBuffer->indexInfo.indexCount == previousEntityBuffer->indexInfo.indexCount;
+        previousEntityBuffer = entityBuffer;
+        if (sameDraw)
+        {
+            drawingBuffer.entityDraws.back().instanceCount++;
+        }
+        else
+        {
+            if (sameBatch)
+            {
+                drawingBuffer.entityDrawBatches.back().drawCount++;
+            }
+            else
+            {
+                VulkanEntityDrawBatch entityDrawBatch{};
+                entityDrawBatch.firstDraw = static_cast<uint32_t>(drawingBuffer.entityDraws.size());
+                entityDrawBatch.drawCount = 1;
+                drawingBuffer.entityDrawBatches.push_back(entityDrawBatch);
+            }
+
+            VulkanEntityDraw entityDraw{};
+            entityDraw.vertexBuffer = entityBuffer->vertexBuffer;
+            entityDraw.indexBuffer = entityBuffer->indexBuffer;
+            entityDraw.indexInfo = entityBuffer->indexInfo;
+            entityDraw.vertexOffset = entityBuffer->vertexOffset;
+            entityDraw.textureBuffer = entityBuffer->textureBuffer;
+            entityDraw.firstInstance = firstInstance;
+            entityDraw.instanceCount = 1;
+            drawingBuffer.entityDraws.push_back(entityDraw);
+        }
+        frameInstanceIndices.push_back(entityBuffer->instanceIndex);
+        frameInstanceDrawIndices.push_back(static_cast<uint32_t>(drawingBuffer.entityDraws.size() - 1));
+    }
+
+    uint32_t drawnInstanceCount = static_cast<uint32_t>(frameInstanceIndices.size());
+    if (gpuCulling)
+    {
+        gpuCulling->PrepareFrame(
+            imageIndex,
+            drawingBuffer.entityDraws,
+            drawingBuffer.entityDrawBatches,
+            drawnInstanceCount,
+            instanceBuffers[imageIndex].get(),
+            visibleInstanceBuffers[imageIndex].get());
+    }
+    else if (drawnInstanceCount > 0)
+    {
+        // Every recorded instance is visible, each one reads its own input
+        frameVisibleInstanceIndices.resize(drawnInstanceCount);
+        for (uint32_t i = 0; i < drawnInstanceCount; i++)
+        {
+            frameVisibleInstanceIndices[i] = i;
+        }
+        visibleInstanceBuffers[imageIndex]->UpdateFast(
+            frameVisibleInstanceIndices.data(), static_cast<uint32_t>(sizeof(uint32_t) * drawnInstanceCount));
+    }
+}
+
 void VulkanBufferManager::LoadCubeMapBuffer(
     std::vector<Vertex> &vertices,
     std::vector<uint32_t> &indices,
@@ -90,19 +312,15 @@ void VulkanBufferManager::LoadCubeMapBuffer(
 {
     assert(images.size() > 0);
 
-    cubeMapVertexBuffer = std::make_unique<VulkanBuffer>(context, commandPool, vmaAllocator);
+    cubeMapVertexBuffer = std::make_unique<VulkanBuffer>(context, uploadManager.get(), vmaAllocator);
     cubeMapVertexBuffer->Load(
         VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
         VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
         vertices.data(),
         static_cast<uint32_t>(sizeof(Vertex) * vertices.size()));
 
-    cubeMapIndexBuffer = std::make_unique<VulkanBuffer>(context, commandPool, vmaAllocator);
-    cubeMapIndexBuffer->Load(
-        VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        indices.data(),
-        static_cast<uint32_t>(sizeof(uint32_t) * indices.size()));
+    cubeMapIndexBuffer = std::make_unique<VulkanBuffer>(context, uploadManager.get(), vmaAllocator);
+    cubeMapBufferCache.indexInfo = LoadIndexBuffer(cubeMapIndexBuffer.get(), indices, vertices.size());
 
     std::vector<uint8_t *> imagePixels;
     for (Image *image : images)
@@ -110,7 +328,7 @@ void VulkanBufferManager::LoadCubeMapBuffer(
         imagePixels.push_back(image->GetPixels());
     }
     cubeMapImage = std::make_shared<VulkanImage>(
-        context, commandPool, imageVmaAllocator, VulkanImageType::CubeMap);
+        context, uploadManager.get(), imageVmaAllocator, VulkanImageType::CubeMap);
     cubeMapImage->Load(
         imagePixels,
         images[0]->GetWidth(),
@@ -122,6 +340,10 @@ void VulkanBufferManager::LoadCubeMapBuffer(
         pipelines.cubeMapPipeline->GetImageDescriptorSetLayout());
     cubeMapTexture->Create();
     cubeMapTexture->AddImage(cubeMapImage, 0);
+    if (textureTable)
+    {
+        textureTable->SetEnvironmentMap(cubeMapImage.get());
+    }
 
     cubeMapBufferCache.textureBuffer = cubeMapTexture.get();
     cubeMapBufferCache.vertexBuffer = cubeMapVertexBuffer.get();
@@ -137,95 +359,174 @@ void VulkanBufferManager::LoadIntoBuffer(
     VulkanInstanceBufferInput &instanceBufferInput,
     std::vector<Vertex> &vertices,
     std::vector<uint32_t> &indices,
+    const std::vector<MeshLod> &lods,
     Material *material)
 {
-    if (vertexBuffers.count(meshId) == 0)
+    uint32_t meshBufferId;
+    if (!meshContents.TryAddReference(meshId, meshBufferId))
     {
-        std::shared_ptr<VulkanBuffer> vertexBuffer = std::make_shared<VulkanBuffer>(
-            context, commandPool, vmaAllocator);
-        vertexBuffer->Load(
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            vertices.data(),
-            static_cast<uint32_t>(sizeof(Vertex) * vertices.size()));
-        vertexBuffers[meshId] = std::move(vertexBuffer);
-
-        std::shared_ptr<VulkanBuffer> indexBuffer = std::make_shared<VulkanBuffer>(
-            context, commandPool, vmaAllocator);
-        indexBuffer->Load(
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            indices.data(),
-            static_cast<uint32_t>(sizeof(uint32_t) * indices.size()));
-        indexBuffers[meshId] = std::move(indexBuffer);
+        // Every level of detail indexes the same vertices, so they share one index buffer
+        std::vector<uint32_t> lodIndices(indices);
+        std::vector<uint32_t> lodIndexCounts = { static_cast<uint32_t>(indices.size()) };
+        for (const MeshLod &lod : lods)
+        {
+            lodIndices.insert(lodIndices.end(), lod.indices.begin(), lod.indices.end());
+            lodIndexCounts.push_back(static_cast<uint32_t>(lod.indices.size()));
+        }
 
-        vertexBufferCount[meshId] = 1;
-    }
-    else
-    {
-        vertexBufferCount[meshId] = vertexBufferCount[meshId] + 1;
+        uint64_t contentHash = ContentHash::Compute(vertices.data(), sizeof(Vertex) * vertices.size());
+        contentHash = ContentHash::Compute(lodIndices.data(), sizeof(uint32_t) * lodIndices.size(), contentHash);
+        contentHash = ContentHash::Compute(lodIndexCounts.data(), sizeof(uint32_t) * lodIndexCounts.size(), contentHash);
+        uint64_t contentSize = sizeof(Vertex) * vertices.size() + sizeof(uint32_t) * lodIndices.size();
+        if (meshContents.AddReference(meshId, contentHash, contentSize, meshBufferId))
+        {
+            Logger::Log(LogLevel::Debug, "Mesh {} has the same content as loaded mesh buffer {}, skipped uploading {:.1f} KB",
+                meshId, meshBufferId, contentSize / 1024.0f);
+        }
+        else
+        {
+            // The vertex ranges are aligned to the vertex size, so that the draws address them with a vertex offset
+            if (usePackedVertices)
+            {
+                std::vector<PackedVertex> packedVertices;
+                PackedVertexDecode vertexDecode = VertexPacker::Pack(vertices, packedVertices);
+                vertexAllocations[meshBufferId] = vertexArena->Allocate(
+                    packedVertices.data(), sizeof(PackedVertex) * packedVertices.size(), sizeof(PackedVertex));
+                vertexDecodes[meshBufferId] = vertexDecode;
+
+                VertexPackingError packingError = VertexPacker::MeasureError(vertices, packedVertices, vertexDecode);
+                Logger::Log(LogLevel::Debug, "Packed mesh {} vertices from {} to {} bytes, "
+                    "max error: position {:.5f}, normal {:.3f} degrees, uv {:.5f}",
+                    meshId, sizeof(Vertex) * vertices.size(), sizeof(PackedVertex) * packedVertices.size(),
+                    packingError.maxPositionError, packingError.maxNormalError, packingError.maxUVError);
+            }
+            else
+            {
+                vertexAllocations[meshBufferId] = vertexArena->Allocate(
+                    vertices.data(), sizeof(Vertex) * vertices.size(), sizeof(Vertex));
+            }
+
+            // 16 and 32 bit indices share the index buffers, each range is aligned to its index size
+            std::vector<uint16_t> shortIndices;
+            void *indexData;
+            uint32_t indexSize;
+            VulkanIndexBufferInfo indexInfo = PackIndices(lodIndices, vertices.size(), shortIndices, indexData, indexSize);
+            VkDeviceSize indexStride = indexInfo.indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+            VulkanArenaAllocation indexAllocation = indexArena->Allocate(indexData, indexSize, indexStride);
+            indexAllocations[meshBufferId] = indexAllocation;
+            indexInfo.firstIndex = static_cast<uint32_t>(indexAllocation.offset / indexStride);
+
+            std::vector<VulkanIndexBufferInfo> &lodIndexInfos = indexBufferInfos[meshBufferId];
+            for (uint32_t lodIndexCount : lodIndexCounts)
+            {
+                indexInfo.indexCount = lodIndexCount;
+                lodIndexInfos.push_back(indexInfo);
+                indexInfo.firstIndex += lodIndexCount;
+            }
+        }
     }
 
-    if (textureBuffers.count(imageId) == 0)
+    uint32_t textureBufferId;
+    // TODO: only load the diffuse image for now
+    if (AddTextureReference(imageId, material->diffuseImage.get(), ENTITY_TEXTURE_HASH_SEED, textureBufferId))
     {
-        // TODO: only load the diffuse image for now
-        std::shared_ptr<VulkanImage> diffuseImage = std::make_shared<VulkanImage>(
-            context, commandPool, imageVmaAllocator, VulkanImageType::Texture);
-        std::shared_ptr<Image> imageToLoad = material->diffuseImage;
-        diffuseImage->Load(
-            std::vector<uint8_t *>({ imageToLoad->GetPixels() }),
-            imageToLoad->GetWidth(),
-            imageToLoad->GetHeight());
+        Image *image = material->diffuseImage.get();
+        uint32_t baseMipLevel = 0;
+        if (IsStreamedTexture(image))
+        {
+            const std::vector<ImageMipLevel> &mipLevels = image->GetMipLevels();
+            StreamedTexture streamedTexture{};
+            streamedTexture.image = material->diffuseImage;
+            while (streamedTexture.lowestMipLevel + 1 < mipLevels.size()
+                && std::max(mipLevels[streamedTexture.lowestMipLevel].width, mipLevels[streamedTexture.lowestMipLevel].height)
+                    > TEXTURE_STREAMING_MIN_SIZE)
+            {
+                streamedTexture.lowestMipLevel++;
+            }
+            streamedTexture.residentMipLevel = streamedTexture.lowestMipLevel;
+            streamedTexture.requestedMipLevel = streamedTexture.lowestMipLevel;
+            streamedTextures[textureBufferId] = streamedTexture;
+            baseMipLevel = streamedTexture.lowestMipLevel;
+        }
+        std::shared_ptr<VulkanImage> diffuseImage = LoadTextureImage(textureBufferId, image, baseMipLevel);
 
-        std::unique_ptr<VulkanTexture> texture = std::make_unique<VulkanTexture>(
-            context,
-            descriptorPool,
-            pipelines.staticPipeline->GetImageDescriptorSetLayout());
-        texture->Create();
-        texture->AddImage(diffuseImage, 0);
-        texture->AddImage(cubeMapImage, 1);
+        std::unique_ptr<VulkanTexture> texture;
+        if (textureTable)
+        {
+            texture = std::make_unique<VulkanTexture>(context, VK_NULL_HANDLE, VK_NULL_HANDLE);
+            texture->AddImage(diffuseImage, 0);
+            textureIndices[textureBufferId] = textureTable->AddImage(diffuseImage.get());
+        }
+        else
+        {
+            texture = std::make_unique<VulkanTexture>(
+                context,
+                descriptorPool,
+                pipelines.staticPipeline->GetImageDescriptorSetLayout());
+            texture->Create();
+            texture->AddImage(diffuseImage, 0);
+            texture->AddImage(cubeMapImage, 1);
+
+            // Every index below the number of materials is taken when none was freed
+            uint32_t materialIndex = static_cast<uint32_t>(materialIndices.size());
+            if (!freeMaterialIndices.empty())
+            {
+                materialIndex = freeMaterialIndices.back();
+                freeMaterialIndices.pop_back();
+            }
+            materialIndices[textureBufferId] = materialIndex;
+        }
 
-        textureBuffers[imageId] = std::move(texture);
-        textureBufferCount[imageId] = 1;
+        textureBuffers[textureBufferId] = std::move(texture);
     }
-    else
+
+    if (usePackedVertices)
+    {
+        instanceBufferInput.vertexDecode = vertexDecodes[meshBufferId];
+    }
+    if (textureTable)
     {
-        textureBufferCount[imageId] = textureBufferCount[imageId] + 1;
+        instanceBufferInput.textureIndex = textureIndices[textureBufferId];
     }
 
-    for (uint32_t i = 0; i < frameBufferSize; i++)
+    // Loading an entity only takes an index in the instance buffers, they are written every frame
+    uint32_t instanceIndex;
+    if (!freeInstanceIndices.empty())
     {
-        std::shared_ptr<VulkanBuffer> instanceBuffer = std::make_shared<VulkanBuffer>(
-            context, commandPool, vmaAllocator);
-        instanceBuffer->Load(
-            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            &instanceBufferInput,
-            sizeof(VulkanInstanceBufferInput));
-        instanceBuffer->CreateDescriptorSet(
-            descriptorPool,
-            pipelines.staticPipeline->GetInstanceDescriptorSetLayout(),
-            VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            sizeof(VulkanInstanceBufferInput));
-        instanceBuffers[instanceId].push_back(std::move(instanceBuffer));
+        instanceIndex = freeInstanceIndices.back();
+        freeInstanceIndices.pop_back();
+        instanceInputs[instanceIndex] = instanceBufferInput;
     }
+    else
+    {
+        instanceIndex = static_cast<uint32_t>(instanceInputs.size());
+        instanceInputs.push_back(instanceBufferInput);
+    }
+    instanceIndices[instanceId] = instanceIndex;
 
     VulkanEntityBufferIds bufferIds{};
     bufferIds.instanceBufferId = instanceId;
-    bufferIds.vertexBufferId = meshId;
-    bufferIds.indexBufferId = meshId;
-    bufferIds.textureBufferId = imageId;
+    bufferIds.meshId = meshId;
+    bufferIds.textureId = imageId;
+    bufferIds.vertexBufferId = meshBufferId;
+    bufferIds.indexBufferId = meshBufferId;
+    bufferIds.textureBufferId = textureBufferId;
     bufferIdCache[instanceId] = bufferIds;
 
     VulkanEntityBuffer entityBuffer{};
-    for (uint32_t i = 0; i < frameBufferSize; i++)
-    {
-        entityBuffer.instanceBuffers.push_back(
-            instanceBuffers[bufferIds.instanceBufferId][i].get());
-    }
-    entityBuffer.vertexBuffer = vertexBuffers[bufferIds.vertexBufferId].get();
-    entityBuffer.indexBuffer = indexBuffers[bufferIds.indexBufferId].get();
+    entityBuffer.instanceIndex = instanceIndex;
+    const VulkanArenaAllocation &vertexAllocation = vertexAllocations[bufferIds.vertexBufferId];
+    entityBuffer.vertexBuffer = vertexAllocation.buffer;
+    entityBuffer.vertexOffset = static_cast<int32_t>(
+        vertexAllocation.offset / (usePackedVertices ? sizeof(PackedVertex) : sizeof(Vertex)));
+    entityBuffer.indexBuffer = indexAllocations[bufferIds.indexBufferId].buffer;
+    entityBuffer.indexInfo = indexBufferInfos[bufferIds.indexBufferId][0];
     entityBuffer.textureBuffer = textureBuffers[bufferIds.textureBufferId].get();
+    entityBuffer.vertexBufferIndex = vertexAllocation.bufferIndex;
+    entityBuffer.indexBufferIndex = indexAllocations[bufferIds.indexBufferId].bufferIndex;
+    // The texture only splits the draws when it is bound per draw
+    entityBuffer.materialIndex = textureTable ? 0 : materialIndices[bufferIds.textureBufferId];
+    entityBuffer.visible = true;
     entityBufferCache[instanceId] = entityBuffer;
 }
 
@@ -256,7 +557,7 @@ void VulkanBufferManager::LoadScreenObjectBuffer(
     if (screenObjectBuffers.count(screenObjectId) == 0)
     {
         std::shared_ptr<VulkanBuffer> vertexBuffer = std::make_shared<VulkanBuffer>(
-            context, commandPool, vmaAllocator);
+            context, uploadManager.get(), vmaAllocator);
         vertexBuffer->Load(
             VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
@@ -265,22 +566,25 @@ void VulkanBufferManager::LoadScreenObjectBuffer(
             MAX_VERTEX_BUFFER_CAPACITY);
         screenObjectBuffers[screenObjectId] = std::move(vertexBuffer);
 
-        std::shared_ptr<VulkanImage> screenImage = std::make_shared<VulkanImage>(
-            context, commandPool, imageVmaAllocator, VulkanImageType::Texture);
-        screenImage->Load(
-            std::vector<uint8_t *>({ image->GetPixels() }),
-            image->GetWidth(),
-            image->GetHeight());
-
-        std::unique_ptr<VulkanTexture> screenTexture = std::make_unique<VulkanTexture>(
-            context,
-            descriptorPool,
-            pipelines.screenPipeline->GetImageDescriptorSetLayout());
-        screenTexture->Create();
-        screenTexture->AddImage(screenImage, 0);
-
-        textureBuffers[screenObjectId] = std::move(screenTexture);
-        textureBufferCount[screenObjectId] = 1;
+        uint32_t textureBufferId;
+        if (AddTextureReference(screenObjectId, image, SCREEN_TEXTURE_HASH_SEED, textureBufferId))
+        {
+            std::shared_ptr<VulkanImage> screenImage = std::make_shared<VulkanImage>(
+                context, uploadManager.get(), imageVmaAllocator, VulkanImageType::Texture);
+            screenImage->Load(
+                std::vector<uint8_t *>({ image->GetPixels() }),
+                image->GetWidth(),
+                image->GetHeight());
+
+            std::unique_ptr<VulkanTexture> screenTexture = std::make_unique<VulkanTexture>(
+                context,
+                descriptorPool,
+                pipelines.screenPipeline->GetImageDescriptorSetLayout());
+            screenTexture->Create();
+            screenTexture->AddImage(screenImage, 0);
+
+            textureBuffers[textureBufferId] = std::move(screenTexture);
+        }
     }
     else
     {
@@ -290,9 +594,12 @@ void VulkanBufferManager::LoadScreenObjectBuffer(
             static_cast<uint32_t>(sizeof(ScreenObjectVertex) * vertices.size()));
     }
 
+    uint32_t textureBufferId = 0;
+    textureContents.TryGetResourceId(screenObjectId, textureBufferId);
+
     VulkanScreenObjectBuffer screenObjectBuffer{};
     screenObjectBuffer.vertexBuffer = screenObjectBuffers[screenObjectId].get();
-    screenObjectBuffer.textureBuffer = textureBuffers[screenObjectId].get();
+    screenObjectBuffer.textureBuffer = textureBuffers[textureBufferId].get();
     screenObjectBufferCache[screenObjectId] = screenObjectBuffer;
 }
 
@@ -305,7 +612,7 @@ void VulkanBufferManager::LoadTerrainIntoBuffer(
     if (terrainVertexBuffers.count(terrainId) == 0)
     {
         std::shared_ptr<VulkanBuffer> vertexBuffer = std::make_shared<VulkanBuffer>(
-            context, commandPool, vmaAllocator);
+            context, uploadManager.get(), vmaAllocator);
         vertexBuffer->Load(
             VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
@@ -314,30 +621,25 @@ void VulkanBufferManager::LoadTerrainIntoBuffer(
         terrainVertexBuffers[terrainId] = std::move(vertexBuffer);
 
         std::shared_ptr<VulkanBuffer> indexBuffer = std::make_shared<VulkanBuffer>(
-            context, commandPool, vmaAllocator);
-        indexBuffer->Load(
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            indices.data(),
-            static_cast<uint32_t>(sizeof(uint32_t) * indices.size()));
+            context, uploadManager.get(), vmaAllocator);
+        terrainIndexBufferInfos[terrainId] = LoadIndexBuffer(indexBuffer.get(), indices, vertices.size());
         terrainIndexBuffers[terrainId] = std::move(indexBuffer);
 
-        std::shared_ptr<VulkanImage> terrainImage = std::make_shared<VulkanImage>(
-            context, commandPool, imageVmaAllocator, VulkanImageType::Texture);
-        terrainImage->Load(
-            std::vector<uint8_t *>({ texture->GetPixels() }),
-            texture->GetWidth(),
-            texture->GetHeight());
+        // Terrain buffers are updated in place, so only the texture is shared
+        uint32_t textureBufferId;
+        if (AddTextureReference(terrainId, texture, TERRAIN_TEXTURE_HASH_SEED, textureBufferId))
+        {
+            std::shared_ptr<VulkanImage> terrainImage = LoadTextureImage(textureBufferId, texture);
 
-        std::unique_ptr<VulkanTexture> terrainTexture = std::make_unique<VulkanTexture>(
-            context,
-            descriptorPool,
-            pipelines.terrainPipeline->GetImageDescriptorSetLayout());
-        terrainTexture->Create();
-        terrainTexture->AddImage(terrainImage, 0);
+            std::unique_ptr<VulkanTexture> terrainTexture = std::make_unique<VulkanTexture>(
+                context,
+                descriptorPool,
+                pipelines.terrainPipeline->GetImageDescriptorSetLayout());
+            terrainTexture->Create();
+            terrainTexture->AddImage(terrainImage, 0);
 
-        textureBuffers[terrainId] = std::move(terrainTexture);
-        textureBufferCount[terrainId] = 1;
+            textureBuffers[textureBufferId] = std::move(terrainTexture);
+        }
     }
     else
     {
@@ -345,19 +647,24 @@ void VulkanBufferManager::LoadTerrainIntoBuffer(
         std::shared_ptr<VulkanBuffer> indexBuffer = terrainIndexBuffers[terrainId];
 
         vertexBuffer->Update(vertices.data(), static_cast<uint32_t>(sizeof(Vertex) * vertices.size()));
-        indexBuffer->Update(indices.data(), static_cast<uint32_t>(sizeof(uint32_t) * indices.size()));
+        terrainIndexBufferInfos[terrainId] = LoadIndexBuffer(indexBuffer.get(), indices, vertices.size());
     }
 
+    uint32_t textureBufferId = 0;
+    textureContents.TryGetResourceId(terrainId, textureBufferId);
+
     VulkanTerrainBuffer terrainBuffer{};
     terrainBuffer.vertexBuffer = terrainVertexBuffers[terrainId].get();
     terrainBuffer.indexBuffer = terrainIndexBuffers[terrainId].get();
-    terrainBuffer.textureBuffer = textureBuffers[terrainId].get();
+    terrainBuffer.indexInfo = terrainIndexBufferInfos[terrainId];
+    terrainBuffer.textureBuffer = textureBuffers[textureBufferId].get();
+    terrainBuffer.visible = true;
     terrainBufferCache[terrainId] = terrainBuffer;
 }
 
-void VulkanBufferManager::ResetCommandPool(VkCommandPool commandPool)
+void VulkanBufferManager::FlushUploads()
 {
-    this->commandPool = commandPool;
+    uploadManager->Flush();
 }
 
 void VulkanBufferManager::ResetScreenBuffers()
@@ -378,32 +685,310 @@ void VulkanBufferManager::UnloadBuffer(uint32_t instanceId)
     {
         VulkanEntityBufferIds bufferIds = bufferIdCache[instanceId];
         
-        uint32_t instanceBufferId = bufferIds.instanceBufferId;
-        std::vector<std::shared_ptr<VulkanBuffer>> &instanceBuffersToRemove = instanceBuffers[instanceBufferId];
-        for (auto const &instanceBufferToRemove : instanceBuffersToRemove)
+        // The input stays in the instance buffers until the index is reused, no draw reads it
+        freeInstanceIndices.push_back(instanceIndices[bufferIds.instanceBufferId]);
+        instanceIndices.erase(bufferIds.instanceBufferId);
+
+        uint32_t vertexBufferId;
+        if (meshContents.RemoveReference(bufferIds.meshId, vertexBufferId))
+        {
+            // The ranges are only reused once the frames drawing them are complete
+            VulkanArenaAllocation vertexAllocation = vertexAllocations[vertexBufferId];
+            VulkanArenaAllocation indexAllocation = indexAllocations[vertexBufferId];
+            context->GetDeletionQueue()->Defer([this, vertexAllocation, indexAllocation]()
+                {
+                    vertexArena->Free(vertexAllocation);
+                    indexArena->Free(indexAllocation);
+                });
+            vertexAllocations.erase(vertexBufferId);
+            indexAllocations.erase(vertexBufferId);
+            indexBufferInfos.erase(vertexBufferId);
+            vertexDecodes.erase(vertexBufferId);
+        }
+
+        DestroyTextureBuffer(bufferIds.textureId);
+
+        bufferIdCache.erase(instanceId);
+        entityBufferCache.erase(instanceId);
+    }
+}
+
+void VulkanBufferManager::SetEntityLod(uint32_t instanceId, uint32_t lod)
+{
+    if (bufferIdCache.count(instanceId) == 0)
+    {
+        return;
+    }
+
+    const std::vector<VulkanIndexBufferInfo> &lodIndexInfos = indexBufferInfos[bufferIdCache[instanceId].indexBufferId];
+    entityBufferCache[instanceId].indexInfo = lodIndexInfos[std::min<size_t>(lod, lodIndexInfos.size() - 1)];
+}
+
+bool VulkanBufferManager::SetEntityVisible(uint32_t instanceId, bool visible)
+{
+    auto entityBuffer = entityBufferCache.find(instanceId);
+    if (entityBuffer == entityBufferCache.end() || entityBuffer->second.visible == visible)
+    {
+        return false;
+    }
+
+    entityBuffer->second.visible = visible;
+    return true;
+}
+
+bool VulkanBufferManager::SetTerrainVisible(uint32_t terrainId, bool visible)
+{
+    auto terrainBuffer = terrainBufferCache.find(terrainId);
+    if (terrainBuffer == terrainBufferCache.end() || terrainBuffer->second.visible == visible)
+    {
+        return false;
+    }
+
+    terrainBuffer->second.visible = visible;
+    return true;
+}
+
+bool VulkanBufferManager::UpdateTextureResidency(const std::unordered_map<uint32_t, VulkanTextureRequest> &requests)
+{
+    memoryBudget->Update();
+    if (streamedTextures.empty())
+    {
+        return false;
+    }
+
+    std::unordered_map<uint32_t, VulkanTextureRequest> bufferRequests;
+    for (const auto &[textureId, textureRequest] : requests)
+    {
+        uint32_t textureBufferId;
+        if (!textureContents.TryGetResourceId(textureId, textureBufferId))
         {
-            instanceBufferToRemove->Unload();
+            continue;
         }
-        instanceBuffers.erase(instanceBufferId);
 
-        uint32_t vertexBufferId = bufferIds.vertexBufferId;
-        vertexBufferCount[vertexBufferId] = vertexBufferCount[vertexBufferId] - 1;
-        if (vertexBufferCount[vertexBufferId] == 0)
+        auto request = bufferRequests.find(textureBufferId);
+        if (request == bufferRequests.end())
+        {
+            bufferRequests[textureBufferId] = textureRequest;
+        }
+        else
         {
-            std::shared_ptr<VulkanBuffer> vertexBuffer = vertexBuffers[vertexBufferId];
-            vertexBuffer->Unload();
-            vertexBuffers.erase(vertexBufferId);
+            request->second.mipLevel = std::min(request->second.mipLevel, textureRequest.mipLevel);
+            request->second.priority = std::max(request->second.priority, textureRequest.priority);
+        }
+    }
 
-            std::shared_ptr<VulkanBuffer> indexBuffer = indexBuffers[vertexBufferId];
-            indexBuffer->Unload();
-            indexBuffers.erase(vertexBufferId);
+    std::unordered_map<uint32_t, uint32_t> targetMipLevels;
+    VkDeviceSize plannedMemorySize = totalTextureMemorySize;
+    for (auto &[textureBufferId, streamedTexture] : streamedTextures)
+    {
+        uint32_t targetMipLevel = streamedTexture.lowestMipLevel;
+        streamedTexture.priority = VulkanResourcePriority::LodProxy;
+        auto request = bufferRequests.find(textureBufferId);
+        if (request != bufferRequests.end())
+        {
+            targetMipLevel = std::min(request->second.mipLevel, streamedTexture.lowestMipLevel);
+            streamedTexture.priority = request->second.priority;
         }
+        streamedTexture.requestedMipLevel = targetMipLevel;
 
-        DestroyTextureBuffer(bufferIds.textureBufferId);
+        // A texture that still needs all but its finest level keeps it, so that it is not uploaded again and again
+        // while the camera stays around the distance where the level is needed
+        if (request != bufferRequests.end() && targetMipLevel == streamedTexture.residentMipLevel + 1)
+        {
+            targetMipLevel = streamedTexture.residentMipLevel;
+        }
+        targetMipLevels[textureBufferId] = targetMipLevel;
+        plannedMemorySize = plannedMemorySize - textureMemorySizes[textureBufferId]
+            + GetMipChainSize(streamedTexture.image.get(), targetMipLevel);
+    }
 
-        bufferIdCache.erase(instanceId);
-        entityBufferCache.erase(instanceId);
+    // Textures get what the other resources leave under the target usage of the device memory budget
+    VkDeviceSize usage = memoryBudget->GetUsage();
+    VkDeviceSize otherMemorySize = usage - std::min(usage, totalTextureMemorySize);
+    VkDeviceSize targetUsage = memoryBudget->GetTargetUsage();
+    VkDeviceSize textureMemoryBudget = std::min(
+        TEXTURE_MEMORY_BUDGET,
+        targetUsage > otherMemorySize ? targetUsage - otherMemorySize : 0);
+
+    // Under memory pressure, the textures with the lowest priority give up their finest levels first,
+    // the largest ones first within the same priority.
+    // A texture giving up a level is queued again with its smaller size, so that each level dropped is a heap update
+    // instead of a scan of all the streamed textures
+    struct EvictionCandidate
+    {
+        VulkanResourcePriority priority;
+        VkDeviceSize size;
+        uint32_t textureBufferId;
+    };
+    auto isEvictedAfter = [](const EvictionCandidate &a, const EvictionCandidate &b)
+    {
+        return a.priority != b.priority ? a.priority > b.priority : a.size < b.size;
+    };
+    std::priority_queue<EvictionCandidate, std::vector<EvictionCandidate>, decltype(isEvictedAfter)> evictionQueue(
+        isEvictedAfter);
+    if (plannedMemorySize > textureMemoryBudget)
+    {
+        for (const auto &[textureBufferId, targetMipLevel] : targetMipLevels)
+        {
+            const StreamedTexture &streamedTexture = streamedTextures[textureBufferId];
+            if (targetMipLevel < streamedTexture.lowestMipLevel)
+            {
+                evictionQueue.push({
+                    streamedTexture.priority,
+                    GetMipChainSize(streamedTexture.image.get(), targetMipLevel),
+                    textureBufferId });
+            }
+        }
     }
+    while (plannedMemorySize > textureMemoryBudget && !evictionQueue.empty())
+    {
+        EvictionCandidate candidate = evictionQueue.top();
+        evictionQueue.pop();
+
+        const StreamedTexture &streamedTexture = streamedTextures[candidate.textureBufferId];
+        uint32_t &targetMipLevel = targetMipLevels[candidate.textureBufferId];
+        targetMipLevel++;
+        VkDeviceSize size = GetMipChainSize(streamedTexture.image.get(), targetMipLevel);
+        plannedMemorySize -= candidate.size - size;
+        if (targetMipLevel < streamedTexture.lowestMipLevel)
+        {
+            evictionQueue.push({ candidate.priority, size, candidate.textureBufferId });
+        }
+    }
+
+    bool budgetExceeded = plannedMemorySize > textureMemoryBudget;
+    if (budgetExceeded && !textureMemoryBudgetExceeded)
+    {
+        Logger::Log(LogLevel::Warning, "Texture memory of {:.1f} MB exceeds its budget of {:.1f} MB "
+            "with every streamed texture at its lowest residency, {:.1f} MB of {:.1f} MB device memory in use",
+            plannedMemorySize / (1024.0f * 1024.0f), textureMemoryBudget / (1024.0f * 1024.0f),
+            usage / (1024.0f * 1024.0f), memoryBudget->GetBudget() / (1024.0f * 1024.0f));
+    }
+    textureMemoryBudgetExceeded = budgetExceeded;
+
+    // Dropping levels only uploads the coarse levels again, while added levels are limited per update
+    // starting from the textures that miss the most levels
+    std::vector<std::pair<uint32_t, uint32_t>> residencyChanges;
+    std::vector<std::pair<uint32_t, uint32_t>> residencyIncreases;
+    for (auto &[textureBufferId, targetMipLevel] : targetMipLevels)
+    {
+        uint32_t residentMipLevel = streamedTextures[textureBufferId].residentMipLevel;
+        if (targetMipLevel > residentMipLevel)
+        {
+            residencyChanges.push_back(std::make_pair(textureBufferId, targetMipLevel));
+        }
+        else if (targetMipLevel < residentMipLevel)
+        {
+            residencyIncreases.push_back(std::make_pair(textureBufferId, targetMipLevel));
+        }
+    }
+    std::sort(
+        residencyIncreases.begin(),
+        residencyIncreases.end(),
+        [&](const std::pair<uint32_t, uint32_t> &a, const std::pair<uint32_t, uint32_t> &b)
+        {
+            return streamedTextures[a.first].residentMipLevel - a.second
+                > streamedTextures[b.first].residentMipLevel - b.second;
+        });
+    VkDeviceSize uploadSize = 0;
+    for (const auto &[textureBufferId, targetMipLevel] : residencyIncreases)
+    {
+        VkDeviceSize textureUploadSize = GetMipChainSize(streamedTextures[textureBufferId].image.get(), targetMipLevel);
+        if (uploadSize > 0 && uploadSize + textureUploadSize > TEXTURE_STREAMING_MAX_UPLOAD_SIZE)
+        {
+            continue;
+        }
+        uploadSize += textureUploadSize;
+        residencyChanges.push_back(std::make_pair(textureBufferId, targetMipLevel));
+    }
+
+    if (residencyChanges.empty())
+    {
+        return false;
+    }
+
+    // Every old image is unloaded before the new ones are loaded, so that their uploads are recorded into one batch.
+    // The submitted frames may still read the old images, which are only destroyed once these frames are complete
+    for (const auto &[textureBufferId, targetMipLevel] : residencyChanges)
+    {
+        textureBuffers[textureBufferId]->GetImage(0)->Unload();
+    }
+    std::unordered_map<uint32_t, uint32_t> replacedTextureIndices;
+    std::unordered_map<const VulkanTexture *, VulkanTexture *> replacedTextures;
+    for (const auto &[textureBufferId, targetMipLevel] : residencyChanges)
+    {
+        ReloadStreamedTexture(textureBufferId, targetMipLevel, replacedTextureIndices, replacedTextures);
+    }
+
+    // The entities read the new textures from the next frame written, or the next commands recorded
+    for (auto &[instanceId, entityBuffer] : entityBufferCache)
+    {
+        uint32_t &textureIndex = instanceInputs[entityBuffer.instanceIndex].textureIndex;
+        auto replacedTextureIndex = replacedTextureIndices.find(textureIndex);
+        if (replacedTextureIndex != replacedTextureIndices.end())
+        {
+            textureIndex = replacedTextureIndex->second;
+        }
+        auto replacedTexture = replacedTextures.find(entityBuffer.textureBuffer);
+        if (replacedTexture != replacedTextures.end())
+        {
+            entityBuffer.textureBuffer = replacedTexture->second;
+        }
+    }
+
+    Logger::Log(LogLevel::Debug, "Changed the resident mip levels of {} textures, uploading {:.1f} MB, "
+        "{:.1f} MB of texture memory in use",
+        residencyChanges.size(), uploadSize / (1024.0f * 1024.0f), totalTextureMemorySize / (1024.0f * 1024.0f));
+    // Texture table slots are read from the instance inputs, so only the per texture sets invalidate the commands
+    return !textureTable;
+}
+
+TextureResidencyStats VulkanBufferManager::GetTextureResidencyStats() const
+{
+    TextureResidencyStats stats{};
+    stats.streamedTextureCount = static_cast<uint32_t>(streamedTextures.size());
+    stats.residentMemorySize = totalTextureMemorySize;
+    stats.fullMemorySize = totalTextureMemorySize;
+    stats.deviceMemoryUsage = memoryBudget->GetUsage();
+    stats.deviceMemoryBudget = memoryBudget->GetBudget();
+    for (const auto &[textureBufferId, streamedTexture] : streamedTextures)
+    {
+        if (streamedTexture.residentMipLevel > streamedTexture.requestedMipLevel)
+        {
+            stats.pendingTextureCount++;
+        }
+        stats.fullMemorySize = stats.fullMemorySize - textureMemorySizes.at(textureBufferId)
+            + GetMipChainSize(streamedTexture.image.get(), 0);
+    }
+    return stats;
+}
+
+ResourceSharingStats VulkanBufferManager::GetResourceSharingStats() const
+{
+    ResourceSharingStats stats{};
+    stats.sharedMeshCount = meshContents.GetSharedLoadCount();
+    stats.savedMeshSize = meshContents.GetSavedSize();
+    stats.sharedTextureCount = textureContents.GetSharedLoadCount();
+    stats.savedTextureSize = textureContents.GetSavedSize();
+    return stats;
+}
+
+GeometryBufferStats VulkanBufferManager::GetGeometryBufferStats() const
+{
+    VulkanArenaStats vertexStats = vertexArena->GetStats();
+    VulkanArenaStats indexStats = indexArena->GetStats();
+
+    GeometryBufferStats stats{};
+    stats.meshCount = vertexStats.allocationCount;
+    stats.bufferCount = vertexStats.bufferCount + indexStats.bufferCount;
+    stats.usedSize = vertexStats.usedSize + indexStats.usedSize;
+    stats.capacity = vertexStats.capacity + indexStats.capacity;
+    VkDeviceSize freeSize = stats.capacity - stats.usedSize;
+    if (freeSize > 0)
+    {
+        stats.fragmentation = 1.0f - static_cast<float>(vertexStats.largestFreeSize + indexStats.largestFreeSize) / freeSize;
+    }
+    return stats;
 }
 
 void VulkanBufferManager::UnloadScreenObjectBuffer(uint32_t screenObjectId)
@@ -431,6 +1016,7 @@ void VulkanBufferManager::UnloadTerrainBuffer(uint32_t terrainId)
         std::shared_ptr<VulkanBuffer> indexBuffer = terrainIndexBuffers[terrainId];
         indexBuffer->Unload();
         terrainIndexBuffers.erase(terrainId);
+        terrainIndexBufferInfos.erase(terrainId);
 
         DestroyTextureBuffer(terrainId);
 
@@ -438,14 +1024,37 @@ void VulkanBufferManager::UnloadTerrainBuffer(uint32_t terrainId)
     }
 }
 
-void VulkanBufferManager::UpdateInstanceBuffer(uint32_t instanceId, VulkanInstanceBufferInput &input, uint32_t imageIndex)
+void VulkanBufferManager::UpdateInstanceTransformation(uint32_t instanceId, const glm::mat4 &transformation)
 {
-    if (instanceBuffers.count(instanceId) == 0)
+    auto instanceIndex = instanceIndices.find(instanceId);
+    if (instanceIndex == instanceIndices.end())
     {
         return;
     }
 
-    instanceBuffers[instanceId][imageIndex]->UpdateFast(&input, sizeof(VulkanInstanceBufferInput));
+    // The vertex decode ranges never change after the entity is loaded
+    instanceInputs[instanceIndex->second].transformation = transformation;
+}
+
+void VulkanBufferManager::UpdateInstanceBuffer(uint32_t imageIndex)
+{
+    // Only the entities drawn by the commands recorded for the image, in their draw order
+    const std::vector<uint32_t> &frameInstanceIndices = drawInstanceIndices[imageIndex];
+    uint32_t instanceCount = std::min(static_cast<uint32_t>(frameInstanceIndices.size()), instanceBufferCapacities[imageIndex]);
+    if (instanceCount == 0)
+    {
+        return;
+    }
+
+    const std::vector<uint32_t> &frameInstanceDrawIndices = drawInstanceDrawIndices[imageIndex];
+    frameInstanceInputs.resize(instanceCount);
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        frameInstanceInputs[i] = instanceInputs[frameInstanceIndices[i]];
+        frameInstanceInputs[i].drawIndex = frameInstanceDrawIndices[i];
+    }
+    instanceBuffers[imageIndex]->UpdateFast(
+        frameInstanceInputs.data(), static_cast<uint32_t>(sizeof(VulkanInstanceBufferInput) * instanceCount));
 }
 
 void VulkanBufferManager::UpdateUniformBuffer(VulkanUniformBufferInput &input, uint32_t imageIndex)
@@ -453,6 +1062,14 @@ void VulkanBufferManager::UpdateUniformBuffer(VulkanUniformBufferInput &input, u
     uniformBuffers[imageIndex]->UpdateFast(&input, sizeof(VulkanUniformBufferInput));
 }
 
+void VulkanBufferManager::UpdateFrustum(const std::array<glm::vec4, 6> &frustumPlanes, uint32_t imageIndex)
+{
+    if (gpuCulling)
+    {
+        gpuCulling->UpdateFrustum(imageIndex, frustumPlanes);
+    }
+}
+
 void VulkanBufferManager::CreateDescriptorPool()
 {
     VkDescriptorPoolCreateInfo poolInfo{};
@@ -460,11 +1077,87 @@ void VulkanBufferManager::CreateDescriptorPool()
     poolInfo.poolSizeCount = STATIC_PIPELINE_DESCRIPTOR_POOL_SIZE_COUNT;
     poolInfo.pPoolSizes = STATIC_PIPELINE_DESCRIPTOR_POOL_SIZES;
     poolInfo.maxSets = MAX_DESCRIPTOR_SETS;
+    // The sets of the textures replaced by the streaming are freed, so that they do not use up the pool
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
     ASSERT_VK_RESULT_SUCCESS(
         vkCreateDescriptorPool(context->GetLogicalDevice(), &poolInfo, nullptr, &descriptorPool),
         "Failed to create descriptor pool");
 }
 
+void VulkanBufferManager::CreateInstanceBuffers()
+{
+    instanceBufferCapacities.resize(frameBufferSize);
+    instanceDescriptorSets.resize(frameBufferSize);
+    for (uint32_t i = 0; i < frameBufferSize; i++)
+    {
+        instanceBuffers.push_back(std::make_unique<VulkanBuffer>(context, uploadManager.get(), vmaAllocator));
+        visibleInstanceBuffers.push_back(std::make_unique<VulkanBuffer>(context, uploadManager.get(), vmaAllocator));
+        LoadInstanceBuffers(i, INITIAL_INSTANCE_CAPACITY);
+
+        VkDescriptorSetLayout descriptorSetLayout = pipelines.staticPipeline->GetInstanceDescriptorSetLayout();
+        VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+        descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        descriptorSetAllocInfo.descriptorPool = descriptorPool;
+        descriptorSetAllocInfo.descriptorSetCount = 1;
+        descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
+        ASSERT_VK_RESULT_SUCCESS(
+            vkAllocateDescriptorSets(context->GetLogicalDevice(), &descriptorSetAllocInfo, &instanceDescriptorSets[i]),
+            "Failed to allocate instance descriptor set");
+        UpdateInstanceDescriptorSet(i);
+    }
+    drawInstanceIndices.resize(frameBufferSize);
+    drawInstanceDrawIndices.resize(frameBufferSize);
+}
+
+void VulkanBufferManager::LoadInstanceBuffers(uint32_t imageIndex, uint32_t capacity)
+{
+    instanceBuffers[imageIndex]->Load(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        nullptr,
+        0,
+        static_cast<uint32_t>(sizeof(VulkanInstanceBufferInput) * capacity));
+    // Only the culling compute shader writes the visible instances when it runs, the CPU writes them otherwise
+    visibleInstanceBuffers[imageIndex]->Load(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        gpuCulling
+            ? VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+            : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        nullptr,
+        0,
+        static_cast<uint32_t>(sizeof(uint32_t) * capacity));
+    instanceBufferCapacities[imageIndex] = capacity;
+}
+
+void VulkanBufferManager::UpdateInstanceDescriptorSet(uint32_t imageIndex)
+{
+    VkBuffer buffers[STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDING_COUNT] =
+    {
+        instanceBuffers[imageIndex]->GetBuffer(),
+        visibleInstanceBuffers[imageIndex]->GetBuffer()
+    };
+
+    VkDescriptorBufferInfo descriptorBufferInfos[STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDING_COUNT]{};
+    VkWriteDescriptorSet descriptorWrites[STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDING_COUNT]{};
+    for (uint32_t binding = 0; binding < STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDING_COUNT; binding++)
+    {
+        descriptorBufferInfos[binding].buffer = buffers[binding];
+        descriptorBufferInfos[binding].offset = 0;
+        descriptorBufferInfos[binding].range = VK_WHOLE_SIZE;
+
+        descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[binding].dstSet = instanceDescriptorSets[imageIndex];
+        descriptorWrites[binding].dstBinding = binding;
+        descriptorWrites[binding].dstArrayElement = 0;
+        descriptorWrites[binding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[binding].descriptorCount = 1;
+        descriptorWrites[binding].pBufferInfo = &descriptorBufferInfos[binding];
+    }
+
+    vkUpdateDescriptorSets(
+        context->GetLogicalDevice(), STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDING_COUNT, descriptorWrites, 0, nullptr);
+}
+
 void VulkanBufferManager::CreateMemoryAllocator()
 {
     VmaAllocatorCreateInfo createInfo{};
@@ -472,6 +1165,10 @@ void VulkanBufferManager::CreateMemoryAllocator()
     createInfo.physicalDevice = context->GetPhysicalDevice();
     createInfo.vulkanApiVersion = VK_API_VERSION_1_0;
     createInfo.instance = context->GetInstance();
+    if (context->SupportsMemoryBudget())
+    {
+        createInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+    }
 
     ASSERT_VK_RESULT_SUCCESS(
         vmaCreateAllocator(&createInfo, &vmaAllocator),
@@ -484,7 +1181,7 @@ void VulkanBufferManager::CreateMemoryAllocator()
 void VulkanBufferManager::CreateLineBuffer()
 {
     lineVertexBuffer = std::make_unique<VulkanBuffer>(
-        context, commandPool, vmaAllocator);
+        context, uploadManager.get(), vmaAllocator);
 }
 
 void VulkanBufferManager::CreateScreenBuffers()
@@ -492,7 +1189,7 @@ void VulkanBufferManager::CreateScreenBuffers()
     VulkanScreenBufferInput dummyScreenBufferInput{};
     for (uint32_t i = 0; i < frameBufferSize; i++)
     {
-        std::unique_ptr<VulkanBuffer> screenBuffer = std::make_unique<VulkanBuffer>(context, commandPool, vmaAllocator);
+        std::unique_ptr<VulkanBuffer> screenBuffer = std::make_unique<VulkanBuffer>(context, uploadManager.get(), vmaAllocator);
         screenBuffer->Load(
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
@@ -513,7 +1210,7 @@ void VulkanBufferManager::CreateUniformBuffers()
 {
     for (uint32_t i = 0; i < frameBufferSize; i++)
     {
-        std::unique_ptr<VulkanBuffer> uniformBuffer = std::make_unique<VulkanBuffer>(context, commandPool, vmaAllocator);
+        std::unique_ptr<VulkanBuffer> uniformBuffer = std::make_unique<VulkanBuffer>(context, uploadManager.get(), vmaAllocator);
         VulkanUniformBufferInput defaultUniformBufferInput{};
         uniformBuffer->Load(
             VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
@@ -542,6 +1239,24 @@ void VulkanBufferManager::DestroyCubeMapBuffer()
     cubeMapVertexBuffer->Unload();
 }
 
+void VulkanBufferManager::DestroyInstanceBuffers()
+{
+    for (std::unique_ptr<VulkanBuffer> &instanceBuffer : instanceBuffers)
+    {
+        instanceBuffer->Unload();
+    }
+    for (std::unique_ptr<VulkanBuffer> &visibleInstanceBuffer : visibleInstanceBuffers)
+    {
+        visibleInstanceBuffer->Unload();
+    }
+    instanceBuffers.clear();
+    visibleInstanceBuffers.clear();
+    instanceBufferCapacities.clear();
+    instanceDescriptorSets.clear();
+    drawInstanceIndices.clear();
+    drawInstanceDrawIndices.clear();
+}
+
 void VulkanBufferManager::DestroyLineBuffer()
 {
     lineVertexBuffer->Unload();
@@ -565,10 +1280,31 @@ void VulkanBufferManager::DestroyUniformBuffers()
     uniformBuffers.clear();
 }
 
-void VulkanBufferManager::DestroyTextureBuffer(uint32_t textureBufferId)
+bool VulkanBufferManager::AddTextureReference(
+    uint32_t textureId,
+    const Image *image,
+    uint64_t hashSeed,
+    uint32_t &textureBufferId)
 {
-    textureBufferCount[textureBufferId] = textureBufferCount[textureBufferId] - 1;
-    if (textureBufferCount[textureBufferId] == 0)
+    if (textureContents.TryAddReference(textureId, textureBufferId))
+    {
+        return false;
+    }
+
+    uint64_t contentSize = image->GetDataSize();
+    if (textureContents.AddReference(textureId, image->ComputeContentHash(hashSeed), contentSize, textureBufferId))
+    {
+        Logger::Log(LogLevel::Debug, "Texture {} has the same content as loaded texture buffer {}, skipped uploading {:.1f} KB",
+            textureId, textureBufferId, contentSize / 1024.0f);
+        return false;
+    }
+    return true;
+}
+
+void VulkanBufferManager::DestroyTextureBuffer(uint32_t textureId)
+{
+    uint32_t textureBufferId;
+    if (textureContents.RemoveReference(textureId, textureBufferId))
     {
         const auto &textureBuffer = textureBuffers[textureBufferId];
         const auto &images = textureBuffer->GetImages();
@@ -578,5 +1314,191 @@ void VulkanBufferManager::DestroyTextureBuffer(uint32_t textureBufferId)
         }
         textureBuffer->Destroy();
         textureBuffers.erase(textureBufferId);
+
+        if (textureMemorySizes.count(textureBufferId) > 0)
+        {
+            totalTextureMemorySize -= textureMemorySizes[textureBufferId];
+            textureMemorySizes.erase(textureBufferId);
+        }
+        streamedTextures.erase(textureBufferId);
+
+        if (textureIndices.count(textureBufferId) > 0)
+        {
+            // The index is only given to another texture once the frames drawing this one are complete
+            uint32_t textureIndex = textureIndices[textureBufferId];
+            VulkanTextureTable *table = textureTable.get();
+            context->GetDeletionQueue()->Defer([table, textureIndex]()
+                {
+                    table->RemoveImage(textureIndex);
+                });
+            textureIndices.erase(textureBufferId);
+        }
+        if (materialIndices.count(textureBufferId) > 0)
+        {
+            freeMaterialIndices.push_back(materialIndices[textureBufferId]);
+            materialIndices.erase(textureBufferId);
+        }
+    }
+}
+
+std::shared_ptr<VulkanImage> VulkanBufferManager::LoadTextureImage(
+    uint32_t textureBufferId,
+    Image *image,
+    uint32_t baseMipLevel)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::shared_ptr<VulkanImage> textureImage = std::make_shared<VulkanImage>(
+        context, uploadManager.get(), imageVmaAllocator, VulkanImageType::Texture);
+    if (image->IsCompressed())
+    {
+        textureImage->LoadCompressed(image, baseMipLevel);
+    }
+    else
+    {
+        textureImage->Load(
+            std::vector<uint8_t *>({ image->GetPixels() }),
+            image->GetWidth(),
+            image->GetHeight());
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    float uploadTimeMs = std::chrono::duration<float, std::milli>(endTime - startTime).count();
+
+    VkDeviceSize memorySize = textureImage->GetMemorySize();
+    textureMemorySizes[textureBufferId] = memorySize;
+    totalTextureMemorySize += memorySize;
+
+    Logger::Log(
+        LogLevel::Debug,
+        "Loaded {} texture {} ({}x{}, {} mip levels resident) using {:.1f} KB, staged in {:.2f} ms, total texture memory {:.1f} MB",
+        image->IsCompressed() ? "compressed" : "uncompressed",
+        textureBufferId,
+        image->GetWidth(),
+        image->GetHeight(),
+        textureImage->GetMipLevels(),
+        memorySize / 1024.0f,
+        uploadTimeMs,
+        totalTextureMemorySize / (1024.0f * 1024.0f));
+    return textureImage;
+}
+
+bool VulkanBufferManager::IsStreamedTexture(const Image *image)
+{
+    return image->IsCompressed()
+        && image->GetMipLevels().size() > 1
+        && static_cast<uint32_t>(std::max(image->GetWidth(), image->GetHeight())) > TEXTURE_STREAMING_MIN_SIZE;
+}
+
+VkDeviceSize VulkanBufferManager::GetMipChainSize(const Image *image, uint32_t baseMipLevel)
+{
+    VkDeviceSize size = 0;
+    const std::vector<ImageMipLevel> &mipLevels = image->GetMipLevels();
+    for (uint32_t level = baseMipLevel; level < mipLevels.size(); level++)
+    {
+        size += mipLevels[level].size;
     }
+    return size;
+}
+
+void VulkanBufferManager::ReloadStreamedTexture(
+    uint32_t textureBufferId,
+    uint32_t baseMipLevel,
+    std::unordered_map<uint32_t, uint32_t> &replacedTextureIndices,
+    std::unordered_map<const VulkanTexture *, VulkanTexture *> &replacedTextures)
+{
+    StreamedTexture &streamedTexture = streamedTextures[textureBufferId];
+    totalTextureMemorySize -= textureMemorySizes[textureBufferId];
+
+    std::shared_ptr<VulkanImage> textureImage = LoadTextureImage(
+        textureBufferId, streamedTexture.image.get(), baseMipLevel);
+
+    // The submitted frames may still read the descriptor of the old image, so the new image is written into a slot
+    // or set none of them reads, and the old one is released once they are complete
+    VulkanDeletionQueue *deletionQueue = context->GetDeletionQueue();
+    if (textureIndices.count(textureBufferId) > 0)
+    {
+        uint32_t previousTextureIndex = textureIndices[textureBufferId];
+        textureBuffers[textureBufferId]->AddImage(textureImage, 0);
+        textureIndices[textureBufferId] = textureTable->AddImage(textureImage.get());
+        replacedTextureIndices[previousTextureIndex] = textureIndices[textureBufferId];
+
+        VulkanTextureTable *table = textureTable.get();
+        deletionQueue->Defer([table, previousTextureIndex]()
+            {
+                table->RemoveImage(previousTextureIndex);
+            });
+    }
+    else
+    {
+        std::unique_ptr<VulkanTexture> texture = std::make_unique<VulkanTexture>(
+            context,
+            descriptorPool,
+            pipelines.staticPipeline->GetImageDescriptorSetLayout());
+        texture->Create();
+        texture->AddImage(textureImage, 0);
+        texture->AddImage(cubeMapImage, 1);
+
+        std::shared_ptr<VulkanTexture> previousTexture = std::move(textureBuffers[textureBufferId]);
+        replacedTextures[previousTexture.get()] = texture.get();
+        textureBuffers[textureBufferId] = std::move(texture);
+        deletionQueue->Defer([previousTexture]()
+            {
+                previousTexture->FreeDescriptorSet();
+                previousTexture->Destroy();
+            });
+    }
+    streamedTexture.residentMipLevel = baseMipLevel;
+}
+
+VulkanIndexBufferInfo VulkanBufferManager::PackIndices(
+    std::vector<uint32_t> &indices,
+    size_t vertexCount,
+    std::vector<uint16_t> &shortIndices,
+    void *&data,
+    uint32_t &size)
+{
+    VulkanIndexBufferInfo indexInfo{};
+    indexInfo.indexCount = static_cast<uint32_t>(indices.size());
+
+    data = indices.data();
+    size = static_cast<uint32_t>(sizeof(uint32_t) * indices.size());
+    if (MeshOptimizer::Use16BitIndices(vertexCount))
+    {
+        shortIndices.assign(indices.begin(), indices.end());
+        data = shortIndices.data();
+        size = static_cast<uint32_t>(sizeof(uint16_t) * shortIndices.size());
+        indexInfo.indexType = VK_INDEX_TYPE_UINT16;
+    }
+    else
+    {
+        indexInfo.indexType = VK_INDEX_TYPE_UINT32;
+    }
+    return indexInfo;
+}
+
+VulkanIndexBufferInfo VulkanBufferManager::LoadIndexBuffer(
+    VulkanBuffer *indexBuffer,
+    std::vector<uint32_t> &indices,
+    size_t vertexCount)
+{
+    std::vector<uint16_t> shortIndices;
+    void *data;
+    uint32_t size;
+    VulkanIndexBufferInfo indexInfo = PackIndices(indices, vertexCount, shortIndices, data, size);
+
+    if (!indexBuffer->IsLoaded())
+    {
+        indexBuffer->Load(
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            data,
+            size);
+    }
+    else
+    {
+        indexBuffer->Update(data, size);
+    }
+
+    return indexInfo;
 }
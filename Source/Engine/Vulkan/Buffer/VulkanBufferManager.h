@@ -1,22 +1,34 @@
 #pragma once
 
+#include <array>
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 #include <vulkan/vulkan.h>
 
 #include "vk_mem_alloc.hpp"
 
+#include "Engine/DrawEngine.h"
 #include "Engine/Vulkan/VulkanCommon.h"
+#include "VulkanBufferArena.h"
+#include "VulkanContentCache.h"
+#include "VulkanRenderQueue.h"
 
 class Image;
 struct Material;
+struct MeshLod;
 struct Vertex;
 
 class VulkanBuffer;
 class VulkanContext;
+class VulkanGpuCulling;
 class VulkanImage;
+class VulkanMemoryBudget;
 class VulkanTexture;
+class VulkanTextureTable;
 class VulkanRenderPass;
+class VulkanUploadManager;
 
 class VulkanBufferManager
 {
@@ -25,15 +37,18 @@ public:
         VulkanContext *context,
         VulkanRenderPass *renderPass,
         VulkanDrawingPipelines pipelines,
-        VkCommandPool commandPool,
-        uint32_t frameBufferSize);
+        uint32_t frameBufferSize,
+        bool usePackedVertices,
+        bool useGpuCulling,
+        VkDeviceSize memoryBudgetCap);
     ~VulkanBufferManager();
 
     // Initialization
     void Create();
     void Destroy();
     void ResetScreenBuffers();
-    void ResetCommandPool(VkCommandPool commandPool);
+    // Submits the uploads recorded since the last call, before the frame that uses them
+    void FlushUploads();
 
     // Cubemap Buffering
     void LoadCubeMapBuffer(
@@ -53,6 +68,8 @@ public:
     void UnloadTerrainBuffer(uint32_t terrainId);
 
     // Vertex/Texture Buffering
+    // The vertices and indices are only read when the mesh is not loaded yet
+    bool IsMeshLoaded(uint32_t meshId) const { return meshContents.IsLoaded(meshId); }
     void LoadIntoBuffer(
         uint32_t instanceId,
         uint32_t meshId,
@@ -60,11 +77,34 @@ public:
         VulkanInstanceBufferInput &instanceBuffer,
         std::vector<Vertex> &vertices,
         std::vector<uint32_t> &indices,
+        const std::vector<MeshLod> &lods,
         Material *material);
     void UnloadBuffer(uint32_t instanceId);
-
-    void UpdateInstanceBuffer(uint32_t instanceId, VulkanInstanceBufferInput &input, uint32_t imageIndex);
+    // Level 0 is the full detail mesh, followed by the levels of detail of the mesh
+    void SetEntityLod(uint32_t instanceId, uint32_t lod);
+    // Culled entities are left out of the recorded draws, returns true if the commands have to be recorded again.
+    // With the GPU culling, which culls every entity each frame, only the occluded entities are left out
+    bool SetEntityVisible(uint32_t instanceId, bool visible);
+    // Terrain blocks are culled on the CPU even with the GPU culling, returns true if the commands have to be recorded again
+    bool SetTerrainVisible(uint32_t terrainId, bool visible);
+
+    // Texture Streaming
+    // Moves the streamed textures towards the finest mip level requested for them, textures that are not requested
+    // drop to their lowest residency, returns true if the commands have to be recorded again for the replaced textures
+    // The mip levels are requested by texture id, ids sharing a texture get the finest level and highest priority
+    // requested for any of them
+    bool UpdateTextureResidency(const std::unordered_map<uint32_t, VulkanTextureRequest> &requests);
+    TextureResidencyStats GetTextureResidencyStats() const;
+    ResourceSharingStats GetResourceSharingStats() const;
+    GeometryBufferStats GetGeometryBufferStats() const;
+
+    // Only the transformation changes after the entity is loaded
+    void UpdateInstanceTransformation(uint32_t instanceId, const glm::mat4 &transformation);
+    // Writes the instance inputs of the entities drawn by the frame into its instance buffer at once
+    void UpdateInstanceBuffer(uint32_t imageIndex);
     void UpdateUniformBuffer(VulkanUniformBufferInput &input, uint32_t imageIndex);
+    // Planes the GPU culling of the frame tests the instances against
+    void UpdateFrustum(const std::array<glm::vec4, 6> &frustumPlanes, uint32_t imageIndex);
 
     // Screen Object Buffering
     void LoadScreenObjectBuffer(
@@ -73,7 +113,12 @@ public:
         Image *image);
     void UnloadScreenObjectBuffer(uint32_t screenObjectId);
 
-    VulkanDrawingBuffer GetDrawingBuffer(uint32_t imageIndex);
+    // Draws of the entities sorted through the render queue, the nearest first within each draw.
+    // The drawing buffer is reused by every recording, only the parts of the updated layers are built again
+    const VulkanDrawingBuffer &GetDrawingBuffer(
+        uint32_t imageIndex,
+        const glm::vec3 &cameraPosition,
+        const VulkanRenderLayerUpdates &layersUpdated);
 
 private:
     // Should be good enough for images per scene
@@ -82,36 +127,110 @@ private:
     static constexpr uint32_t MAX_VERTEX_BUFFERS = 20000;
     // Reserve more space for frequently updated vertex buffers (ex. screen object, debug draw, etc.)
     static constexpr uint32_t MAX_VERTEX_BUFFER_CAPACITY = 5000 * sizeof(ScreenObjectVertex);
+    // Entities the instance buffers have room for at first, they grow with the number of entities
+    static constexpr uint32_t INITIAL_INSTANCE_CAPACITY = 1024;
+    // Size of the pooled buffers the entity meshes are suballocated from, larger meshes get a buffer of their own.
+    // An index buffer holds at most 2^24 16-bit indices, so that the first index fits the sort key of the render queue
+    static constexpr VkDeviceSize VERTEX_ARENA_BUFFER_SIZE = 64ULL * 1024 * 1024;
+    static constexpr VkDeviceSize INDEX_ARENA_BUFFER_SIZE = 32ULL * 1024 * 1024;
+    // Streamed textures are created with only the mip levels up to this size resident
+    static constexpr uint32_t TEXTURE_STREAMING_MIN_SIZE = 64;
+    // Finer mip levels are dropped from the textures that need them the least to stay under this size,
+    // or under what the other resources leave of the device memory budget
+    static constexpr VkDeviceSize TEXTURE_MEMORY_BUDGET = 512ULL * 1024 * 1024;
+    // Limits the uploads of one residency update, the rest of the textures are updated in the next ones
+    static constexpr VkDeviceSize TEXTURE_STREAMING_MAX_UPLOAD_SIZE = 32ULL * 1024 * 1024;
+    // Textures are only shared within the pipeline they were loaded for, as their descriptor sets differ
+    static constexpr uint64_t ENTITY_TEXTURE_HASH_SEED = 1;
+    static constexpr uint64_t TERRAIN_TEXTURE_HASH_SEED = 2;
+    static constexpr uint64_t SCREEN_TEXTURE_HASH_SEED = 3;
+
+    struct StreamedTexture
+    {
+        // Kept to upload the finer levels from when they are needed
+        std::shared_ptr<Image> image;
+        // Finest level in the image, mip levels are numbered from the full size one
+        uint32_t residentMipLevel;
+        uint32_t requestedMipLevel;
+        VulkanResourcePriority priority;
+        // Level up to the minimum streaming size, always resident
+        uint32_t lowestMipLevel;
+    };
 
     void CreateDescriptorPool();
+    void CreateInstanceBuffers();
     void CreateMemoryAllocator();
     void CreateLineBuffer();
     void CreateScreenBuffers();
     void CreateUniformBuffers();
     void DestroyCubeMapBuffer();
+    void DestroyInstanceBuffers();
     void DestroyScreenBuffers();
     void DestroyLineBuffer();
     void DestroyUniformBuffers();
-
-    void DestroyTextureBuffer(uint32_t textureBufferId);
+    void LoadInstanceBuffers(uint32_t imageIndex, uint32_t capacity);
+    void UpdateInstanceDescriptorSet(uint32_t imageIndex);
+    // Sorts the visible entities into the draws and batches recorded for the image, with their instance order
+    // and the inputs of the GPU culling
+    void BuildEntityDraws(uint32_t imageIndex, const glm::vec3 &cameraPosition);
+
+    // Returns true when no texture with the same content is loaded, and the caller loads it as the texture buffer
+    bool AddTextureReference(uint32_t textureId, const Image *image, uint64_t hashSeed, uint32_t &textureBufferId);
+    // Unloads the texture buffer when the last id using it is removed
+    void DestroyTextureBuffer(uint32_t textureId);
+    // Uploads a block compressed image as is from the base mip level, otherwise generates the mipmaps from the RGBA pixels
+    std::shared_ptr<VulkanImage> LoadTextureImage(uint32_t textureBufferId, Image *image, uint32_t baseMipLevel = 0);
+    // Only block compressed textures have prebuilt mip chains to stream the levels from
+    static bool IsStreamedTexture(const Image *image);
+    static VkDeviceSize GetMipChainSize(const Image *image, uint32_t baseMipLevel);
+    // Binds the new image through a new texture table slot or descriptor set, and records which one it replaces
+    void ReloadStreamedTexture(
+        uint32_t textureBufferId,
+        uint32_t baseMipLevel,
+        std::unordered_map<uint32_t, uint32_t> &replacedTextureIndices,
+        std::unordered_map<const VulkanTexture *, VulkanTexture *> &replacedTextures);
+
+    // Packs the indices into 16 bits when the vertex count allows it, the data points to the indices or the packed ones
+    static VulkanIndexBufferInfo PackIndices(
+        std::vector<uint32_t> &indices,
+        size_t vertexCount,
+        std::vector<uint16_t> &shortIndices,
+        void *&data,
+        uint32_t &size);
+    // Loads or updates the index buffer, packing the indices into 16 bits when the vertex count allows it
+    VulkanIndexBufferInfo LoadIndexBuffer(VulkanBuffer *indexBuffer, std::vector<uint32_t> &indices, size_t vertexCount);
 
     uint32_t frameBufferSize;
+    bool usePackedVertices;
+    bool useGpuCulling;
+    VkDeviceSize memoryBudgetCap;
     VulkanContext *context;
     VulkanRenderPass *renderPass;
 
     VmaAllocator vmaAllocator;
     VmaAllocator imageVmaAllocator;
+    std::unique_ptr<VulkanMemoryBudget> memoryBudget;
+    // Only logged when the budget starts being exceeded
+    bool textureMemoryBudgetExceeded;
+    // Only logged when the entities start being drawn unsorted
+    bool sortKeysOverflowed;
 
     VulkanDrawingPipelines pipelines;
 
-    VkCommandPool commandPool;
+    std::unique_ptr<VulkanUploadManager> uploadManager;
     VkDescriptorPool descriptorPool;
+    // Only created when the device supports descriptor indexing, entity textures have their own sets otherwise
+    std::unique_ptr<VulkanTextureTable> textureTable;
+    // Only created when the device supports indirect draws with a first instance
+    std::unique_ptr<VulkanGpuCulling> gpuCulling;
 
     // Buffer caches
     VulkanCubeMapBuffer cubeMapBufferCache;
     std::unordered_map<uint32_t, VulkanEntityBuffer> entityBufferCache;
     std::unordered_map<uint32_t, VulkanTerrainBuffer> terrainBufferCache;
     std::unordered_map<uint32_t, VulkanScreenObjectBuffer> screenObjectBufferCache;
+    VulkanRenderQueue renderQueue;
+    VulkanDrawingBuffer drawingBuffer;
 
     // Cubemap buffers
     bool cubeMapBufferLoaded;
@@ -121,11 +240,34 @@ private:
     std::shared_ptr<VulkanImage> cubeMapImage;
 
     // Static scene buffers
-    std::unordered_map<uint32_t, std::vector<std::shared_ptr<VulkanBuffer>>> instanceBuffers;
-
-    std::unordered_map<uint32_t, std::shared_ptr<VulkanBuffer>> vertexBuffers;
-    std::unordered_map<uint32_t, std::shared_ptr<VulkanBuffer>> indexBuffers;
-    std::unordered_map<uint32_t, uint32_t> vertexBufferCount;
+    // The instance inputs of all the entities are kept in one array, copied into the instance buffer of each frame
+    // in the order of its draws
+    std::vector<VulkanInstanceBufferInput> instanceInputs;
+    std::unordered_map<uint32_t, uint32_t> instanceIndices;
+    // Indices of unloaded entities, reused by the next loaded ones
+    std::vector<uint32_t> freeInstanceIndices;
+    std::vector<std::unique_ptr<VulkanBuffer>> instanceBuffers;
+    // Index in the instance buffer of each visible instance, in the instance ranges of the draws
+    std::vector<std::unique_ptr<VulkanBuffer>> visibleInstanceBuffers;
+    std::vector<uint32_t> instanceBufferCapacities;
+    std::vector<VkDescriptorSet> instanceDescriptorSets;
+    // Index in the instance inputs of each instance drawn by the commands recorded for each image
+    std::vector<std::vector<uint32_t>> drawInstanceIndices;
+    // Draw of each instance drawn by the commands recorded for each image
+    std::vector<std::vector<uint32_t>> drawInstanceDrawIndices;
+    // Reused to gather the instance inputs of a frame before they are written
+    std::vector<VulkanInstanceBufferInput> frameInstanceInputs;
+    std::vector<uint32_t> frameVisibleInstanceIndices;
+
+    // Vertex and index ranges of the meshes, by the id of the buffers holding their content
+    VulkanContentCache meshContents;
+    std::unique_ptr<VulkanBufferArena> vertexArena;
+    std::unique_ptr<VulkanBufferArena> indexArena;
+    std::unordered_map<uint32_t, VulkanArenaAllocation> vertexAllocations;
+    std::unordered_map<uint32_t, VulkanArenaAllocation> indexAllocations;
+    // Per level of detail ranges of the shared index buffer
+    std::unordered_map<uint32_t, std::vector<VulkanIndexBufferInfo>> indexBufferInfos;
+    std::unordered_map<uint32_t, PackedVertexDecode> vertexDecodes;
 
     std::unordered_map<uint32_t, VulkanEntityBufferIds> bufferIdCache;
 
@@ -138,10 +280,21 @@ private:
     // Terrain buffers
     std::unordered_map<uint32_t, std::shared_ptr<VulkanBuffer>> terrainVertexBuffers;
     std::unordered_map<uint32_t, std::shared_ptr<VulkanBuffer>> terrainIndexBuffers;
+    std::unordered_map<uint32_t, VulkanIndexBufferInfo> terrainIndexBufferInfos;
 
-    // Image buffers that are used by both scene and terrain pipelines
+    // Image buffers that are used by the scene, terrain and screen pipelines, by the id of the buffers holding their content
+    VulkanContentCache textureContents;
     std::unordered_map<uint32_t, std::unique_ptr<VulkanTexture>> textureBuffers;
-    std::unordered_map<uint32_t, uint32_t> textureBufferCount;
+    // Device memory of the texture images, to compare compressed and uncompressed textures
+    std::unordered_map<uint32_t, VkDeviceSize> textureMemorySizes;
+    VkDeviceSize totalTextureMemorySize;
+    std::unordered_map<uint32_t, StreamedTexture> streamedTextures;
+    // Index of each entity texture in the texture table
+    std::unordered_map<uint32_t, uint32_t> textureIndices;
+    // Dense indices of the entity textures bound per draw, assigned when the texture is loaded, for the sort keys
+    // of the render queue. Each texture has a descriptor set, so the indices stay below the descriptor set count
+    std::unordered_map<uint32_t, uint32_t> materialIndices;
+    std::vector<uint32_t> freeMaterialIndices;
 
     // Uniform buffers
     VulkanScreenBufferInput screenBufferInput;
@@ -0,0 +1,101 @@
+#include "VulkanContentCache.h"
+
+VulkanContentCache::VulkanContentCache()
+    : nextResourceId(1),
+      sharedLoadCount(0),
+      savedSize(0)
+{
+}
+
+VulkanContentCache::~VulkanContentCache()
+{
+}
+
+bool VulkanContentCache::TryGetResourceId(uint32_t logicalId, uint32_t &resourceId) const
+{
+    auto logicalResource = logicalResources.find(logicalId);
+    if (logicalResource == logicalResources.end())
+    {
+        return false;
+    }
+
+    resourceId = logicalResource->second.resourceId;
+    return true;
+}
+
+bool VulkanContentCache::TryAddReference(uint32_t logicalId, uint32_t &resourceId)
+{
+    auto logicalResource = logicalResources.find(logicalId);
+    if (logicalResource == logicalResources.end())
+    {
+        return false;
+    }
+
+    logicalResource->second.referenceCount++;
+    resourceId = logicalResource->second.resourceId;
+    resources[resourceId].referenceCount++;
+    return true;
+}
+
+bool VulkanContentCache::AddReference(
+    uint32_t logicalId,
+    uint64_t contentHash,
+    uint64_t contentSize,
+    uint32_t &resourceId)
+{
+    if (TryAddReference(logicalId, resourceId))
+    {
+        return true;
+    }
+
+    // A hash collision between different sizes loads the content on its own
+    auto contentResource = contentResources.find(contentHash);
+    if (contentResource != contentResources.end() && resources[contentResource->second].contentSize == contentSize)
+    {
+        resourceId = contentResource->second;
+        resources[resourceId].referenceCount++;
+        logicalResources[logicalId] = { resourceId, 1 };
+
+        sharedLoadCount++;
+        savedSize += contentSize;
+        return true;
+    }
+
+    resourceId = nextResourceId++;
+    resources[resourceId] = { contentHash, contentSize, 1 };
+    logicalResources[logicalId] = { resourceId, 1 };
+    if (contentResource == contentResources.end())
+    {
+        contentResources[contentHash] = resourceId;
+    }
+    return false;
+}
+
+bool VulkanContentCache::RemoveReference(uint32_t logicalId, uint32_t &resourceId)
+{
+    auto logicalResource = logicalResources.find(logicalId);
+    if (logicalResource == logicalResources.end())
+    {
+        return false;
+    }
+
+    resourceId = logicalResource->second.resourceId;
+    if (--logicalResource->second.referenceCount == 0)
+    {
+        logicalResources.erase(logicalResource);
+    }
+
+    Resource &resource = resources[resourceId];
+    if (--resource.referenceCount > 0)
+    {
+        return false;
+    }
+
+    auto contentResource = contentResources.find(resource.contentHash);
+    if (contentResource != contentResources.end() && contentResource->second == resourceId)
+    {
+        contentResources.erase(contentResource);
+    }
+    resources.erase(resourceId);
+    return true;
+}
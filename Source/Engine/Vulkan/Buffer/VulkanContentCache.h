@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+// Maps the ids resources are loaded with to the GPU resources holding their content, so that meshes and textures
+// loaded several times under different ids (e.g. the same file referenced by several models) are uploaded once
+// Content is identified by its hash and size, the caller owns the GPU resources and loads them under the resource ids
+class VulkanContentCache
+{
+public:
+    VulkanContentCache();
+    ~VulkanContentCache();
+
+    bool IsLoaded(uint32_t logicalId) const { return logicalResources.count(logicalId) > 0; }
+    bool TryGetResourceId(uint32_t logicalId, uint32_t &resourceId) const;
+    // Only adds the reference when the logical id is already loaded, so that its content is not hashed again
+    bool TryAddReference(uint32_t logicalId, uint32_t &resourceId);
+    // Returns true when the content is already loaded, otherwise the caller loads it into a new resource
+    bool AddReference(uint32_t logicalId, uint64_t contentHash, uint64_t contentSize, uint32_t &resourceId);
+    // Returns true when the last reference to the resource is removed, and the caller unloads it
+    bool RemoveReference(uint32_t logicalId, uint32_t &resourceId);
+
+    // Loads that reused the content of another id, and the size they did not upload
+    uint32_t GetSharedLoadCount() const { return sharedLoadCount; }
+    uint64_t GetSavedSize() const { return savedSize; }
+
+private:
+    struct LogicalResource
+    {
+        uint32_t resourceId;
+        uint32_t referenceCount;
+    };
+
+    struct Resource
+    {
+        uint64_t contentHash;
+        uint64_t contentSize;
+        // References from all the logical ids sharing the resource
+        uint32_t referenceCount;
+    };
+
+    std::unordered_map<uint32_t, LogicalResource> logicalResources;
+    std::unordered_map<uint32_t, Resource> resources;
+    std::unordered_map<uint64_t, uint32_t> contentResources;
+    uint32_t nextResourceId;
+
+    uint32_t sharedLoadCount;
+    uint64_t savedSize;
+};
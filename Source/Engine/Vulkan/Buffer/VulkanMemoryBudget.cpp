@@ -0,0 +1,62 @@
+#include <algorithm>
+
+#include "Engine/Vulkan/VulkanContext.h"
+#include "VulkanMemoryBudget.h"
+
+VulkanMemoryBudget::VulkanMemoryBudget(VulkanContext *context, VkDeviceSize budgetCap)
+    : context(context),
+      budgetCap(budgetCap),
+      usage(0),
+      budget(0)
+{
+}
+
+VulkanMemoryBudget::~VulkanMemoryBudget()
+{
+}
+
+void VulkanMemoryBudget::AddAllocator(VmaAllocator allocator)
+{
+    allocators.push_back(allocator);
+}
+
+void VulkanMemoryBudget::Update()
+{
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(context->GetPhysicalDevice(), &memoryProperties);
+
+    usage = 0;
+    budget = 0;
+    for (size_t i = 0; i < allocators.size(); i++)
+    {
+        VmaBudget heapBudgets[VK_MAX_MEMORY_HEAPS];
+        vmaGetBudget(allocators[i], heapBudgets);
+        for (uint32_t heapIndex = 0; heapIndex < memoryProperties.memoryHeapCount; heapIndex++)
+        {
+            if (!(memoryProperties.memoryHeaps[heapIndex].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+            {
+                continue;
+            }
+
+            // The budget and the usage reported by the driver are the ones of the whole process, the same for
+            // every allocator, while the estimated usage only counts the memory blocks of each allocator
+            if (i == 0)
+            {
+                budget += heapBudgets[heapIndex].budget;
+                if (context->SupportsMemoryBudget())
+                {
+                    usage += heapBudgets[heapIndex].usage;
+                }
+            }
+            if (!context->SupportsMemoryBudget())
+            {
+                usage += heapBudgets[heapIndex].blockBytes;
+            }
+        }
+    }
+
+    if (budgetCap > 0)
+    {
+        budget = std::min(budget, budgetCap);
+    }
+}
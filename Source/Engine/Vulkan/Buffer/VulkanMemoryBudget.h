@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "vk_mem_alloc.hpp"
+
+class VulkanContext;
+
+// Tracks the device local memory used by the allocators against the budget of the device
+// The budget comes from VK_EXT_memory_budget when the driver supports it, and is estimated by VMA otherwise
+// A budget cap simulates a device with less memory, e.g. when testing on a software renderer
+class VulkanMemoryBudget
+{
+public:
+    VulkanMemoryBudget(VulkanContext *context, VkDeviceSize budgetCap);
+    ~VulkanMemoryBudget();
+
+    void AddAllocator(VmaAllocator allocator);
+    // Cheap enough to be called every frame
+    void Update();
+
+    VkDeviceSize GetUsage() const { return usage; }
+    VkDeviceSize GetBudget() const { return budget; }
+    // Usage the resources are kept under, leaving room for the allocations that are not tracked (e.g. swap chain)
+    VkDeviceSize GetTargetUsage() const { return static_cast<VkDeviceSize>(budget * BUDGET_USAGE_RATIO); }
+
+private:
+    static constexpr double BUDGET_USAGE_RATIO = 0.9;
+
+    VulkanContext *context;
+    // No cap when 0
+    VkDeviceSize budgetCap;
+    std::vector<VmaAllocator> allocators;
+
+    VkDeviceSize usage;
+    VkDeviceSize budget;
+};
@@ -0,0 +1,93 @@
+#include <algorithm>
+#include <array>
+
+#include "VulkanRenderQueue.h"
+
+VulkanRenderQueue::VulkanRenderQueue()
+{
+}
+
+VulkanRenderQueue::~VulkanRenderQueue()
+{
+}
+
+bool VulkanRenderQueue::TryMakeSortKey(
+    uint32_t vertexBufferIndex,
+    uint32_t indexBufferIndex,
+    VkIndexType indexType,
+    uint32_t materialIndex,
+    uint32_t firstIndex,
+    float distance,
+    uint64_t &sortKey)
+{
+    if (materialIndex >= (1U << MATERIAL_KEY_BITS) || firstIndex >= (1U << MESH_KEY_BITS))
+    {
+        sortKey = UNSORTED_KEY;
+        return false;
+    }
+
+    float depth = std::clamp(distance / MAX_KEY_DISTANCE, 0.0f, 1.0f);
+    uint64_t depthKey = static_cast<uint64_t>(depth * ((1 << DEPTH_KEY_BITS) - 1));
+
+    sortKey = vertexBufferIndex & ((1ULL << BUFFER_KEY_BITS) - 1);
+    sortKey = (sortKey << BUFFER_KEY_BITS) | (indexBufferIndex & ((1ULL << BUFFER_KEY_BITS) - 1));
+    sortKey = (sortKey << 1) | (indexType == VK_INDEX_TYPE_UINT32 ? 1 : 0);
+    sortKey = (sortKey << MATERIAL_KEY_BITS) | materialIndex;
+    sortKey = (sortKey << MESH_KEY_BITS) | firstIndex;
+    sortKey = (sortKey << DEPTH_KEY_BITS) | depthKey;
+    return true;
+}
+
+void VulkanRenderQueue::Clear()
+{
+    items.clear();
+}
+
+void VulkanRenderQueue::Push(uint64_t sortKey, const VulkanEntityBuffer *entityBuffer)
+{
+    items.push_back({ sortKey, entityBuffer });
+}
+
+void VulkanRenderQueue::Sort()
+{
+    size_t itemCount = items.size();
+    if (itemCount < 2)
+    {
+        return;
+    }
+
+    // The counts of every digit are taken in one pass over the keys
+    std::array<std::array<uint32_t, RADIX_SIZE>, KEY_DIGIT_COUNT> digitCounts{};
+    for (const auto &item : items)
+    {
+        for (uint32_t digit = 0; digit < KEY_DIGIT_COUNT; digit++)
+        {
+            digitCounts[digit][(item.sortKey >> (digit * RADIX_BITS)) & (RADIX_SIZE - 1)]++;
+        }
+    }
+
+    sortedItems.resize(itemCount);
+    for (uint32_t digit = 0; digit < KEY_DIGIT_COUNT; digit++)
+    {
+        uint32_t shift = digit * RADIX_BITS;
+        std::array<uint32_t, RADIX_SIZE> &counts = digitCounts[digit];
+        // Most keys share their upper digits, e.g. the buffer indices, and a pass would not move any item
+        if (counts[(items[0].sortKey >> shift) & (RADIX_SIZE - 1)] == itemCount)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t &count : counts)
+        {
+            uint32_t digitCount = count;
+            count = offset;
+            offset += digitCount;
+        }
+        for (const auto &item : items)
+        {
+            sortedItems[counts[(item.sortKey >> shift) & (RADIX_SIZE - 1)]++] = item;
+        }
+        items.swap(sortedItems);
+    }
+}
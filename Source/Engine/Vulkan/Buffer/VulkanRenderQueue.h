@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct VulkanEntityBuffer;
+
+struct VulkanRenderQueueItem
+{
+    uint64_t sortKey;
+    const VulkanEntityBuffer *entityBuffer;
+};
+
+// Entities drawn by the recorded commands as flat items, radix sorted by a 64-bit key so that the entities sharing
+// their bound buffers, texture and mesh range follow each other, the nearest first. The arrays are kept between
+// the recordings, so that they are only allocated when the number of entities grows.
+// From the most significant bits, the key holds the vertex buffer, index buffer, index type, material, mesh range
+// and depth of the entity
+class VulkanRenderQueue
+{
+public:
+    static constexpr uint32_t DEPTH_KEY_BITS = 11;
+    static constexpr uint32_t MESH_KEY_BITS = 24;
+    static constexpr uint32_t MATERIAL_KEY_BITS = 16;
+    static constexpr uint32_t BUFFER_KEY_BITS = 6;
+
+    VulkanRenderQueue();
+    ~VulkanRenderQueue();
+
+    // Pushed after the sorted entities, in the order they were pushed
+    static constexpr uint64_t UNSORTED_KEY = UINT64_MAX;
+
+    // The material is the dense index assigned when its texture is loaded, 0 when the texture does not split
+    // the batches, and the mesh range is its first index. When either does not fit its bits the key is
+    // the unsorted key instead, so that the entities of different draws never interleave.
+    // Buffer slots past their bits only order the entities less well
+    static bool TryMakeSortKey(
+        uint32_t vertexBufferIndex,
+        uint32_t indexBufferIndex,
+        VkIndexType indexType,
+        uint32_t materialIndex,
+        uint32_t firstIndex,
+        float distance,
+        uint64_t &sortKey);
+
+    const std::vector<VulkanRenderQueueItem> &GetItems() const { return items; }
+
+    void Clear();
+    void Push(uint64_t sortKey, const VulkanEntityBuffer *entityBuffer);
+    // Least significant digit first, the passes over digits every key shares are skipped
+    void Sort();
+
+private:
+    static constexpr uint32_t RADIX_BITS = 8;
+    static constexpr uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+    static constexpr uint32_t KEY_DIGIT_COUNT = 64 / RADIX_BITS;
+    // Entities farther than this distance share the farthest depth
+    static constexpr float MAX_KEY_DISTANCE = 2048.0f;
+
+    std::vector<VulkanRenderQueueItem> items;
+    // Items of the previous pass while sorting
+    std::vector<VulkanRenderQueueItem> sortedItems;
+};
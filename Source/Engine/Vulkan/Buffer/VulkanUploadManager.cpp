@@ -0,0 +1,498 @@
+#include "Common/Logger.h"
+#include "Engine/Vulkan/VulkanCommon.h"
+#include "Engine/Vulkan/VulkanContext.h"
+#include "VulkanBuffer.h"
+#include "VulkanUploadManager.h"
+
+VulkanUploadManager::VulkanUploadManager(VulkanContext *context, VmaAllocator &allocator)
+    : context(context),
+      allocator(allocator),
+      transferCommandPool(VK_NULL_HANDLE),
+      graphicsCommandPool(VK_NULL_HANDLE),
+      currentBatch(0),
+      recording(false),
+      stagingBuffer(VK_NULL_HANDLE),
+      stagingAllocation(),
+      stagingMappedData(nullptr),
+      stagingHead(0),
+      stagingUsedSize(0),
+      totalUploadSize(0),
+      totalUploadTimeMs(0.0f),
+      totalStallTimeMs(0.0f)
+{
+}
+
+VulkanUploadManager::~VulkanUploadManager()
+{
+}
+
+void VulkanUploadManager::Create()
+{
+    VkDevice logicalDevice = context->GetLogicalDevice();
+
+    VkCommandPoolCreateInfo commandPoolInfo{};
+    commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    commandPoolInfo.queueFamilyIndex = context->GetGraphicsQueueIndex();
+    ASSERT_VK_RESULT_SUCCESS(
+        vkCreateCommandPool(logicalDevice, &commandPoolInfo, nullptr, &graphicsCommandPool),
+        "Failed to create upload command pool");
+    commandPoolInfo.queueFamilyIndex = context->GetTransferQueueIndex();
+    ASSERT_VK_RESULT_SUCCESS(
+        vkCreateCommandPool(logicalDevice, &commandPoolInfo, nullptr, &transferCommandPool),
+        "Failed to create transfer command pool");
+
+    batches.resize(MAX_PENDING_BATCHES);
+    for (UploadBatch &batch : batches)
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        allocInfo.commandPool = graphicsCommandPool;
+        ASSERT_VK_RESULT_SUCCESS(
+            vkAllocateCommandBuffers(logicalDevice, &allocInfo, &batch.graphicsCommandBuffer),
+            "Failed to allocate upload command buffer");
+        allocInfo.commandPool = transferCommandPool;
+        ASSERT_VK_RESULT_SUCCESS(
+            vkAllocateCommandBuffers(logicalDevice, &allocInfo, &batch.transferCommandBuffer),
+            "Failed to allocate transfer command buffer");
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        ASSERT_VK_RESULT_SUCCESS(
+            vkCreateSemaphore(logicalDevice, &semaphoreInfo, nullptr, &batch.transferFinishedSemaphore),
+            "Failed to create transfer semaphore");
+        ASSERT_VK_RESULT_SUCCESS(
+            vkCreateFence(logicalDevice, &fenceInfo, nullptr, &batch.fence),
+            "Failed to create upload fence");
+    }
+
+    VulkanBuffer::CreateBuffer(
+        allocator,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        STAGING_RING_SIZE,
+        stagingBuffer,
+        stagingAllocation);
+    void *mappedData;
+    vmaMapMemory(allocator, stagingAllocation, &mappedData);
+    stagingMappedData = static_cast<uint8_t *>(mappedData);
+}
+
+void VulkanUploadManager::Destroy()
+{
+    WaitIdle();
+
+    VkDevice logicalDevice = context->GetLogicalDevice();
+    if (recording)
+    {
+        // Nothing was recorded into the open batch, otherwise it would have been submitted
+        vkEndCommandBuffer(batches[currentBatch].graphicsCommandBuffer);
+        vkEndCommandBuffer(batches[currentBatch].transferCommandBuffer);
+        recording = false;
+    }
+
+    for (UploadBatch &batch : batches)
+    {
+        vkDestroySemaphore(logicalDevice, batch.transferFinishedSemaphore, nullptr);
+        vkDestroyFence(logicalDevice, batch.fence, nullptr);
+    }
+    batches.clear();
+
+    // Command buffers are freed with their pools
+    vkDestroyCommandPool(logicalDevice, graphicsCommandPool, nullptr);
+    vkDestroyCommandPool(logicalDevice, transferCommandPool, nullptr);
+
+    vmaUnmapMemory(allocator, stagingAllocation);
+    vmaDestroyBuffer(allocator, stagingBuffer, stagingAllocation);
+    stagingMappedData = nullptr;
+}
+
+VulkanStagingRegion VulkanUploadManager::AllocateStagingRegion(VkDeviceSize size)
+{
+    BeginBatch();
+
+    VulkanStagingRegion stagingRegion{};
+    if (size > STAGING_RING_SIZE)
+    {
+        VkBuffer temporaryBuffer;
+        VmaAllocation temporaryAllocation;
+        VulkanBuffer::CreateBuffer(
+            allocator,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            size,
+            temporaryBuffer,
+            temporaryAllocation);
+        vmaMapMemory(allocator, temporaryAllocation, &stagingRegion.mappedData);
+        stagingRegion.buffer = temporaryBuffer;
+        stagingRegion.offset = 0;
+
+        UploadBatch &batch = batches[currentBatch];
+        batch.temporaryStagingBuffers.push_back(std::make_pair(temporaryBuffer, temporaryAllocation));
+        batch.uploadSize += size;
+        return stagingRegion;
+    }
+
+    while (true)
+    {
+        VkDeviceSize offset = (stagingHead + STAGING_ALIGNMENT - 1) / STAGING_ALIGNMENT * STAGING_ALIGNMENT;
+        if (offset + size > STAGING_RING_SIZE)
+        {
+            // Skip the end of the ring, the region must be contiguous
+            offset = 0;
+        }
+        VkDeviceSize requiredSize = (offset >= stagingHead ? offset - stagingHead : STAGING_RING_SIZE - stagingHead) + size;
+
+        if (stagingUsedSize + requiredSize <= STAGING_RING_SIZE)
+        {
+            stagingHead = offset + size;
+            stagingUsedSize += requiredSize;
+
+            UploadBatch &batch = batches[currentBatch];
+            batch.stagingSize += requiredSize;
+            batch.uploadSize += size;
+
+            stagingRegion.buffer = stagingBuffer;
+            stagingRegion.offset = offset;
+            stagingRegion.mappedData = stagingMappedData + offset;
+            return stagingRegion;
+        }
+
+        // The ring is full, the current batch has to be submitted so the space it uses can be freed
+        if (batches[currentBatch].stagingSize > 0)
+        {
+            Flush();
+        }
+        WaitForOldestBatch();
+        BeginBatch();
+    }
+}
+
+VkCommandBuffer VulkanUploadManager::GetCopyCommandBuffer(bool inUse)
+{
+    BeginBatch();
+
+    UploadBatch &batch = batches[currentBatch];
+    batch.hasCommands = true;
+    if (inUse || !context->HasDedicatedTransferQueue())
+    {
+        return batch.graphicsCommandBuffer;
+    }
+
+    batch.hasTransferCommands = true;
+    return batch.transferCommandBuffer;
+}
+
+VkCommandBuffer VulkanUploadManager::GetGraphicsCommandBuffer()
+{
+    BeginBatch();
+
+    UploadBatch &batch = batches[currentBatch];
+    batch.hasCommands = true;
+    return batch.graphicsCommandBuffer;
+}
+
+void VulkanUploadManager::CopyToBuffer(
+    const VulkanStagingRegion &stagingRegion,
+    VkBuffer buffer,
+    VkDeviceSize size,
+    VkBufferUsageFlags usage,
+    bool inUse,
+    VkDeviceSize dstOffset)
+{
+    VkAccessFlags dstAccess;
+    VkPipelineStageFlags dstStage;
+    GetBufferAccess(usage, dstAccess, dstStage);
+
+    VkCommandBuffer commandBuffer = GetCopyCommandBuffer(inUse);
+
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer;
+    barrier.offset = dstOffset;
+    barrier.size = size;
+
+    if (inUse)
+    {
+        // Earlier frames must have finished reading the buffer before it is overwritten
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer, dstStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+
+    VkBufferCopy copyRegion{};
+    copyRegion.srcOffset = stagingRegion.offset;
+    copyRegion.dstOffset = dstOffset;
+    copyRegion.size = size;
+    vkCmdCopyBuffer(commandBuffer, stagingRegion.buffer, buffer, 1, &copyRegion);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = dstAccess;
+    if (inUse || !context->HasDedicatedTransferQueue())
+    {
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+        return;
+    }
+
+    // Release on the transfer queue, then acquire on the graphics queue with the same barrier
+    barrier.srcQueueFamilyIndex = context->GetTransferQueueIndex();
+    barrier.dstQueueFamilyIndex = context->GetGraphicsQueueIndex();
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        1,
+        &barrier,
+        0,
+        nullptr);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(
+        GetGraphicsCommandBuffer(),
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        dstStage,
+        0,
+        0,
+        nullptr,
+        1,
+        &barrier,
+        0,
+        nullptr);
+}
+
+void VulkanUploadManager::ReleaseImage(VkImageMemoryBarrier barrier, VkPipelineStageFlags dstStage, bool inUse)
+{
+    VkCommandBuffer commandBuffer = GetCopyCommandBuffer(inUse);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    if (inUse || !context->HasDedicatedTransferQueue())
+    {
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        return;
+    }
+
+    // The layout transition happens once, as part of the ownership transfer
+    VkAccessFlags dstAccess = barrier.dstAccessMask;
+    barrier.srcQueueFamilyIndex = context->GetTransferQueueIndex();
+    barrier.dstQueueFamilyIndex = context->GetGraphicsQueueIndex();
+    barrier.dstAccessMask = 0;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = dstAccess;
+    vkCmdPipelineBarrier(
+        GetGraphicsCommandBuffer(),
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        dstStage,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+}
+
+void VulkanUploadManager::Flush()
+{
+    RetireCompletedBatches();
+
+    if (!recording || !batches[currentBatch].hasCommands)
+    {
+        return;
+    }
+
+    UploadBatch &batch = batches[currentBatch];
+    vkEndCommandBuffer(batch.graphicsCommandBuffer);
+    vkEndCommandBuffer(batch.transferCommandBuffer);
+
+    if (batch.hasTransferCommands)
+    {
+        VkSubmitInfo transferSubmitInfo{};
+        transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        transferSubmitInfo.commandBufferCount = 1;
+        transferSubmitInfo.pCommandBuffers = &batch.transferCommandBuffer;
+        transferSubmitInfo.signalSemaphoreCount = 1;
+        transferSubmitInfo.pSignalSemaphores = &batch.transferFinishedSemaphore;
+        ASSERT_VK_RESULT_SUCCESS(
+            vkQueueSubmit(context->GetTransferQueue(), 1, &transferSubmitInfo, VK_NULL_HANDLE),
+            "Failed to submit the transfer commands");
+    }
+
+    // The fence covers both submissions, as the graphics one waits for the transfer one
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo graphicsSubmitInfo{};
+    graphicsSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    graphicsSubmitInfo.commandBufferCount = 1;
+    graphicsSubmitInfo.pCommandBuffers = &batch.graphicsCommandBuffer;
+    if (batch.hasTransferCommands)
+    {
+        graphicsSubmitInfo.waitSemaphoreCount = 1;
+        graphicsSubmitInfo.pWaitSemaphores = &batch.transferFinishedSemaphore;
+        graphicsSubmitInfo.pWaitDstStageMask = &waitStage;
+    }
+    ASSERT_VK_RESULT_SUCCESS(
+        vkResetFences(context->GetLogicalDevice(), 1, &batch.fence),
+        "Failed to reset upload fence");
+    ASSERT_VK_RESULT_SUCCESS(
+        vkQueueSubmit(context->GetGraphicsQueue(), 1, &graphicsSubmitInfo, batch.fence),
+        "Failed to submit the upload commands");
+
+    batch.submitTime = std::chrono::high_resolution_clock::now();
+    pendingBatches.push_back(currentBatch);
+    currentBatch = (currentBatch + 1) % MAX_PENDING_BATCHES;
+    recording = false;
+}
+
+void VulkanUploadManager::WaitIdle()
+{
+    Flush();
+    while (!pendingBatches.empty())
+    {
+        WaitForOldestBatch();
+    }
+}
+
+void VulkanUploadManager::GetBufferAccess(VkBufferUsageFlags usage, VkAccessFlags &access, VkPipelineStageFlags &stage)
+{
+    access = 0;
+    stage = 0;
+    if (usage & VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+    {
+        access |= VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        stage |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+    {
+        access |= VK_ACCESS_INDEX_READ_BIT;
+        stage |= VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+    {
+        access |= VK_ACCESS_UNIFORM_READ_BIT;
+        stage |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    if (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+    {
+        access |= VK_ACCESS_SHADER_READ_BIT;
+        stage |= VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    }
+    if (stage == 0)
+    {
+        access = VK_ACCESS_MEMORY_READ_BIT;
+        stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+}
+
+void VulkanUploadManager::BeginBatch()
+{
+    if (recording)
+    {
+        return;
+    }
+
+    RetireCompletedBatches();
+    if (pendingBatches.size() == MAX_PENDING_BATCHES)
+    {
+        WaitForOldestBatch();
+    }
+
+    UploadBatch &batch = batches[currentBatch];
+    batch.hasCommands = false;
+    batch.hasTransferCommands = false;
+    batch.stagingSize = 0;
+    batch.uploadSize = 0;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(batch.graphicsCommandBuffer, &beginInfo);
+    vkBeginCommandBuffer(batch.transferCommandBuffer, &beginInfo);
+
+    recording = true;
+}
+
+void VulkanUploadManager::RetireCompletedBatches()
+{
+    while (!pendingBatches.empty()
+        && vkGetFenceStatus(context->GetLogicalDevice(), batches[pendingBatches.front()].fence) == VK_SUCCESS)
+    {
+        RetireOldestBatch();
+    }
+}
+
+void VulkanUploadManager::RetireOldestBatch()
+{
+    UploadBatch &batch = batches[pendingBatches.front()];
+    pendingBatches.pop_front();
+
+    // Batches finish in the order they were submitted, so their staging space is always the oldest part of the ring
+    stagingUsedSize -= batch.stagingSize;
+    if (stagingUsedSize == 0)
+    {
+        stagingHead = 0;
+    }
+    for (auto &[temporaryBuffer, temporaryAllocation] : batch.temporaryStagingBuffers)
+    {
+        vmaUnmapMemory(allocator, temporaryAllocation);
+        vmaDestroyBuffer(allocator, temporaryBuffer, temporaryAllocation);
+    }
+    batch.temporaryStagingBuffers.clear();
+
+    // Completion is only noticed when polled, so the time is an upper bound of the GPU time
+    auto retireTime = std::chrono::high_resolution_clock::now();
+    float uploadTimeMs = std::chrono::duration<float, std::milli>(retireTime - batch.submitTime).count();
+    totalUploadSize += batch.uploadSize;
+    totalUploadTimeMs += uploadTimeMs;
+
+    Logger::Log(
+        LogLevel::Debug,
+        "Uploaded {:.1f} KB in {:.2f} ms, {:.1f} MB/s on average, render thread stalled for {:.2f} ms in total",
+        batch.uploadSize / 1024.0f,
+        uploadTimeMs,
+        totalUploadTimeMs > 0.0f ? totalUploadSize / (1024.0f * 1024.0f) / (totalUploadTimeMs / 1000.0f) : 0.0f,
+        totalStallTimeMs);
+}
+
+void VulkanUploadManager::WaitForOldestBatch()
+{
+    if (pendingBatches.empty())
+    {
+        return;
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    ASSERT_VK_RESULT_SUCCESS(
+        vkWaitForFences(context->GetLogicalDevice(), 1, &batches[pendingBatches.front()].fence, VK_TRUE, UINT64_MAX),
+        "Failed to wait for upload fence");
+    auto endTime = std::chrono::high_resolution_clock::now();
+    totalStallTimeMs += std::chrono::duration<float, std::milli>(endTime - startTime).count();
+
+    RetireOldestBatch();
+}
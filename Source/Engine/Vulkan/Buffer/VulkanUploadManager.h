@@ -0,0 +1,103 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <utility>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include "vk_mem_alloc.hpp"
+
+class VulkanContext;
+
+// Part of the staging memory that the data of one upload is written into
+struct VulkanStagingRegion
+{
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    void *mappedData;
+};
+
+// Collects the uploads of a frame into a single batch, staged in a persistently mapped ring buffer
+// Resources not used by the GPU yet are copied on the dedicated transfer queue when the GPU has one,
+// and handed over to the graphics queue, others are copied on the graphics queue after the frames reading them
+// Allocate the staging region before getting a command buffer, as running out of staging space submits the batch
+class VulkanUploadManager
+{
+public:
+    VulkanUploadManager(VulkanContext *context, VmaAllocator &allocator);
+    ~VulkanUploadManager();
+
+    void Create();
+    void Destroy();
+
+    VulkanStagingRegion AllocateStagingRegion(VkDeviceSize size);
+    VkCommandBuffer GetCopyCommandBuffer(bool inUse);
+    // For the commands after the copies that only the graphics queue supports (e.g. blits)
+    VkCommandBuffer GetGraphicsCommandBuffer();
+
+    void CopyToBuffer(
+        const VulkanStagingRegion &stagingRegion,
+        VkBuffer buffer,
+        VkDeviceSize size,
+        VkBufferUsageFlags usage,
+        bool inUse,
+        VkDeviceSize dstOffset = 0);
+    // Records the barrier after the image copies, with the queue ownership transfer when they are on the transfer queue
+    void ReleaseImage(VkImageMemoryBarrier barrier, VkPipelineStageFlags dstStage, bool inUse);
+
+    // Submits the recorded uploads, which run before any graphics submission after it
+    void Flush();
+    void WaitIdle();
+
+private:
+    static constexpr VkDeviceSize STAGING_RING_SIZE = 64 * 1024 * 1024;
+    // Enough for the texel blocks of compressed images
+    static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+    static constexpr uint32_t MAX_PENDING_BATCHES = 4;
+
+    struct UploadBatch
+    {
+        VkCommandBuffer transferCommandBuffer;
+        VkCommandBuffer graphicsCommandBuffer;
+        VkSemaphore transferFinishedSemaphore;
+        VkFence fence;
+        bool hasCommands;
+        bool hasTransferCommands;
+        // Ring space including the padding skipped when wrapping around
+        VkDeviceSize stagingSize;
+        VkDeviceSize uploadSize;
+        // Uploads larger than the whole ring get their own staging buffer
+        std::vector<std::pair<VkBuffer, VmaAllocation>> temporaryStagingBuffers;
+        std::chrono::high_resolution_clock::time_point submitTime;
+    };
+
+    static void GetBufferAccess(VkBufferUsageFlags usage, VkAccessFlags &access, VkPipelineStageFlags &stage);
+
+    void BeginBatch();
+    void RetireCompletedBatches();
+    void RetireOldestBatch();
+    void WaitForOldestBatch();
+
+    VulkanContext *context;
+    VmaAllocator &allocator;
+
+    VkCommandPool transferCommandPool;
+    VkCommandPool graphicsCommandPool;
+    std::vector<UploadBatch> batches;
+    uint32_t currentBatch;
+    bool recording;
+    // Submitted batches from the oldest
+    std::deque<uint32_t> pendingBatches;
+
+    VkBuffer stagingBuffer;
+    VmaAllocation stagingAllocation;
+    uint8_t *stagingMappedData;
+    VkDeviceSize stagingHead;
+    VkDeviceSize stagingUsedSize;
+
+    // Totals for measuring the upload throughput and the time the render thread was blocked
+    VkDeviceSize totalUploadSize;
+    float totalUploadTimeMs;
+    float totalStallTimeMs;
+};
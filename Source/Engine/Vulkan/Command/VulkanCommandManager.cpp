@@ -1,26 +1,32 @@
-#include <future>
+#include <algorithm>
 
 #include "Common/Logger.h"
 #include "Engine/Vulkan/VulkanCommon.h"
 #include "Engine/Vulkan/VulkanContext.h"
 #include "Engine/Vulkan/VulkanRenderPass.h"
 #include "Engine/Vulkan/Buffer/VulkanBuffer.h"
+#include "Engine/Vulkan/Culling/VulkanGpuCulling.h"
 #include "Engine/Vulkan/Image/VulkanImage.h"
 #include "Engine/Vulkan/Image/VulkanTexture.h"
+#include "Engine/Vulkan/Image/VulkanTextureTable.h"
 #include "Engine/Vulkan/Pipeline/VulkanPipeline.h"
 #include "VulkanCommandPool.h"
 #include "VulkanCommandManager.h"
+#include "VulkanRenderWorkers.h"
 
 VulkanCommandManager::VulkanCommandManager(
     VulkanContext *context,
     VulkanCommandPool *commandPool,
     VulkanRenderPass *renderPass,
+    VulkanRenderWorkers *renderWorkers,
     VulkanDrawingPipelines pipelines)
     : context(context),
       commandPool(commandPool),
       renderPass(renderPass),
+      renderWorkers(renderWorkers),
       pipelines(pipelines),
-      frameBufferSize(0)
+      frameBufferSize(0),
+      lastRecordedLayerCount(0)
 {
 }
 
@@ -33,6 +39,12 @@ void VulkanCommandManager::Create(uint32_t frameBufferSize)
     VkCommandPool commandPoolToUse = commandPool->GetOrCreateCommandPool(std::this_thread::get_id());
 
     this->frameBufferSize = frameBufferSize;
+    recordedTriangleCounts.assign(frameBufferSize, 0);
+    recordedBindCounts.assign(frameBufferSize, 0);
+    recordedPipelineBindCounts.assign(frameBufferSize, 0);
+    recordedDescriptorSetBindCounts.assign(frameBufferSize, 0);
+    recordedDrawCounts.assign(frameBufferSize, 0);
+    recordedInstanceCounts.assign(frameBufferSize, 0);
     for (uint32_t i = 0; i < frameBufferSize; i++)
     {
         std::unique_ptr<VulkanCommand> commandBuffer = std::make_unique<VulkanCommand>(context, commandPoolToUse);
@@ -40,250 +52,514 @@ void VulkanCommandManager::Create(uint32_t frameBufferSize)
 
         primaryCommandBuffers.push_back(std::move(commandBuffer));
     }
+
+    // The secondary command buffers are allocated by the workers as the layers need them
+    workerCommandPools.resize(frameBufferSize);
+    for (auto &workerCommandPoolsForFrame : workerCommandPools)
+    {
+        workerCommandPoolsForFrame.resize(renderWorkers->GetWorkerCount());
+        for (auto &workerCommandPool : workerCommandPoolsForFrame)
+        {
+            workerCommandPool.commandPool = commandPool->CreateWorkerCommandPool();
+        }
+    }
+    layerCommands.resize(frameBufferSize);
 }
 
 void VulkanCommandManager::Destroy()
 {
-    for (auto &[threadId, secondaryCommandBuffer] : secondaryCommandBuffers)
+    // The command buffers are freed with their pools
+    layerCommands.clear();
+    workerCommandPools.clear();
+    primaryCommandBuffers.clear();
+}
+
+uint32_t VulkanCommandManager::GetSecondaryCommandBufferCount() const
+{
+    size_t commandBufferCount = 0;
+    for (const auto &workerCommandPoolsForFrame : workerCommandPools)
     {
-        for (auto &commandBufferForFrame : secondaryCommandBuffer)
+        for (const auto &workerCommandPool : workerCommandPoolsForFrame)
         {
-            for (auto &commandBuffer : commandBufferForFrame.commandBuffers)
-            {
-                commandBuffer->Reset();
-            }
+            commandBufferCount += workerCommandPool.commandBuffers.size();
         }
     }
-
-    secondaryCommandBuffers.clear();
-    primaryCommandBuffers.clear();
+    return static_cast<uint32_t>(commandBufferCount);
 }
 
 void VulkanCommandManager::Record(
     uint32_t imageIndex,
     VkFramebuffer framebuffer,
     VulkanPushConstants pushConstants,
-    VulkanDrawingBuffer drawingBuffer)
+    const VulkanDrawingBuffer &drawingBuffer,
+    const VulkanRenderLayerUpdates &layersUpdated)
 {
-    VkCommandBuffer primaryCommandBuffer = BeginPrimaryCommand(imageIndex, framebuffer);
+    // The layers are recorded in parallel by the render workers, and the entities are split among them
+    std::vector<VulkanRenderWorkers::Job> recordJobs;
+    lastRecordedLayerCount = 0;
+    for (uint32_t layerIndex = 0; layerIndex < RENDER_LAYER_COUNT; layerIndex++)
+    {
+        if (!layersUpdated[layerIndex])
+        {
+            continue;
+        }
+        lastRecordedLayerCount++;
 
-    VulkanBuffer *uniformBuffer = drawingBuffer.uniformBuffer;
-    VulkanBuffer *screenBuffer = drawingBuffer.screenBuffer;
+        // No submitted frame still executes the command buffers of the frame buffer
+        std::vector<LayerCommand> &commands = layerCommands[imageIndex][layerIndex];
+        for (const auto &command : commands)
+        {
+            workerCommandPools[imageIndex][command.workerIndex].freeCommandBuffers.push_back(command.commandBuffer);
+        }
 
-    VulkanMeshPushConstant &meshPushConstant = pushConstants.meshPushConstant;
+        VulkanRenderLayer layer = static_cast<VulkanRenderLayer>(layerIndex);
+        std::vector<std::pair<uint32_t, uint32_t>> batchRanges = layer == VulkanRenderLayer::Static
+            ? SplitEntityDrawBatches(drawingBuffer)
+            : std::vector<std::pair<uint32_t, uint32_t>>{ { 0, 0 } };
+        commands.assign(batchRanges.size(), LayerCommand{});
+        for (size_t commandIndex = 0; commandIndex < commands.size(); commandIndex++)
+        {
+            LayerCommand *command = &commands[commandIndex];
+            std::pair<uint32_t, uint32_t> batchRange = batchRanges[commandIndex];
+            recordJobs.push_back([&, layer, command, batchRange](uint32_t workerIndex)
+                {
+                    RecordLayerCommand(
+                        layer,
+                        imageIndex,
+                        workerIndex,
+                        framebuffer,
+                        pushConstants,
+                        drawingBuffer,
+                        batchRange,
+                        *command);
+                });
+        }
+    }
+    renderWorkers->Run(recordJobs);
+
+    // The primary command buffer is always recorded again, as recording a secondary command buffer
+    // invalidates the primary command buffers executing it
+    VkCommandBuffer primaryCommandBuffer = BeginPrimaryCommand(imageIndex);
+    // The culling runs every time the commands are submitted, so that the recorded draws follow the camera
+    VulkanGpuCulling *gpuCulling = drawingBuffer.gpuCulling;
+    if (gpuCulling)
+    {
+        gpuCulling->RecordCulling(primaryCommandBuffer, imageIndex);
+    }
+    BeginRenderPass(primaryCommandBuffer, framebuffer);
 
-    std::mutex secondaryCommandMutex;
     std::vector<VkCommandBuffer> secondaryCommandBuffers;
-
-    std::future<void> staticCommandFuture = std::async(std::launch::async, [&]()
+    uint64_t triangleCount = 0;
+    uint32_t bindCount = 0;
+    uint32_t pipelineBindCount = 0;
+    uint32_t descriptorSetBindCount = 0;
+    uint32_t drawCount = 0;
+    uint32_t instanceCount = 0;
+    for (const auto &commands : layerCommands[imageIndex])
+    {
+        for (const auto &command : commands)
         {
-            secondaryCommandMutex.lock();
-            VkCommandBuffer secondaryCommandBuffer = BeginSecondaryCommand(imageIndex, framebuffer);
-            secondaryCommandMutex.unlock();
-
-            VulkanPipeline *staticPipeline = pipelines.staticPipeline;
-            BindPipeline(secondaryCommandBuffer, staticPipeline);
-
-            PushConstant(
-                secondaryCommandBuffer,
-                VK_SHADER_STAGE_VERTEX_BIT,
-                staticPipeline,
-                &meshPushConstant,
-                sizeof(VulkanMeshPushConstant));
-
-            for (const auto &entityBuffer : drawingBuffer.entityBuffers)
+            if (command.hasCommands)
             {
-                VulkanBuffer *instanceBuffer = entityBuffer.instanceBuffers[imageIndex];
-                VulkanBuffer *vertexBuffer = entityBuffer.vertexBuffer;
-                VulkanBuffer *indexBuffer = entityBuffer.indexBuffer;
-                VulkanTexture *textureBuffer = entityBuffer.textureBuffer;
-
-                // Bind vertex buffer
-                VkBuffer vertexBuffers[] = { vertexBuffer->GetBuffer() };
-                VkDeviceSize offsets[] = { 0 };
-                vkCmdBindVertexBuffers(secondaryCommandBuffer, 0, 1, vertexBuffers, offsets);
-                // Bind index buffer
-                vkCmdBindIndexBuffer(secondaryCommandBuffer, indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
-                // Bind uniform descriptor set
-                uniformBuffer->BindDescriptorSet(secondaryCommandBuffer, 0, staticPipeline->GetPipelineLayout());
-                // Bind image sampler descriptor set
-                textureBuffer->BindDescriptorSet(secondaryCommandBuffer, 1, staticPipeline->GetPipelineLayout());
-                // Bind instance descriptor set
-                instanceBuffer->BindDescriptorSet(secondaryCommandBuffer, 2, staticPipeline->GetPipelineLayout());
-
-                uint32_t indexCount = indexBuffer->Size() / sizeof(uint32_t);
-                vkCmdDrawIndexed(secondaryCommandBuffer, indexCount, 1, 0, 0, 0);
+                secondaryCommandBuffers.push_back(command.commandBuffer->GetBuffer());
             }
+            triangleCount += command.triangleCount;
+            bindCount += command.bindCount;
+            pipelineBindCount += command.pipelineBindCount;
+            descriptorSetBindCount += command.descriptorSetBindCount;
+            drawCount += command.drawCount;
+            instanceCount += command.instanceCount;
+        }
+    }
+    recordedTriangleCounts[imageIndex] = triangleCount;
+    recordedBindCounts[imageIndex] = bindCount;
+    recordedPipelineBindCounts[imageIndex] = pipelineBindCount;
+    recordedDescriptorSetBindCounts[imageIndex] = descriptorSetBindCount;
+    recordedDrawCounts[imageIndex] = drawCount;
+    recordedInstanceCounts[imageIndex] = instanceCount;
+
+    if (!secondaryCommandBuffers.empty())
+    {
+        vkCmdExecuteCommands(
+            primaryCommandBuffer,
+            static_cast<uint32_t>(secondaryCommandBuffers.size()),
+            secondaryCommandBuffers.data());
+    }
 
-            secondaryCommandMutex.lock();
-            secondaryCommandBuffers.push_back(secondaryCommandBuffer);
-            secondaryCommandMutex.unlock();
-
-            EndCommand(secondaryCommandBuffer);
-        });
+    vkCmdEndRenderPass(primaryCommandBuffer);
+    EndCommand(primaryCommandBuffer);
+}
 
-    std::future<void> cubeMapCommandFuture = std::async(std::launch::async, [&]()
+std::vector<std::pair<uint32_t, uint32_t>> VulkanCommandManager::SplitEntityDrawBatches(
+    const VulkanDrawingBuffer &drawingBuffer) const
+{
+    uint32_t batchCount = static_cast<uint32_t>(drawingBuffer.entityDrawBatches.size());
+    uint32_t drawCount = static_cast<uint32_t>(drawingBuffer.entityDraws.size());
+    uint32_t chunkCount = std::clamp(drawCount / MIN_STATIC_CHUNK_DRAW_COUNT, 1u, renderWorkers->GetWorkerCount());
+
+    // A batch shares its bound buffers, so it is never split, the chunks end at the first batch reaching their share
+    std::vector<std::pair<uint32_t, uint32_t>> batchRanges;
+    uint32_t firstBatch = 0;
+    uint32_t splitDrawCount = 0;
+    for (uint32_t batchIndex = 0; batchIndex < batchCount; batchIndex++)
+    {
+        splitDrawCount += drawingBuffer.entityDrawBatches[batchIndex].drawCount;
+        uint32_t chunkIndex = static_cast<uint32_t>(batchRanges.size());
+        uint64_t chunkEndDrawCount = static_cast<uint64_t>(drawCount) * (chunkIndex + 1) / chunkCount;
+        if (splitDrawCount >= chunkEndDrawCount || batchIndex == batchCount - 1)
         {
-            secondaryCommandMutex.lock();
-            VkCommandBuffer secondaryCommandBuffer = BeginSecondaryCommand(imageIndex, framebuffer);
-            secondaryCommandMutex.unlock();
-
-            VulkanPipeline *cubeMapPipeline = pipelines.cubeMapPipeline;
+            batchRanges.push_back(std::make_pair(firstBatch, batchIndex + 1));
+            firstBatch = batchIndex + 1;
+        }
+    }
+    if (batchRanges.empty())
+    {
+        batchRanges.push_back(std::make_pair(0, 0));
+    }
+    return batchRanges;
+}
 
-            VulkanCubeMapBuffer cubeMapBuffer = drawingBuffer.cubeMapBuffer;
-            VulkanBuffer *cubeMapVertexBuffer = cubeMapBuffer.vertexBuffer;
-            VulkanBuffer *cubeMapIndexBuffer = cubeMapBuffer.indexBuffer;
-            if (cubeMapVertexBuffer != nullptr && cubeMapVertexBuffer->IsLoaded())
-            {
-                BindPipeline(secondaryCommandBuffer, cubeMapPipeline);
-                // Bind cubemap mesh
-                VkDeviceSize offsets[] = { 0 };
-                VkBuffer cubeMapVertexBuffers[] = { cubeMapVertexBuffer->GetBuffer() };
-                vkCmdBindVertexBuffers(secondaryCommandBuffer, 0, 1, cubeMapVertexBuffers, offsets);
-                vkCmdBindIndexBuffer(secondaryCommandBuffer, cubeMapIndexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
-                // Bind uniform descriptor set
-                uniformBuffer->BindDescriptorSet(secondaryCommandBuffer, 0, cubeMapPipeline->GetPipelineLayout());
-                // Bind cubemap descriptor set
-                cubeMapBuffer.textureBuffer->BindDescriptorSet(secondaryCommandBuffer, 1, cubeMapPipeline->GetPipelineLayout());
-                // Draw the cube map
-                uint32_t indexCount = cubeMapIndexBuffer->Size() / sizeof(uint32_t);
-                vkCmdDrawIndexed(secondaryCommandBuffer, indexCount, 1, 0, 0, 0);
-            }
+void VulkanCommandManager::RecordLayerCommand(
+    VulkanRenderLayer layer,
+    uint32_t imageIndex,
+    uint32_t workerIndex,
+    VkFramebuffer framebuffer,
+    VulkanPushConstants &pushConstants,
+    const VulkanDrawingBuffer &drawingBuffer,
+    std::pair<uint32_t, uint32_t> batchRange,
+    LayerCommand &layerCommand)
+{
+    // Command buffers are only allocated when the worker has none left from the updated layers
+    WorkerCommandPool &workerCommandPool = workerCommandPools[imageIndex][workerIndex];
+    if (workerCommandPool.freeCommandBuffers.empty())
+    {
+        std::unique_ptr<VulkanCommand> commandBuffer =
+            std::make_unique<VulkanCommand>(context, workerCommandPool.commandPool);
+        commandBuffer->Create(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        workerCommandPool.freeCommandBuffers.push_back(commandBuffer.get());
+        workerCommandPool.commandBuffers.push_back(std::move(commandBuffer));
+    }
+    layerCommand.workerIndex = workerIndex;
+    layerCommand.commandBuffer = workerCommandPool.freeCommandBuffers.back();
+    workerCommandPool.freeCommandBuffers.pop_back();
+
+    // Beginning the command buffer resets what was recorded in it before
+    VkCommandBuffer commandBuffer = layerCommand.commandBuffer->GetBuffer();
+    BeginSecondaryCommand(commandBuffer, framebuffer);
+    switch (layer)
+    {
+    case VulkanRenderLayer::Static:
+        RecordStaticLayer(commandBuffer, imageIndex, pushConstants, drawingBuffer, batchRange, layerCommand);
+        break;
+    case VulkanRenderLayer::CubeMap:
+        RecordCubeMapLayer(commandBuffer, drawingBuffer, layerCommand);
+        break;
+    case VulkanRenderLayer::Terrain:
+        RecordTerrainLayer(commandBuffer, pushConstants, drawingBuffer, layerCommand);
+        break;
+    case VulkanRenderLayer::Screen:
+        RecordScreenLayer(commandBuffer, drawingBuffer, layerCommand);
+        break;
+    case VulkanRenderLayer::Line:
+        RecordLineLayer(commandBuffer, drawingBuffer, layerCommand);
+        break;
+    }
+    EndCommand(commandBuffer);
+}
 
-            secondaryCommandMutex.lock();
-            secondaryCommandBuffers.push_back(secondaryCommandBuffer);
-            secondaryCommandMutex.unlock();
+void VulkanCommandManager::RecordStaticLayer(
+    VkCommandBuffer commandBuffer,
+    uint32_t imageIndex,
+    VulkanPushConstants &pushConstants,
+    const VulkanDrawingBuffer &drawingBuffer,
+    std::pair<uint32_t, uint32_t> batchRange,
+    LayerCommand &layerCommand)
+{
+    if (batchRange.first == batchRange.second)
+    {
+        return;
+    }
+    layerCommand.hasCommands = true;
 
-            EndCommand(secondaryCommandBuffer);
-        });
+    VulkanPipeline *staticPipeline = pipelines.staticPipeline;
+    BindPipeline(commandBuffer, staticPipeline, layerCommand);
 
-    std::future<void> terrainCommandFuture = std::async(std::launch::async, [&]()
+    PushConstant(
+        commandBuffer,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        staticPipeline,
+        &pushConstants.meshPushConstant,
+        sizeof(VulkanMeshPushConstant));
+
+    // Bind uniform descriptor set
+    drawingBuffer.uniformBuffer->BindDescriptorSet(commandBuffer, 0, staticPipeline->GetPipelineLayout());
+    layerCommand.descriptorSetBindCount++;
+    // Bind every entity texture at once, each instance reads the index of its texture
+    VulkanTextureTable *textureTable = drawingBuffer.textureTable;
+    if (textureTable)
+    {
+        textureTable->BindDescriptorSet(commandBuffer, 1, staticPipeline->GetPipelineLayout());
+        layerCommand.descriptorSetBindCount++;
+    }
+    // Bind the instance inputs of every entity at once, each draw reads the range of its visible instances
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_GRAPHICS,
+        staticPipeline->GetPipelineLayout(),
+        2, 1, &drawingBuffer.instanceDescriptorSet,
+        0, nullptr);
+    layerCommand.descriptorSetBindCount++;
+
+    // The meshes share a few pooled buffers, and the draws come sorted by them then by texture in batches,
+    // so the buffers and textures are only bound again when the next batch uses other ones
+    VulkanGpuCulling *gpuCulling = drawingBuffer.gpuCulling;
+    VulkanTexture *boundTextureBuffer = nullptr;
+    VulkanBuffer *boundVertexBuffer = nullptr;
+    VulkanBuffer *boundIndexBuffer = nullptr;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+    for (uint32_t batchIndex = batchRange.first; batchIndex < batchRange.second; batchIndex++)
+    {
+        const VulkanEntityDrawBatch &entityDrawBatch = drawingBuffer.entityDrawBatches[batchIndex];
+        const VulkanEntityDraw &firstEntityDraw = drawingBuffer.entityDraws[entityDrawBatch.firstDraw];
+        VulkanBuffer *vertexBuffer = firstEntityDraw.vertexBuffer;
+        VulkanBuffer *indexBuffer = firstEntityDraw.indexBuffer;
+        VkIndexType indexType = firstEntityDraw.indexInfo.indexType;
+
+        // Bind vertex buffer
+        if (vertexBuffer != boundVertexBuffer)
         {
-            secondaryCommandMutex.lock();
-            VkCommandBuffer secondaryCommandBuffer = BeginSecondaryCommand(imageIndex, framebuffer);
-            secondaryCommandMutex.unlock();
-
-            VulkanPipeline *terrainPipeline = pipelines.terrainPipeline;
-            BindPipeline(secondaryCommandBuffer, terrainPipeline);
-
-            PushConstant(
-                secondaryCommandBuffer,
-                VK_SHADER_STAGE_VERTEX_BIT,
-                terrainPipeline,
-                &meshPushConstant,
-                sizeof(VulkanMeshPushConstant));
+            VkBuffer vertexBuffers[] = { vertexBuffer->GetBuffer() };
+            VkDeviceSize offsets[] = { 0 };
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+            boundVertexBuffer = vertexBuffer;
+            layerCommand.bindCount++;
+        }
+        // Bind index buffer
+        if (indexBuffer != boundIndexBuffer || indexType != boundIndexType)
+        {
+            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->GetBuffer(), 0, indexType);
+            boundIndexBuffer = indexBuffer;
+            boundIndexType = indexType;
+            layerCommand.bindCount++;
+        }
+        if (!textureTable && firstEntityDraw.textureBuffer != boundTextureBuffer)
+        {
+            // Bind image sampler descriptor set
+            firstEntityDraw.textureBuffer->BindDescriptorSet(
+                commandBuffer, 1, staticPipeline->GetPipelineLayout());
+            boundTextureBuffer = firstEntityDraw.textureBuffer;
+            layerCommand.descriptorSetBindCount++;
+        }
 
-            for (const auto &terrainBuffer : drawingBuffer.terrainBuffers)
+        if (gpuCulling)
+        {
+            // The culling fills in the instance counts, and with the draw count extension only keeps the draws
+            // with visible instances, so one indirect draw issues the whole batch
+            VkBuffer drawCommandBuffer = gpuCulling->GetDrawCommandBuffer(imageIndex);
+            VkDeviceSize drawCommandOffset = sizeof(VulkanDrawIndirectCommand) * entityDrawBatch.firstDraw;
+            if (gpuCulling->CompactsDraws())
             {
-                VulkanBuffer *vertexBuffer = terrainBuffer.vertexBuffer;
-                VulkanBuffer *indexBuffer = terrainBuffer.indexBuffer;
-                VulkanTexture *textureBuffer = terrainBuffer.textureBuffer;
-
-                // Bind vertex buffer
-                VkBuffer vertexBuffers[] = { vertexBuffer->GetBuffer() };
-                VkDeviceSize offsets[] = { 0 };
-                vkCmdBindVertexBuffers(secondaryCommandBuffer, 0, 1, vertexBuffers, offsets);
-                // Bind index buffer
-                vkCmdBindIndexBuffer(secondaryCommandBuffer, indexBuffer->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
-                // Bind uniform descriptor set
-                uniformBuffer->BindDescriptorSet(secondaryCommandBuffer, 0, terrainPipeline->GetPipelineLayout());
-                // Bind image sampler descriptor set
-                textureBuffer->BindDescriptorSet(secondaryCommandBuffer, 1, terrainPipeline->GetPipelineLayout());
-
-                uint32_t indexCount = indexBuffer->Size() / sizeof(uint32_t);
-                vkCmdDrawIndexed(secondaryCommandBuffer, indexCount, 1, 0, 0, 0);
+                context->GetDrawIndexedIndirectCount()(
+                    commandBuffer,
+                    drawCommandBuffer,
+                    drawCommandOffset,
+                    gpuCulling->GetDrawCountBuffer(imageIndex),
+                    sizeof(uint32_t) * batchIndex,
+                    entityDrawBatch.drawCount,
+                    sizeof(VulkanDrawIndirectCommand));
             }
+            else
+            {
+                vkCmdDrawIndexedIndirect(
+                    commandBuffer,
+                    drawCommandBuffer,
+                    drawCommandOffset,
+                    entityDrawBatch.drawCount,
+                    sizeof(VulkanDrawIndirectCommand));
+            }
+            layerCommand.drawCount++;
+        }
 
-            secondaryCommandMutex.lock();
-            secondaryCommandBuffers.push_back(secondaryCommandBuffer);
-            secondaryCommandMutex.unlock();
+        // Counted before the GPU culling, which only the GPU knows the result of
+        for (uint32_t drawIndex = entityDrawBatch.firstDraw;
+            drawIndex < entityDrawBatch.firstDraw + entityDrawBatch.drawCount;
+            drawIndex++)
+        {
+            const VulkanEntityDraw &entityDraw = drawingBuffer.entityDraws[drawIndex];
+            if (!gpuCulling)
+            {
+                vkCmdDrawIndexed(
+                    commandBuffer,
+                    entityDraw.indexInfo.indexCount,
+                    entityDraw.instanceCount,
+                    entityDraw.indexInfo.firstIndex,
+                    entityDraw.vertexOffset,
+                    entityDraw.firstInstance);
+                layerCommand.drawCount++;
+            }
+            layerCommand.triangleCount +=
+                static_cast<uint64_t>(entityDraw.indexInfo.indexCount / 3) * entityDraw.instanceCount;
+            layerCommand.instanceCount += entityDraw.instanceCount;
+        }
+    }
+}
 
-            EndCommand(secondaryCommandBuffer);
-        });
+void VulkanCommandManager::RecordCubeMapLayer(
+    VkCommandBuffer commandBuffer,
+    const VulkanDrawingBuffer &drawingBuffer,
+    LayerCommand &layerCommand)
+{
+    const VulkanCubeMapBuffer &cubeMapBuffer = drawingBuffer.cubeMapBuffer;
+    VulkanBuffer *cubeMapVertexBuffer = cubeMapBuffer.vertexBuffer;
+    VulkanBuffer *cubeMapIndexBuffer = cubeMapBuffer.indexBuffer;
+    if (cubeMapVertexBuffer == nullptr || !cubeMapVertexBuffer->IsLoaded())
+    {
+        return;
+    }
+    layerCommand.hasCommands = true;
+
+    VulkanPipeline *cubeMapPipeline = pipelines.cubeMapPipeline;
+    BindPipeline(commandBuffer, cubeMapPipeline, layerCommand);
+    // Bind cubemap mesh
+    VkDeviceSize offsets[] = { 0 };
+    VkBuffer cubeMapVertexBuffers[] = { cubeMapVertexBuffer->GetBuffer() };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, cubeMapVertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, cubeMapIndexBuffer->GetBuffer(), 0, cubeMapBuffer.indexInfo.indexType);
+    layerCommand.bindCount += 2;
+    // Bind uniform descriptor set
+    drawingBuffer.uniformBuffer->BindDescriptorSet(commandBuffer, 0, cubeMapPipeline->GetPipelineLayout());
+    // Bind cubemap descriptor set
+    cubeMapBuffer.textureBuffer->BindDescriptorSet(commandBuffer, 1, cubeMapPipeline->GetPipelineLayout());
+    layerCommand.descriptorSetBindCount += 2;
+    // Draw the cube map
+    vkCmdDrawIndexed(commandBuffer, cubeMapBuffer.indexInfo.indexCount, 1, 0, 0, 0);
+    layerCommand.triangleCount += cubeMapBuffer.indexInfo.indexCount / 3;
+    layerCommand.drawCount++;
+}
 
-    terrainCommandFuture.get();
-    staticCommandFuture.get();
-    cubeMapCommandFuture.get();
+void VulkanCommandManager::RecordTerrainLayer(
+    VkCommandBuffer commandBuffer,
+    VulkanPushConstants &pushConstants,
+    const VulkanDrawingBuffer &drawingBuffer,
+    LayerCommand &layerCommand)
+{
+    if (drawingBuffer.terrainBuffers.empty())
+    {
+        return;
+    }
+    layerCommand.hasCommands = true;
 
-    // Screen objects must appear on top of everthing else
-    // Otherwise, the screen object could be blended by something else
-    std::future<void> screenCommandFuture = std::async(std::launch::async, [&]()
-        {
-            secondaryCommandMutex.lock();
-            VkCommandBuffer secondaryCommandBuffer = BeginSecondaryCommand(imageIndex, framebuffer);
-            secondaryCommandMutex.unlock();
+    VulkanPipeline *terrainPipeline = pipelines.terrainPipeline;
+    BindPipeline(commandBuffer, terrainPipeline, layerCommand);
 
-            VulkanPipeline *screenPipeline = pipelines.screenPipeline;
-            BindPipeline(secondaryCommandBuffer, screenPipeline);
+    PushConstant(
+        commandBuffer,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        terrainPipeline,
+        &pushConstants.meshPushConstant,
+        sizeof(VulkanMeshPushConstant));
 
-            for (const auto &screenObjectBuffer : drawingBuffer.screenObjectBuffers)
-            {
-                VulkanBuffer *vertexBuffer = screenObjectBuffer.vertexBuffer;
-                VulkanTexture *textureBuffer = screenObjectBuffer.textureBuffer;
-
-                // Bind vertex buffer
-                VkBuffer vertexBuffers[] = { vertexBuffer->GetBuffer() };
-                VkDeviceSize offsets[] = { 0 };
-                vkCmdBindVertexBuffers(secondaryCommandBuffer, 0, 1, vertexBuffers, offsets);
-                // Bind uniform descriptor set
-                screenBuffer->BindDescriptorSet(secondaryCommandBuffer, 0, screenPipeline->GetPipelineLayout());
-                // Bind image sampler descriptor set
-                textureBuffer->BindDescriptorSet(secondaryCommandBuffer, 1, screenPipeline->GetPipelineLayout());
-
-                uint32_t vertexCount = vertexBuffer->Size() / sizeof(ScreenObjectVertex);
-                vkCmdDraw(secondaryCommandBuffer, vertexCount, 1, 0, 0);
-            }
+    // Bind uniform descriptor set, shared by every terrain block
+    drawingBuffer.uniformBuffer->BindDescriptorSet(commandBuffer, 0, terrainPipeline->GetPipelineLayout());
+    layerCommand.descriptorSetBindCount++;
 
-            secondaryCommandMutex.lock();
-            secondaryCommandBuffers.push_back(secondaryCommandBuffer);
-            secondaryCommandMutex.unlock();
+    VulkanTexture *boundTextureBuffer = nullptr;
+    for (const auto &terrainBuffer : drawingBuffer.terrainBuffers)
+    {
+        VulkanBuffer *vertexBuffer = terrainBuffer.vertexBuffer;
+        VulkanBuffer *indexBuffer = terrainBuffer.indexBuffer;
+        VulkanTexture *textureBuffer = terrainBuffer.textureBuffer;
+
+        // Bind vertex buffer
+        VkBuffer vertexBuffers[] = { vertexBuffer->GetBuffer() };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        // Bind index buffer
+        vkCmdBindIndexBuffer(commandBuffer, indexBuffer->GetBuffer(), 0, terrainBuffer.indexInfo.indexType);
+        layerCommand.bindCount += 2;
+        // Bind image sampler descriptor set
+        if (textureBuffer != boundTextureBuffer)
+        {
+            textureBuffer->BindDescriptorSet(commandBuffer, 1, terrainPipeline->GetPipelineLayout());
+            boundTextureBuffer = textureBuffer;
+            layerCommand.descriptorSetBindCount++;
+        }
 
-            EndCommand(secondaryCommandBuffer);
-        });
-    screenCommandFuture.get();
+        vkCmdDrawIndexed(commandBuffer, terrainBuffer.indexInfo.indexCount, 1, 0, 0, 0);
+        layerCommand.triangleCount += terrainBuffer.indexInfo.indexCount / 3;
+        layerCommand.drawCount++;
+    }
+}
 
-    // Line segments for debugging purpose
-    std::future<void> lineCommandFuture = std::async(std::launch::async, [&]()
-        {
-            VulkanBuffer *lineBuffer = drawingBuffer.lineBuffer.vertexBuffer;
-            if (lineBuffer != nullptr && lineBuffer->IsLoaded())
-            {
-                secondaryCommandMutex.lock();
-                VkCommandBuffer secondaryCommandBuffer = BeginSecondaryCommand(imageIndex, framebuffer);
-                secondaryCommandMutex.unlock();
+void VulkanCommandManager::RecordScreenLayer(
+    VkCommandBuffer commandBuffer,
+    const VulkanDrawingBuffer &drawingBuffer,
+    LayerCommand &layerCommand)
+{
+    if (drawingBuffer.screenObjectBuffers.empty())
+    {
+        return;
+    }
+    layerCommand.hasCommands = true;
 
-                VulkanPipeline *linePipeline = pipelines.linePipeline;
-                BindPipeline(secondaryCommandBuffer, linePipeline);
+    VulkanPipeline *screenPipeline = pipelines.screenPipeline;
+    BindPipeline(commandBuffer, screenPipeline, layerCommand);
+    // Bind uniform descriptor set, shared by every screen object
+    drawingBuffer.screenBuffer->BindDescriptorSet(commandBuffer, 0, screenPipeline->GetPipelineLayout());
+    layerCommand.descriptorSetBindCount++;
 
-                // Bind vertex buffer
-                VkBuffer vertexBuffers[] = { lineBuffer->GetBuffer() };
-                VkDeviceSize offsets[] = { 0 };
-                vkCmdBindVertexBuffers(secondaryCommandBuffer, 0, 1, vertexBuffers, offsets);
-                // Bind uniform descriptor set
-                uniformBuffer->BindDescriptorSet(secondaryCommandBuffer, 0, linePipeline->GetPipelineLayout());
+    VulkanTexture *boundTextureBuffer = nullptr;
+    for (const auto &screenObjectBuffer : drawingBuffer.screenObjectBuffers)
+    {
+        VulkanBuffer *vertexBuffer = screenObjectBuffer.vertexBuffer;
+        VulkanTexture *textureBuffer = screenObjectBuffer.textureBuffer;
+
+        // Bind vertex buffer
+        VkBuffer vertexBuffers[] = { vertexBuffer->GetBuffer() };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+        // Bind image sampler descriptor set
+        if (textureBuffer != boundTextureBuffer)
+        {
+            textureBuffer->BindDescriptorSet(commandBuffer, 1, screenPipeline->GetPipelineLayout());
+            boundTextureBuffer = textureBuffer;
+            layerCommand.descriptorSetBindCount++;
+        }
 
-                uint32_t vertexCount = lineBuffer->Size() / sizeof(LineSegmentVertex);
-                vkCmdDraw(secondaryCommandBuffer, vertexCount, 1, 0, 0);
+        uint32_t vertexCount = vertexBuffer->Size() / sizeof(ScreenObjectVertex);
+        vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+    }
+}
 
-                secondaryCommandMutex.lock();
-                secondaryCommandBuffers.push_back(secondaryCommandBuffer);
-                secondaryCommandMutex.unlock();
+// Line segments for debugging purpose
+void VulkanCommandManager::RecordLineLayer(
+    VkCommandBuffer commandBuffer,
+    const VulkanDrawingBuffer &drawingBuffer,
+    LayerCommand &layerCommand)
+{
+    VulkanBuffer *lineBuffer = drawingBuffer.lineBuffer.vertexBuffer;
+    if (lineBuffer == nullptr || !lineBuffer->IsLoaded())
+    {
+        return;
+    }
+    layerCommand.hasCommands = true;
 
-                EndCommand(secondaryCommandBuffer);
-            }
-        });
-    lineCommandFuture.get();
+    VulkanPipeline *linePipeline = pipelines.linePipeline;
+    BindPipeline(commandBuffer, linePipeline, layerCommand);
 
-    vkCmdExecuteCommands(
-        primaryCommandBuffer,
-        static_cast<uint32_t>(secondaryCommandBuffers.size()),
-        secondaryCommandBuffers.data());
+    // Bind vertex buffer
+    VkBuffer vertexBuffers[] = { lineBuffer->GetBuffer() };
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    // Bind uniform descriptor set
+    drawingBuffer.uniformBuffer->BindDescriptorSet(commandBuffer, 0, linePipeline->GetPipelineLayout());
+    layerCommand.descriptorSetBindCount++;
 
-    vkCmdEndRenderPass(primaryCommandBuffer);
-    EndCommand(primaryCommandBuffer);
+    uint32_t vertexCount = lineBuffer->Size() / sizeof(LineSegmentVertex);
+    vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
 }
 
-VkCommandBuffer VulkanCommandManager::BeginPrimaryCommand(uint32_t imageIndex, VkFramebuffer frameBuffer)
+VkCommandBuffer VulkanCommandManager::BeginPrimaryCommand(uint32_t imageIndex)
 {
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -296,6 +572,11 @@ VkCommandBuffer VulkanCommandManager::BeginPrimaryCommand(uint32_t imageIndex, V
 
     SetViewPortAndScissor(commandBuffer);
 
+    return commandBuffer;
+}
+
+void VulkanCommandManager::BeginRenderPass(VkCommandBuffer commandBuffer, VkFramebuffer frameBuffer)
+{
     VkRenderPassBeginInfo renderPassBeginInfo{};
     renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassBeginInfo.renderPass = renderPass->GetRenderPass();
@@ -310,15 +591,10 @@ VkCommandBuffer VulkanCommandManager::BeginPrimaryCommand(uint32_t imageIndex, V
     renderPassBeginInfo.pClearValues = clearValues;
 
     vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
-
-    return commandBuffer;
 }
 
-VkCommandBuffer VulkanCommandManager::BeginSecondaryCommand(uint32_t imageIndex, VkFramebuffer frameBuffer)
+void VulkanCommandManager::BeginSecondaryCommand(VkCommandBuffer commandBuffer, VkFramebuffer frameBuffer)
 {
-    VulkanCommand *secondaryCommandBuffer = RequestSecondaryCommandBuffer(imageIndex);
-    VkCommandBuffer commandBuffer = secondaryCommandBuffer->GetBuffer();
-
     VkCommandBufferInheritanceInfo inheritanceInfo{};
     inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
     inheritanceInfo.framebuffer = frameBuffer;
@@ -334,13 +610,12 @@ VkCommandBuffer VulkanCommandManager::BeginSecondaryCommand(uint32_t imageIndex,
         "Failed to begin command buffer");
 
     SetViewPortAndScissor(commandBuffer);
-
-    return commandBuffer;
 }
 
-void VulkanCommandManager::BindPipeline(VkCommandBuffer commandBuffer, VulkanPipeline *pipeline)
+void VulkanCommandManager::BindPipeline(VkCommandBuffer commandBuffer, VulkanPipeline *pipeline, LayerCommand &layerCommand)
 {
     vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->GetPipeline());
+    layerCommand.pipelineBindCount++;
 }
 
 void VulkanCommandManager::EndCommand(VkCommandBuffer commandBuffer)
@@ -353,62 +628,18 @@ void VulkanCommandManager::PushConstant(
     VkShaderStageFlags stage,
     VulkanPipeline *pipeline,
     void *data,
-    uint32_t size)
+    uint32_t size,
+    uint32_t offset)
 {
     vkCmdPushConstants(
         commandBuffer,
         pipeline->GetPipelineLayout(),
         stage,
-        0,
+        offset,
         size,
         data);
 }
 
-VulkanCommand * VulkanCommandManager::RequestSecondaryCommandBuffer(uint32_t imageIndex)
-{
-    // This method is not thread-safe, so need to have a mutx to ensure
-    // that only one thread is calling this function at a time
-    std::thread::id threadId = std::this_thread::get_id();
-    VkCommandPool commandPoolToUse = commandPool->GetOrCreateCommandPool(threadId);
-
-    if (secondaryCommandBuffers.count(threadId) == 0)
-    {
-        secondaryCommandBuffers[threadId].resize(frameBufferSize);
-        secondaryCommandBuffers[threadId][imageIndex].activeBuffersInUse = 0;
-    }
-
-    // This is obviously not be the best solution
-    // But if the same thread ID is assigned to two different secondary command buffers at the same time
-    // Then one of them must create a new command buffer, to avoid conflict with the other one
-    auto &secondaryCommandBuffer = secondaryCommandBuffers[threadId][imageIndex];
-    if (secondaryCommandBuffer.activeBuffersInUse < secondaryCommandBuffer.commandBuffers.size())
-    {
-        int currentIndex = secondaryCommandBuffer.activeBuffersInUse;
-        secondaryCommandBuffer.activeBuffersInUse++;
-        return secondaryCommandBuffer.commandBuffers[currentIndex].get();
-    }
-    // Allocate extra command buffer for the thread in case all existing command buffers are in use
-    else
-    {
-        std::unique_ptr<VulkanCommand> commandBuffer = std::make_unique<VulkanCommand>(context, commandPoolToUse);
-        commandBuffer->Create(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
-
-        secondaryCommandBuffer.commandBuffers.push_back(std::move(commandBuffer));
-        secondaryCommandBuffer.activeBuffersInUse++;
-
-        return secondaryCommandBuffer.commandBuffers.back().get();
-    }
-}
-
-void VulkanCommandManager::Reset(uint32_t previousImageIndex)
-{
-    // Allows threads to reuse the command buffer that were previously created
-    for (auto &[threadId, secondaryCommandBuffer] : secondaryCommandBuffers)
-    {
-        secondaryCommandBuffer[previousImageIndex].activeBuffersInUse = 0;
-    }
-}
-
 void VulkanCommandManager::SetViewPortAndScissor(VkCommandBuffer commandBuffer)
 {
     VkViewport viewport{};
@@ -1,12 +1,13 @@
 #pragma once
 
+#include <array>
 #include <memory>
-#include <thread>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <vulkan/vulkan.h>
 
+#include "Engine/Vulkan/VulkanCommon.h"
 #include "VulkanCommand.h"
 
 struct VulkanCubeMapBuffer;
@@ -16,6 +17,7 @@ struct VulkanPushConstants;
 class VulkanContext;
 class VulkanCommandPool;
 class VulkanRenderPass;
+class VulkanRenderWorkers;
 
 class VulkanCommandManager
 {
@@ -24,6 +26,7 @@ public:
         VulkanContext *context,
         VulkanCommandPool *commandPool,
         VulkanRenderPass *renderPass,
+        VulkanRenderWorkers *renderWorkers,
         VulkanDrawingPipelines pipelines);
     ~VulkanCommandManager();
 
@@ -32,47 +35,158 @@ public:
         return primaryCommandBuffers[imageIndex]->GetBuffer();
     }
 
+    // Triangles drawn by the command buffer of the image, excluding the screen objects and debug lines
+    uint64_t GetRecordedTriangleCount(uint32_t imageIndex) const
+    {
+        return recordedTriangleCounts[imageIndex];
+    }
+
+    // Vertex and index buffer binds recorded in the same command buffer
+    uint32_t GetRecordedBindCount(uint32_t imageIndex) const
+    {
+        return recordedBindCounts[imageIndex];
+    }
+
+    // Pipeline and descriptor set binds recorded in the same command buffer, each layer binds its pipeline once
+    uint32_t GetRecordedPipelineBindCount(uint32_t imageIndex) const
+    {
+        return recordedPipelineBindCounts[imageIndex];
+    }
+
+    uint32_t GetRecordedDescriptorSetBindCount(uint32_t imageIndex) const
+    {
+        return recordedDescriptorSetBindCounts[imageIndex];
+    }
+
+    // Draws recorded in the same command buffer, entities sharing a mesh and texture are instances of one draw,
+    // and a batch of draws is one indirect draw when culled on the GPU
+    uint32_t GetRecordedDrawCount(uint32_t imageIndex) const
+    {
+        return recordedDrawCounts[imageIndex];
+    }
+
+    // Instances before the GPU culling, which only leaves out the instances outside of the frustum on the GPU
+    uint32_t GetRecordedInstanceCount(uint32_t imageIndex) const
+    {
+        return recordedInstanceCounts[imageIndex];
+    }
+
+    // Layers recorded again by the last recording, the other layers executed the secondary command buffers
+    // recorded before
+    uint32_t GetLastRecordedLayerCount() const { return lastRecordedLayerCount; }
+    // Allocated by the render workers, only grows with the most command buffers any frame buffer needed
+    uint32_t GetSecondaryCommandBufferCount() const;
+
     void Create(uint32_t frameBufferSize);
     void Destroy();
+    // Records the primary command buffer of the image again, with the secondary command buffers of the updated layers
     void Record(
         uint32_t imageIndex,
         VkFramebuffer framebuffer,
         VulkanPushConstants pushConstants,
-        VulkanDrawingBuffer drawingBuffer);
-    void Reset(uint32_t previousImageIndex);
+        const VulkanDrawingBuffer &drawingBuffer,
+        const VulkanRenderLayerUpdates &layersUpdated);
 
 private:
-    void BindPipeline(VkCommandBuffer commandBuffer, VulkanPipeline *pipeline);
+    // Draws below which the entities are not split into more chunks, recording a secondary command buffer costs more
+    static constexpr uint32_t MIN_STATIC_CHUNK_DRAW_COUNT = 128;
+
+    // Secondary command buffer recorded by a render worker, kept until its layer is updated
+    struct LayerCommand
+    {
+        uint32_t workerIndex;
+        VulkanCommand *commandBuffer;
+        // Not executed when there is nothing to draw
+        bool hasCommands;
+        uint64_t triangleCount;
+        uint32_t bindCount;
+        uint32_t pipelineBindCount;
+        uint32_t descriptorSetBindCount;
+        uint32_t drawCount;
+        uint32_t instanceCount;
+    };
+
+    // Command pool of a render worker for one frame buffer, only that worker records from it
+    struct WorkerCommandPool
+    {
+        VkCommandPool commandPool;
+        std::vector<std::unique_ptr<VulkanCommand>> commandBuffers;
+        // Command buffers of the updated layers, recorded again before new ones are allocated
+        std::vector<VulkanCommand *> freeCommandBuffers;
+    };
+
+    // Ranges of entity draw batches with about as many draws each, one per render worker at most
+    std::vector<std::pair<uint32_t, uint32_t>> SplitEntityDrawBatches(const VulkanDrawingBuffer &drawingBuffer) const;
+    void RecordLayerCommand(
+        VulkanRenderLayer layer,
+        uint32_t imageIndex,
+        uint32_t workerIndex,
+        VkFramebuffer framebuffer,
+        VulkanPushConstants &pushConstants,
+        const VulkanDrawingBuffer &drawingBuffer,
+        std::pair<uint32_t, uint32_t> batchRange,
+        LayerCommand &layerCommand);
+    void RecordStaticLayer(
+        VkCommandBuffer commandBuffer,
+        uint32_t imageIndex,
+        VulkanPushConstants &pushConstants,
+        const VulkanDrawingBuffer &drawingBuffer,
+        std::pair<uint32_t, uint32_t> batchRange,
+        LayerCommand &layerCommand);
+    void RecordCubeMapLayer(
+        VkCommandBuffer commandBuffer,
+        const VulkanDrawingBuffer &drawingBuffer,
+        LayerCommand &layerCommand);
+    void RecordTerrainLayer(
+        VkCommandBuffer commandBuffer,
+        VulkanPushConstants &pushConstants,
+        const VulkanDrawingBuffer &drawingBuffer,
+        LayerCommand &layerCommand);
+    void RecordScreenLayer(
+        VkCommandBuffer commandBuffer,
+        const VulkanDrawingBuffer &drawingBuffer,
+        LayerCommand &layerCommand);
+    void RecordLineLayer(
+        VkCommandBuffer commandBuffer,
+        const VulkanDrawingBuffer &drawingBuffer,
+        LayerCommand &layerCommand);
+
+    void BindPipeline(VkCommandBuffer commandBuffer, VulkanPipeline *pipeline, LayerCommand &layerCommand);
     void PushConstant(
         VkCommandBuffer commandBuffer,
         VkShaderStageFlags stage,
         VulkanPipeline *pipeline,
         void *data,
-        uint32_t size);
+        uint32_t size,
+        uint32_t offset = 0);
 
-    // Primary command buffer
-    VkCommandBuffer BeginPrimaryCommand(uint32_t imageIndex, VkFramebuffer frameBuffer);
+    // Primary command buffer, the render pass begins after the commands recorded outside of it
+    VkCommandBuffer BeginPrimaryCommand(uint32_t imageIndex);
+    void BeginRenderPass(VkCommandBuffer commandBuffer, VkFramebuffer frameBuffer);
     // Secondary command buffer
-    VkCommandBuffer BeginSecondaryCommand(uint32_t imageIndex, VkFramebuffer frameBuffer);
-    VulkanCommand * RequestSecondaryCommandBuffer(uint32_t imageIndex);
+    void BeginSecondaryCommand(VkCommandBuffer commandBuffer, VkFramebuffer frameBuffer);
 
     void EndCommand(VkCommandBuffer commandBuffer);
     void SetViewPortAndScissor(VkCommandBuffer commandBuffer);
 
     std::vector<std::unique_ptr<VulkanCommand>> primaryCommandBuffers;
-    struct SecondaryCommandBuffer
-    {
-        int activeBuffersInUse;
-        std::vector<std::unique_ptr<VulkanCommand>> commandBuffers;
-    };
-    // Each thread has number of SecondaryCommandBuffer's equal to the number of frame buffers
-    // Then each SecondaryCommandBuffer allows one or more command buffer to be defined
-    std::unordered_map<std::thread::id, std::vector<SecondaryCommandBuffer>> secondaryCommandBuffers;
+    // Indexed by frame buffer then by render worker
+    std::vector<std::vector<WorkerCommandPool>> workerCommandPools;
+    // Indexed by frame buffer then by layer, the entities are split into several command buffers
+    std::vector<std::array<std::vector<LayerCommand>, RENDER_LAYER_COUNT>> layerCommands;
 
     uint32_t frameBufferSize;
+    uint32_t lastRecordedLayerCount;
+    std::vector<uint64_t> recordedTriangleCounts;
+    std::vector<uint32_t> recordedBindCounts;
+    std::vector<uint32_t> recordedPipelineBindCounts;
+    std::vector<uint32_t> recordedDescriptorSetBindCounts;
+    std::vector<uint32_t> recordedDrawCounts;
+    std::vector<uint32_t> recordedInstanceCounts;
 
     VulkanContext *context;
     VulkanCommandPool *commandPool;
     VulkanRenderPass *renderPass;
+    VulkanRenderWorkers *renderWorkers;
     VulkanDrawingPipelines pipelines;
 };
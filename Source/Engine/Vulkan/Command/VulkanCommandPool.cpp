@@ -23,6 +23,12 @@ void VulkanCommandPool::Destroy()
         vkDestroyCommandPool(context->GetLogicalDevice(), commandPool, nullptr);
     }
     commandPools.clear();
+
+    for (VkCommandPool commandPool : workerCommandPools)
+    {
+        vkDestroyCommandPool(context->GetLogicalDevice(), commandPool, nullptr);
+    }
+    workerCommandPools.clear();
 }
 
 VkCommandPool VulkanCommandPool::GetOrCreateCommandPool(std::thread::id threadId)
@@ -32,15 +38,32 @@ VkCommandPool VulkanCommandPool::GetOrCreateCommandPool(std::thread::id threadId
         return commandPools[threadId];
     }
 
+    VkCommandPool commandPool = CreateCommandPool(
+        VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    commandPools.insert(std::make_pair(threadId, commandPool));
+
+    return commandPools[threadId];
+}
+
+VkCommandPool VulkanCommandPool::CreateWorkerCommandPool()
+{
+    // The command buffers are reused one by one, when the layers recorded in them are updated
+    VkCommandPool commandPool = CreateCommandPool(VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    workerCommandPools.push_back(commandPool);
+
+    return commandPool;
+}
+
+VkCommandPool VulkanCommandPool::CreateCommandPool(VkCommandPoolCreateFlags flags)
+{
     VkCommandPool commandPool;
     VkCommandPoolCreateInfo commandPoolInfo{};
     commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     commandPoolInfo.queueFamilyIndex = context->GetGraphicsQueueIndex();
-    commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    commandPoolInfo.flags = flags;
     ASSERT_VK_RESULT_SUCCESS(
         vkCreateCommandPool(context->GetLogicalDevice(), &commandPoolInfo, nullptr, &commandPool),
         "Failed to create command pool");
-    commandPools.insert(std::make_pair(threadId, commandPool));
 
-    return commandPools[threadId];
+    return commandPool;
 }
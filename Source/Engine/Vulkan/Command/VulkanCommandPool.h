@@ -2,6 +2,7 @@
 
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
 #include <vulkan/vulkan.h>
 
@@ -16,9 +17,20 @@ public:
     void Create();
     void Destroy();
 
+    // Pools are only created by the render thread and the render workers, so their count stays constant
+    uint32_t GetCommandPoolCount() const
+    {
+        return static_cast<uint32_t>(commandPools.size() + workerCommandPools.size());
+    }
+
     VkCommandPool GetOrCreateCommandPool(std::thread::id threadId);
+    // Not tied to a thread, only the render worker owning it records from it
+    VkCommandPool CreateWorkerCommandPool();
 
 private:
+    VkCommandPool CreateCommandPool(VkCommandPoolCreateFlags flags);
+
     VulkanContext *context;
     std::unordered_map<std::thread::id, VkCommandPool> commandPools;
+    std::vector<VkCommandPool> workerCommandPools;
 };
@@ -0,0 +1,108 @@
+#include <algorithm>
+
+#include "VulkanRenderWorkers.h"
+
+VulkanRenderWorkers::VulkanRenderWorkers(uint32_t workerCount)
+    : workerCount(workerCount),
+      jobs(nullptr),
+      nextJobIndex(0),
+      remainingJobCount(0),
+      isStopping(false)
+{
+    if (this->workerCount == 0)
+    {
+        uint32_t hardwareThreadCount = std::thread::hardware_concurrency();
+        this->workerCount = hardwareThreadCount > 1 ? hardwareThreadCount - 1 : 1;
+    }
+    this->workerCount = std::min(this->workerCount, MAX_WORKER_COUNT);
+}
+
+VulkanRenderWorkers::~VulkanRenderWorkers()
+{
+}
+
+void VulkanRenderWorkers::Create()
+{
+    isStopping = false;
+    for (uint32_t workerIndex = 0; workerIndex < workerCount; workerIndex++)
+    {
+        workers.emplace_back(&VulkanRenderWorkers::RunWorker, this, workerIndex);
+    }
+}
+
+void VulkanRenderWorkers::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(jobMutex);
+        isStopping = true;
+    }
+    jobsAvailable.notify_all();
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+}
+
+void VulkanRenderWorkers::Run(const std::vector<Job> &jobs)
+{
+    if (jobs.empty())
+    {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(jobMutex);
+    this->jobs = &jobs;
+    nextJobIndex = 0;
+    remainingJobCount = jobs.size();
+    jobsAvailable.notify_all();
+
+    jobsDone.wait(lock, [&]() { return remainingJobCount == 0; });
+    this->jobs = nullptr;
+
+    if (jobException)
+    {
+        std::exception_ptr exception = jobException;
+        jobException = nullptr;
+        std::rethrow_exception(exception);
+    }
+}
+
+void VulkanRenderWorkers::RunWorker(uint32_t workerIndex)
+{
+    std::unique_lock<std::mutex> lock(jobMutex);
+    while (true)
+    {
+        jobsAvailable.wait(lock, [&]()
+            {
+                return isStopping || (jobs != nullptr && nextJobIndex < jobs->size());
+            });
+        if (isStopping)
+        {
+            return;
+        }
+
+        const Job &job = (*jobs)[nextJobIndex++];
+        lock.unlock();
+        std::exception_ptr exception;
+        try
+        {
+            job(workerIndex);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+        lock.lock();
+
+        if (exception && !jobException)
+        {
+            jobException = exception;
+        }
+        if (--remainingJobCount == 0)
+        {
+            jobsDone.notify_one();
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of threads recording the secondary command buffers, started once with the draw engine.
+// Each job is given the index of the worker running it, so that it only records from the command pools of that worker
+class VulkanRenderWorkers
+{
+public:
+    using Job = std::function<void(uint32_t workerIndex)>;
+
+    // One less than the hardware threads when the worker count is 0
+    VulkanRenderWorkers(uint32_t workerCount);
+    ~VulkanRenderWorkers();
+
+    uint32_t GetWorkerCount() const { return workerCount; }
+
+    void Create();
+    void Destroy();
+    // Blocks until every job is done, and rethrows the first exception thrown by the jobs
+    void Run(const std::vector<Job> &jobs);
+
+private:
+    static constexpr uint32_t MAX_WORKER_COUNT = 8;
+
+    void RunWorker(uint32_t workerIndex);
+
+    uint32_t workerCount;
+    std::vector<std::thread> workers;
+
+    std::mutex jobMutex;
+    std::condition_variable jobsAvailable;
+    std::condition_variable jobsDone;
+    // Jobs of the current run, null between the runs
+    const std::vector<Job> *jobs;
+    size_t nextJobIndex;
+    size_t remainingJobCount;
+    std::exception_ptr jobException;
+    bool isStopping;
+};
@@ -0,0 +1,327 @@
+#include "Common/Logger.h"
+#include "Engine/Vulkan/VulkanContext.h"
+#include "Engine/Vulkan/Buffer/VulkanBuffer.h"
+#include "Engine/Vulkan/Pipeline/VulkanComputePipeline.h"
+#include "VulkanGpuCulling.h"
+
+VulkanGpuCulling::VulkanGpuCulling(
+    VulkanContext *context,
+    VulkanUploadManager *uploadManager,
+    VmaAllocator &allocator,
+    VkDescriptorPool descriptorPool,
+    VulkanDrawingPipelines pipelines,
+    uint32_t frameBufferSize)
+    : context(context),
+      uploadManager(uploadManager),
+      allocator(allocator),
+      descriptorPool(descriptorPool),
+      pipelines(pipelines),
+      frameBufferSize(frameBufferSize)
+{
+}
+
+VulkanGpuCulling::~VulkanGpuCulling()
+{
+}
+
+void VulkanGpuCulling::Create()
+{
+    frames.resize(frameBufferSize);
+    for (FrameCulling &frame : frames)
+    {
+        VulkanCullingBufferInput defaultCullingBufferInput{};
+        frame.cullingBuffer = std::make_unique<VulkanBuffer>(context, uploadManager, allocator);
+        frame.cullingBuffer->Load(
+            VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            nullptr,
+            0,
+            sizeof(VulkanCullingBufferInput));
+        frame.cullingBuffer->UpdateFast(&defaultCullingBufferInput, sizeof(VulkanCullingBufferInput));
+
+        frame.drawCommandTemplateBuffer = std::make_unique<VulkanBuffer>(context, uploadManager, allocator);
+        frame.drawCommandBuffer = std::make_unique<VulkanBuffer>(context, uploadManager, allocator);
+        frame.compactedDrawCommandBuffer = std::make_unique<VulkanBuffer>(context, uploadManager, allocator);
+        frame.drawCountBuffer = std::make_unique<VulkanBuffer>(context, uploadManager, allocator);
+        LoadDrawBuffers(frame, INITIAL_DRAW_CAPACITY);
+
+        VkDescriptorSetLayout descriptorSetLayout = pipelines.cullInstancesPipeline->GetDescriptorSetLayout();
+        VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+        descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        descriptorSetAllocInfo.descriptorPool = descriptorPool;
+        descriptorSetAllocInfo.descriptorSetCount = 1;
+        descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
+        ASSERT_VK_RESULT_SUCCESS(
+            vkAllocateDescriptorSets(context->GetLogicalDevice(), &descriptorSetAllocInfo, &frame.descriptorSet),
+            "Failed to allocate culling descriptor set");
+
+        frame.instanceCount = 0;
+        frame.drawCount = 0;
+        frame.batchCount = 0;
+    }
+}
+
+void VulkanGpuCulling::Destroy()
+{
+    // The descriptor sets are freed with the descriptor pool
+    for (FrameCulling &frame : frames)
+    {
+        frame.cullingBuffer->Unload();
+        UnloadDrawBuffers(frame);
+    }
+    frames.clear();
+}
+
+bool VulkanGpuCulling::CompactsDraws() const
+{
+    return context->GetDrawIndexedIndirectCount() != nullptr;
+}
+
+void VulkanGpuCulling::PrepareFrame(
+    uint32_t imageIndex,
+    const std::vector<VulkanEntityDraw> &draws,
+    const std::vector<VulkanEntityDrawBatch> &batches,
+    uint32_t instanceCount,
+    VulkanBuffer *instanceBuffer,
+    VulkanBuffer *visibleInstanceBuffer)
+{
+    FrameCulling &frame = frames[imageIndex];
+    uint32_t drawCount = static_cast<uint32_t>(draws.size());
+    if (drawCount > frame.drawCapacity)
+    {
+        uint32_t capacity = frame.drawCapacity;
+        while (capacity < drawCount)
+        {
+            capacity *= 2;
+        }
+
+        UnloadDrawBuffers(frame);
+        LoadDrawBuffers(frame, capacity);
+        Logger::Log(LogLevel::Debug, "Grew culling buffers {} to {} draws", imageIndex, capacity);
+    }
+
+    // Every draw starts with no instance, the culling adds the visible ones
+    drawCommands.resize(drawCount);
+    for (uint32_t batchIndex = 0; batchIndex < batches.size(); batchIndex++)
+    {
+        const VulkanEntityDrawBatch &batch = batches[batchIndex];
+        for (uint32_t drawIndex = batch.firstDraw; drawIndex < batch.firstDraw + batch.drawCount; drawIndex++)
+        {
+            const VulkanEntityDraw &draw = draws[drawIndex];
+            VulkanDrawIndirectCommand &drawCommand = drawCommands[drawIndex];
+            drawCommand.command.indexCount = draw.indexInfo.indexCount;
+            drawCommand.command.instanceCount = 0;
+            drawCommand.command.firstIndex = draw.indexInfo.firstIndex;
+            drawCommand.command.vertexOffset = draw.vertexOffset;
+            drawCommand.command.firstInstance = draw.firstInstance;
+            drawCommand.batchIndex = batchIndex;
+            drawCommand.batchFirstDraw = batch.firstDraw;
+            drawCommand.padding = 0;
+        }
+    }
+    if (drawCount > 0)
+    {
+        frame.drawCommandTemplateBuffer->UpdateFast(
+            drawCommands.data(), static_cast<uint32_t>(sizeof(VulkanDrawIndirectCommand) * drawCount));
+    }
+
+    frame.instanceCount = instanceCount;
+    frame.drawCount = drawCount;
+    frame.batchCount = static_cast<uint32_t>(batches.size());
+    UpdateDescriptorSet(frame, instanceBuffer, visibleInstanceBuffer);
+}
+
+void VulkanGpuCulling::UpdateFrustum(uint32_t imageIndex, const std::array<glm::vec4, 6> &frustumPlanes)
+{
+    VulkanCullingBufferInput cullingBufferInput{};
+    std::copy(frustumPlanes.begin(), frustumPlanes.end(), cullingBufferInput.frustumPlanes);
+    frames[imageIndex].cullingBuffer->UpdateFast(&cullingBufferInput, sizeof(VulkanCullingBufferInput));
+}
+
+void VulkanGpuCulling::RecordCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    const FrameCulling &frame = frames[imageIndex];
+    if (frame.drawCount == 0)
+    {
+        return;
+    }
+
+    bool compactDraws = CompactsDraws();
+    VkBufferCopy drawCommandCopy{};
+    drawCommandCopy.size = sizeof(VulkanDrawIndirectCommand) * frame.drawCount;
+    vkCmdCopyBuffer(
+        commandBuffer,
+        frame.drawCommandTemplateBuffer->GetBuffer(),
+        frame.drawCommandBuffer->GetBuffer(),
+        1,
+        &drawCommandCopy);
+    if (compactDraws)
+    {
+        vkCmdFillBuffer(commandBuffer, frame.drawCountBuffer->GetBuffer(), 0, sizeof(uint32_t) * frame.batchCount, 0);
+    }
+
+    // The previous frame of the image read the same buffers as draw parameters, which is done once its fence is waited
+    VkMemoryBarrier resetBarrier{};
+    resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        1, &resetBarrier,
+        0, nullptr,
+        0, nullptr);
+
+    VulkanCullingPushConstant pushConstant{ frame.instanceCount, frame.drawCount };
+    VulkanComputePipeline *cullInstancesPipeline = pipelines.cullInstancesPipeline;
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullInstancesPipeline->GetPipeline());
+    vkCmdBindDescriptorSets(
+        commandBuffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        cullInstancesPipeline->GetPipelineLayout(),
+        0, 1, &frame.descriptorSet,
+        0, nullptr);
+    vkCmdPushConstants(
+        commandBuffer,
+        cullInstancesPipeline->GetPipelineLayout(),
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        0,
+        sizeof(VulkanCullingPushConstant),
+        &pushConstant);
+    vkCmdDispatch(commandBuffer, (frame.instanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier cullingBarrier{};
+    cullingBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullingBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    if (compactDraws)
+    {
+        cullingBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            commandBuffer,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            0,
+            1, &cullingBarrier,
+            0, nullptr,
+            0, nullptr);
+
+        VulkanComputePipeline *compactDrawsPipeline = pipelines.compactDrawsPipeline;
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, compactDrawsPipeline->GetPipeline());
+        vkCmdBindDescriptorSets(
+            commandBuffer,
+            VK_PIPELINE_BIND_POINT_COMPUTE,
+            compactDrawsPipeline->GetPipelineLayout(),
+            0, 1, &frame.descriptorSet,
+            0, nullptr);
+        vkCmdPushConstants(
+            commandBuffer,
+            compactDrawsPipeline->GetPipelineLayout(),
+            VK_SHADER_STAGE_COMPUTE_BIT,
+            0,
+            sizeof(VulkanCullingPushConstant),
+            &pushConstant);
+        vkCmdDispatch(commandBuffer, (frame.drawCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    }
+
+    // The draws read the commands and counts as draw parameters, and the visible instances in the vertex shader
+    cullingBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+        0,
+        1, &cullingBarrier,
+        0, nullptr,
+        0, nullptr);
+}
+
+VkBuffer VulkanGpuCulling::GetDrawCommandBuffer(uint32_t imageIndex) const
+{
+    const FrameCulling &frame = frames[imageIndex];
+    return CompactsDraws()
+        ? frame.compactedDrawCommandBuffer->GetBuffer()
+        : frame.drawCommandBuffer->GetBuffer();
+}
+
+VkBuffer VulkanGpuCulling::GetDrawCountBuffer(uint32_t imageIndex) const
+{
+    return frames[imageIndex].drawCountBuffer->GetBuffer();
+}
+
+void VulkanGpuCulling::LoadDrawBuffers(FrameCulling &frame, uint32_t drawCapacity)
+{
+    uint32_t drawCommandSize = static_cast<uint32_t>(sizeof(VulkanDrawIndirectCommand) * drawCapacity);
+    frame.drawCommandTemplateBuffer->Load(
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        nullptr,
+        0,
+        drawCommandSize);
+    frame.drawCommandBuffer->Load(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        nullptr,
+        0,
+        drawCommandSize);
+    frame.compactedDrawCommandBuffer->Load(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        nullptr,
+        0,
+        drawCommandSize);
+    // There are never more batches than draws
+    frame.drawCountBuffer->Load(
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        nullptr,
+        0,
+        static_cast<uint32_t>(sizeof(uint32_t) * drawCapacity));
+    frame.drawCapacity = drawCapacity;
+}
+
+void VulkanGpuCulling::UnloadDrawBuffers(FrameCulling &frame)
+{
+    frame.drawCommandTemplateBuffer->Unload();
+    frame.drawCommandBuffer->Unload();
+    frame.compactedDrawCommandBuffer->Unload();
+    frame.drawCountBuffer->Unload();
+}
+
+void VulkanGpuCulling::UpdateDescriptorSet(
+    FrameCulling &frame,
+    VulkanBuffer *instanceBuffer,
+    VulkanBuffer *visibleInstanceBuffer)
+{
+    // Same order as the bindings of the culling descriptor set layout
+    VkBuffer buffers[CULLING_DESCRIPTOR_LAYOUT_BINDING_COUNT] =
+    {
+        frame.cullingBuffer->GetBuffer(),
+        instanceBuffer->GetBuffer(),
+        frame.drawCommandBuffer->GetBuffer(),
+        visibleInstanceBuffer->GetBuffer(),
+        frame.compactedDrawCommandBuffer->GetBuffer(),
+        frame.drawCountBuffer->GetBuffer()
+    };
+
+    VkDescriptorBufferInfo descriptorBufferInfos[CULLING_DESCRIPTOR_LAYOUT_BINDING_COUNT]{};
+    VkWriteDescriptorSet descriptorWrites[CULLING_DESCRIPTOR_LAYOUT_BINDING_COUNT]{};
+    for (uint32_t binding = 0; binding < CULLING_DESCRIPTOR_LAYOUT_BINDING_COUNT; binding++)
+    {
+        descriptorBufferInfos[binding].buffer = buffers[binding];
+        descriptorBufferInfos[binding].offset = 0;
+        descriptorBufferInfos[binding].range = VK_WHOLE_SIZE;
+
+        descriptorWrites[binding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[binding].dstSet = frame.descriptorSet;
+        descriptorWrites[binding].dstBinding = binding;
+        descriptorWrites[binding].dstArrayElement = 0;
+        descriptorWrites[binding].descriptorType = CULLING_DESCRIPTOR_LAYOUT_BINDINGS[binding].descriptorType;
+        descriptorWrites[binding].descriptorCount = 1;
+        descriptorWrites[binding].pBufferInfo = &descriptorBufferInfos[binding];
+    }
+
+    vkUpdateDescriptorSets(
+        context->GetLogicalDevice(), CULLING_DESCRIPTOR_LAYOUT_BINDING_COUNT, descriptorWrites, 0, nullptr);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+
+#include "vk_mem_alloc.hpp"
+
+#include "Engine/Vulkan/VulkanCommon.h"
+
+class VulkanBuffer;
+class VulkanContext;
+class VulkanUploadManager;
+
+// Culls the instances of the recorded draws against the view frustum with a compute shader at the start of each frame,
+// so that commands recorded once only draw the visible instances while the camera moves.
+// The draws start with no instance, each visible instance is counted into its draw and listed in the instance range
+// of the draw, then the draws with visible instances are compacted per batch for the indirect count draws
+class VulkanGpuCulling
+{
+public:
+    VulkanGpuCulling(
+        VulkanContext *context,
+        VulkanUploadManager *uploadManager,
+        VmaAllocator &allocator,
+        VkDescriptorPool descriptorPool,
+        VulkanDrawingPipelines pipelines,
+        uint32_t frameBufferSize);
+    ~VulkanGpuCulling();
+
+    void Create();
+    void Destroy();
+
+    // Without VK_KHR_draw_indirect_count, every draw of a batch is issued and the culled ones have no instance
+    bool CompactsDraws() const;
+    // Called when the commands of the image are recorded again, the instance buffers are the ones of the image
+    void PrepareFrame(
+        uint32_t imageIndex,
+        const std::vector<VulkanEntityDraw> &draws,
+        const std::vector<VulkanEntityDrawBatch> &batches,
+        uint32_t instanceCount,
+        VulkanBuffer *instanceBuffer,
+        VulkanBuffer *visibleInstanceBuffer);
+    void UpdateFrustum(uint32_t imageIndex, const std::array<glm::vec4, 6> &frustumPlanes);
+    // Recorded outside of the render pass, before the draws reading the results
+    void RecordCulling(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+
+    // VulkanDrawIndirectCommand of each draw, compacted per batch when the draws are compacted
+    VkBuffer GetDrawCommandBuffer(uint32_t imageIndex) const;
+    // Number of compacted draws of each batch
+    VkBuffer GetDrawCountBuffer(uint32_t imageIndex) const;
+
+private:
+    // Draws the buffers have room for at first, they grow with the number of draws
+    static constexpr uint32_t INITIAL_DRAW_CAPACITY = 256;
+    static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+    struct FrameCulling
+    {
+        std::unique_ptr<VulkanBuffer> cullingBuffer;
+        // Written by the CPU when the commands are recorded, copied into the draw commands before each culling
+        std::unique_ptr<VulkanBuffer> drawCommandTemplateBuffer;
+        std::unique_ptr<VulkanBuffer> drawCommandBuffer;
+        std::unique_ptr<VulkanBuffer> compactedDrawCommandBuffer;
+        std::unique_ptr<VulkanBuffer> drawCountBuffer;
+        uint32_t drawCapacity;
+        VkDescriptorSet descriptorSet;
+
+        uint32_t instanceCount;
+        uint32_t drawCount;
+        uint32_t batchCount;
+    };
+
+    void LoadDrawBuffers(FrameCulling &frame, uint32_t drawCapacity);
+    void UnloadDrawBuffers(FrameCulling &frame);
+    void UpdateDescriptorSet(FrameCulling &frame, VulkanBuffer *instanceBuffer, VulkanBuffer *visibleInstanceBuffer);
+
+    VulkanContext *context;
+    VulkanUploadManager *uploadManager;
+    VmaAllocator &allocator;
+    VkDescriptorPool descriptorPool;
+    VulkanDrawingPipelines pipelines;
+    uint32_t frameBufferSize;
+
+    std::vector<FrameCulling> frames;
+    // Reused to build the draw commands of a frame before they are written
+    std::vector<VulkanDrawIndirectCommand> drawCommands;
+};
@@ -8,10 +8,8 @@
 
 VulkanFrameBuffer::VulkanFrameBuffer(
     VulkanContext *context,
-    VkCommandPool &commandPool,
     VmaAllocator &allocator)
     : context(context),
-      commandPool(commandPool),
       allocator(allocator),
       frameBuffer(VK_NULL_HANDLE)
 {
@@ -31,13 +29,13 @@ void VulkanFrameBuffer::Create(
     std::vector<uint8_t *> blankImagePixels;
     std::unique_ptr<VulkanImage> colorImage = std::make_unique<VulkanImage>(
         context,
-        commandPool,
+        nullptr,
         allocator,
         VulkanImageType::Color);
     colorImage->Load(blankImagePixels, width, height);
     std::unique_ptr<VulkanImage> depthImage = std::make_unique<VulkanImage>(
         context,
-        commandPool,
+        nullptr,
         allocator,
         VulkanImageType::Depth);
     depthImage->Load(blankImagePixels, width, height);
@@ -15,7 +15,6 @@ class VulkanFrameBuffer
 public:
     VulkanFrameBuffer(
         VulkanContext *context,
-        VkCommandPool &commandPool,
         VmaAllocator &allocator);
     ~VulkanFrameBuffer();
 
@@ -32,7 +31,6 @@ public:
 
 private:
     VulkanContext *context;
-    VkCommandPool &commandPool;
     VmaAllocator &allocator;
 
     VkFramebuffer frameBuffer;
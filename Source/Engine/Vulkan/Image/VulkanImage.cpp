@@ -1,16 +1,18 @@
 #include "Engine/Image.h"
 #include "Engine/Vulkan/VulkanCommon.h"
 #include "Engine/Vulkan/VulkanContext.h"
-#include "Engine/Vulkan/Buffer/VulkanBuffer.h"
+#include "Engine/Vulkan/VulkanDeletionQueue.h"
+#include "Engine/Vulkan/Buffer/VulkanUploadManager.h"
 #include "VulkanImage.h"
+#include "VulkanSamplerCache.h"
 
 VulkanImage::VulkanImage(
     VulkanContext *context,
-    VkCommandPool &commandPool,
+    VulkanUploadManager *uploadManager,
     VmaAllocator &allocator,
     VulkanImageType type)
     : context(context),
-      commandPool(commandPool),
+      uploadManager(uploadManager),
       allocator(allocator),
       type(type),
       allocation(),
@@ -19,6 +21,7 @@ VulkanImage::VulkanImage(
       image(),
       imageView(),
       sampler(),
+      compressedFormat(VK_FORMAT_UNDEFINED),
       mipLevels(1),
       loaded(false)
 {
@@ -40,6 +43,27 @@ void VulkanImage::Load(
     this->loaded = true;
 }
 
+void VulkanImage::LoadCompressed(const Image *compressedImage, uint32_t baseMipLevel)
+{
+    const std::vector<ImageMipLevel> &imageMipLevels = compressedImage->GetMipLevels();
+    compressedFormat = GetCompressedFormat(compressedImage);
+    mipLevels = static_cast<uint32_t>(imageMipLevels.size()) - baseMipLevel;
+
+    CreateImage({}, imageMipLevels[baseMipLevel].width, imageMipLevels[baseMipLevel].height);
+    UploadCompressedMipLevels(compressedImage, baseMipLevel);
+    CreateImageView();
+    CreateSampler();
+
+    this->loaded = true;
+}
+
+VkDeviceSize VulkanImage::GetMemorySize() const
+{
+    VmaAllocationInfo allocationInfo{};
+    vmaGetAllocationInfo(allocator, allocation, &allocationInfo);
+    return allocationInfo.size;
+}
+
 void VulkanImage::Unload()
 {
     if (!loaded)
@@ -47,11 +71,23 @@ void VulkanImage::Unload()
         return;
     }
 
-    VkDevice logicalDevice = context->GetLogicalDevice();
+    // A copy into the image may still be waiting in the current upload batch, it is submitted before the next frame
+    // and the image is destroyed once that frame is complete
+    if (uploadManager)
+    {
+        uploadManager->Flush();
+    }
 
-    vkDestroySampler(logicalDevice, sampler, nullptr);
-    vkDestroyImageView(logicalDevice, imageView, nullptr);
-    vmaDestroyImage(allocator, image, allocation);
+    VkDevice logicalDevice = context->GetLogicalDevice();
+    VmaAllocator imageAllocator = allocator;
+    VkImage unloadedImage = image;
+    VkImageView unloadedImageView = imageView;
+    VmaAllocation unloadedAllocation = allocation;
+    context->GetDeletionQueue()->Defer([logicalDevice, imageAllocator, unloadedImage, unloadedImageView, unloadedAllocation]()
+        {
+            vkDestroyImageView(logicalDevice, unloadedImageView, nullptr);
+            vmaDestroyImage(imageAllocator, unloadedImage, unloadedAllocation);
+        });
 
     this->loaded = false;
 }
@@ -63,8 +99,8 @@ void VulkanImage::CreateImage(
 {
     width = imageWidth;
     height = imageHeight;
-    // Only texture for objects would have mipmaps
-    if (type == VulkanImageType::Texture)
+    // Only texture for objects would have mipmaps, compressed textures come with their own
+    if (type == VulkanImageType::Texture && compressedFormat == VK_FORMAT_UNDEFINED)
     {
         mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
     }
@@ -148,96 +184,8 @@ void VulkanImage::CreateImageView()
 
 void VulkanImage::CreateSampler()
 {
-    VkDevice logicalDevice = context->GetLogicalDevice();
-
-    VkPhysicalDeviceProperties physicalDeviceProperties;
-    vkGetPhysicalDeviceProperties(context->GetPhysicalDevice(), &physicalDeviceProperties);
-
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = physicalDeviceProperties.limits.maxSamplerAnisotropy;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    samplerInfo.minLod = 0.0f;
-    samplerInfo.maxLod = static_cast<float>(mipLevels);
-    samplerInfo.mipLodBias = 0.0f;
-
-    ASSERT_VK_RESULT_SUCCESS(
-        vkCreateSampler(logicalDevice, &samplerInfo, nullptr, &sampler),
-        "Failed to create texture sampler");
-}
-
-VkCommandBuffer VulkanImage::BeginSingleUseCommandBuffer()
-{
-    VkDevice logicalDevice = context->GetLogicalDevice();
-
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = commandPool;
-    allocInfo.commandBufferCount = 1;
-
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(logicalDevice, &allocInfo, &commandBuffer);
-
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-    return commandBuffer;
-}
-
-void VulkanImage::CopyDataToImageBuffer(
-    VkBuffer stagingBuffer,
-    VkDeviceSize offset,
-    uint32_t layerIndex,
-    uint32_t width,
-    uint32_t height)
-{
-    VkCommandBuffer commandBuffer = BeginSingleUseCommandBuffer();
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = offset;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = layerIndex;
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { width, height, 1 };
-    region.imageSubresource.layerCount = 1;
-
-    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-    EndSingleUseCommandBuffer(commandBuffer);
-}
-
-void VulkanImage::EndSingleUseCommandBuffer(VkCommandBuffer commandBuffer)
-{
-    VkDevice logicalDevice = context->GetLogicalDevice();
-    VkQueue graphicsQueue = context->GetGraphicsQueue();
-
-    vkEndCommandBuffer(commandBuffer);
-
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
-
-    vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(graphicsQueue);
-
-    vkFreeCommandBuffers(logicalDevice, commandPool, 1, &commandBuffer);
+    // Shared with the other images, so it is not destroyed with the image
+    sampler = context->GetSamplerCache()->GetSampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, true);
 }
 
 VkFormat VulkanImage::FindImageFormat(VulkanImageType type)
@@ -249,6 +197,7 @@ VkFormat VulkanImage::FindImageFormat(VulkanImageType type)
     case VulkanImageType::Depth:
         return context->GetDepthImageFormat();
     case VulkanImageType::Texture:
+        return compressedFormat != VK_FORMAT_UNDEFINED ? compressedFormat : VK_FORMAT_R8G8B8A8_SRGB;
     case VulkanImageType::CubeMap:
     default:
         return VK_FORMAT_R8G8B8A8_SRGB;
@@ -284,6 +233,125 @@ VkImageUsageFlags VulkanImage::GetUsageFlags(VulkanImageType type)
     }
 }
 
+VkFormat VulkanImage::GetCompressedFormat(const Image *compressedImage)
+{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    switch (compressedImage->GetFormat())
+    {
+    case ImageFormat::BC1:
+        format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+        break;
+    case ImageFormat::BC3:
+        format = VK_FORMAT_BC3_SRGB_BLOCK;
+        break;
+    case ImageFormat::BC5:
+        // Two channel data such as normal maps, so not in sRGB
+        format = VK_FORMAT_BC5_UNORM_BLOCK;
+        break;
+    case ImageFormat::BC7:
+        format = VK_FORMAT_BC7_SRGB_BLOCK;
+        break;
+    default:
+        throw std::invalid_argument("Image is not block compressed");
+    }
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(context->GetPhysicalDevice(), format, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+    {
+        throw std::runtime_error("Block compressed texture format is not supported by the GPU");
+    }
+    return format;
+}
+
+void VulkanImage::UploadCompressedMipLevels(const Image *compressedImage, uint32_t baseMipLevel)
+{
+    const std::vector<uint8_t> &compressedData = compressedImage->GetCompressedData();
+    const std::vector<ImageMipLevel> &imageMipLevels = compressedImage->GetMipLevels();
+
+    // The levels are stored from the finest, so the resident ones are the end of the data
+    size_t baseOffset = imageMipLevels[baseMipLevel].offset;
+    size_t dataSize = compressedData.size() - baseOffset;
+    VulkanStagingRegion stagingRegion = uploadManager->AllocateStagingRegion(dataSize);
+    memcpy(stagingRegion.mappedData, compressedData.data() + baseOffset, dataSize);
+
+    std::vector<VkBufferImageCopy> regions;
+    for (uint32_t level = baseMipLevel; level < imageMipLevels.size(); level++)
+    {
+        VkBufferImageCopy region{};
+        region.bufferOffset = stagingRegion.offset + imageMipLevels[level].offset - baseOffset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = level - baseMipLevel;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { imageMipLevels[level].width, imageMipLevels[level].height, 1 };
+        regions.push_back(region);
+    }
+
+    CopyStagingRegionToImage(stagingRegion, regions, false);
+}
+
+void VulkanImage::CopyStagingRegionToImage(
+    const VulkanStagingRegion &stagingRegion,
+    const std::vector<VkBufferImageCopy> &regions,
+    bool generateMipmaps)
+{
+    // An image that earlier frames sample is overwritten on the graphics queue after them
+    bool inUse = loaded;
+    VkCommandBuffer commandBuffer = uploadManager->GetCopyCommandBuffer(inUse);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = type == VulkanImageType::CubeMap ? 6 : 1;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        inUse ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0,
+        nullptr,
+        0,
+        nullptr,
+        1,
+        &barrier);
+
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        stagingRegion.buffer,
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data());
+
+    // Blits are only supported on the graphics queue, so the image stays a transfer destination until it gets there
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    if (generateMipmaps)
+    {
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        uploadManager->ReleaseImage(barrier, VK_PIPELINE_STAGE_TRANSFER_BIT, inUse);
+        GenerateMipmaps(FindImageFormat(type));
+    }
+    else
+    {
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        uploadManager->ReleaseImage(barrier, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, inUse);
+    }
+}
+
 void VulkanImage::GenerateMipmaps(VkFormat format)
 {
     VkFormatProperties formatProperties;
@@ -294,7 +362,7 @@ void VulkanImage::GenerateMipmaps(VkFormat format)
         throw std::runtime_error("Texture image format does not support linear blitting");
     }
 
-    VkCommandBuffer commandBuffer = BeginSingleUseCommandBuffer();
+    VkCommandBuffer commandBuffer = uploadManager->GetGraphicsCommandBuffer();
 
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
@@ -396,72 +464,6 @@ void VulkanImage::GenerateMipmaps(VkFormat format)
         nullptr,
         1,
         &barrier);
-
-    EndSingleUseCommandBuffer(commandBuffer);
-}
-
-void VulkanImage::RunPipelineBarrierCommand(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
-{
-    VkCommandBuffer commandBuffer = BeginSingleUseCommandBuffer();
-
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = oldLayout;
-    barrier.newLayout = newLayout;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = image;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = mipLevels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    if (type == VulkanImageType::Texture)
-    {
-        barrier.subresourceRange.layerCount = 1;
-    }
-    else if (type == VulkanImageType::CubeMap)
-    {
-        barrier.subresourceRange.layerCount = 6;
-    }
-
-    VkPipelineStageFlags sourceStage;
-    VkPipelineStageFlags destinationStage;
-    if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED
-        && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
-    {
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    }
-    else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-        && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
-    {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    }
-    else
-    {
-        throw std::invalid_argument("Invalid layout transition parameters");
-    }
-
-    vkCmdPipelineBarrier(
-        commandBuffer,
-        sourceStage,
-        destinationStage,
-        0,
-        0,
-        nullptr,
-        0,
-        nullptr,
-        1,
-        &barrier);
-
-    EndSingleUseCommandBuffer(commandBuffer);
 }
 
 void VulkanImage::UpdateImagePixels(
@@ -473,51 +475,29 @@ void VulkanImage::UpdateImagePixels(
     width = imageWidth;
     height = imageHeight;
 
-    VkFormat format = FindImageFormat(type);
-    RunPipelineBarrierCommand(format, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+    // Cube map has six images to load into
+    VkDeviceSize layerSize = static_cast<VkDeviceSize>(width) * height * static_cast<VkDeviceSize>(sizeof(uint32_t));
+    VkDeviceSize imageSize = layerSize * imagePixels.size();
 
-    VkDeviceSize imageSize = 0, layerSize = 1;
-    if (type == VulkanImageType::Texture)
-    {
-        imageSize = static_cast<VkDeviceSize>(width) * height * static_cast<VkDeviceSize>(sizeof(uint32_t));
-        layerSize = imageSize;
-    }
-    else if (type == VulkanImageType::CubeMap)
-    {
-        // Cube map has six images to load into
-        imageSize = 6 * static_cast<VkDeviceSize>(width) * height * static_cast<VkDeviceSize>(sizeof(uint32_t));
-        layerSize = imageSize / 6;
-    }
-
-    VkBuffer stagingBuffer;
-    VmaAllocation stagingAllocation;
-    VulkanBuffer::CreateBuffer(
-        allocator,
-        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-        imageSize,
-        stagingBuffer,
-        stagingAllocation);
-
-    void *mappedData;
-    vmaMapMemory(allocator, stagingAllocation, &mappedData);
+    VulkanStagingRegion stagingRegion = uploadManager->AllocateStagingRegion(imageSize);
+    std::vector<VkBufferImageCopy> regions;
     for (uint32_t layer = 0; layer < imagePixels.size(); layer++)
     {
-        uint8_t *pixels = imagePixels[layer];
         VkDeviceSize offset = layer * layerSize;
-        memcpy(static_cast<uint8_t *>(mappedData) + offset, pixels, layerSize);
-        CopyDataToImageBuffer(stagingBuffer, offset, layer, width, height);
-    }
-    vmaUnmapMemory(allocator, stagingAllocation);
-
-    if (type == VulkanImageType::Texture)
-    {
-        GenerateMipmaps(format);
-    }
-    else if (type == VulkanImageType::CubeMap)
-    {
-        RunPipelineBarrierCommand(format, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        memcpy(static_cast<uint8_t *>(stagingRegion.mappedData) + offset, imagePixels[layer], layerSize);
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = stagingRegion.offset + offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = layer;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { width, height, 1 };
+        regions.push_back(region);
     }
 
-    vmaDestroyBuffer(allocator, stagingBuffer, stagingAllocation);
+    CopyStagingRegionToImage(stagingRegion, regions, type == VulkanImageType::Texture);
 }
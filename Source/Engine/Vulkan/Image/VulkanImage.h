@@ -3,7 +3,10 @@
 #include <vulkan/vulkan.h>
 #include "vk_mem_alloc.hpp"
 
+class Image;
 class VulkanContext;
+class VulkanUploadManager;
+struct VulkanStagingRegion;
 
 enum class VulkanImageType
 {
@@ -18,7 +21,7 @@ class VulkanImage
 public:
     VulkanImage(
         VulkanContext *context,
-        VkCommandPool &commandPool,
+        VulkanUploadManager *uploadManager,
         VmaAllocator &allocator,
         VulkanImageType type);
     ~VulkanImage();
@@ -26,11 +29,16 @@ public:
     VkImage GetImage() { return image; }
     VkImageView GetImageView() { return imageView; }
     VkSampler GetSampler() { return sampler; }
+    uint32_t GetMipLevels() const { return mipLevels; }
+    VkDeviceSize GetMemorySize() const;
 
     void Load(
         std::vector<uint8_t *> imagePixels,
         uint32_t width,
         uint32_t height);
+    // Copies the levels of a block compressed texture from the base level as is, no mipmaps are generated
+    // The finer levels are left out of the image, which is how streamed textures keep only their low mips resident
+    void LoadCompressed(const Image *compressedImage, uint32_t baseMipLevel = 0);
     void Unload();
     void UpdateImagePixels(
         std::vector<uint8_t *> imagePixels,
@@ -45,29 +53,29 @@ private:
     void CreateImageView();
     void CreateSampler();
 
-    VkCommandBuffer BeginSingleUseCommandBuffer();
-    void CopyDataToImageBuffer(
-        VkBuffer stagingBuffer,
-        VkDeviceSize offset,
-        uint32_t layerIndex,
-        uint32_t width,
-        uint32_t height);
-    void EndSingleUseCommandBuffer(VkCommandBuffer commandBuffer);
-    
+    void CopyStagingRegionToImage(
+        const VulkanStagingRegion &stagingRegion,
+        const std::vector<VkBufferImageCopy> &regions,
+        bool generateMipmaps);
+
     VkFormat FindImageFormat(VulkanImageType type);
     VkImageAspectFlags GetAspectFlags(VulkanImageType type);
     VkImageUsageFlags GetUsageFlags(VulkanImageType type);
 
+    VkFormat GetCompressedFormat(const Image *compressedImage);
+    void UploadCompressedMipLevels(const Image *compressedImage, uint32_t baseMipLevel);
     void GenerateMipmaps(VkFormat format);
-    void RunPipelineBarrierCommand(VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
 
     VulkanImageType type;
     bool loaded;
 
     VulkanContext *context;
-    VkCommandPool &commandPool;
+    // Not used by the frame buffer attachments, which have no pixels to upload
+    VulkanUploadManager *uploadManager;
     VmaAllocator &allocator;
 
+    // Only set for block compressed textures
+    VkFormat compressedFormat;
     uint32_t mipLevels;
     uint32_t width;
     uint32_t height;
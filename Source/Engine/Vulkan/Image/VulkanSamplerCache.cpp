@@ -0,0 +1,67 @@
+#include "Common/Logger.h"
+#include "Engine/Vulkan/VulkanCommon.h"
+#include "Engine/Vulkan/VulkanContext.h"
+#include "VulkanSamplerCache.h"
+
+VulkanSamplerCache::VulkanSamplerCache(VulkanContext *context)
+    : context(context)
+{
+}
+
+VulkanSamplerCache::~VulkanSamplerCache()
+{
+}
+
+void VulkanSamplerCache::Destroy()
+{
+    std::lock_guard<std::mutex> lock(samplerMutex);
+    for (auto &[key, sampler] : samplers)
+    {
+        vkDestroySampler(context->GetLogicalDevice(), sampler, nullptr);
+    }
+    samplers.clear();
+}
+
+VkSampler VulkanSamplerCache::GetSampler(VkFilter filter, VkSamplerAddressMode addressMode, bool enableAnisotropy)
+{
+    std::lock_guard<std::mutex> lock(samplerMutex);
+
+    auto key = std::make_tuple(filter, addressMode, enableAnisotropy);
+    auto cachedSampler = samplers.find(key);
+    if (cachedSampler != samplers.end())
+    {
+        return cachedSampler->second;
+    }
+
+    VkPhysicalDeviceProperties physicalDeviceProperties;
+    vkGetPhysicalDeviceProperties(context->GetPhysicalDevice(), &physicalDeviceProperties);
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = filter;
+    samplerInfo.minFilter = filter;
+    samplerInfo.addressModeU = addressMode;
+    samplerInfo.addressModeV = addressMode;
+    samplerInfo.addressModeW = addressMode;
+    samplerInfo.anisotropyEnable = enableAnisotropy ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = enableAnisotropy ? physicalDeviceProperties.limits.maxSamplerAnisotropy : 1.0f;
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.minLod = 0.0f;
+    // The image views limit the levels that are sampled
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    samplerInfo.mipLodBias = 0.0f;
+
+    VkSampler sampler;
+    ASSERT_VK_RESULT_SUCCESS(
+        vkCreateSampler(context->GetLogicalDevice(), &samplerInfo, nullptr, &sampler),
+        "Failed to create texture sampler");
+    samplers[key] = sampler;
+
+    Logger::Log(LogLevel::Debug, "Created sampler {} of {}", samplers.size(),
+        physicalDeviceProperties.limits.maxSamplerAllocationCount);
+    return sampler;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+
+// Samplers shared by every image with the same filtering, as devices only allow a limited number of them
+// They cover the whole mip chain, so images with any number of resident mip levels can use the same one
+class VulkanSamplerCache
+{
+public:
+    VulkanSamplerCache(VulkanContext *context);
+    ~VulkanSamplerCache();
+
+    void Destroy();
+
+    VkSampler GetSampler(VkFilter filter, VkSamplerAddressMode addressMode, bool enableAnisotropy);
+
+private:
+    VulkanContext *context;
+
+    // Images may be created from more than one thread
+    std::mutex samplerMutex;
+    std::map<std::tuple<VkFilter, VkSamplerAddressMode, bool>, VkSampler> samplers;
+};
@@ -1,5 +1,3 @@
-#include <assert.h>
-
 #include "Engine/Vulkan/VulkanCommon.h"
 #include "Engine/Vulkan/VulkanContext.h"
 #include "VulkanImage.h"
@@ -40,9 +38,26 @@ void VulkanTexture::Destroy()
     images.clear();
 }
 
+void VulkanTexture::FreeDescriptorSet()
+{
+    if (descriptorSet == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    vkFreeDescriptorSets(context->GetLogicalDevice(), descriptorPool, 1, &descriptorSet);
+    descriptorSet = VK_NULL_HANDLE;
+}
+
 void VulkanTexture::AddImage(std::shared_ptr<VulkanImage> image, uint32_t descriptorSetBinding)
 {
-    assert((descriptorSet != VK_NULL_HANDLE, "Descriptor set must be created before adding an image"));
+    images[descriptorSetBinding] = image;
+
+    // Textures drawn through the texture table only hold their images
+    if (descriptorSet == VK_NULL_HANDLE)
+    {
+        return;
+    }
 
     // Maps a Vulkan image buffer to a specific binding of a descriptor set
     VkDescriptorImageInfo imageInfo{};
@@ -60,8 +75,6 @@ void VulkanTexture::AddImage(std::shared_ptr<VulkanImage> image, uint32_t descri
     descriptorWrite.pImageInfo = &imageInfo;
 
     vkUpdateDescriptorSets(context->GetLogicalDevice(), 1, &descriptorWrite, 0, nullptr);
-
-    images[descriptorSetBinding] = image;
 }
 
 void VulkanTexture::BindDescriptorSet(VkCommandBuffer commandBuffer, uint32_t setNumber, VkPipelineLayout layout)
@@ -8,6 +8,8 @@
 class VulkanContext;
 class VulkanImage;
 
+// Images of a drawn object and the descriptor set they are bound with
+// The set is not allocated when Create is not called, for the textures in the texture table
 class VulkanTexture
 {
 public:
@@ -19,8 +21,11 @@ public:
 
     void Create();
     void Destroy();
+    // Returns the set to its pool, which must allow freeing sets, once no submitted frame reads it
+    void FreeDescriptorSet();
 
     std::vector<std::shared_ptr<VulkanImage>> GetImages() const;
+    std::shared_ptr<VulkanImage> GetImage(uint32_t descriptorSetBinding) const { return images.at(descriptorSetBinding); }
 
     void AddImage(std::shared_ptr<VulkanImage> image, uint32_t descriptorSetBinding);
     void BindDescriptorSet(VkCommandBuffer commandBuffer, uint32_t setNumber, VkPipelineLayout layout);
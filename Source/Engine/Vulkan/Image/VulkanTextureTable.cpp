@@ -0,0 +1,123 @@
+#include "Engine/Vulkan/VulkanCommon.h"
+#include "Engine/Vulkan/VulkanContext.h"
+#include "VulkanImage.h"
+#include "VulkanSamplerCache.h"
+#include "VulkanTextureTable.h"
+
+VulkanTextureTable::VulkanTextureTable(VulkanContext *context, VkDescriptorSetLayout descriptorSetLayout)
+    : context(context),
+      descriptorPool(VK_NULL_HANDLE),
+      descriptorSetLayout(descriptorSetLayout),
+      descriptorSet(VK_NULL_HANDLE),
+      nextTextureIndex(0)
+{
+}
+
+VulkanTextureTable::~VulkanTextureTable()
+{
+}
+
+void VulkanTextureTable::Create()
+{
+    // Sets with update after bind bindings need a pool of their own
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.poolSizeCount = BINDLESS_DESCRIPTOR_POOL_SIZE_COUNT;
+    poolInfo.pPoolSizes = BINDLESS_DESCRIPTOR_POOL_SIZES;
+    poolInfo.maxSets = 1;
+    ASSERT_VK_RESULT_SUCCESS(
+        vkCreateDescriptorPool(context->GetLogicalDevice(), &poolInfo, nullptr, &descriptorPool),
+        "Failed to create texture table descriptor pool");
+
+    VkDescriptorSetAllocateInfo descriptorSetAllocInfo{};
+    descriptorSetAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    descriptorSetAllocInfo.descriptorPool = descriptorPool;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+    descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
+    ASSERT_VK_RESULT_SUCCESS(
+        vkAllocateDescriptorSets(context->GetLogicalDevice(), &descriptorSetAllocInfo, &descriptorSet),
+        "Failed to allocate texture table descriptor set");
+
+    // Same sampler as the one each image would be bound with on its own
+    VkSampler sampler = context->GetSamplerCache()->GetSampler(VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT, true);
+    WriteDescriptor(2, 0, VK_DESCRIPTOR_TYPE_SAMPLER, VK_NULL_HANDLE, sampler);
+}
+
+void VulkanTextureTable::Destroy()
+{
+    // Destroying the descriptor pool frees the set
+    vkDestroyDescriptorPool(context->GetLogicalDevice(), descriptorPool, nullptr);
+    descriptorPool = VK_NULL_HANDLE;
+    descriptorSet = VK_NULL_HANDLE;
+
+    nextTextureIndex = 0;
+    freeTextureIndices.clear();
+}
+
+uint32_t VulkanTextureTable::AddImage(VulkanImage *image)
+{
+    uint32_t textureIndex;
+    if (!freeTextureIndices.empty())
+    {
+        textureIndex = freeTextureIndices.back();
+        freeTextureIndices.pop_back();
+    }
+    else if (nextTextureIndex < BINDLESS_TEXTURE_CAPACITY)
+    {
+        textureIndex = nextTextureIndex++;
+    }
+    else
+    {
+        throw std::runtime_error("Texture table is full");
+    }
+
+    ReplaceImage(textureIndex, image);
+    return textureIndex;
+}
+
+void VulkanTextureTable::ReplaceImage(uint32_t textureIndex, VulkanImage *image)
+{
+    WriteDescriptor(0, textureIndex, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, image->GetImageView(), VK_NULL_HANDLE);
+}
+
+void VulkanTextureTable::RemoveImage(uint32_t textureIndex)
+{
+    // The descriptor is left as is, partially bound arrays may hold invalid descriptors that are not used
+    freeTextureIndices.push_back(textureIndex);
+}
+
+void VulkanTextureTable::SetEnvironmentMap(VulkanImage *image)
+{
+    WriteDescriptor(1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, image->GetImageView(), image->GetSampler());
+}
+
+void VulkanTextureTable::BindDescriptorSet(VkCommandBuffer commandBuffer, uint32_t setNumber, VkPipelineLayout layout)
+{
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, setNumber, 1, &descriptorSet, 0, nullptr);
+}
+
+void VulkanTextureTable::WriteDescriptor(
+    uint32_t binding,
+    uint32_t arrayElement,
+    VkDescriptorType descriptorType,
+    VkImageView imageView,
+    VkSampler sampler)
+{
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.imageView = imageView;
+    imageInfo.sampler = sampler;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = descriptorSet;
+    descriptorWrite.dstBinding = binding;
+    descriptorWrite.dstArrayElement = arrayElement;
+    descriptorWrite.descriptorType = descriptorType;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(context->GetLogicalDevice(), 1, &descriptorWrite, 0, nullptr);
+}
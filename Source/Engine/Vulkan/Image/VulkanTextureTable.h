@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+class VulkanContext;
+class VulkanImage;
+
+// One descriptor set with every entity texture in an array of sampled images, bound once per command buffer
+// Draws select their texture with its index, and the descriptors are updated after bind
+// so that textures are added and replaced without recording the commands again
+class VulkanTextureTable
+{
+public:
+    VulkanTextureTable(VulkanContext *context, VkDescriptorSetLayout descriptorSetLayout);
+    ~VulkanTextureTable();
+
+    void Create();
+    void Destroy();
+
+    // Returns the index of the texture in the array
+    uint32_t AddImage(VulkanImage *image);
+    void ReplaceImage(uint32_t textureIndex, VulkanImage *image);
+    // The index is reused by the next texture, the image must no longer be in use by any submitted frame
+    void RemoveImage(uint32_t textureIndex);
+    void SetEnvironmentMap(VulkanImage *image);
+
+    void BindDescriptorSet(VkCommandBuffer commandBuffer, uint32_t setNumber, VkPipelineLayout layout);
+
+private:
+    void WriteDescriptor(
+        uint32_t binding,
+        uint32_t arrayElement,
+        VkDescriptorType descriptorType,
+        VkImageView imageView,
+        VkSampler sampler);
+
+    VulkanContext *context;
+
+    VkDescriptorPool descriptorPool;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkDescriptorSet descriptorSet;
+
+    uint32_t nextTextureIndex;
+    std::vector<uint32_t> freeTextureIndices;
+};
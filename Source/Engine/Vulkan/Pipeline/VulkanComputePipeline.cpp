@@ -0,0 +1,66 @@
+#include "Engine/Vulkan/VulkanCommon.h"
+#include "VulkanComputePipeline.h"
+
+VulkanComputePipeline::VulkanComputePipeline(VulkanContext *context)
+    : context(context),
+      pipeline(),
+      pipelineLayout(),
+      descriptorSetLayout()
+{
+}
+
+VulkanComputePipeline::~VulkanComputePipeline()
+{
+}
+
+void VulkanComputePipeline::Create(VulkanComputePipelineConfig config)
+{
+    VkDevice logicalDevice = context->GetLogicalDevice();
+
+    VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
+    descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    descriptorSetLayoutInfo.bindingCount = config.bindingCount;
+    descriptorSetLayoutInfo.pBindings = config.bindings;
+    ASSERT_VK_RESULT_SUCCESS(
+        vkCreateDescriptorSetLayout(logicalDevice, &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout),
+        "Failed to create compute descriptor set layout");
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = config.pushConstantSize;
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = config.pushConstantSize > 0 ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    ASSERT_VK_RESULT_SUCCESS(
+        vkCreatePipelineLayout(logicalDevice, &pipelineLayoutInfo, nullptr, &pipelineLayout),
+        "Failed to create compute pipeline layout");
+
+    VkPipelineShaderStageCreateInfo computeShaderStageInfo{};
+    computeShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computeShaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computeShaderStageInfo.module = config.computeShader->GetShaderModule();
+    computeShaderStageInfo.pName = SHADER_MAIN_FUNCTION_NAME;
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage = computeShaderStageInfo;
+    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    ASSERT_VK_RESULT_SUCCESS(
+        vkCreateComputePipelines(logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline),
+        "Failed to create compute pipeline");
+}
+
+void VulkanComputePipeline::Destroy()
+{
+    VkDevice logicalDevice = context->GetLogicalDevice();
+    vkDestroyDescriptorSetLayout(logicalDevice, descriptorSetLayout, nullptr);
+    vkDestroyPipeline(logicalDevice, pipeline, nullptr);
+    vkDestroyPipelineLayout(logicalDevice, pipelineLayout, nullptr);
+}
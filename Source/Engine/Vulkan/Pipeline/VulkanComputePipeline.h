@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include "Engine/Vulkan/VulkanContext.h"
+#include "Engine/Vulkan/VulkanShader.h"
+
+// Compute pipelines have one descriptor set and one push constant range
+struct VulkanComputePipelineConfig
+{
+    VulkanShader *computeShader;
+
+    uint32_t bindingCount;
+    const VkDescriptorSetLayoutBinding *bindings;
+    uint32_t pushConstantSize;
+};
+
+class VulkanComputePipeline
+{
+public:
+    VulkanComputePipeline(VulkanContext *context);
+    ~VulkanComputePipeline();
+
+    VkPipeline GetPipeline() const { return pipeline; }
+    VkPipelineLayout GetPipelineLayout() const { return pipelineLayout; }
+    VkDescriptorSetLayout GetDescriptorSetLayout() const { return descriptorSetLayout; }
+
+    void Create(VulkanComputePipelineConfig config);
+    void Destroy();
+
+private:
+    VulkanContext *context;
+
+    VkPipeline pipeline;
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorSetLayout descriptorSetLayout;
+};
@@ -145,6 +145,16 @@ void VulkanPipeline::CreateDescriptorLayouts(
         descriptorSetLayoutInfo.bindingCount = descriptorLayoutConfig.bindingCount;
         descriptorSetLayoutInfo.pBindings = descriptorLayoutConfig.bindings;
 
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+        if (descriptorLayoutConfig.bindingFlags)
+        {
+            bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+            bindingFlagsInfo.bindingCount = descriptorLayoutConfig.bindingCount;
+            bindingFlagsInfo.pBindingFlags = descriptorLayoutConfig.bindingFlags;
+            descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+            descriptorSetLayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+        }
+
         VkDescriptorSetLayout targetLayout;
         ASSERT_VK_RESULT_SUCCESS(
             vkCreateDescriptorSetLayout(context->GetLogicalDevice(), &descriptorSetLayoutInfo, nullptr, &targetLayout),
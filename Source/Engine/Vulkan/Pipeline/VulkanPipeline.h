@@ -20,6 +20,8 @@ struct VulkanDescriptorLayoutConfig
     VulkanDescriptorLayoutType type;
     uint32_t bindingCount;
     const VkDescriptorSetLayoutBinding *bindings;
+    // Optional, one per binding, the layout is then allocated from an update after bind pool
+    const VkDescriptorBindingFlagsEXT *bindingFlags;
 };
 
 struct VulkanPushConstantLayoutConfig
@@ -2,12 +2,19 @@
 #include "Engine/Vulkan/VulkanContext.h"
 #include "Engine/Vulkan/VulkanRenderPass.h"
 #include "Engine/Vulkan/VulkanShader.h"
+#include "VulkanComputePipeline.h"
 #include "VulkanPipeline.h"
 #include "VulkanPipelineManager.h"
 
-VulkanPipelineManager::VulkanPipelineManager(VulkanContext *context, VulkanRenderPass *renderPass)
+VulkanPipelineManager::VulkanPipelineManager(
+    VulkanContext *context,
+    VulkanRenderPass *renderPass,
+    bool usePackedVertices,
+    bool useGpuCulling)
     : context(context),
-      renderPass(renderPass)
+      renderPass(renderPass),
+      usePackedVertices(usePackedVertices),
+      useGpuCulling(useGpuCulling)
 {
 }
 
@@ -17,10 +24,21 @@ VulkanPipelineManager::~VulkanPipelineManager()
 
 void VulkanPipelineManager::Create()
 {
+    bool useBindlessTextures = context->SupportsBindlessTextures();
+
     VulkanShader staticVertexShader(context, VulkanShaderType::Vertex);
     VulkanShader staticFragmentShader(context, VulkanShaderType::Fragment);
-    if (!staticVertexShader.Compile(STATIC_PIPELINE_VERTEX_SHADER)
-        || !staticFragmentShader.Compile(STATIC_PIPELINE_FRAGMENT_SHADER))
+    const char *staticVertexShaderPath = usePackedVertices
+        ? STATIC_PACKED_PIPELINE_VERTEX_SHADER
+        : STATIC_PIPELINE_VERTEX_SHADER;
+    std::map<std::string, std::string> staticFragmentShaderMacros;
+    if (useBindlessTextures)
+    {
+        staticFragmentShaderMacros["BINDLESS_TEXTURES"] = "1";
+        staticFragmentShaderMacros["BINDLESS_TEXTURE_CAPACITY"] = std::to_string(BINDLESS_TEXTURE_CAPACITY);
+    }
+    if (!staticVertexShader.Compile(staticVertexShaderPath)
+        || !staticFragmentShader.Compile(STATIC_PIPELINE_FRAGMENT_SHADER, staticFragmentShaderMacros))
     {
         throw std::runtime_error("Failed to compile static scene shader code");
     }
@@ -82,8 +100,17 @@ void VulkanPipelineManager::Create()
     staticPipelineConfig.descriptorLayoutConfigs[0].bindingCount = STATIC_PIPELINE_UNIFORM_DESCRIPTOR_LAYOUT_BINDING_COUNT;
     staticPipelineConfig.descriptorLayoutConfigs[0].bindings = STATIC_PIPELINE_UNIFORM_DESCRIPTOR_LAYOUT_BINDINGS;
     staticPipelineConfig.descriptorLayoutConfigs[1].type = VulkanDescriptorLayoutType::Image;
-    staticPipelineConfig.descriptorLayoutConfigs[1].bindingCount = STATIC_PIPELINE_IMAGE_DESCRIPTOR_LAYOUT_BINDING_COUNT;
-    staticPipelineConfig.descriptorLayoutConfigs[1].bindings = STATIC_PIPELINE_IMAGE_DESCRIPTOR_LAYOUT_BINDINGS;
+    if (useBindlessTextures)
+    {
+        staticPipelineConfig.descriptorLayoutConfigs[1].bindingCount = BINDLESS_IMAGE_DESCRIPTOR_LAYOUT_BINDING_COUNT;
+        staticPipelineConfig.descriptorLayoutConfigs[1].bindings = BINDLESS_IMAGE_DESCRIPTOR_LAYOUT_BINDINGS;
+        staticPipelineConfig.descriptorLayoutConfigs[1].bindingFlags = BINDLESS_IMAGE_DESCRIPTOR_BINDING_FLAGS;
+    }
+    else
+    {
+        staticPipelineConfig.descriptorLayoutConfigs[1].bindingCount = STATIC_PIPELINE_IMAGE_DESCRIPTOR_LAYOUT_BINDING_COUNT;
+        staticPipelineConfig.descriptorLayoutConfigs[1].bindings = STATIC_PIPELINE_IMAGE_DESCRIPTOR_LAYOUT_BINDINGS;
+    }
     staticPipelineConfig.descriptorLayoutConfigs[2].type = VulkanDescriptorLayoutType::Instance;
     staticPipelineConfig.descriptorLayoutConfigs[2].bindingCount = STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDING_COUNT;
     staticPipelineConfig.descriptorLayoutConfigs[2].bindings = STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDINGS;
@@ -92,9 +119,18 @@ void VulkanPipelineManager::Create()
     staticPipelineConfig.pushConstantConfigs[0].size = sizeof(VulkanMeshPushConstant);
     staticPipelineConfig.pushConstantConfigs[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
 
-    staticPipelineConfig.vertexLayoutConfig.vertexSize = sizeof(Vertex);
-    staticPipelineConfig.vertexLayoutConfig.descriptionCount = VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_COUNT;
-    staticPipelineConfig.vertexLayoutConfig.descriptions = VERTEX_INPUT_ATTRIBUTE_DESCRIPTIONS;
+    if (usePackedVertices)
+    {
+        staticPipelineConfig.vertexLayoutConfig.vertexSize = sizeof(PackedVertex);
+        staticPipelineConfig.vertexLayoutConfig.descriptionCount = PACKED_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_COUNT;
+        staticPipelineConfig.vertexLayoutConfig.descriptions = PACKED_VERTEX_INPUT_ATTRIBUTE_DESCRIPTIONS;
+    }
+    else
+    {
+        staticPipelineConfig.vertexLayoutConfig.vertexSize = sizeof(Vertex);
+        staticPipelineConfig.vertexLayoutConfig.descriptionCount = VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_COUNT;
+        staticPipelineConfig.vertexLayoutConfig.descriptions = VERTEX_INPUT_ATTRIBUTE_DESCRIPTIONS;
+    }
 
     staticPipeline = std::make_unique<VulkanPipeline>(context, renderPass);
     staticPipeline->Create(staticPipelineConfig);
@@ -210,6 +246,41 @@ void VulkanPipelineManager::Create()
     terrainFragmentShader.Unload();
     screenVertexShader.Unload();
     screenFragmentShader.Unload();
+
+    if (useGpuCulling)
+    {
+        CreateCullingPipelines();
+    }
+}
+
+void VulkanPipelineManager::CreateCullingPipelines()
+{
+    VulkanShader cullInstancesShader(context, VulkanShaderType::Compute);
+    VulkanShader compactDrawsShader(context, VulkanShaderType::Compute);
+    if (!cullInstancesShader.Compile(CULL_INSTANCES_COMPUTE_SHADER)
+        || !compactDrawsShader.Compile(COMPACT_DRAWS_COMPUTE_SHADER))
+    {
+        throw std::runtime_error("Failed to compile culling shader code");
+    }
+    cullInstancesShader.Load();
+    compactDrawsShader.Load();
+
+    // Both pipelines use the same descriptor set, each shader only declares the bindings it reads
+    VulkanComputePipelineConfig cullingPipelineConfig{};
+    cullingPipelineConfig.bindingCount = CULLING_DESCRIPTOR_LAYOUT_BINDING_COUNT;
+    cullingPipelineConfig.bindings = CULLING_DESCRIPTOR_LAYOUT_BINDINGS;
+    cullingPipelineConfig.pushConstantSize = sizeof(VulkanCullingPushConstant);
+
+    cullingPipelineConfig.computeShader = &cullInstancesShader;
+    cullInstancesPipeline = std::make_unique<VulkanComputePipeline>(context);
+    cullInstancesPipeline->Create(cullingPipelineConfig);
+
+    cullingPipelineConfig.computeShader = &compactDrawsShader;
+    compactDrawsPipeline = std::make_unique<VulkanComputePipeline>(context);
+    compactDrawsPipeline->Create(cullingPipelineConfig);
+
+    cullInstancesShader.Unload();
+    compactDrawsShader.Unload();
 }
 
 void VulkanPipelineManager::Destroy()
@@ -219,6 +290,11 @@ void VulkanPipelineManager::Destroy()
     linePipeline->Destroy();
     terrainPipeline->Destroy();
     screenPipeline->Destroy();
+    if (cullInstancesPipeline)
+    {
+        cullInstancesPipeline->Destroy();
+        compactDrawsPipeline->Destroy();
+    }
 }
 
 VulkanDrawingPipelines VulkanPipelineManager::GetDrawingPipelines() const
@@ -229,5 +305,7 @@ VulkanDrawingPipelines VulkanPipelineManager::GetDrawingPipelines() const
     drawingPipelines.linePipeline = linePipeline.get();
     drawingPipelines.terrainPipeline = terrainPipeline.get();
     drawingPipelines.screenPipeline = screenPipeline.get();
+    drawingPipelines.cullInstancesPipeline = cullInstancesPipeline.get();
+    drawingPipelines.compactDrawsPipeline = compactDrawsPipeline.get();
     return drawingPipelines;
 }
@@ -2,6 +2,7 @@
 
 #include <memory>
 
+class VulkanComputePipeline;
 class VulkanContext;
 class VulkanPipeline;
 class VulkanRenderPass;
@@ -9,7 +10,11 @@ class VulkanRenderPass;
 class VulkanPipelineManager
 {
 public:
-    VulkanPipelineManager(VulkanContext *context, VulkanRenderPass *renderPass);
+    VulkanPipelineManager(
+        VulkanContext *context,
+        VulkanRenderPass *renderPass,
+        bool usePackedVertices,
+        bool useGpuCulling);
     ~VulkanPipelineManager();
 
     void Create();
@@ -18,12 +23,21 @@ public:
     VulkanDrawingPipelines GetDrawingPipelines() const;
 
 private:
+    void CreateCullingPipelines();
+
     VulkanContext *context;
     VulkanRenderPass *renderPass;
 
+    // Static pipeline reads PackedVertex instead of Vertex
+    bool usePackedVertices;
+    // The culling compute pipelines are only created when the entities are culled on the GPU
+    bool useGpuCulling;
+
     std::unique_ptr<VulkanPipeline> staticPipeline;
     std::unique_ptr<VulkanPipeline> cubeMapPipeline;
     std::unique_ptr<VulkanPipeline> linePipeline;
     std::unique_ptr<VulkanPipeline> terrainPipeline;
     std::unique_ptr<VulkanPipeline> screenPipeline;
+    std::unique_ptr<VulkanComputePipeline> cullInstancesPipeline;
+    std::unique_ptr<VulkanComputePipeline> compactDrawsPipeline;
 };
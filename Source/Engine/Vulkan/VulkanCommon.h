@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <stdexcept>
 
 #include <vulkan/vulkan.h>
@@ -18,6 +19,7 @@ static constexpr char *SHADER_MAIN_FUNCTION_NAME = "main";
 
 static constexpr char *STATIC_PIPELINE_VERTEX_SHADER = "shaders/static_vertex_shader.glsl";
 static constexpr char *STATIC_PIPELINE_FRAGMENT_SHADER = "shaders/static_fragment_shader.glsl";
+static constexpr char *STATIC_PACKED_PIPELINE_VERTEX_SHADER = "shaders/static_packed_vertex_shader.glsl";
 static constexpr char *CUBEMAP_PIPELINE_VERTEX_SHADER = "shaders/cubemap_vertex_shader.glsl";
 static constexpr char *CUBEMAP_PIPELINE_FRAGMENT_SHADER = "shaders/cubemap_fragment_shader.glsl";
 static constexpr char *LINE_PIPELINE_VERTEX_SHADER = "shaders/line_vertex_shader.glsl";
@@ -26,18 +28,25 @@ static constexpr char *TERRAIN_PIPELINE_VERTEX_SHADER = "shaders/terrain_vertex_
 static constexpr char *TERRAIN_PIPELINE_FRAGMENT_SHADER = "shaders/terrain_fragment_shader.glsl";
 static constexpr char *SCREEN_PIPELINE_VERTEX_SHADER = "shaders/screen_vertex_shader.glsl";
 static constexpr char *SCREEN_PIPELINE_FRAGMENT_SHADER = "shaders/screen_fragment_shader.glsl";
+static constexpr char *CULL_INSTANCES_COMPUTE_SHADER = "shaders/cull_instances_compute_shader.glsl";
+static constexpr char *COMPACT_DRAWS_COMPUTE_SHADER = "shaders/compact_draws_compute_shader.glsl";
 
-static constexpr int STATIC_PIPELINE_DESCRIPTOR_POOL_SIZE_COUNT = 2;
+static constexpr int STATIC_PIPELINE_DESCRIPTOR_POOL_SIZE_COUNT = 3;
 static constexpr VkDescriptorPoolSize STATIC_PIPELINE_DESCRIPTOR_POOL_SIZES[] =
 {
     {
         VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,          // type
-        3 + 8192 * 3                                // maximum count
+        24                                          // maximum count, uniform, screen and culling buffers
+                                                    // for each frame buffer
     },
     {
         VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
         8192 * 3                                    // reserved for diffuse, normal
                                                     // and specular for each frame buffer
+    },
+    {
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        64                                          // instance and culling buffers for each frame buffer
     }
 };
 
@@ -74,19 +83,141 @@ static constexpr VkDescriptorSetLayoutBinding STATIC_PIPELINE_IMAGE_DESCRIPTOR_L
     }
 };
 
-static constexpr int STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDING_COUNT = 1;
+// Entity textures drawn from one array when the device supports descriptor indexing
+static constexpr uint32_t BINDLESS_TEXTURE_CAPACITY = 16384;
+
+static constexpr int BINDLESS_DESCRIPTOR_POOL_SIZE_COUNT = 3;
+static constexpr VkDescriptorPoolSize BINDLESS_DESCRIPTOR_POOL_SIZES[] =
+{
+    {
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        BINDLESS_TEXTURE_CAPACITY
+    },
+    {
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        1
+    },
+    {
+        VK_DESCRIPTOR_TYPE_SAMPLER,
+        1
+    }
+};
+
+static constexpr int BINDLESS_IMAGE_DESCRIPTOR_LAYOUT_BINDING_COUNT = 3;
+static constexpr VkDescriptorSetLayoutBinding BINDLESS_IMAGE_DESCRIPTOR_LAYOUT_BINDINGS[] =
+{
+    // Diffuse textures, indexed per draw
+    {
+        0,
+        VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE,
+        BINDLESS_TEXTURE_CAPACITY,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        nullptr
+    },
+    // Environment map
+    {
+        1,
+        VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        1,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        nullptr
+    },
+    // Sampler shared by the diffuse textures
+    {
+        2,
+        VK_DESCRIPTOR_TYPE_SAMPLER,
+        1,
+        VK_SHADER_STAGE_FRAGMENT_BIT,
+        nullptr
+    }
+};
+
+// Textures are added and replaced while recorded command buffers still use the set,
+// and the slots that are not in use are left empty
+static constexpr VkDescriptorBindingFlagsEXT BINDLESS_IMAGE_DESCRIPTOR_BINDING_FLAGS[] =
+{
+    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+        | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT
+        | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT,
+    VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+        | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT,
+    0
+};
+
+static constexpr int STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDING_COUNT = 2;
 static constexpr VkDescriptorSetLayoutBinding STATIC_PIPELINE_INSTANCE_DESCRIPTOR_LAYOUT_BINDINGS[] =
 {
-    // Instance buffer for each object
+    // Instance inputs of every object
     {
         0,
-        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        1,
+        VK_SHADER_STAGE_VERTEX_BIT,
+        nullptr
+    },
+    // Index of the instance input of each visible instance, indexed by the instance index of the draw
+    {
+        1,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
         1,
         VK_SHADER_STAGE_VERTEX_BIT,
         nullptr
     }
 };
 
+static constexpr int CULLING_DESCRIPTOR_LAYOUT_BINDING_COUNT = 6;
+static constexpr VkDescriptorSetLayoutBinding CULLING_DESCRIPTOR_LAYOUT_BINDINGS[] =
+{
+    // Frustum planes
+    {
+        0,
+        VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        1,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        nullptr
+    },
+    // Instance inputs
+    {
+        1,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        1,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        nullptr
+    },
+    // Draw commands, counting the visible instances of each draw
+    {
+        2,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        1,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        nullptr
+    },
+    // Visible instances
+    {
+        3,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        1,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        nullptr
+    },
+    // Draw commands with visible instances, packed per batch
+    {
+        4,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        1,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        nullptr
+    },
+    // Draw count of each batch
+    {
+        5,
+        VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        1,
+        VK_SHADER_STAGE_COMPUTE_BIT,
+        nullptr
+    }
+};
+
 static constexpr int VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_COUNT = 3;
 static constexpr VkVertexInputAttributeDescription VERTEX_INPUT_ATTRIBUTE_DESCRIPTIONS[] =
 {
@@ -110,6 +241,29 @@ static constexpr VkVertexInputAttributeDescription VERTEX_INPUT_ATTRIBUTE_DESCRI
     }
 };
 
+static constexpr int PACKED_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_COUNT = 3;
+static constexpr VkVertexInputAttributeDescription PACKED_VERTEX_INPUT_ATTRIBUTE_DESCRIPTIONS[] =
+{
+    {
+        0,                                          // location
+        0,                                          // binding
+        VK_FORMAT_R16G16B16A16_UNORM,               // format
+        offsetof(PackedVertex, position)            // offset
+    },
+    {
+        1,
+        0,
+        VK_FORMAT_R16G16_SNORM,
+        offsetof(PackedVertex, normal)
+    },
+    {
+        2,
+        0,
+        VK_FORMAT_R16G16_UNORM,
+        offsetof(PackedVertex, uv)
+    }
+};
+
 static constexpr int LINE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_COUNT = 2;
 static constexpr VkVertexInputAttributeDescription LINE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTIONS[] =
 {
@@ -157,16 +311,38 @@ static constexpr VkFormat DEPTH_IMAGE_FORMATS[] =
     VK_FORMAT_D24_UNORM_S8_UINT
 };
 
+// Formats of the DDS textures, the DDS files are only used when the device can sample all of them
+static constexpr VkFormat BLOCK_COMPRESSED_IMAGE_FORMATS[] =
+{
+    VK_FORMAT_BC1_RGBA_SRGB_BLOCK,
+    VK_FORMAT_BC3_SRGB_BLOCK,
+    VK_FORMAT_BC5_UNORM_BLOCK,
+    VK_FORMAT_BC7_SRGB_BLOCK
+};
+
 class VulkanBuffer;
+class VulkanComputePipeline;
+class VulkanGpuCulling;
 class VulkanImage;
 class VulkanTexture;
+class VulkanTextureTable;
 class VulkanPipeline;
 
 // Drawing Buffers
+// Index buffers are either 16-bit or 32-bit depending on the vertex count of the mesh
+// Entity index buffers hold every level of detail back to back, starting at firstIndex
+struct VulkanIndexBufferInfo
+{
+    VkIndexType indexType;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
 struct VulkanCubeMapBuffer
 {
     VulkanBuffer *vertexBuffer;
     VulkanBuffer *indexBuffer;
+    VulkanIndexBufferInfo indexInfo;
     VulkanTexture *textureBuffer;
 };
 
@@ -179,7 +355,10 @@ struct VulkanTerrainBuffer
 {
     VulkanBuffer *vertexBuffer;
     VulkanBuffer *indexBuffer;
+    VulkanIndexBufferInfo indexInfo;
     VulkanTexture *textureBuffer;
+    // Left out of the recorded draws when outside of the view frustum
+    bool visible;
 };
 
 struct VulkanScreenObjectBuffer
@@ -190,20 +369,74 @@ struct VulkanScreenObjectBuffer
 
 struct VulkanEntityBuffer
 {
-    std::vector<VulkanBuffer *> instanceBuffers;
+    // Index of the entity in the instance inputs
+    uint32_t instanceIndex;
     VulkanBuffer *vertexBuffer;
     VulkanBuffer *indexBuffer;
+    // Ranges of the pooled vertex and index buffers the mesh is suballocated from, the first index of the range
+    // is part of the index info
+    VulkanIndexBufferInfo indexInfo;
+    int32_t vertexOffset;
     VulkanTexture *textureBuffer;
+    // Sort key fields of the render queue, the slots of the pooled buffers and the dense index of the material
+    // the texture is bound with
+    uint32_t vertexBufferIndex;
+    uint32_t indexBufferIndex;
+    uint32_t materialIndex;
+    // Left out of the recorded draws when culled on the CPU, or hidden behind the occluders
+    bool visible;
+};
+
+// Entities with the same mesh range and texture are drawn as instances of one draw
+struct VulkanEntityDraw
+{
+    VulkanBuffer *vertexBuffer;
+    VulkanBuffer *indexBuffer;
+    VulkanIndexBufferInfo indexInfo;
+    int32_t vertexOffset;
+    VulkanTexture *textureBuffer;
+    // Range of the instance buffer of the frame holding the inputs of the instances
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+};
+
+// Consecutive draws sharing the vertex and index buffers, and the texture when it is bound per draw,
+// which are issued by one indirect draw when culled on the GPU
+struct VulkanEntityDrawBatch
+{
+    uint32_t firstDraw;
+    uint32_t drawCount;
 };
 
 struct VulkanEntityBufferIds
 {
     uint32_t instanceBufferId;
+    // Ids the mesh and texture were loaded with, the buffers may be shared with other ids of the same content
+    uint32_t meshId;
+    uint32_t textureId;
     uint32_t vertexBufferId;
     uint32_t indexBufferId;
     uint32_t textureBufferId;
 };
 
+// Texture streaming
+// When the memory budget is exceeded, the textures with the lowest priority give up their finest mip levels first
+enum class VulkanResourcePriority
+{
+    // Entities drawn with a coarser level of detail
+    LodProxy,
+    FarProp,
+    NearProp,
+    // Entities moved by the game, i.e. the vehicles
+    Vehicle
+};
+
+struct VulkanTextureRequest
+{
+    uint32_t mipLevel;
+    VulkanResourcePriority priority;
+};
+
 struct VulkanDrawingPipelines
 {
     VulkanPipeline *staticPipeline;
@@ -211,23 +444,74 @@ struct VulkanDrawingPipelines
     VulkanPipeline *terrainPipeline;
     VulkanPipeline *linePipeline;
     VulkanPipeline *screenPipeline;
+    // Null when the entities are culled on the CPU
+    VulkanComputePipeline *cullInstancesPipeline;
+    VulkanComputePipeline *compactDrawsPipeline;
+};
+
+// Each layer is recorded into secondary command buffers of its own, which are only recorded again when the data
+// drawn by the layer changes, and the layers are executed in this order
+enum class VulkanRenderLayer
+{
+    Static,
+    CubeMap,
+    Terrain,
+    // Screen objects must appear on top of everthing else
+    Screen,
+    Line
 };
+static constexpr uint32_t RENDER_LAYER_COUNT = 5;
+// Indexed by VulkanRenderLayer
+using VulkanRenderLayerUpdates = std::array<bool, RENDER_LAYER_COUNT>;
 
 struct VulkanDrawingBuffer
 {
     VulkanBuffer *uniformBuffer;
     VulkanBuffer *screenBuffer;
+    // Instance inputs of the drawn entities and the indices of the visible ones, written once per frame
+    VkDescriptorSet instanceDescriptorSet;
     VulkanLineBuffer lineBuffer;
     VulkanCubeMapBuffer cubeMapBuffer;
     std::vector<VulkanTerrainBuffer> terrainBuffers;
-    std::vector<VulkanEntityBuffer> entityBuffers;
+    std::vector<VulkanEntityDraw> entityDraws;
+    std::vector<VulkanEntityDrawBatch> entityDrawBatches;
+    // Null when the entities are culled on the CPU, the draws then only hold the visible entities
+    VulkanGpuCulling *gpuCulling;
     std::vector<VulkanScreenObjectBuffer> screenObjectBuffers;
+    // Null when the entity textures are bound per draw
+    VulkanTextureTable *textureTable;
 };
 
 // Buffer input
+// One element of the instance array read by the static vertex shaders and the culling compute shader,
+// matches their std430 layout
 struct VulkanInstanceBufferInput
 {
     glm::mat4 transformation;
+    // Only read by the packed vertex layout, written once when the entity is loaded
+    PackedVertexDecode vertexDecode;
+    // Center in xyz and radius in w, in model space
+    glm::vec4 boundingSphere;
+    // Only used with the texture table
+    uint32_t textureIndex;
+    // Draw the instance belongs to in the frame, written with the instance buffer of the frame
+    uint32_t drawIndex;
+    uint32_t padding[2];
+};
+
+// Written by the CPU with the draws of the frame, the GPU culling counts the visible instances and compacts them
+struct VulkanDrawIndirectCommand
+{
+    VkDrawIndexedIndirectCommand command;
+    uint32_t batchIndex;
+    // First draw of the batch in the compacted draw commands
+    uint32_t batchFirstDraw;
+    uint32_t padding;
+};
+
+struct VulkanCullingBufferInput
+{
+    glm::vec4 frustumPlanes[6];
 };
 
 struct VulkanScreenBufferInput
@@ -252,6 +536,12 @@ struct VulkanMeshPushConstant
     alignas(16) glm::vec3 fogColor; // To match the GLSL alignment requirement
 };
 
+struct VulkanCullingPushConstant
+{
+    uint32_t instanceCount;
+    uint32_t drawCount;
+};
+
 struct VulkanPushConstants
 {
     VulkanMeshPushConstant meshPushConstant;
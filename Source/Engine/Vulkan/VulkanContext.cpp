@@ -1,6 +1,8 @@
 #include "Common/Logger.h"
 #include "VulkanCommon.h"
 #include "VulkanContext.h"
+#include "VulkanDeletionQueue.h"
+#include "Image/VulkanSamplerCache.h"
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
@@ -11,6 +13,13 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
 VulkanContext::VulkanContext(Screen *screen, const bool &enableDebugging)
     : instance(),
     debugMessenger(),
+    physicalDeviceProperties2Enabled(false),
+    bindlessTexturesSupported(false),
+    memoryBudgetSupported(false),
+    gpuCullingSupported(false),
+    drawIndirectCountSupported(false),
+    blockCompressedTexturesSupported(false),
+    drawIndexedIndirectCount(nullptr),
     surface(),
     logicalDevice(),
     physicalDevice(),
@@ -18,6 +27,8 @@ VulkanContext::VulkanContext(Screen *screen, const bool &enableDebugging)
     graphicsQueue(),
     presentQueueIndex(),
     presentQueue(),
+    transferQueueIndex(),
+    transferQueue(),
     oldSwapChain(),
     msaaSamples(VK_SAMPLE_COUNT_1_BIT),
     swapChain(),
@@ -32,6 +43,7 @@ VulkanContext::VulkanContext(Screen *screen, const bool &enableDebugging)
     depthImageView(),
     depthImageFormat(),
     depthImageMemory(),
+    waitIdleCount(0),
     screen(screen),
     enableDebugging(enableDebugging)
 {
@@ -52,8 +64,15 @@ void VulkanContext::Create()
     }
 
     FindPhysicalDevice();
+    FindDescriptorIndexingSupport();
+    FindMemoryBudgetSupport();
+    FindIndirectDrawSupport();
+    FindBlockCompressionSupport();
     CreateLogicalDevice();
+    samplerCache = std::make_unique<VulkanSamplerCache>(this);
+    deletionQueue = std::make_unique<VulkanDeletionQueue>();
     FindGraphicsAndPresentQueues();
+    FindTransferQueue();
     CreateSwapChain();
     CreateSwapChainImageViews();
     FindDepthImageFormat();
@@ -61,8 +80,10 @@ void VulkanContext::Create()
 
 void VulkanContext::Destroy()
 {
+    deletionQueue->ReleaseAll();
     DestroySwapChainImageViews();
     DestroySwapChain();
+    samplerCache->Destroy();
     
     vkDestroyDevice(logicalDevice, nullptr);
     vkDestroySurfaceKHR(instance, surface, nullptr);
@@ -89,6 +110,8 @@ void VulkanContext::RecreateSwapChain()
 void VulkanContext::WaitIdle()
 {
     vkDeviceWaitIdle(logicalDevice);
+    waitIdleCount++;
+    deletionQueue->ReleaseAll();
 }
 
 void VulkanContext::CreateImageForFrameBuffer(
@@ -207,6 +230,20 @@ void VulkanContext::CreateInstance()
     std::vector<const char *> sfmlExtensions = sf::Vulkan::getGraphicsRequiredInstanceExtensions();
     std::vector<const char *> extensions(sfmlExtensions);
 
+    uint32_t availableExtensionCount;
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableExtensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(availableExtensionCount);
+    vkEnumerateInstanceExtensionProperties(nullptr, &availableExtensionCount, availableExtensions.data());
+    for (const VkExtensionProperties &extension : availableExtensions)
+    {
+        if (strcmp(extension.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0)
+        {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+            physicalDeviceProperties2Enabled = true;
+            break;
+        }
+    }
+
     const char *enabledLayerNames[] = { VULKAN_VALIDATION_LAYER };
     if (enableDebugging)
     {
@@ -234,26 +271,69 @@ void VulkanContext::CreateLogicalDevice()
     TryFindQueueFamilyIndices(graphicsQueueFamilyIndex, presentQueueFamilyIndex);
 
     float queuePriority = 1.0f;
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     VkDeviceQueueCreateInfo queueCreateInfo{};
     queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
     queueCreateInfo.queueFamilyIndex = graphicsQueueFamilyIndex;
     queueCreateInfo.queueCount = 1;
     queueCreateInfo.pQueuePriorities = &queuePriority;
+    queueCreateInfos.push_back(queueCreateInfo);
+
+    uint32_t transferQueueFamilyIndex;
+    if (TryFindTransferQueueFamilyIndex(transferQueueFamilyIndex))
+    {
+        queueCreateInfo.queueFamilyIndex = transferQueueFamilyIndex;
+        queueCreateInfos.push_back(queueCreateInfo);
+    }
+
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
 
     VkPhysicalDeviceFeatures physicalDeviceFeatures{};
     physicalDeviceFeatures.samplerAnisotropy = VK_TRUE;
     physicalDeviceFeatures.fillModeNonSolid = VK_TRUE;
     physicalDeviceFeatures.wideLines = VK_TRUE;
+    // Needed by precompressed textures, which are checked again when loaded
+    physicalDeviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
 
     VkDeviceCreateInfo logicalDeviceCreateInfo{};
     logicalDeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    logicalDeviceCreateInfo.pQueueCreateInfos = &queueCreateInfo;
-    logicalDeviceCreateInfo.queueCreateInfoCount = 1;
+    logicalDeviceCreateInfo.pQueueCreateInfos = queueCreateInfos.data();
+    logicalDeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     logicalDeviceCreateInfo.pEnabledFeatures = &physicalDeviceFeatures;
 
-    char *enabledExtensionNames[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
-    logicalDeviceCreateInfo.enabledExtensionCount = 1;
-    logicalDeviceCreateInfo.ppEnabledExtensionNames = enabledExtensionNames;
+    std::vector<const char *> enabledExtensionNames = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (bindlessTexturesSupported)
+    {
+        // The texture array is indexed with the texture index of the instance, which is the same within a draw
+        physicalDeviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+        descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        logicalDeviceCreateInfo.pNext = &descriptorIndexingFeatures;
+
+        enabledExtensionNames.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME);
+        enabledExtensionNames.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
+    if (memoryBudgetSupported)
+    {
+        enabledExtensionNames.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+    if (gpuCullingSupported)
+    {
+        // Each instance range of the culled draws starts at the first instance of its draw
+        physicalDeviceFeatures.multiDrawIndirect = VK_TRUE;
+        physicalDeviceFeatures.drawIndirectFirstInstance = VK_TRUE;
+    }
+    if (drawIndirectCountSupported)
+    {
+        enabledExtensionNames.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+    logicalDeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensionNames.size());
+    logicalDeviceCreateInfo.ppEnabledExtensionNames = enabledExtensionNames.data();
 
     const char *enabledLayerNames[] = { VULKAN_VALIDATION_LAYER };
     if (enableDebugging)
@@ -269,6 +349,12 @@ void VulkanContext::CreateLogicalDevice()
     ASSERT_VK_RESULT_SUCCESS(
         vkCreateDevice(physicalDevice, &logicalDeviceCreateInfo, nullptr, &logicalDevice),
         "Failed to create logical device");
+
+    if (drawIndirectCountSupported)
+    {
+        drawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)
+            vkGetDeviceProcAddr(logicalDevice, "vkCmdDrawIndexedIndirectCountKHR");
+    }
 }
 
 void VulkanContext::CreateSwapChain()
@@ -431,6 +517,169 @@ void VulkanContext::FindDepthImageFormat()
     throw std::runtime_error("Failed to find suitable depth image format");
 }
 
+void VulkanContext::FindDescriptorIndexingSupport()
+{
+    bindlessTexturesSupported = false;
+    if (!physicalDeviceProperties2Enabled)
+    {
+        Logger::Log(LogLevel::Info, "Descriptor indexing is not available, textures are bound per draw");
+        return;
+    }
+
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    bool descriptorIndexingFound = false, maintenance3Found = false;
+    for (const VkExtensionProperties &extension : availableExtensions)
+    {
+        descriptorIndexingFound = descriptorIndexingFound
+            || strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+        maintenance3Found = maintenance3Found
+            || strcmp(extension.extensionName, VK_KHR_MAINTENANCE3_EXTENSION_NAME) == 0;
+    }
+    if (!descriptorIndexingFound || !maintenance3Found)
+    {
+        Logger::Log(LogLevel::Info, "Descriptor indexing is not available, textures are bound per draw");
+        return;
+    }
+
+    PFN_vkGetPhysicalDeviceFeatures2KHR getFeaturesFunc = (PFN_vkGetPhysicalDeviceFeatures2KHR)
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceFeatures2KHR");
+    PFN_vkGetPhysicalDeviceProperties2KHR getPropertiesFunc = (PFN_vkGetPhysicalDeviceProperties2KHR)
+        vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceProperties2KHR");
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexingFeatures{};
+    descriptorIndexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2KHR features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2_KHR;
+    features.pNext = &descriptorIndexingFeatures;
+    getFeaturesFunc(physicalDevice, &features);
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT descriptorIndexingProperties{};
+    descriptorIndexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2KHR properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2_KHR;
+    properties.pNext = &descriptorIndexingProperties;
+    getPropertiesFunc(physicalDevice, &properties);
+
+    // The array also shares the stage with the environment map and the sampler
+    bindlessTexturesSupported = features.features.shaderSampledImageArrayDynamicIndexing
+        && descriptorIndexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+        && descriptorIndexingFeatures.descriptorBindingPartiallyBound
+        && descriptorIndexingFeatures.descriptorBindingUpdateUnusedWhilePending
+        && descriptorIndexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages >= BINDLESS_TEXTURE_CAPACITY + 1
+        && descriptorIndexingProperties.maxDescriptorSetUpdateAfterBindSampledImages >= BINDLESS_TEXTURE_CAPACITY + 1
+        && descriptorIndexingProperties.maxPerStageUpdateAfterBindResources >= BINDLESS_TEXTURE_CAPACITY + 2;
+
+    Logger::Log(
+        LogLevel::Info,
+        bindlessTexturesSupported
+            ? "Using descriptor indexing for up to {} textures"
+            : "Descriptor indexing does not support {} textures, textures are bound per draw",
+        BINDLESS_TEXTURE_CAPACITY);
+}
+
+void VulkanContext::FindMemoryBudgetSupport()
+{
+    memoryBudgetSupported = false;
+    if (physicalDeviceProperties2Enabled)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const VkExtensionProperties &extension : availableExtensions)
+        {
+            if (strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0)
+            {
+                memoryBudgetSupported = true;
+                break;
+            }
+        }
+    }
+
+    Logger::Log(
+        LogLevel::Info,
+        memoryBudgetSupported
+            ? "Using the memory budget reported by the driver"
+            : "Memory budget is not reported by the driver, it is estimated from the heap sizes");
+}
+
+void VulkanContext::FindIndirectDrawSupport()
+{
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+    // The culling is dispatched in the command buffers of the graphics queue
+    uint32_t graphicsQueueFamilyIndex, presentQueueFamilyIndex;
+    TryFindQueueFamilyIndices(graphicsQueueFamilyIndex, presentQueueFamilyIndex);
+    uint32_t queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    gpuCullingSupported = supportedFeatures.multiDrawIndirect
+        && supportedFeatures.drawIndirectFirstInstance
+        && (queueFamilies[graphicsQueueFamilyIndex].queueFlags & VK_QUEUE_COMPUTE_BIT);
+
+    drawIndirectCountSupported = false;
+    if (gpuCullingSupported)
+    {
+        uint32_t extensionCount;
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+        for (const VkExtensionProperties &extension : availableExtensions)
+        {
+            if (strcmp(extension.extensionName, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) == 0)
+            {
+                drawIndirectCountSupported = true;
+                break;
+            }
+        }
+    }
+
+    if (!gpuCullingSupported)
+    {
+        Logger::Log(LogLevel::Info, "Multi draw indirect is not supported, entities are culled on the CPU");
+    }
+    else
+    {
+        Logger::Log(
+            LogLevel::Info,
+            drawIndirectCountSupported
+                ? "Culling entities on the GPU, the visible draws are compacted and drawn with indirect count draws"
+                : "Culling entities on the GPU, the culled draws are drawn with indirect draws");
+    }
+}
+
+void VulkanContext::FindBlockCompressionSupport()
+{
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+    blockCompressedTexturesSupported = supportedFeatures.textureCompressionBC;
+    for (VkFormat format : BLOCK_COMPRESSED_IMAGE_FORMATS)
+    {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+        {
+            blockCompressedTexturesSupported = false;
+        }
+    }
+
+    Logger::Log(
+        LogLevel::Info,
+        blockCompressedTexturesSupported
+            ? "Loading the block compressed DDS textures"
+            : "Block compressed textures are not supported, the DDS textures are ignored");
+}
+
 void VulkanContext::FindGraphicsAndPresentQueues()
 {
     uint32_t graphicsQueueFamilyIndex, presentQueueFamilyIndex;
@@ -442,6 +691,22 @@ void VulkanContext::FindGraphicsAndPresentQueues()
     vkGetDeviceQueue(logicalDevice, presentQueueFamilyIndex, 0, &presentQueue);
 }
 
+void VulkanContext::FindTransferQueue()
+{
+    uint32_t transferQueueFamilyIndex;
+    if (TryFindTransferQueueFamilyIndex(transferQueueFamilyIndex))
+    {
+        transferQueueIndex = transferQueueFamilyIndex;
+        vkGetDeviceQueue(logicalDevice, transferQueueFamilyIndex, 0, &transferQueue);
+        Logger::Log(LogLevel::Info, "Using queue family {} for transfers", transferQueueFamilyIndex);
+    }
+    else
+    {
+        transferQueueIndex = graphicsQueueIndex;
+        transferQueue = graphicsQueue;
+    }
+}
+
 void VulkanContext::FindPhysicalDevice()
 {
     uint32_t deviceCount = 0;
@@ -592,6 +857,33 @@ bool VulkanContext::TryFindQueueFamilyIndices(uint32_t &graphicsQueueFamilyIndex
     return false;
 }
 
+bool VulkanContext::TryFindTransferQueueFamilyIndex(uint32_t &transferQueueFamilyIndex)
+{
+    transferQueueFamilyIndex = UINT32_MAX;
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    // Prefer the copy engine family that supports nothing but transfers
+    for (uint32_t currentIndex = 0; currentIndex < queueFamilies.size(); currentIndex++)
+    {
+        VkQueueFlags queueFlags = queueFamilies.at(currentIndex).queueFlags;
+        if ((queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            transferQueueFamilyIndex = currentIndex;
+            if (!(queueFlags & VK_QUEUE_COMPUTE_BIT))
+            {
+                break;
+            }
+        }
+    }
+
+    return transferQueueFamilyIndex != UINT32_MAX;
+}
+
 static VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(
     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
     VkDebugUtilsMessageTypeFlagsEXT messageType,
@@ -1,7 +1,9 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
 #include <vector>
 
@@ -10,6 +12,9 @@
 #include "Common/Constants.h"
 #include "Engine/Screen.h"
 
+class VulkanDeletionQueue;
+class VulkanSamplerCache;
+
 class VulkanContext
 {
 public:
@@ -19,19 +24,38 @@ public:
     void Create();
     void Destroy();
     void RecreateSwapChain();
+    // Also destroys every resource waiting in the deletion queue, nothing is in use once the device is idle
     void WaitIdle();
+    // Device-wide waits since the context was created, unloads defer their destruction instead of waiting
+    uint64_t GetWaitIdleCount() const { return waitIdleCount; }
 
     Screen * GetScreen() const { return screen; }
     VkQueue GetGraphicsQueue() const { return graphicsQueue; }
     uint32_t GetGraphicsQueueIndex() const { return graphicsQueueIndex; }
     VkQueue GetPresentQueue() const { return presentQueue; }
     uint32_t GetPresentQueueIndex() const { return presentQueueIndex; }
+    // Same as the graphics queue when the GPU has no queue family dedicated to transfers
+    VkQueue GetTransferQueue() const { return transferQueue; }
+    uint32_t GetTransferQueueIndex() const { return transferQueueIndex; }
+    bool HasDedicatedTransferQueue() const { return transferQueueIndex != graphicsQueueIndex; }
 
     VkInstance GetInstance() const { return instance; }
     VkPhysicalDevice GetPhysicalDevice() const { return physicalDevice; }
     VkDevice GetLogicalDevice() const { return logicalDevice; }
 
     VkFormat GetDepthImageFormat() const { return depthImageFormat; }
+    VulkanSamplerCache * GetSamplerCache() const { return samplerCache.get(); }
+    VulkanDeletionQueue * GetDeletionQueue() const { return deletionQueue.get(); }
+    // Descriptor indexing lets the entity textures be drawn from one array of sampled images
+    bool SupportsBindlessTextures() const { return bindlessTexturesSupported; }
+    // VK_EXT_memory_budget is enabled, so the memory usage and budget come from the driver
+    bool SupportsMemoryBudget() const { return memoryBudgetSupported; }
+    // The entities can be culled by a compute shader and drawn with indirect draws of many draws each
+    bool SupportsGpuCulling() const { return gpuCullingSupported; }
+    // The block compressed formats of the DDS textures can be sampled
+    bool SupportsBlockCompressedTextures() const { return blockCompressedTexturesSupported; }
+    // Null when VK_KHR_draw_indirect_count is not supported, the culled draws are then not compacted
+    PFN_vkCmdDrawIndexedIndirectCountKHR GetDrawIndexedIndirectCount() const { return drawIndexedIndirectCount; }
 
     VkSwapchainKHR GetSwapChain() const { return swapChain; }
     VkExtent2D GetSwapChainExtent() const { return swapChainExtent; }
@@ -65,7 +89,12 @@ private:
 
     void EnableDebugging();
     void FindDepthImageFormat();
+    void FindDescriptorIndexingSupport();
+    void FindMemoryBudgetSupport();
+    void FindIndirectDrawSupport();
+    void FindBlockCompressionSupport();
     void FindGraphicsAndPresentQueues();
+    void FindTransferQueue();
     void FindPhysicalDevice();
     VkSampleCountFlagBits GetMaxSampleCount();
     bool TryFindSwapChainDetail(
@@ -73,6 +102,7 @@ private:
         std::vector<VkSurfaceFormatKHR> &formats,
         std::vector<VkPresentModeKHR> &presentModes);
     bool TryFindQueueFamilyIndices(uint32_t &graphicsQueueFamilyIndex, uint32_t &presentQueueFamilyIndex);
+    bool TryFindTransferQueueFamilyIndex(uint32_t &transferQueueFamilyIndex);
 
     VkInstance instance;
     VkSurfaceKHR surface;
@@ -82,10 +112,21 @@ private:
     bool enableDebugging;
     VkDebugUtilsMessengerEXT debugMessenger;
 
+    // The instance targets Vulkan 1.0, so the device features are queried through the extension
+    bool physicalDeviceProperties2Enabled;
+    bool bindlessTexturesSupported;
+    bool memoryBudgetSupported;
+    bool gpuCullingSupported;
+    bool drawIndirectCountSupported;
+    bool blockCompressedTexturesSupported;
+    PFN_vkCmdDrawIndexedIndirectCountKHR drawIndexedIndirectCount;
+
     uint32_t graphicsQueueIndex;
     VkQueue graphicsQueue;
     uint32_t presentQueueIndex;
     VkQueue presentQueue;
+    uint32_t transferQueueIndex;
+    VkQueue transferQueue;
 
     VkSwapchainKHR swapChain;
     VkSwapchainKHR oldSwapChain;
@@ -104,5 +145,10 @@ private:
 
     VkSampleCountFlagBits msaaSamples;
 
+    std::unique_ptr<VulkanSamplerCache> samplerCache;
+    std::unique_ptr<VulkanDeletionQueue> deletionQueue;
+    // Read by the renderer while unloading from the game thread
+    std::atomic<uint64_t> waitIdleCount;
+
     Screen *screen;
 };
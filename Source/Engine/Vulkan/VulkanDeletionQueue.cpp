@@ -0,0 +1,52 @@
+#include "VulkanDeletionQueue.h"
+
+VulkanDeletionQueue::VulkanDeletionQueue()
+    : submittedFrameCount(0)
+{
+}
+
+VulkanDeletionQueue::~VulkanDeletionQueue()
+{
+}
+
+void VulkanDeletionQueue::Defer(std::function<void()> destroy)
+{
+    std::lock_guard<std::mutex> lock(deletionMutex);
+    pendingDestructions.push_back({ submittedFrameCount + 1, std::move(destroy) });
+}
+
+void VulkanDeletionQueue::OnFrameSubmitted()
+{
+    std::lock_guard<std::mutex> lock(deletionMutex);
+    submittedFrameCount++;
+}
+
+void VulkanDeletionQueue::ReleaseCompleted(uint64_t completedFrameCount)
+{
+    // Destroying a resource may release others (e.g. the last range of an arena buffer), which are queued behind it
+    while (true)
+    {
+        std::function<void()> destroy;
+        {
+            std::lock_guard<std::mutex> lock(deletionMutex);
+            if (pendingDestructions.empty() || pendingDestructions.front().frameCount > completedFrameCount)
+            {
+                return;
+            }
+            destroy = std::move(pendingDestructions.front().destroy);
+            pendingDestructions.pop_front();
+        }
+        destroy();
+    }
+}
+
+void VulkanDeletionQueue::ReleaseAll()
+{
+    ReleaseCompleted(UINT64_MAX);
+}
+
+uint32_t VulkanDeletionQueue::GetPendingCount()
+{
+    std::lock_guard<std::mutex> lock(deletionMutex);
+    return static_cast<uint32_t>(pendingDestructions.size());
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+// Destroys the resources released by the renderer once no submitted frame can still be reading them,
+// instead of waiting for the whole device to go idle on every unload.
+// Each release is tagged with the frame submitted next, as the uploads flushed before it may still write the resource,
+// and destroyed once the draw engine has waited for the fence of that frame
+class VulkanDeletionQueue
+{
+public:
+    VulkanDeletionQueue();
+    ~VulkanDeletionQueue();
+
+    void Defer(std::function<void()> destroy);
+    // Called after each frame is submitted
+    void OnFrameSubmitted();
+    // Destroys the resources released before the given number of frames were submitted, which are all complete
+    void ReleaseCompleted(uint64_t completedFrameCount);
+    // Only when the device is idle
+    void ReleaseAll();
+
+    uint64_t GetSubmittedFrameCount() const { return submittedFrameCount; }
+    uint32_t GetPendingCount();
+
+private:
+    struct PendingDestruction
+    {
+        uint64_t frameCount;
+        std::function<void()> destroy;
+    };
+
+    // Entities may be unloaded from more than one thread
+    std::mutex deletionMutex;
+    // Ordered by frame, as the frame count only grows
+    std::deque<PendingDestruction> pendingDestructions;
+    uint64_t submittedFrameCount;
+};
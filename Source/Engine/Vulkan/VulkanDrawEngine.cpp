@@ -1,29 +1,57 @@
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <execution>
 
 #include "Common/Logger.h"
 #include "Engine/Camera.h"
 #include "Engine/Entity.h"
+#include "Engine/Frustum.h"
 #include "Engine/Image.h"
 #include "Engine/Material.h"
 #include "Engine/Mesh.h"
 #include "Engine/Terrain.h"
+#include "VulkanDeletionQueue.h"
 #include "VulkanDrawEngine.h"
 #include "VulkanRenderPass.h"
 #include "Buffer/VulkanBuffer.h"
 #include "Buffer/VulkanBufferManager.h"
 #include "Command/VulkanCommandPool.h"
 #include "Command/VulkanCommandManager.h"
+#include "Command/VulkanRenderWorkers.h"
 #include "Frame/VulkanFrameBuffer.h"
 #include "Pipeline/VulkanPipelineManager.h"
 
-VulkanDrawEngine::VulkanDrawEngine(Screen *screen, bool enableDebugging)
+VulkanDrawEngine::VulkanDrawEngine(
+    Screen *screen,
+    bool enableDebugging,
+    bool usePackedVertices,
+    bool useGpuCulling,
+    VkDeviceSize memoryBudgetCap,
+    uint32_t renderWorkerCount,
+    bool useOcclusionCulling)
     : context(),
       screen(screen),
       isInitialized(false),
       enableDebugging(enableDebugging),
+      usePackedVertices(usePackedVertices),
+      useGpuCulling(useGpuCulling),
+      gpuCulling(false),
+      memoryBudgetCap(memoryBudgetCap),
+      renderWorkerCount(renderWorkerCount),
+      useOcclusionCulling(useOcclusionCulling),
       currentInFlightFrame(0),
-      pushConstants{}
+      pushConstants{},
+      lodCameraPosition(0.0f),
+      lodPixelsPerUnit(0.0f),
+      frustumPlanes{},
+      cullingStats{},
+      submittedTriangleCount(0),
+      submittedBindCount(0),
+      drawCallStats{},
+      textureStreamingFrame(0),
+      loadedMeshEntityStats(),
+      newMeshEntityStats()
 {
 }
 
@@ -41,11 +69,14 @@ void VulkanDrawEngine::Destroy()
     context->WaitIdle();
 
     DestroyCommandBuffers();
+    renderWorkers->Destroy();
     ClearDrawingBuffers();
 
     DestroySynchronizationObjects();
     DestroyFrameBuffers();
 
+    // The frame buffer images are destroyed before their allocator
+    context->GetDeletionQueue()->ReleaseAll();
     vmaDestroyAllocator(frameBufferImageAllocator);
 
     commandPool->Destroy();
@@ -68,6 +99,9 @@ void VulkanDrawEngine::DestroySynchronizationObjects()
 void VulkanDrawEngine::DrawFrame()
 {
     uint32_t imageIndex = 0;
+    SelectEntityLods();
+    RequestTextureMipLevels();
+    CullEntities();
     BeginFrame(imageIndex);
     Submit(imageIndex);
     EndFrame(imageIndex);
@@ -81,12 +115,24 @@ void VulkanDrawEngine::Initialize()
     renderPass = std::make_unique<VulkanRenderPass>(context.get());
     renderPass->Create();
 
-    pipelineManager = std::make_unique<VulkanPipelineManager>(context.get(), renderPass.get());
+    // Falls back to the culling on the CPU when the device cannot draw indirect draws with a first instance
+    gpuCulling = useGpuCulling && context->SupportsGpuCulling();
+    if (useGpuCulling && !gpuCulling)
+    {
+        Logger::Log(LogLevel::Info, "GPU culling is not supported by the device, entities are culled on the CPU");
+    }
+
+    pipelineManager = std::make_unique<VulkanPipelineManager>(
+        context.get(), renderPass.get(), usePackedVertices, gpuCulling);
     pipelineManager->Create();
 
     commandPool = std::make_unique<VulkanCommandPool>(context.get());
     commandPool->Create();
 
+    renderWorkers = std::make_unique<VulkanRenderWorkers>(renderWorkerCount);
+    renderWorkers->Create();
+    Logger::Log(LogLevel::Info, "Recording the draw commands with {} render workers", renderWorkers->GetWorkerCount());
+
     VmaAllocatorCreateInfo vmaCreateInto{};
     vmaCreateInto.device = context->GetLogicalDevice();
     vmaCreateInto.physicalDevice = context->GetPhysicalDevice();
@@ -100,13 +146,14 @@ void VulkanDrawEngine::Initialize()
     CreateSynchronizationObjects();
 
     CreateCommandBuffers();
-    VkCommandPool commandPoolToUse = commandPool->GetOrCreateCommandPool(std::this_thread::get_id());
     bufferManager = std::make_unique<VulkanBufferManager>(
         context.get(),
         renderPass.get(),
         pipelineManager->GetDrawingPipelines(),
-        commandPoolToUse,
-        static_cast<uint32_t>(screenFrameBuffers.size()));
+        static_cast<uint32_t>(screenFrameBuffers.size()),
+        usePackedVertices,
+        gpuCulling,
+        memoryBudgetCap);
     bufferManager->Create();
 
     isInitialized = true;
@@ -114,15 +161,19 @@ void VulkanDrawEngine::Initialize()
 
 void VulkanDrawEngine::BeginFrame(uint32_t &imageIndex)
 {
-    // Reset command buffer of previous image index
-    commandManager->Reset(imageIndex);
-
     VkDevice logicalDevice = context->GetLogicalDevice();
     VkSwapchainKHR swapChain = context->GetSwapChain();
 
     ASSERT_VK_RESULT_SUCCESS(
         vkWaitForFences(logicalDevice, 1, &inFlightFences[currentInFlightFrame], VK_TRUE, UINT64_MAX),
         "Failed to wait for fences");
+    // The fence of every frame is waited in turn, so all the frames but the ones still in flight are complete
+    VulkanDeletionQueue *deletionQueue = context->GetDeletionQueue();
+    uint64_t submittedFrameCount = deletionQueue->GetSubmittedFrameCount();
+    if (submittedFrameCount >= MAX_FRAMES_IN_FLIGHT - 1)
+    {
+        deletionQueue->ReleaseCompleted(submittedFrameCount - (MAX_FRAMES_IN_FLIGHT - 1));
+    }
 
     VkResult acquireImageResult = vkAcquireNextImageKHR(
         logicalDevice,
@@ -137,24 +188,34 @@ void VulkanDrawEngine::BeginFrame(uint32_t &imageIndex)
         return;
     }
 
-    // The acquire image is still in use
+    // The acquired image may still be drawn by an earlier frame, whose instance buffers and commands are rewritten below
     if (imagesInFlight[imageIndex] != VK_NULL_HANDLE)
     {
         ASSERT_VK_RESULT_SUCCESS(
-            vkWaitForFences(logicalDevice, 1, &imagesInFlight[currentInFlightFrame], VK_TRUE, UINT64_MAX),
+            vkWaitForFences(logicalDevice, 1, &imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX),
             "Failed to wait for fences");
     }
     imagesInFlight[imageIndex] = inFlightFences[currentInFlightFrame];
 
-    // Recording should happen only if the data are changed
-    if (dataUpdated[imageIndex])
+    // Recording should happen only if the data are changed, and only for the layers drawing them
+    VulkanRenderLayerUpdates &imageLayersUpdated = layersUpdated[imageIndex];
+    if (std::find(imageLayersUpdated.begin(), imageLayersUpdated.end(), true) != imageLayersUpdated.end())
     {
+        auto recordStartTime = std::chrono::high_resolution_clock::now();
         commandManager->Record(
             imageIndex,
             screenFrameBuffers[imageIndex]->GetFrameBuffer(),
             pushConstants,
-            bufferManager->GetDrawingBuffer(imageIndex));
-        dataUpdated[imageIndex] = false;
+            bufferManager->GetDrawingBuffer(imageIndex, lodCameraPosition, imageLayersUpdated),
+            imageLayersUpdated);
+        imageLayersUpdated.fill(false);
+        drawCallStats.recordTimeMs = std::chrono::duration<float, std::milli>(
+            std::chrono::high_resolution_clock::now() - recordStartTime).count();
+        drawCallStats.recordedLayerCount = commandManager->GetLastRecordedLayerCount();
+        drawCallStats.recordCount++;
+        drawCallStats.renderWorkerCount = renderWorkers->GetWorkerCount();
+        drawCallStats.commandPoolCount = commandPool->GetCommandPoolCount();
+        drawCallStats.secondaryCommandBufferCount = commandManager->GetSecondaryCommandBufferCount();
     }
 }
 
@@ -190,24 +251,23 @@ void VulkanDrawEngine::CreateCommandBuffers()
         context.get(),
         commandPool.get(),
         renderPass.get(),
+        renderWorkers.get(),
         pipelineManager->GetDrawingPipelines());
     commandManager->Create(static_cast<uint32_t>(screenFrameBuffers.size()));
 
-    dataUpdated.resize(screenFrameBuffers.size());
+    layersUpdated.resize(screenFrameBuffers.size());
     MarkDataAsUpdated();
 }
 
 void VulkanDrawEngine::CreateFrameBuffers()
 {
     VkExtent2D swapChainExtent = context->GetSwapChainExtent();
-    VkCommandPool commandPoolToUse = commandPool->GetOrCreateCommandPool(std::this_thread::get_id());
 
     std::vector<VkImageView> swapChainImageViews = context->GetSwapChainImageViews();
     for (uint32_t swapChainImageIndex = 0; swapChainImageIndex < swapChainImageViews.size(); swapChainImageIndex++)
     {
         std::unique_ptr<VulkanFrameBuffer> frameBuffer = std::make_unique<VulkanFrameBuffer>(
             context.get(),
-            commandPoolToUse,
             frameBufferImageAllocator);
         frameBuffer->Create(
             swapChainExtent.width,
@@ -291,10 +351,21 @@ void VulkanDrawEngine::EndFrame(uint32_t &imageIndex)
 }
 
 void VulkanDrawEngine::MarkDataAsUpdated()
+{
+    for (VulkanRenderLayerUpdates &imageLayersUpdated : layersUpdated)
+    {
+        imageLayersUpdated.fill(true);
+    }
+}
+
+void VulkanDrawEngine::MarkLayerAsUpdated(VulkanRenderLayer layer)
 {
     // This method should be called only when there are objects add/removed
     // No need to call this when only the position/color of an object is changed
-    std::fill(dataUpdated.begin(), dataUpdated.end(), true);
+    for (VulkanRenderLayerUpdates &imageLayersUpdated : layersUpdated)
+    {
+        imageLayersUpdated[static_cast<uint32_t>(layer)] = true;
+    }
 }
 
 void VulkanDrawEngine::LoadCubeMap(CubeMap &cubeMap)
@@ -321,31 +392,50 @@ void VulkanDrawEngine::LoadCubeMap(CubeMap &cubeMap)
         skyColor[1] / 255.f,
         skyColor[2] / 255.f
     };
+
+    MarkLayerAsUpdated(VulkanRenderLayer::CubeMap);
+    MarkLayerAsUpdated(VulkanRenderLayer::Static);
+    MarkLayerAsUpdated(VulkanRenderLayer::Terrain);
 }
 
 void VulkanDrawEngine::LoadEntity(const Entity &entity)
 {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
     std::shared_ptr<Mesh> mesh = entity.mesh;
+    if (mesh->boundingRadius <= 0.0f && mesh->vertices.size() > 1)
+    {
+        Logger::Log(LogLevel::Warning, "Mesh {} of entity {} has no bounds, it will be culled as a single point",
+            mesh->id, entity.id);
+    }
     glm::vec3 translation = ConvertToVulkanCoordinates(entity.translation);
     glm::vec3 scale = ConvertToVulkanCoordinates(entity.scale);
     glm::vec3 rotations = ConvertToVulkanCoordinates(entity.rotation);
 
-    std::vector<Vertex> &vertices = mesh->vertices;
-    std::vector<Vertex> transformedVertices(vertices.size());
-    std::transform(
-        std::execution::par,
-        vertices.begin(),
-        vertices.end(),
-        transformedVertices.begin(),
-        [&](Vertex &vertex)
-        {
-            return ConvertToVulkanVertex(vertex);
-        });
+    // Meshes shared by several entities are converted only once, when they are first loaded into the buffers
+    bool meshLoaded = bufferManager->IsMeshLoaded(mesh->id);
+    std::vector<Vertex> transformedVertices;
+    if (!meshLoaded)
+    {
+        std::vector<Vertex> &vertices = mesh->vertices;
+        transformedVertices.resize(vertices.size());
+        std::transform(
+            std::execution::par,
+            vertices.begin(),
+            vertices.end(),
+            transformedVertices.begin(),
+            [&](Vertex &vertex)
+            {
+                return ConvertToVulkanVertex(vertex);
+            });
+    }
 
     glm::mat4 translatedMatrix = ComputeTransformationMatrix(translation, scale, rotations);
+    glm::vec3 boundingCenter = ConvertToVulkanVertex({ mesh->boundingCenter }).position;
 
     VulkanInstanceBufferInput instanceBufferInput{};
     instanceBufferInput.transformation = translatedMatrix;
+    instanceBufferInput.boundingSphere = glm::vec4(boundingCenter, mesh->boundingRadius);
 
     uint32_t entityId = entity.id;
     bufferManager->LoadIntoBuffer(
@@ -355,10 +445,344 @@ void VulkanDrawEngine::LoadEntity(const Entity &entity)
         instanceBufferInput,
         transformedVertices,
         mesh->indices,
+        mesh->lods,
         mesh->material.get());
     bufferIds.insert(entityId);
 
-    MarkDataAsUpdated();
+    // The axes are swapped by the conversion, so the corners are sorted again
+    glm::vec3 boundingCorner1 = ConvertToVulkanVertex({ mesh->boundingMin }).position;
+    glm::vec3 boundingCorner2 = ConvertToVulkanVertex({ mesh->boundingMax }).position;
+    EntityBounds bounds{};
+    bounds.boundingBox = { glm::min(boundingCorner1, boundingCorner2), glm::max(boundingCorner1, boundingCorner2) };
+    bounds.transformation = translatedMatrix;
+    bounds.worldBoundingBox = Frustum::TransformBox(bounds.boundingBox, translatedMatrix);
+    bounds.hasBounds = bounds.boundingBox.min != bounds.boundingBox.max;
+    bounds.isOccludee = entity.isOccludee;
+    entityBounds[entityId] = bounds;
+    if (bounds.hasBounds)
+    {
+        entityCullingGrid.Insert(entityId, bounds.worldBoundingBox);
+    }
+
+    if (useOcclusionCulling && entity.isOccluder)
+    {
+        std::shared_ptr<const OccluderMesh> occluderMesh = occluderMeshes[mesh->id].lock();
+        if (!occluderMesh)
+        {
+            std::shared_ptr<OccluderMesh> newOccluderMesh = std::make_shared<OccluderMesh>();
+            newOccluderMesh->positions.reserve(mesh->vertices.size());
+            for (const Vertex &vertex : mesh->vertices)
+            {
+                newOccluderMesh->positions.push_back(ConvertToVulkanVertex(vertex).position);
+            }
+            newOccluderMesh->indices = mesh->indices;
+            occluderMesh = newOccluderMesh;
+            occluderMeshes[mesh->id] = occluderMesh;
+        }
+        occlusionCuller.AddOccluder(entityId, occluderMesh, translatedMatrix, bounds.worldBoundingBox);
+    }
+
+    if (!mesh->lods.empty())
+    {
+        EntityLod entityLod{};
+        entityLod.boundingCenter = boundingCenter;
+        entityLod.boundingRadius = mesh->boundingRadius;
+        entityLod.transformation = translatedMatrix;
+        entityLod.lodErrors.push_back(0.0f);
+        for (const MeshLod &lod : mesh->lods)
+        {
+            entityLod.lodErrors.push_back(lod.error);
+        }
+        entityLod.currentLod = 0;
+        entityLods[entityId] = std::move(entityLod);
+    }
+
+    const Image *diffuseImage = mesh->material->diffuseImage.get();
+    EntityTexture entityTexture{};
+    entityTexture.textureId = mesh->material->id;
+    entityTexture.boundingCenter = boundingCenter;
+    entityTexture.boundingRadius = mesh->boundingRadius;
+    entityTexture.transformation = translatedMatrix;
+    entityTexture.texelsPerUnit = mesh->uvDensity * std::max(diffuseImage->GetWidth(), diffuseImage->GetHeight());
+    entityTextures[entityId] = entityTexture;
+
+    MarkLayerAsUpdated(VulkanRenderLayer::Static);
+
+    EntityLoadStats &loadStats = meshLoaded ? loadedMeshEntityStats : newMeshEntityStats;
+    loadStats.count++;
+    loadStats.totalTimeMs += std::chrono::duration<float, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    Logger::Log(LogLevel::Debug, "Loaded entity {} with {} mesh {}, average load time: "
+        "{:.3f} ms for {} entities with loaded meshes, {:.3f} ms for {} entities with new meshes",
+        entityId, meshLoaded ? "loaded" : "new", mesh->id,
+        loadedMeshEntityStats.GetAverageTimeMs(), loadedMeshEntityStats.count,
+        newMeshEntityStats.GetAverageTimeMs(), newMeshEntityStats.count);
+}
+
+float VulkanDrawEngine::GetScreenPixelsPerUnit(
+    const glm::mat4 &transformation,
+    const glm::vec3 &boundingCenter,
+    float boundingRadius) const
+{
+    float scale = std::max({
+        glm::length(glm::vec3(transformation[0])),
+        glm::length(glm::vec3(transformation[1])),
+        glm::length(glm::vec3(transformation[2])) });
+    glm::vec3 center = glm::vec3(transformation * glm::vec4(boundingCenter, 1.0f));
+    float distance = std::max(glm::distance(center, lodCameraPosition) - boundingRadius * scale, LOD_MIN_DISTANCE);
+    return scale * lodPixelsPerUnit / distance;
+}
+
+void VulkanDrawEngine::SelectEntityLods()
+{
+    bool lodChanged = false;
+    for (auto &[entityId, entityLod] : entityLods)
+    {
+        float errorToPixels = GetScreenPixelsPerUnit(
+            entityLod.transformation, entityLod.boundingCenter, entityLod.boundingRadius);
+
+        // Coarsest level with a small enough error on screen, moving to a coarser level than the current one
+        // needs some margin so that an entity right at the limit does not keep switching back and forth
+        uint32_t selectedLod = 0;
+        for (uint32_t lod = 1; lod < entityLod.lodErrors.size(); lod++)
+        {
+            float maxScreenError = lod > entityLod.currentLod
+                ? LOD_MAX_SCREEN_ERROR * (1.0f - LOD_HYSTERESIS)
+                : LOD_MAX_SCREEN_ERROR;
+            if (entityLod.lodErrors[lod] * errorToPixels > maxScreenError)
+            {
+                break;
+            }
+            selectedLod = lod;
+        }
+
+        if (selectedLod != entityLod.currentLod)
+        {
+            entityLod.currentLod = selectedLod;
+            bufferManager->SetEntityLod(entityId, selectedLod);
+            lodChanged = true;
+        }
+    }
+
+    if (lodChanged)
+    {
+        MarkLayerAsUpdated(VulkanRenderLayer::Static);
+    }
+}
+
+void VulkanDrawEngine::CullEntities()
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    glm::mat4 viewProjection = uniformBufferInput.projection * uniformBufferInput.view;
+    frustumPlanes = Frustum::ExtractPlanes(viewProjection);
+
+    cullingStats = {};
+    bool terrainVisibilityChanged = false;
+    for (const auto &[terrainId, bounds] : terrainBounds)
+    {
+        bool visible = Frustum::IntersectsBox(frustumPlanes, bounds);
+        terrainVisibilityChanged |= bufferManager->SetTerrainVisible(terrainId, visible);
+        if (visible)
+        {
+            cullingStats.visibleTerrainCount++;
+        }
+        else
+        {
+            cullingStats.culledTerrainCount++;
+        }
+    }
+    if (terrainVisibilityChanged)
+    {
+        MarkLayerAsUpdated(VulkanRenderLayer::Terrain);
+    }
+
+    // The GPU culling tests every instance against the planes of the frame when the commands are submitted,
+    // the entities in the view frustum are still the ones tested against the occluders.
+    // Only the entities whose visibility changed are updated, the others keep their recorded draws
+    entityVisibilityChanges.clear();
+    entityCullingGrid.Cull(frustumPlanes, entityVisibilityChanges);
+    bool visibilityChanged = false;
+    if (!gpuCulling)
+    {
+        for (const auto &visibilityChange : entityVisibilityChanges)
+        {
+            visibilityChanged |= UpdateEntityVisibility(visibilityChange.first);
+        }
+    }
+
+    CullingGrid::Stats gridStats = entityCullingGrid.GetStats();
+    cullingStats.visibleEntityCount = gridStats.visibleCount;
+    cullingStats.culledEntityCount = gridStats.culledCount;
+    cullingStats.culledCellCount = gridStats.culledCellCount;
+    cullingStats.cellCount = gridStats.cellCount;
+
+    if (useOcclusionCulling)
+    {
+        visibilityChanged |= CullOccludedEntities(viewProjection);
+    }
+    if (visibilityChanged)
+    {
+        MarkLayerAsUpdated(VulkanRenderLayer::Static);
+    }
+
+    cullingStats.cullTimeMs = std::chrono::duration<float, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+bool VulkanDrawEngine::CullOccludedEntities(const glm::mat4 &viewProjection)
+{
+    auto startTime = std::chrono::high_resolution_clock::now();
+    std::swap(occludedEntityIds, previousOccludedEntityIds);
+    occludedEntityIds.clear();
+    if (occlusionCuller.HasOccluders())
+    {
+        occlusionCuller.Render(viewProjection, frustumPlanes, lodCameraPosition);
+
+        visibleEntityIds.clear();
+        entityCullingGrid.GetVisibleIds(visibleEntityIds);
+        for (uint32_t entityId : visibleEntityIds)
+        {
+            const EntityBounds &bounds = entityBounds[entityId];
+            if (bounds.isOccludee && occlusionCuller.IsOccluded(bounds.worldBoundingBox))
+            {
+                occludedEntityIds.insert(entityId);
+            }
+        }
+
+        OcclusionCuller::Stats occlusionStats = occlusionCuller.GetStats();
+        cullingStats.occluderCount = occlusionStats.occluderCount;
+        cullingStats.occluderTriangleCount = occlusionStats.triangleCount;
+    }
+
+    // Only the entities hidden or revealed since the last culling are updated
+    bool visibilityChanged = false;
+    for (uint32_t entityId : occludedEntityIds)
+    {
+        if (previousOccludedEntityIds.count(entityId) == 0)
+        {
+            visibilityChanged |= UpdateEntityVisibility(entityId);
+        }
+    }
+    for (uint32_t entityId : previousOccludedEntityIds)
+    {
+        if (occludedEntityIds.count(entityId) == 0)
+        {
+            visibilityChanged |= UpdateEntityVisibility(entityId);
+        }
+    }
+
+    cullingStats.occludedEntityCount = static_cast<uint32_t>(occludedEntityIds.size());
+    cullingStats.occlusionTimeMs = std::chrono::duration<float, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    return visibilityChanged;
+}
+
+bool VulkanDrawEngine::UpdateEntityVisibility(uint32_t entityId)
+{
+    auto bounds = entityBounds.find(entityId);
+    bool inFrustum = gpuCulling
+        || bounds == entityBounds.end()
+        || !bounds->second.hasBounds
+        || entityCullingGrid.IsVisible(entityId);
+    bool visible = inFrustum && occludedEntityIds.count(entityId) == 0;
+    return bufferManager->SetEntityVisible(entityId, visible);
+}
+
+void VulkanDrawEngine::RequestTextureMipLevels()
+{
+    if (++textureStreamingFrame < TEXTURE_STREAMING_INTERVAL)
+    {
+        return;
+    }
+    textureStreamingFrame = 0;
+
+    // Textures shared by several entities need the finest level and the highest priority any of them asks for
+    std::unordered_map<uint32_t, VulkanTextureRequest> textureRequests;
+    for (auto &[entityId, entityTexture] : entityTextures)
+    {
+        float pixelsPerUnit = GetScreenPixelsPerUnit(
+            entityTexture.transformation, entityTexture.boundingCenter, entityTexture.boundingRadius);
+        uint32_t mipLevel = 0;
+        if (entityTexture.texelsPerUnit > 0.0f)
+        {
+            float texelsPerPixel = entityTexture.texelsPerUnit / pixelsPerUnit;
+            if (texelsPerPixel > 1.0f)
+            {
+                mipLevel = static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel)));
+            }
+        }
+
+        VulkanResourcePriority priority = VulkanResourcePriority::NearProp;
+        auto entityLod = entityLods.find(entityId);
+        if (entityTexture.isMoving)
+        {
+            priority = VulkanResourcePriority::Vehicle;
+        }
+        else if (entityLod != entityLods.end() && entityLod->second.currentLod > 0)
+        {
+            priority = VulkanResourcePriority::LodProxy;
+        }
+        else if (2.0f * entityTexture.boundingRadius * pixelsPerUnit < FAR_PROP_SCREEN_SIZE)
+        {
+            priority = VulkanResourcePriority::FarProp;
+        }
+
+        auto request = textureRequests.find(entityTexture.textureId);
+        if (request == textureRequests.end())
+        {
+            textureRequests[entityTexture.textureId] = { mipLevel, priority };
+        }
+        else
+        {
+            request->second.mipLevel = std::min(request->second.mipLevel, mipLevel);
+            request->second.priority = std::max(request->second.priority, priority);
+        }
+    }
+
+    if (bufferManager->UpdateTextureResidency(textureRequests))
+    {
+        MarkLayerAsUpdated(VulkanRenderLayer::Static);
+    }
+}
+
+TextureResidencyStats VulkanDrawEngine::GetTextureResidencyStats() const
+{
+    return bufferManager->GetTextureResidencyStats();
+}
+
+ResourceSharingStats VulkanDrawEngine::GetResourceSharingStats() const
+{
+    return bufferManager->GetResourceSharingStats();
+}
+
+DrawCallStats VulkanDrawEngine::GetDrawCallStats() const
+{
+    return drawCallStats;
+}
+
+DeferredDestructionStats VulkanDrawEngine::GetDeferredDestructionStats() const
+{
+    DeferredDestructionStats stats{};
+    stats.pendingCount = context->GetDeletionQueue()->GetPendingCount();
+    stats.deviceWaitCount = context->GetWaitIdleCount();
+    return stats;
+}
+
+CullingStats VulkanDrawEngine::GetCullingStats() const
+{
+    return cullingStats;
+}
+
+bool VulkanDrawEngine::SupportsBlockCompressedTextures() const
+{
+    return context->SupportsBlockCompressedTextures();
+}
+
+GeometryBufferStats VulkanDrawEngine::GetGeometryBufferStats() const
+{
+    GeometryBufferStats stats = bufferManager->GetGeometryBufferStats();
+    stats.bindCount = submittedBindCount;
+    return stats;
 }
 
 void VulkanDrawEngine::LoadLineSegments(std::vector<LineSegmentVertex> &lines)
@@ -379,6 +803,8 @@ void VulkanDrawEngine::LoadLineSegments(std::vector<LineSegmentVertex> &lines)
         });
 
     bufferManager->LoadLineBuffer(transformedVertices);
+
+    MarkLayerAsUpdated(VulkanRenderLayer::Line);
 }
 
 void VulkanDrawEngine::LoadScreenObject(ScreenMesh &screenMesh)
@@ -391,7 +817,7 @@ void VulkanDrawEngine::LoadScreenObject(ScreenMesh &screenMesh)
         vertices,
         screenMesh.image.get());
 
-    MarkDataAsUpdated();
+    MarkLayerAsUpdated(VulkanRenderLayer::Screen);
 }
 
 void VulkanDrawEngine::LoadTerrain(Terrain &terrain)
@@ -416,7 +842,32 @@ void VulkanDrawEngine::LoadTerrain(Terrain &terrain)
         terrain.texture.get());
     terrainBufferIds.insert(terrainId);
 
-    MarkDataAsUpdated();
+    BoundingBox bounds{};
+    if (!transformedVertices.empty())
+    {
+        bounds = { transformedVertices[0].position, transformedVertices[0].position };
+        for (const Vertex &vertex : transformedVertices)
+        {
+            bounds.min = glm::min(bounds.min, vertex.position);
+            bounds.max = glm::max(bounds.max, vertex.position);
+        }
+    }
+    terrainBounds[terrainId] = bounds;
+
+    if (useOcclusionCulling)
+    {
+        std::shared_ptr<OccluderMesh> occluderMesh = std::make_shared<OccluderMesh>();
+        occluderMesh->positions.reserve(transformedVertices.size());
+        for (const Vertex &vertex : transformedVertices)
+        {
+            occluderMesh->positions.push_back(vertex.position);
+        }
+        occluderMesh->indices = terrain.indices;
+        occlusionCuller.AddOccluder(
+            TERRAIN_OCCLUDER_ID_BIT | terrainId, std::move(occluderMesh), glm::mat4(1.0f), bounds);
+    }
+
+    MarkLayerAsUpdated(VulkanRenderLayer::Terrain);
 }
 
 void VulkanDrawEngine::RecreateSwapChain()
@@ -444,9 +895,7 @@ void VulkanDrawEngine::RecreateSwapChain()
     context->RecreateSwapChain();
 
     commandPool->Create();
-    VkCommandPool commandPoolToUse = commandPool->GetOrCreateCommandPool(std::this_thread::get_id());
 
-    bufferManager->ResetCommandPool(commandPoolToUse);
     bufferManager->ResetScreenBuffers();
 
     CreateFrameBuffers();
@@ -458,18 +907,28 @@ void VulkanDrawEngine::SetFog(float density, float gradient)
     // Fog color is already set when the cubemap image is being loaded/updated
     pushConstants.meshPushConstant.fogDensity = density;
     pushConstants.meshPushConstant.fogGradient = gradient;
+    // Pushed by the layers drawing meshes
 
-    MarkDataAsUpdated();
+    MarkLayerAsUpdated(VulkanRenderLayer::Static);
+    MarkLayerAsUpdated(VulkanRenderLayer::Terrain);
 }
 
 void VulkanDrawEngine::Submit(uint32_t &imageIndex)
 {
     // Update the uniform and instance buffers before submission
     bufferManager->UpdateUniformBuffer(uniformBufferInput, imageIndex);
-    for (auto [entityId, instanceBufferInput] : instanceBufferInputs)
-    {
-        bufferManager->UpdateInstanceBuffer(entityId, instanceBufferInput, imageIndex);
-    }
+    bufferManager->UpdateInstanceBuffer(imageIndex);
+    bufferManager->UpdateFrustum(frustumPlanes, imageIndex);
+
+    submittedTriangleCount = commandManager->GetRecordedTriangleCount(imageIndex);
+    submittedBindCount = commandManager->GetRecordedBindCount(imageIndex);
+    drawCallStats.drawCount = commandManager->GetRecordedDrawCount(imageIndex);
+    drawCallStats.instanceCount = commandManager->GetRecordedInstanceCount(imageIndex);
+    drawCallStats.pipelineBindCount = commandManager->GetRecordedPipelineBindCount(imageIndex);
+    drawCallStats.descriptorSetBindCount = commandManager->GetRecordedDescriptorSetBindCount(imageIndex);
+
+    // The uploads of this frame go in first, the graphics queue runs them before drawing
+    bufferManager->FlushUploads();
 
     VkDevice logicalDevice = context->GetLogicalDevice();
     VkQueue graphicsQueue = context->GetGraphicsQueue();
@@ -496,6 +955,7 @@ void VulkanDrawEngine::Submit(uint32_t &imageIndex)
     ASSERT_VK_RESULT_SUCCESS(
         vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFences[currentInFlightFrame]),
         "Failed to submit the command for drawing the buffer");
+    context->GetDeletionQueue()->OnFrameSubmitted();
 }
 
 void VulkanDrawEngine::UpdateCamera(Camera *camera)
@@ -514,6 +974,9 @@ void VulkanDrawEngine::UpdateCamera(Camera *camera)
     uniformBufferInput.view = glm::lookAt(position, position + front, up);
     uniformBufferInput.lightPosition = { 100.0f, 100.0f, 100.0f };
     uniformBufferInput.eyePosition = position;
+
+    lodCameraPosition = position;
+    lodPixelsPerUnit = screen->GetHeight() / (2.0f * std::tan(camera->GetFieldOfView() * 0.5f));
 }
 
 void VulkanDrawEngine::UpdateEntityTransformation(uint32_t entityId, EntityTransformation transformation)
@@ -541,41 +1004,69 @@ void VulkanDrawEngine::UpdateEntityTransformation(uint32_t entityId, EntityTrans
             transformation.angle);
     }
 
-    instanceBufferInputs[entityId] = input;
+    bufferManager->UpdateInstanceTransformation(entityId, input.transformation);
+
+    auto bounds = entityBounds.find(entityId);
+    if (bounds != entityBounds.end())
+    {
+        bounds->second.transformation = input.transformation;
+        bounds->second.worldBoundingBox = Frustum::TransformBox(bounds->second.boundingBox, input.transformation);
+        if (bounds->second.hasBounds)
+        {
+            entityCullingGrid.Update(entityId, bounds->second.worldBoundingBox);
+        }
+        occlusionCuller.UpdateOccluder(entityId, input.transformation, bounds->second.worldBoundingBox);
+    }
+
+    auto entityLod = entityLods.find(entityId);
+    if (entityLod != entityLods.end())
+    {
+        entityLod->second.transformation = input.transformation;
+    }
+
+    auto entityTexture = entityTextures.find(entityId);
+    if (entityTexture != entityTextures.end())
+    {
+        entityTexture->second.transformation = input.transformation;
+        entityTexture->second.isMoving = true;
+    }
 }
 
 void VulkanDrawEngine::UnloadEntity(uint32_t entityId)
 {
-    // Ensure that the buffers are not in use by command buffers before destroying
-    context->WaitIdle();
-
+    // The buffers are destroyed by the deletion queue once the frames using them are complete,
+    // and the commands are recorded again without them before the next submission of each image
     if (bufferIds.count(entityId) > 0)
     {
         bufferManager->UnloadBuffer(entityId);
         bufferIds.erase(entityId);
     }
 
-    instanceBufferInputs.erase(entityId);
+    entityBounds.erase(entityId);
+    entityCullingGrid.Remove(entityId);
+    occlusionCuller.RemoveOccluder(entityId);
+    occludedEntityIds.erase(entityId);
+    entityLods.erase(entityId);
+    entityTextures.erase(entityId);
 
-    MarkDataAsUpdated();
+    MarkLayerAsUpdated(VulkanRenderLayer::Static);
 }
 
 void VulkanDrawEngine::UnloadScreenObject(uint32_t screenMeshId)
 {
-    context->WaitIdle();
     bufferManager->UnloadScreenObjectBuffer(screenMeshId);
-    MarkDataAsUpdated();
+    MarkLayerAsUpdated(VulkanRenderLayer::Screen);
 }
 
 void VulkanDrawEngine::UnloadTerrain(uint32_t terrainId)
 {
-    context->WaitIdle();
-
     if (terrainBufferIds.count(terrainId) > 0)
     {
         bufferManager->UnloadTerrainBuffer(terrainId);
         terrainBufferIds.erase(terrainId);
     }
+    terrainBounds.erase(terrainId);
+    occlusionCuller.RemoveOccluder(TERRAIN_OCCLUDER_ID_BIT | terrainId);
 
-    MarkDataAsUpdated();
+    MarkLayerAsUpdated(VulkanRenderLayer::Terrain);
 }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <array>
 #include <memory>
 #include <vector>
+#include <unordered_map>
 #include <unordered_set>
 
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -11,7 +13,10 @@
 #include <glm/gtx/euler_angles.hpp>
 #include "vk_mem_alloc.hpp"
 
+#include "Engine/CullingGrid.h"
 #include "Engine/DrawEngine.h"
+#include "Engine/Frustum.h"
+#include "Engine/OcclusionCuller.h"
 #include "Engine/Screen.h"
 #include "Engine/Vertex.h"
 #include "VulkanCommon.h"
@@ -24,15 +29,31 @@ class VulkanCommandPool;
 class VulkanCommandManager;
 class VulkanPipelineManager;
 class VulkanRenderPass;
+class VulkanRenderWorkers;
 
 class VulkanDrawEngine : public DrawEngine
 {
 public:
-    VulkanDrawEngine(Screen *screen, bool enableDebugging);
+    VulkanDrawEngine(
+        Screen *screen,
+        bool enableDebugging,
+        bool usePackedVertices,
+        bool useGpuCulling,
+        VkDeviceSize memoryBudgetCap,
+        uint32_t renderWorkerCount,
+        bool useOcclusionCulling);
     ~VulkanDrawEngine();
 
     void Destroy() override;
     void DrawFrame() override;
+    uint64_t GetSubmittedTriangleCount() const override { return submittedTriangleCount; }
+    TextureResidencyStats GetTextureResidencyStats() const override;
+    ResourceSharingStats GetResourceSharingStats() const override;
+    GeometryBufferStats GetGeometryBufferStats() const override;
+    DrawCallStats GetDrawCallStats() const override;
+    DeferredDestructionStats GetDeferredDestructionStats() const override;
+    CullingStats GetCullingStats() const override;
+    bool SupportsBlockCompressedTextures() const override;
     void Initialize() override;
     void LoadCubeMap(CubeMap &cubeMap) override;
     void LoadEntity(const Entity &entity) override;
@@ -48,6 +69,59 @@ public:
 
 private:
     static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    // A level of detail is used while its simplification error covers less than this many pixels on screen
+    static constexpr float LOD_MAX_SCREEN_ERROR = 1.0f;
+    // Switching to a coarser level requires the error to be this much below the limit, to avoid flickering
+    static constexpr float LOD_HYSTERESIS = 0.25f;
+    static constexpr float LOD_MIN_DISTANCE = 0.1f;
+    // Frames between the texture residency updates, each one may have to wait for the GPU to go idle
+    static constexpr uint32_t TEXTURE_STREAMING_INTERVAL = 30;
+    // Props smaller than this many pixels on screen are the first to lose texture detail under memory pressure
+    static constexpr float FAR_PROP_SCREEN_SIZE = 128.0f;
+    // The terrain ids may be the same as entity ids, their occluders are kept above the 32-bit ids
+    static constexpr uint64_t TERRAIN_OCCLUDER_ID_BIT = 1ull << 32;
+
+    struct EntityBounds
+    {
+        // Bounding box of the mesh in model space
+        BoundingBox boundingBox;
+        glm::mat4 transformation;
+        BoundingBox worldBoundingBox;
+        // Meshes without bounds are left out of the culling grid and always drawn
+        bool hasBounds;
+        bool isOccludee;
+    };
+
+    struct EntityLod
+    {
+        // Bounding sphere of the mesh in model space
+        glm::vec3 boundingCenter;
+        float boundingRadius;
+        glm::mat4 transformation;
+        // Level 0 is the full detail mesh with no error
+        std::vector<float> lodErrors;
+        uint32_t currentLod;
+    };
+
+    struct EntityTexture
+    {
+        uint32_t textureId;
+        glm::vec3 boundingCenter;
+        float boundingRadius;
+        glm::mat4 transformation;
+        // Texels of the full size texture per model unit, 0 when unknown so the full size is always requested
+        float texelsPerUnit;
+        // Moved by the game after being loaded, unlike the props of the map
+        bool isMoving;
+    };
+
+    struct EntityLoadStats
+    {
+        uint32_t count;
+        float totalTimeMs;
+
+        float GetAverageTimeMs() const { return count > 0 ? totalTimeMs / count : 0.0f; }
+    };
 
     // The game treats Z-axis as the upward axis, while Vulkan/OpenGL treats Y-axis as the upward axis
     // Therefore, a conversion is required.
@@ -158,10 +232,32 @@ private:
 
     void RecreateSwapChain();
 
+    // Records every layer again, when the command buffers are created
     void MarkDataAsUpdated();
+    void MarkLayerAsUpdated(VulkanRenderLayer layer);
+    // Pixels covered by one model unit at the point of the bounding sphere closest to the camera
+    float GetScreenPixelsPerUnit(const glm::mat4 &transformation, const glm::vec3 &boundingCenter, float boundingRadius) const;
+    void SelectEntityLods();
+    // Leaves the entities outside of the view frustum out of the recorded draws, unless they are culled on the GPU,
+    // and the terrain blocks outside of it in any case
+    void CullEntities();
+    // Leaves the entities hidden behind the occluders out of the recorded draws, returns true if any visibility changed
+    bool CullOccludedEntities(const glm::mat4 &viewProjection);
+    // Visible when inside the view frustum, or culled on the GPU, and not occluded
+    bool UpdateEntityVisibility(uint32_t entityId);
+    // Requests the mip level of each entity texture from the size of its texels on screen,
+    // with the priority of the entity to keep its texture detail under memory pressure
+    void RequestTextureMipLevels();
 
     bool isInitialized;
     bool enableDebugging;
+    bool usePackedVertices;
+    bool useGpuCulling;
+    // Requested and supported by the device
+    bool gpuCulling;
+    VkDeviceSize memoryBudgetCap;
+    uint32_t renderWorkerCount;
+    bool useOcclusionCulling;
 
     Screen *screen;
     std::unique_ptr<VulkanContext> context;
@@ -169,6 +265,8 @@ private:
 
     std::unique_ptr<VulkanCommandPool> commandPool;
     std::unique_ptr<VulkanCommandManager> commandManager;
+    // Kept through the swap chain recreations, unlike the command buffers they record
+    std::unique_ptr<VulkanRenderWorkers> renderWorkers;
     std::unique_ptr<VulkanPipelineManager> pipelineManager;
 
     std::unordered_set<uint32_t> bufferIds;
@@ -185,16 +283,48 @@ private:
     // Based on number of swap chain images (which is usually 3)
     std::vector<std::unique_ptr<VulkanFrameBuffer>> screenFrameBuffers;
     std::vector<VkFence> imagesInFlight;
-    std::vector<bool> dataUpdated;
+    // Layers to record again before the next submission of each image
+    std::vector<VulkanRenderLayerUpdates> layersUpdated;
 
     // Based on the maximum allowed frames in flight
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
 
-    // Uniform/instance buffers that are to be submitted in the next draw call
+    // Uniform buffer that is to be submitted in the next draw call, the instance inputs are kept by the buffer manager
     VulkanUniformBufferInput uniformBufferInput;
-    std::unordered_map<uint32_t, VulkanInstanceBufferInput> instanceBufferInputs;
+
+    std::unordered_map<uint32_t, EntityBounds> entityBounds;
+    // World space bounds of the entities, culled a cell at a time
+    CullingGrid entityCullingGrid;
+    std::vector<std::pair<uint32_t, bool>> entityVisibilityChanges;
+    std::unordered_map<uint32_t, BoundingBox> terrainBounds;
+    OcclusionCuller occlusionCuller;
+    // Triangles of the occluder meshes, shared by the occluders with the same mesh
+    std::unordered_map<uint32_t, std::weak_ptr<const OccluderMesh>> occluderMeshes;
+    // Entities hidden behind the occluders at the last culling and the one before
+    std::unordered_set<uint32_t> occludedEntityIds;
+    std::unordered_set<uint32_t> previousOccludedEntityIds;
+    std::vector<uint32_t> visibleEntityIds;
+    // Planes of the view frustum of the camera, updated every frame
+    std::array<glm::vec4, 6> frustumPlanes;
+    CullingStats cullingStats;
+
+    // Only entities with generated levels of detail
+    std::unordered_map<uint32_t, EntityLod> entityLods;
+    glm::vec3 lodCameraPosition;
+    // Pixels covered by one unit at a distance of one unit
+    float lodPixelsPerUnit;
+    uint64_t submittedTriangleCount;
+    uint32_t submittedBindCount;
+    DrawCallStats drawCallStats;
+
+    std::unordered_map<uint32_t, EntityTexture> entityTextures;
+    uint32_t textureStreamingFrame;
+
+    // Time to add an entity whose mesh is already in the buffers, and one whose mesh has to be uploaded
+    EntityLoadStats loadedMeshEntityStats;
+    EntityLoadStats newMeshEntityStats;
 
     // Active frame that is in use by the GPU
     uint32_t currentInFlightFrame;
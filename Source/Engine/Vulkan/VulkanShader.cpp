@@ -5,7 +5,8 @@
 std::map<VulkanShaderType, shaderc_shader_kind> VulkanShader::shaderTypeToKindMap =
 {
     { VulkanShaderType::Vertex, shaderc_shader_kind::shaderc_glsl_vertex_shader },
-    { VulkanShaderType::Fragment, shaderc_shader_kind::shaderc_glsl_fragment_shader }
+    { VulkanShaderType::Fragment, shaderc_shader_kind::shaderc_glsl_fragment_shader },
+    { VulkanShaderType::Compute, shaderc_shader_kind::shaderc_glsl_compute_shader }
 };
 
 VulkanShader::VulkanShader(VulkanContext *context, VulkanShaderType type)
@@ -21,7 +22,9 @@ VulkanShader::~VulkanShader()
 {
 }
 
-bool VulkanShader::Compile(const std::string &shaderCodePath)
+bool VulkanShader::Compile(
+    const std::string &shaderCodePath,
+    const std::map<std::string, std::string> &macroDefinitions)
 {
     std::ifstream sourceCodeFileStream(shaderCodePath);
     if (!sourceCodeFileStream.is_open())
@@ -34,6 +37,10 @@ bool VulkanShader::Compile(const std::string &shaderCodePath)
         std::istreambuf_iterator<char>());
 
     shaderc::CompileOptions options;
+    for (const auto &[name, value] : macroDefinitions)
+    {
+        options.AddMacroDefinition(name, value);
+    }
     shaderc::SpvCompilationResult result = compiler.CompileGlslToSpv(
         sourceCode,
         shaderTypeToKindMap[type],
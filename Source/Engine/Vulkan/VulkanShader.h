@@ -13,7 +13,8 @@
 enum class VulkanShaderType
 {
     Vertex,
-    Fragment
+    Fragment,
+    Compute
 };
 
 class VulkanShader
@@ -24,7 +25,9 @@ public:
 
     VkShaderModule GetShaderModule() const { return shaderModule; }
 
-    bool Compile(const std::string &shaderCodePath);
+    bool Compile(
+        const std::string &shaderCodePath,
+        const std::map<std::string, std::string> &macroDefinitions = {});
     void Load();
     void Unload();
 
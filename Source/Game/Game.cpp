@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include "Common/FileSystem.h"
 #include "Common/HandledThread.h"
 #include "Common/Util.h"
@@ -67,7 +69,14 @@ void Game::InitializeComponents()
     screen->Create();
 
     renderer = std::make_unique<Renderer>(camera.get());
-    renderer->Initialize(screen.get());
+    int gpuMemoryBudgetMB = gameSettings.graphicsSettings.gpuMemoryBudgetMB;
+    renderer->Initialize(
+        screen.get(),
+        gameSettings.graphicsSettings.usePackedVertices,
+        gameSettings.graphicsSettings.useGpuCulling,
+        gpuMemoryBudgetMB > 0 ? static_cast<uint64_t>(gpuMemoryBudgetMB) * 1024 * 1024 : 0,
+        static_cast<uint32_t>(std::max(gameSettings.graphicsSettings.renderWorkerCount, 0)),
+        gameSettings.graphicsSettings.useOcclusionCulling);
 }
 
 void Game::InitializeSettings(const GameSessionConfig &startConfig)
@@ -113,8 +122,56 @@ void Game::PrepareDebugInfo()
     debugText.position = { 0, 0 };
     debugText.lines =
     {
-        "Camera Position: " + Util::Format3DPoint(worldPosition.x, worldPosition.y, worldPosition.z)
+        "Camera Position: " + Util::Format3DPoint(worldPosition.x, worldPosition.y, worldPosition.z),
+        fmt::format("Triangles: {}", renderer->GetSubmittedTriangleCount())
     };
+
+    DrawCallStats drawCallStats = renderer->GetDrawCallStats();
+    debugText.lines.push_back(fmt::format("Draws: {} for {} entities, recorded {} times, last in {:.2f} ms for {} layers",
+        drawCallStats.drawCount, drawCallStats.instanceCount, drawCallStats.recordCount,
+        drawCallStats.recordTimeMs, drawCallStats.recordedLayerCount));
+    debugText.lines.push_back(fmt::format("Recording: {} workers, {} command pools, {} secondary command buffers",
+        drawCallStats.renderWorkerCount, drawCallStats.commandPoolCount, drawCallStats.secondaryCommandBufferCount));
+    debugText.lines.push_back(fmt::format("Binds: {} pipelines, {} descriptor sets",
+        drawCallStats.pipelineBindCount, drawCallStats.descriptorSetBindCount));
+
+    TextureResidencyStats textureStats = renderer->GetTextureResidencyStats();
+    debugText.lines.push_back(fmt::format("Textures: {:.1f} MB resident, {:.1f} MB with all mips, {} streamed, {} pending",
+        textureStats.residentMemorySize / (1024.0f * 1024.0f), textureStats.fullMemorySize / (1024.0f * 1024.0f),
+        textureStats.streamedTextureCount, textureStats.pendingTextureCount));
+    debugText.lines.push_back(fmt::format("GPU memory: {:.1f} MB used of {:.1f} MB budget",
+        textureStats.deviceMemoryUsage / (1024.0f * 1024.0f), textureStats.deviceMemoryBudget / (1024.0f * 1024.0f)));
+
+    ResourceSharingStats sharingStats = renderer->GetResourceSharingStats();
+    debugText.lines.push_back(fmt::format("Shared: {} meshes ({:.1f} MB), {} textures ({:.1f} MB) not uploaded again",
+        sharingStats.sharedMeshCount, sharingStats.savedMeshSize / (1024.0f * 1024.0f),
+        sharingStats.sharedTextureCount, sharingStats.savedTextureSize / (1024.0f * 1024.0f)));
+
+    GeometryBufferStats geometryStats = renderer->GetGeometryBufferStats();
+    debugText.lines.push_back(fmt::format("Geometry: {} meshes in {} buffers, {:.1f}/{:.1f} MB, {:.0f}% fragmented, {} binds",
+        geometryStats.meshCount, geometryStats.bufferCount, geometryStats.usedSize / (1024.0f * 1024.0f),
+        geometryStats.capacity / (1024.0f * 1024.0f), geometryStats.fragmentation * 100.0f, geometryStats.bindCount));
+
+    CullingStats cullingStats = renderer->GetCullingStats();
+    debugText.lines.push_back(fmt::format("Culling: {} visible, {} culled entities ({}/{} cells), {} visible, {} culled terrain blocks in {:.3f} ms",
+        cullingStats.visibleEntityCount, cullingStats.culledEntityCount, cullingStats.culledCellCount, cullingStats.cellCount,
+        cullingStats.visibleTerrainCount, cullingStats.culledTerrainCount, cullingStats.cullTimeMs));
+    debugText.lines.push_back(fmt::format("Occlusion: {} occluders ({} triangles), {} entities hidden in {:.3f} ms",
+        cullingStats.occluderCount, cullingStats.occluderTriangleCount, cullingStats.occludedEntityCount,
+        cullingStats.occlusionTimeMs));
+
+    DeferredDestructionStats destructionStats = renderer->GetDeferredDestructionStats();
+    debugText.lines.push_back(fmt::format("Destruction: {} pending, {} device waits",
+        destructionStats.pendingCount, destructionStats.deviceWaitCount));
+
+    glm::vec3 viewPosition = view->GetWorldPosition();
+    RoadLaneQueryResult laneResult{};
+    if (map->GetRoadNetwork()->FindNearestLane(viewPosition, DEBUG_INFO_ROAD_SEARCH_DISTANCE, laneResult))
+    {
+        debugText.lines.push_back(fmt::format("Road: segment {} lane {}, {:.1f}/{:.1f} m along, {:.1f} m away",
+            laneResult.segmentId, laneResult.laneIndex,
+            laneResult.distanceAlongLane, laneResult.laneLength, laneResult.distance));
+    }
     renderer->PutText(debugText);
 
     DebugSegments &physicsDebugDrawing = physicsSystem->GetDebugDrawing();
@@ -159,9 +216,11 @@ void Game::Start(const GameSessionConfig &startConfig)
         });
 
     Logger::Log(LogLevel::Info, "Creating a separate thread for loading map resources");
+    mapLoader->SetCompressedTexturesSupported(renderer->SupportsBlockCompressedTextures());
     mapLoader->StartLoadBlocksThread();
 
     Logger::Log(LogLevel::Info, "Creating a separate thread for loading moving entities");
+    gameObjectLoader->SetCompressedTexturesSupported(renderer->SupportsBlockCompressedTextures());
     gameObjectLoader->StartLoadGameObjectThread();
 
     RunMainLoop();
@@ -298,7 +357,7 @@ void Game::RunGameLoop()
         if (mapLoader->IsReadyToAdd())
         {
             MapBlockSurfaces mapBlockSurface = mapLoader->PollLoadedSurfaces();
-            physicsSystem->AddSurface(mapBlockSurface.blockId, mapBlockSurface.collisionMeshes);
+            physicsSystem->AddSurface(mapBlockSurface.blockId, mapBlockSurface.collisionBodies);
         }
 
         timeSinceLastUpdate += timer.DeltaTime();
@@ -39,6 +39,7 @@ public:
 
 private:
     static constexpr uint32_t DEBUG_INFO_ENTITY_ID = static_cast<uint32_t>(IdentifierType::DebugInfo);
+    static constexpr float DEBUG_INFO_ROAD_SEARCH_DISTANCE = 20.0f;
 
     void InitializeComponents();
     void InitializeSettings(const GameSessionConfig &startConfig);
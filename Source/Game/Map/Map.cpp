@@ -99,5 +99,10 @@ std::list<uint32_t> Map::UnloadBlocks(const std::unordered_set<MapBlockPosition>
         loadedBlocks.erase(mapBlockPositionToUnload);
     }
 
+    for (uint32_t mapBlockIdToUnload : mapBlockIdsToUnload)
+    {
+        roadNetwork.RemoveBlock(mapBlockIdToUnload);
+    }
+
     return mapBlockIdsToUnload;
 }
@@ -6,6 +6,7 @@
 #include <unordered_map>
 
 #include "Game/Path/Road.h"
+#include "Game/Path/RoadNetwork.h"
 #include "Config/MapConfig.h"
 
 // Dimension of a map block in meters, this should never be changed
@@ -26,6 +27,7 @@ struct StaticObjectMapItem
 struct RoadMapItem
 {
     uint32_t id;
+    uint32_t segmentId;
     RoadInfo info;
     std::vector<uint32_t> entityIds;
 };
@@ -105,6 +107,7 @@ public:
     std::string GetSkyBoxImageFilePath() const;
     MapBlock *GetCurrentBlock() const { return currentBlock; }
     MapBlock *GetPreviousBlock() const { return previousBlock; }
+    RoadNetwork *GetRoadNetwork() { return &roadNetwork; }
 
     void AddLoadedBlock(const MapBlock &mapBlock);
     bool GetMapBlockFile(const MapBlockPosition &mapBlockPosition, MapBlockFileConfig &mapBlockFile);
@@ -119,4 +122,5 @@ private:
     MapInfoConfig mapInfoConfig;
     std::string configFilePath;
     std::unordered_map<MapBlockPosition, MapBlock> loadedBlocks;
+    RoadNetwork roadNetwork;
 };
@@ -13,10 +13,12 @@
 #include "Config/ObjectConfig.h"
 #include "Engine/Image.h"
 #include "Engine/Material.h"
+#include "Game/Physics/PhysicsSystem.h"
 #include "MapLoader.h"
 
 MapLoader::MapLoader(Map *map, const MapLoadSettings &mapLoadSettings)
-    : meshLoader(),
+    : meshLoader(mapLoadSettings.meshLodTriangleRatios),
+    roadLoader(mapLoadSettings.roadMaxSegmentAngle, mapLoadSettings.roadMaxChordalError),
     terrainLoader(MAP_BLOCK_SIZE, 10, 50),
     staticEntityIdCount(0),
     loadProgress(0),
@@ -24,6 +26,7 @@ MapLoader::MapLoader(Map *map, const MapLoadSettings &mapLoadSettings)
     readyToAdd(false),
     shouldTerminate(false),
     firstBlockLoaded(false),
+    compressedTexturesSupported(false),
     map(map),
     mapLoadSettings(mapLoadSettings)
 {
@@ -112,6 +115,12 @@ MapBlockSurfaces MapLoader::PollLoadedSurfaces()
     return result;
 }
 
+void MapLoader::SetCompressedTexturesSupported(bool supported)
+{
+    compressedTexturesSupported = supported;
+    roadLoader.SetCompressedTexturesSupported(supported);
+}
+
 void MapLoader::StartLoadBlocksThread()
 {
     loadBlockThread = std::make_unique<HandledThread>([&]()
@@ -182,7 +191,8 @@ void MapLoader::StartLoadBlocksThread()
                     terrain.id = blockId;
                     const TerrainConfig &terrainConfig = mapBlockInfoConfig.terrain;
                     std::string heightMapPath = FileSystem::GetHeightMapFile(mapBaseDirectory, terrainConfig.heightMap);
-                    std::string textureFilePath = FileSystem::GetTextureFile(mapBaseDirectory, terrainConfig.baseTexture);
+                    std::string textureFilePath = FileSystem::GetCompressedTextureFile(
+                        mapBaseDirectory, terrainConfig.baseTexture, compressedTexturesSupported);
                     if (!terrainLoader.LoadFromHeightMap(
                         heightMapPath,
                         glm::vec3(mapBlockOffsetX, mapBlockOffsetY, 0.0f),
@@ -208,7 +218,7 @@ void MapLoader::StartLoadBlocksThread()
                             return glm::vec3{ vertex.position.x, -vertex.position.y, vertex.position.z };
                         });
                     std::copy(terrain.indices.begin(), terrain.indices.end(), terrainCollisionMesh.indices.begin());
-                    mapBlockSurface.collisionMeshes.push_back(terrainCollisionMesh);
+                    mapBlockSurface.collisionBodies.push_back(PhysicsSystem::CreateStaticBody(terrainCollisionMesh));
 
                     loadedMapBlock.terrainMapItem.id = terrain.id;
 
@@ -217,6 +227,7 @@ void MapLoader::StartLoadBlocksThread()
                     std::vector<EntityConfig> &entityConfigs = mapBlockInfoConfig.entities;
 
                     std::unordered_map<uint32_t, std::shared_ptr<Mesh>> objectIdMeshMap;
+                    std::unordered_map<uint32_t, StaticObjectConfig> objectIdConfigMap;
                     std::unordered_map<uint32_t, std::shared_ptr<Material>> materialIdImageMap;
                     for (const EntityConfig &entityConfig : entityConfigs)
                     {
@@ -246,7 +257,8 @@ void MapLoader::StartLoadBlocksThread()
                                 continue;
                             }
 
-                            std::string textureFilePath = FileSystem::GetTextureFile(objectBaseDirectory, staticObjectConfig.material.diffuse);
+                            std::string textureFilePath = FileSystem::GetCompressedTextureFile(
+                                objectBaseDirectory, staticObjectConfig.material.diffuse, compressedTexturesSupported);
                             uint32_t materialId = Identifier::GenerateIdentifier(textureFilePath);
                             if (materialIdImageMap.count(materialId) == 0)
                             {
@@ -266,6 +278,7 @@ void MapLoader::StartLoadBlocksThread()
 
                             mesh.material = materialIdImageMap[materialId];
                             objectIdMeshMap[objectId] = std::make_shared<Mesh>(mesh);
+                            objectIdConfigMap[objectId] = staticObjectConfig;
                         }
 
                         glm::vec3 entityOrigin =
@@ -287,6 +300,8 @@ void MapLoader::StartLoadBlocksThread()
                         };
                         entity.scale = { 1.0f, 1.0f, 1.0f };
                         entity.mesh = objectIdMeshMap[objectId];
+                        entity.isOccluder = objectIdConfigMap[objectId].occluder;
+                        entity.isOccludee = objectIdConfigMap[objectId].occludee;
                         entities.push_back(entity);
 
                         StaticObjectMapItem objectMapItem{};
@@ -296,9 +311,22 @@ void MapLoader::StartLoadBlocksThread()
                         loadedMapBlock.staticMapItems.push_back(objectMapItem);
                     }
 
+                    if (!entityConfigs.empty())
+                    {
+                        MeshCacheStats meshCacheStats = meshLoader.GetCacheStats();
+                        Logger::Log(LogLevel::Info, "Mesh cache: {} hits, {} misses, {:.1f} ms import time saved",
+                            meshCacheStats.hits, meshCacheStats.misses, meshCacheStats.importTimeSavedMs);
+                    }
+
                     // Load the roads, where each road maps to one or more entities
                     // since each road allows multiple materials
                     std::vector<RoadInfoConfig> &roadConfigs = mapBlockInfoConfig.roads;
+                    roadLoader.ResetStats();
+                    roadLoader.RemoveExpiredTemplates();
+
+                    // All road pieces of the block are merged into a single collision body,
+                    // instead of having one static body per road mesh in the broadphase
+                    CollisionMesh roadCollisionMesh;
                     for (const RoadInfoConfig &roadConfig : roadConfigs)
                     {
                         Road road;
@@ -318,10 +346,13 @@ void MapLoader::StartLoadBlocksThread()
 
                         RoadMapItem roadMapItem{};
                         roadMapItem.id = road.id;
+                        roadMapItem.segmentId = map->GetRoadNetwork()->AddRoad(blockId, road);
                         roadMapItem.info = roadInfo;
 
-                        for (Mesh &roadMesh : road.meshes)
+                        for (const std::shared_ptr<Mesh> &roadMeshTemplate : road.meshes)
                         {
+                            const Mesh &roadMesh = *roadMeshTemplate;
+
                             Entity roadEntity;
 
                             roadEntity.id = Identifier::GenerateIdentifier(IdentifierType::Entity, ++staticEntityIdCount);
@@ -329,22 +360,23 @@ void MapLoader::StartLoadBlocksThread()
                             roadEntity.translation = roadInfo.position;
                             roadEntity.rotation = { 0.0f, 0.0f, roadInfo.rotationZ };
                             roadEntity.scale = { 1.0f, 1.0f, 1.0f };
-                            roadEntity.mesh = std::make_shared<Mesh>(roadMesh);
+                            roadEntity.mesh = roadMeshTemplate;
 
                             entities.push_back(roadEntity);
                             roadMapItem.entityIds.push_back(roadEntity.id);
 
                             // For collision mesh, we would need to apply the transformation for loading into the physics world
                             float rotationRadians = glm::radians<float>(roadInfo.rotationZ);
-                            CollisionMesh roadCollisionMesh;
-                            roadCollisionMesh.vertices.resize(roadMesh.vertices.size());
-                            roadCollisionMesh.indices.resize(roadMesh.indices.size());
+                            size_t vertexOffset = roadCollisionMesh.vertices.size(),
+                                   indexOffset = roadCollisionMesh.indices.size();
+                            roadCollisionMesh.vertices.resize(vertexOffset + roadMesh.vertices.size());
+                            roadCollisionMesh.indices.resize(indexOffset + roadMesh.indices.size());
                             std::transform(
                                 std::execution::par,
                                 roadMesh.vertices.begin(),
                                 roadMesh.vertices.end(),
-                                roadCollisionMesh.vertices.begin(),
-                                [&](Vertex &vertex)
+                                roadCollisionMesh.vertices.begin() + vertexOffset,
+                                [&](const Vertex &vertex)
                                 {
                                     // Apply rotation and translations to the collision mesh of the road
                                     float cosRotation = glm::cos(-rotationRadians),
@@ -356,13 +388,40 @@ void MapLoader::StartLoadBlocksThread()
                                     glm::vec3 rotatedPosition = { rotatedX, rotatedY, vertex.position.z };
                                     return rotatedPosition + roadInfo.position;
                                 });
-                            std::copy(roadMesh.indices.begin(), roadMesh.indices.end(), roadCollisionMesh.indices.begin());
-                            mapBlockSurface.collisionMeshes.push_back(roadCollisionMesh);
+                            std::transform(
+                                roadMesh.indices.begin(),
+                                roadMesh.indices.end(),
+                                roadCollisionMesh.indices.begin() + indexOffset,
+                                [&](uint32_t index)
+                                {
+                                    return index + static_cast<uint32_t>(vertexOffset);
+                                });
                         }
 
                         loadedMapBlock.roadMapItems.push_back(roadMapItem);
                     }
 
+                    if (!roadCollisionMesh.indices.empty())
+                    {
+                        mapBlockSurface.collisionBodies.push_back(PhysicsSystem::CreateStaticBody(roadCollisionMesh));
+                    }
+
+                    if (!roadConfigs.empty())
+                    {
+                        RoadLoadStats roadStats = roadLoader.GetStats();
+                        Logger::Log(LogLevel::Info,
+                            "Roads for block ({}, {}): {} meshes from {} new and {} shared templates, "
+                            "{} textures loaded ({} bytes), {} reused ({} bytes saved), "
+                            "{} vertices and {} indices for both render and collision meshes, "
+                            "of which {} vertices and {} indices generated for the render meshes",
+                            mapBlockPositionValue.x, mapBlockPositionValue.y,
+                            roadStats.roadMeshes, roadStats.templateMeshesCreated, roadStats.templateMeshesReused,
+                            roadStats.texturesLoaded, roadStats.textureBytesLoaded,
+                            roadStats.texturesReused, roadStats.textureBytesSaved,
+                            roadStats.vertices, roadStats.indices,
+                            roadStats.templateVertices, roadStats.templateIndices);
+                    }
+
                     loadedResources.push_back(mapBlockResource);
                     loadedSurfaces.push_back(mapBlockSurface);
                     map->AddLoadedBlock(loadedMapBlock);
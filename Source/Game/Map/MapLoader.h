@@ -36,10 +36,11 @@ struct MapBlockResources
 };
 
 // Used to load the collision surfaces into the physics world
+// The bodies are built on the loading thread, only adding them to the world is left
 struct MapBlockSurfaces
 {
     uint32_t blockId;
-    std::vector<CollisionMesh> collisionMeshes;
+    std::vector<std::shared_ptr<CollisionBody>> collisionBodies;
 };
 
 class MapLoader
@@ -59,6 +60,8 @@ public:
     MapBlockResources PollLoadedResources();
     MapBlockSurfaces PollLoadedSurfaces();
     
+    // The DDS textures are only loaded when the device can sample them, set before the thread is started
+    void SetCompressedTexturesSupported(bool supported);
     void StartLoadBlocksThread();
     void TerminateLoadBlocksThread();
 
@@ -71,6 +74,7 @@ private:
     std::atomic<uint32_t> staticEntityIdCount;
 
     bool firstBlockLoaded;
+    bool compressedTexturesSupported;
     Map *map;
     MapLoadSettings mapLoadSettings;
 
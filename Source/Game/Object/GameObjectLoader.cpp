@@ -19,7 +19,8 @@ GameObjectLoader::GameObjectLoader(PhysicsSystem *physics)
     : physics(physics),
       shouldTerminate(false),
       readyToBuffer(false),
-      gameObjectEntityIdCount(0)
+      gameObjectEntityIdCount(0),
+      compressedTexturesSupported(false)
 {
 }
 
@@ -94,9 +95,11 @@ bool GameObjectLoader::LoadVehicleConfig(
 
     // Load the chassis and wheel meshes for rendering
     std::string chassisMeshFilePath = FileSystem::GetModelFile(vehicleConfigDirectory, chassisObjectConfig.mesh);
-    std::string chassisTextureFilePath = FileSystem::GetTextureFile(vehicleConfigDirectory, chassisObjectConfig.material.diffuse);
+    std::string chassisTextureFilePath = FileSystem::GetCompressedTextureFile(
+        vehicleConfigDirectory, chassisObjectConfig.material.diffuse, compressedTexturesSupported);
     std::string wheelMeshFilePath = FileSystem::GetModelFile(vehicleConfigDirectory, wheelObjectConfig.mesh);
-    std::string wheelTextureFilePath = FileSystem::GetTextureFile(vehicleConfigDirectory, wheelObjectConfig.material.diffuse);
+    std::string wheelTextureFilePath = FileSystem::GetCompressedTextureFile(
+        vehicleConfigDirectory, wheelObjectConfig.material.diffuse, compressedTexturesSupported);
 
     uint32_t meshId = Identifier::GenerateIdentifier(chassisMeshFilePath);
     uint32_t materialId = Identifier::GenerateIdentifier(chassisTextureFilePath);
@@ -61,6 +61,8 @@ public:
     std::list<std::unique_ptr<Entity>> PollLoadedEntities();
     std::list<GameObjectLoadResult> PollLoadedGameObjects();
 
+    // The DDS textures are only loaded when the device can sample them, set before the thread is started
+    void SetCompressedTexturesSupported(bool supported) { compressedTexturesSupported = supported; }
     void StartLoadGameObjectThread();
     void TerminateLoadGameObjectThread();
 
@@ -75,6 +77,7 @@ private:
     PhysicsSystem *physics;
 
     uint32_t gameObjectEntityIdCount;
+    bool compressedTexturesSupported;
 
     std::atomic<bool> readyToSpawn;
     std::list<GameObjectLoadResult> loadedGameObjects;
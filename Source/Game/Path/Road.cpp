@@ -1,3 +1,8 @@
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 
@@ -8,10 +13,26 @@
 #include "Config/ObjectConfig.h"
 #include "Engine/Image.h"
 #include "Engine/Material.h"
+#include "Engine/MeshOptimizer.h"
 #include "Road.h"
 
-RoadLoader::RoadLoader()
+RoadLoader::RoadLoader(float maxSegmentAngle, float maxChordalError)
+    : maxSegmentRadians(glm::radians(std::max(maxSegmentAngle, MIN_SEGMENT_ANGLE))),
+      maxChordalError(std::max(maxChordalError, MIN_CHORDAL_ERROR)),
+      compressedTexturesSupported(false),
+      stats()
 {
+    // A zero tolerance would need infinitely many segments
+    if (!(maxSegmentAngle > 0.0f))
+    {
+        Logger::Log(LogLevel::Warning, "Road max segment angle {} is not positive, using {} degrees",
+            maxSegmentAngle, MIN_SEGMENT_ANGLE);
+    }
+    if (!(maxChordalError > 0.0f))
+    {
+        Logger::Log(LogLevel::Warning, "Road max chordal error {} is not positive, using {} meters",
+            maxChordalError, MIN_CHORDAL_ERROR);
+    }
 }
 
 RoadLoader::~RoadLoader()
@@ -39,24 +60,6 @@ bool RoadLoader::LoadFromFile(
         roadObjectConfig = *loadedRoadConfigs[filename];
     }
 
-    const float radius = info.radius;
-    const float length = info.length;
-
-    int segments;
-    float radiansPerSegment;
-
-    if (radius == 0.0f)
-    {
-        segments = 1;
-        radiansPerSegment = 0.0f;
-    }
-    else
-    {
-        float centralAngle = length / radius;
-        segments = (int) std::ceilf(length * SEGMENTS_PER_METER);
-        radiansPerSegment = centralAngle / segments;
-    }
-
     std::string roadBaseDirectory = FileSystem::GetParentDirectory(filename);
     
     uint32_t roadFileHash = Identifier::GenerateIdentifier(filename);
@@ -67,129 +70,287 @@ bool RoadLoader::LoadFromFile(
         static_cast<int>(info.position.z));
 
     road.id = roadFileHash ^ (roadPositionHash << 8);
+    road.info = info;
+    LoadLanes(roadObjectConfig, road);
     road.meshes.resize(roadObjectConfig.meshes.size());
+
+    // All meshes of a road share the same segmentation so that their edges line up
+    int segments = GetSegmentCount(roadObjectConfig, info);
     for (uint32_t i = 0; i < roadObjectConfig.meshes.size(); i++)
     {
         const RoadMeshInfo &meshInfo = roadObjectConfig.meshes[i];
+        stats.roadMeshes++;
 
-        Mesh &roadMesh = road.meshes[i];
-        
-        roadMesh.id = roadFileHash ^ (roadPositionHash << 8) ^ (i << 16);
-        const std::string &diffuseImagePath = FileSystem::GetTextureFile(roadBaseDirectory, meshInfo.material.diffuse);
-        std::shared_ptr<Image> diffuseImage = std::make_shared<Image>();
-        if (!diffuseImage->Load(diffuseImagePath, ImageColor::ColorWithAlpha))
+        // Geometry is generated in road local space, so roads of the same type and shape
+        // can share the same mesh (and therefore the same vertex buffers)
+        uint32_t templateMeshId = GetTemplateMeshId(filename, info, i);
+        auto loadedRoadMesh = loadedRoadMeshes.find(templateMeshId);
+        if (loadedRoadMesh != loadedRoadMeshes.end())
         {
-            Logger::Log(LogLevel::Error, "Failed to load image from {}", diffuseImagePath);
-            return false;
+            road.meshes[i] = loadedRoadMesh->second.lock();
         }
-        roadMesh.material = std::make_shared<Material>();
-        roadMesh.material->id = Identifier::GenerateIdentifier(diffuseImagePath);
-        roadMesh.material->diffuseImage = diffuseImage;
-
-        std::vector<Vertex> &vertices = roadMesh.vertices;
-        std::vector<uint32_t> &indices = roadMesh.indices;
-
-        float startX = meshInfo.startPosition.x,
-              startZ = meshInfo.startPosition.y;
-        float startU = meshInfo.startTextureCoord.x,
-              startV = meshInfo.startTextureCoord.y;
-        float endX = meshInfo.endPosition.x,
-              endZ = meshInfo.endPosition.y;
-        float endU = meshInfo.endTextureCoord.x,
-              endV = meshInfo.endTextureCoord.y;
-        for (int i = 0; i < segments; i++)
+        if (road.meshes[i])
         {
-            float currAngle = i * radiansPerSegment;
-            float nextAngle = (i + 1) * radiansPerSegment;
-
-            float cosCurrAngle = glm::cos(currAngle),
-                  sinCurrAngle = glm::sin(currAngle);
-            float cosNextAngle = glm::cos(nextAngle),
-                  sinNextAngle = glm::sin(nextAngle);
-
-            float startTextureCoordV = i * startV * TEXTURE_VERTICAL_INCREMENT_PER_METER;
-            float endTextureCoordV = (i + 1) * endV * TEXTURE_VERTICAL_INCREMENT_PER_METER;
-
-            // If the road is straight, then just use the length, since this loop will only be iterated once
-            if (radius == 0.0f)
-            {
-                endTextureCoordV = endV * length * TEXTURE_VERTICAL_INCREMENT_PER_METER;
-            }
-
-            // Use the height for the normals for now
-            glm::vec3 currNormal = glm::normalize(glm::vec3{ startZ, startZ, 2.0f });
-            glm::vec3 nextNormal = glm::normalize(glm::vec3{ endZ, endZ, 2.0f });
-
-            // Calculate the radius, and clamp to zero
-            float startRadius = std::max(0.0f, radius - startX);
-            float endRadius = std::max(0.0f, radius - endX);
-
-            Vertex currStartVertex{};
-            currStartVertex.position =
-            {
-                radius - startRadius * cosCurrAngle,
-                startRadius * sinCurrAngle,
-                startZ
-            };
-            currStartVertex.normal = currNormal;
-            currStartVertex.uv = { startU, startTextureCoordV };
-
-            Vertex currEndVertex{};
-            currEndVertex.position =
-            {
-                radius - endRadius * cosCurrAngle,
-                endRadius * sinCurrAngle,
-                startZ
-            };
-            currEndVertex.normal = currNormal;
-            currEndVertex.uv = { endU, startTextureCoordV };
-
-            Vertex nextStartVertex{};
-            nextStartVertex.position =
-            {
-                radius - startRadius * cosNextAngle,
-                startRadius * sinNextAngle,
-                endZ
-            };
-            nextStartVertex.normal = nextNormal;
-            nextStartVertex.uv = { startU, endTextureCoordV };
-
-            Vertex nextEndVertex{};
-            nextEndVertex.position =
-            {
-                radius - endRadius * cosNextAngle,
-                endRadius * sinNextAngle,
-                endZ
-            };
-            nextEndVertex.normal = nextNormal;
-            nextEndVertex.uv = { endU, endTextureCoordV };
-
-            if (radius == 0.0f)
-            {
-                currStartVertex.position.x = startX;
-                currEndVertex.position.x = endX;
-
-                nextEndVertex.position.x = endX;
-                nextEndVertex.position.y = length;
-
-                nextStartVertex.position.x = startX;
-                nextStartVertex.position.y = length;
-            }
-
-            uint32_t startIndex = static_cast<uint32_t>(vertices.size());
-            vertices.push_back(currStartVertex);
-            vertices.push_back(currEndVertex);
-            vertices.push_back(nextStartVertex);
-            vertices.push_back(nextEndVertex);
-
-            indices.push_back(startIndex);
-            indices.push_back(startIndex + 1U);
-            indices.push_back(startIndex + 2U);
-            indices.push_back(startIndex + 2U);
-            indices.push_back(startIndex + 1U);
-            indices.push_back(startIndex + 3U);
+            stats.templateMeshesReused++;
+            stats.vertices += road.meshes[i]->vertices.size();
+            stats.indices += road.meshes[i]->indices.size();
+            continue;
         }
+
+        const std::string &diffuseImagePath = FileSystem::GetCompressedTextureFile(
+            roadBaseDirectory, meshInfo.material.diffuse, compressedTexturesSupported);
+        std::shared_ptr<Material> material = LoadMaterial(diffuseImagePath);
+        if (material == nullptr)
+        {
+            return false;
+        }
+
+        std::shared_ptr<Mesh> roadMesh = std::make_shared<Mesh>();
+        roadMesh->id = templateMeshId;
+        roadMesh->material = material;
+        BuildMesh(meshInfo, info, segments, *roadMesh);
+
+        MeshOptimizationStats statsBefore = MeshOptimizer::Analyze(
+            roadMesh->vertices, roadMesh->indices, sizeof(uint32_t));
+        MeshOptimizer::Optimize(roadMesh->vertices, roadMesh->indices);
+        MeshOptimizationStats statsAfter = MeshOptimizer::Analyze(
+            roadMesh->vertices, roadMesh->indices, MeshOptimizer::GetIndexSize(roadMesh->vertices.size()));
+        MeshOptimizer::LogStats(fmt::format("{} ({})", filename, i), statsBefore, statsAfter);
+        // The culling and the texture streaming rank the road by its bounds and texel density
+        MeshLoader::ComputeBounds(*roadMesh);
+        MeshLoader::ComputeUVDensity(*roadMesh);
+
+        loadedRoadMeshes[templateMeshId] = roadMesh;
+        road.meshes[i] = roadMesh;
+        stats.templateMeshesCreated++;
+        stats.vertices += roadMesh->vertices.size();
+        stats.indices += roadMesh->indices.size();
+        stats.templateVertices += roadMesh->vertices.size();
+        stats.templateIndices += roadMesh->indices.size();
     }
 
     return true;
 }
+
+void RoadLoader::RemoveExpiredTemplates()
+{
+    for (auto loadedRoadMesh = loadedRoadMeshes.begin(); loadedRoadMesh != loadedRoadMeshes.end();)
+    {
+        loadedRoadMesh = loadedRoadMesh->second.expired()
+            ? loadedRoadMeshes.erase(loadedRoadMesh)
+            : std::next(loadedRoadMesh);
+    }
+    for (auto loadedRoadMaterial = loadedRoadMaterials.begin(); loadedRoadMaterial != loadedRoadMaterials.end();)
+    {
+        loadedRoadMaterial = loadedRoadMaterial->second.expired()
+            ? loadedRoadMaterials.erase(loadedRoadMaterial)
+            : std::next(loadedRoadMaterial);
+    }
+}
+
+uint32_t RoadLoader::GetTemplateMeshId(const std::string &filename, const RoadInfo &info, uint32_t meshIndex) const
+{
+    // Round to millimeters so that the same shape written slightly differently still matches
+    return Identifier::GenerateIdentifier(fmt::format("{}|{}|{:.3f}|{:.3f}",
+        filename, meshIndex, info.radius, info.length));
+}
+
+std::shared_ptr<Material> RoadLoader::LoadMaterial(const std::string &diffuseImagePath)
+{
+    auto loadedRoadMaterial = loadedRoadMaterials.find(diffuseImagePath);
+    if (loadedRoadMaterial != loadedRoadMaterials.end())
+    {
+        std::shared_ptr<Material> material = loadedRoadMaterial->second.lock();
+        if (material)
+        {
+            const std::shared_ptr<Image> &diffuseImage = material->diffuseImage;
+            stats.texturesReused++;
+            stats.textureBytesSaved += static_cast<uint64_t>(diffuseImage->GetWidth()) * diffuseImage->GetHeight() * 4;
+            return material;
+        }
+    }
+
+    std::shared_ptr<Image> diffuseImage = std::make_shared<Image>();
+    if (!diffuseImage->Load(diffuseImagePath, ImageColor::ColorWithAlpha))
+    {
+        Logger::Log(LogLevel::Error, "Failed to load image from {}", diffuseImagePath);
+        return nullptr;
+    }
+    stats.texturesLoaded++;
+    stats.textureBytesLoaded += static_cast<uint64_t>(diffuseImage->GetWidth()) * diffuseImage->GetHeight() * 4;
+
+    std::shared_ptr<Material> material = std::make_shared<Material>();
+    material->id = Identifier::GenerateIdentifier(diffuseImagePath);
+    material->diffuseImage = diffuseImage;
+    loadedRoadMaterials[diffuseImagePath] = material;
+    return material;
+}
+
+void RoadLoader::LoadLanes(const RoadObjectConfig &roadObjectConfig, Road &road) const
+{
+    road.lanes.clear();
+    for (const RoadLaneConfig &laneConfig : roadObjectConfig.lanes)
+    {
+        road.lanes.push_back({ laneConfig.offset, laneConfig.width, laneConfig.forward });
+    }
+
+    if (!road.lanes.empty() || roadObjectConfig.meshes.empty())
+    {
+        return;
+    }
+
+    // Older road files have no lanes, so treat the whole road surface as a single lane
+    float minX = std::numeric_limits<float>::max(),
+          maxX = std::numeric_limits<float>::lowest();
+    for (const RoadMeshInfo &meshInfo : roadObjectConfig.meshes)
+    {
+        minX = std::min({ minX, meshInfo.startPosition.x, meshInfo.endPosition.x });
+        maxX = std::max({ maxX, meshInfo.startPosition.x, meshInfo.endPosition.x });
+    }
+    road.lanes.push_back({ (minX + maxX) * 0.5f, maxX - minX, true });
+}
+
+int RoadLoader::GetSegmentCount(const RoadObjectConfig &roadObjectConfig, const RoadInfo &info) const
+{
+    const float radius = info.radius;
+    float centralAngle = radius == 0.0f ? 0.0f : std::abs(info.length / radius);
+    if (centralAngle == 0.0f)
+    {
+        return 1;
+    }
+
+    // The outermost edge has the largest chordal error for the same angle
+    float maxEdgeRadius = 0.0f;
+    for (const RoadMeshInfo &meshInfo : roadObjectConfig.meshes)
+    {
+        maxEdgeRadius = std::max(maxEdgeRadius, std::abs(radius - meshInfo.startPosition.x));
+        maxEdgeRadius = std::max(maxEdgeRadius, std::abs(radius - meshInfo.endPosition.x));
+    }
+
+    // Chordal error (sagitta) of a segment is r * (1 - cos(angle / 2))
+    float segmentRadians = maxSegmentRadians;
+    if (maxEdgeRadius > maxChordalError)
+    {
+        float chordalErrorRadians = 2.0f * glm::acos(1.0f - maxChordalError / maxEdgeRadius);
+        segmentRadians = std::min(segmentRadians, chordalErrorRadians);
+    }
+
+    // Clamped before the conversion, the angle of a tight tolerance on a large radius may round to 0
+    float segments = std::min(std::ceil(centralAngle / segmentRadians), static_cast<float>(MAX_SEGMENTS));
+    return std::max(static_cast<int>(segments), 1);
+}
+
+void RoadLoader::BuildMesh(const RoadMeshInfo &meshInfo, const RoadInfo &info, int segments, Mesh &roadMesh) const
+{
+    const float radius = info.radius;
+    const float length = info.length;
+
+    float radiansPerSegment = radius == 0.0f ? 0.0f : (length / radius) / segments;
+    float metersPerSegment = length / segments;
+
+    std::vector<Vertex> &vertices = roadMesh.vertices;
+    std::vector<uint32_t> &indices = roadMesh.indices;
+
+    float startX = meshInfo.startPosition.x,
+          startZ = meshInfo.startPosition.y;
+    float startU = meshInfo.startTextureCoord.x,
+          startV = meshInfo.startTextureCoord.y;
+    float endX = meshInfo.endPosition.x,
+          endZ = meshInfo.endPosition.y;
+    float endU = meshInfo.endTextureCoord.x,
+          endV = meshInfo.endTextureCoord.y;
+    for (int i = 0; i < segments; i++)
+    {
+        float currAngle = i * radiansPerSegment;
+        float nextAngle = (i + 1) * radiansPerSegment;
+
+        float cosCurrAngle = glm::cos(currAngle),
+              sinCurrAngle = glm::sin(currAngle);
+        float cosNextAngle = glm::cos(nextAngle),
+              sinNextAngle = glm::sin(nextAngle);
+
+        float textureSegmentsStart = i * metersPerSegment * TEXTURE_SEGMENTS_PER_METER;
+        float textureSegmentsEnd = (i + 1) * metersPerSegment * TEXTURE_SEGMENTS_PER_METER;
+        float startTextureCoordV = textureSegmentsStart * startV * TEXTURE_VERTICAL_INCREMENT_PER_METER;
+        float endTextureCoordV = textureSegmentsEnd * endV * TEXTURE_VERTICAL_INCREMENT_PER_METER;
+
+        // If the road is straight, then just use the length, since this loop will only be iterated once
+        if (radius == 0.0f)
+        {
+            endTextureCoordV = endV * length * TEXTURE_VERTICAL_INCREMENT_PER_METER;
+        }
+
+        // Use the height for the normals for now
+        glm::vec3 currNormal = glm::normalize(glm::vec3{ startZ, startZ, 2.0f });
+        glm::vec3 nextNormal = glm::normalize(glm::vec3{ endZ, endZ, 2.0f });
+
+        // Calculate the radius, and clamp to zero
+        float startRadius = std::max(0.0f, radius - startX);
+        float endRadius = std::max(0.0f, radius - endX);
+
+        Vertex currStartVertex{};
+        currStartVertex.position =
+        {
+            radius - startRadius * cosCurrAngle,
+            startRadius * sinCurrAngle,
+            startZ
+        };
+        currStartVertex.normal = currNormal;
+        currStartVertex.uv = { startU, startTextureCoordV };
+
+        Vertex currEndVertex{};
+        currEndVertex.position =
+        {
+            radius - endRadius * cosCurrAngle,
+            endRadius * sinCurrAngle,
+            startZ
+        };
+        currEndVertex.normal = currNormal;
+        currEndVertex.uv = { endU, startTextureCoordV };
+
+        Vertex nextStartVertex{};
+        nextStartVertex.position =
+        {
+            radius - startRadius * cosNextAngle,
+            startRadius * sinNextAngle,
+            endZ
+        };
+        nextStartVertex.normal = nextNormal;
+        nextStartVertex.uv = { startU, endTextureCoordV };
+
+        Vertex nextEndVertex{};
+        nextEndVertex.position =
+        {
+            radius - endRadius * cosNextAngle,
+            endRadius * sinNextAngle,
+            endZ
+        };
+        nextEndVertex.normal = nextNormal;
+        nextEndVertex.uv = { endU, endTextureCoordV };
+
+        if (radius == 0.0f)
+        {
+            currStartVertex.position.x = startX;
+            currEndVertex.position.x = endX;
+
+            nextEndVertex.position.x = endX;
+            nextEndVertex.position.y = length;
+
+            nextStartVertex.position.x = startX;
+            nextStartVertex.position.y = length;
+        }
+
+        uint32_t startIndex = static_cast<uint32_t>(vertices.size());
+        vertices.push_back(currStartVertex);
+        vertices.push_back(currEndVertex);
+        vertices.push_back(nextStartVertex);
+        vertices.push_back(nextEndVertex);
+
+        indices.push_back(startIndex);
+        indices.push_back(startIndex + 1U);
+        indices.push_back(startIndex + 2U);
+        indices.push_back(startIndex + 2U);
+        indices.push_back(startIndex + 1U);
+        indices.push_back(startIndex + 3U);
+    }
+}
@@ -6,6 +6,8 @@
 
 #include "Engine/Mesh.h"
 
+struct Material;
+struct RoadMeshInfo;
 struct RoadObjectConfig;
 class Image;
 
@@ -21,17 +23,45 @@ struct RoadInfo
     float rotationZ;
 };
 
+struct RoadLaneInfo
+{
+    float offset;
+    float width;
+    bool forward;
+};
+
 struct Road
 {
     uint32_t id;
     RoadInfo info;
-    std::vector<Mesh> meshes;
+    std::vector<RoadLaneInfo> lanes;
+    // Meshes are in road local space and shared between roads with identical geometry,
+    // the road transformation is applied per instance
+    std::vector<std::shared_ptr<Mesh>> meshes;
+};
+
+struct RoadLoadStats
+{
+    uint32_t roadMeshes;
+    uint32_t templateMeshesCreated;
+    uint32_t templateMeshesReused;
+    uint32_t texturesLoaded;
+    uint32_t texturesReused;
+    uint64_t textureBytesLoaded;
+    uint64_t textureBytesSaved;
+    // Vertex/index counts of all road meshes including shared ones,
+    // which are the same for the collision meshes
+    uint64_t vertices;
+    uint64_t indices;
+    // Vertex/index counts of the template meshes generated, what the render meshes take without the shared ones
+    uint64_t templateVertices;
+    uint64_t templateIndices;
 };
 
 class RoadLoader
 {
 public:
-    RoadLoader();
+    RoadLoader(float maxSegmentAngle, float maxChordalError);
     ~RoadLoader();
 
     bool LoadFromFile(
@@ -39,9 +69,38 @@ public:
         const RoadInfo &info,
         Road &road);
 
+    RoadLoadStats GetStats() const { return stats; }
+    void ResetStats() { stats = {}; }
+    // Drops the cached templates no loaded road uses anymore
+    void RemoveExpiredTemplates();
+    // The DDS textures are only loaded when the device can sample them
+    void SetCompressedTexturesSupported(bool supported) { compressedTexturesSupported = supported; }
+
 private:
-    static constexpr float SEGMENTS_PER_METER = 2.0f;
+    // Template mesh identifier, roads of the same file and geometry share the same mesh
+    uint32_t GetTemplateMeshId(const std::string &filename, const RoadInfo &info, uint32_t meshIndex) const;
+    std::shared_ptr<Material> LoadMaterial(const std::string &diffuseImagePath);
+    void LoadLanes(const RoadObjectConfig &roadObjectConfig, Road &road) const;
+    int GetSegmentCount(const RoadObjectConfig &roadObjectConfig, const RoadInfo &info) const;
+    void BuildMesh(const RoadMeshInfo &meshInfo, const RoadInfo &info, int segments, Mesh &roadMesh) const;
+
+    // Curves used to be textured per half meter segment, keep the same texture density
+    static constexpr float TEXTURE_SEGMENTS_PER_METER = 2.0f;
     static constexpr float TEXTURE_VERTICAL_INCREMENT_PER_METER = 0.1f;
+    static constexpr int MAX_SEGMENTS = 1024;
+    // Lower limits of the tolerances from the settings
+    static constexpr float MIN_SEGMENT_ANGLE = 0.1f;
+    static constexpr float MIN_CHORDAL_ERROR = 0.001f;
+
+    float maxSegmentRadians;
+    float maxChordalError;
+    bool compressedTexturesSupported;
+
+    RoadLoadStats stats;
 
     std::unordered_map<std::string, std::unique_ptr<RoadObjectConfig>> loadedRoadConfigs;
+    // Only shared while the roads of the loaded blocks use them, so that the meshes and images of the unloaded
+    // blocks are released
+    std::unordered_map<std::string, std::weak_ptr<Material>> loadedRoadMaterials;
+    std::unordered_map<uint32_t, std::weak_ptr<Mesh>> loadedRoadMeshes;
 };
@@ -0,0 +1,445 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <unordered_set>
+
+#define GLM_FORCE_RADIANS
+#include <glm/glm.hpp>
+
+#include "RoadNetwork.h"
+
+RoadNetwork::RoadNetwork()
+    : nextSegmentId(1)
+{
+}
+
+RoadNetwork::~RoadNetwork()
+{
+}
+
+uint32_t RoadNetwork::AddRoad(uint32_t blockId, const Road &road)
+{
+    std::lock_guard<std::mutex> lock(networkMutex);
+
+    RoadSegment segment{};
+    segment.id = nextSegmentId++;
+    segment.blockId = blockId;
+    segment.info = road.info;
+    segment.lanes = road.lanes;
+
+    const RoadInfo &info = segment.info;
+    const float length = info.length;
+    glm::vec2 origin = { info.position.x, info.position.y };
+    segment.startPoint = ToWorld(info, GetLocalPoint(info, 0.0f, 0.0f));
+    segment.endPoint = ToWorld(info, GetLocalPoint(info, 0.0f, length));
+    segment.startDirection = ToWorld(info, GetLocalDirection(info, 0.0f)) - origin;
+    segment.endDirection = ToWorld(info, GetLocalDirection(info, length)) - origin;
+
+    // Register the segment in every grid cell its surface may touch,
+    // the padding covers the bulge of curves between two samples
+    float minOffset = 0.0f, maxOffset = 0.0f;
+    for (const RoadLaneInfo &lane : segment.lanes)
+    {
+        minOffset = std::min(minOffset, lane.offset - lane.width * 0.5f);
+        maxOffset = std::max(maxOffset, lane.offset + lane.width * 0.5f);
+    }
+    glm::vec2 minBound(std::numeric_limits<float>::max());
+    glm::vec2 maxBound(std::numeric_limits<float>::lowest());
+    for (int i = 0; i <= BOUNDS_SAMPLES; i++)
+    {
+        float distanceAlong = length * i / BOUNDS_SAMPLES;
+        for (float offset : { minOffset, maxOffset })
+        {
+            glm::vec2 point = ToWorld(info, GetLocalPoint(info, offset, distanceAlong));
+            minBound = glm::min(minBound, point);
+            maxBound = glm::max(maxBound, point);
+        }
+    }
+    float padding = std::abs(length) / BOUNDS_SAMPLES + CONNECTION_TOLERANCE;
+    minBound -= padding;
+    maxBound += padding;
+
+    int minCellX = static_cast<int>(std::floor(minBound.x / GRID_CELL_SIZE)),
+        minCellY = static_cast<int>(std::floor(minBound.y / GRID_CELL_SIZE));
+    int maxCellX = static_cast<int>(std::floor(maxBound.x / GRID_CELL_SIZE)),
+        maxCellY = static_cast<int>(std::floor(maxBound.y / GRID_CELL_SIZE));
+    std::vector<int64_t> &cells = segmentCells[segment.id];
+    for (int x = minCellX; x <= maxCellX; x++)
+    {
+        for (int y = minCellY; y <= maxCellY; y++)
+        {
+            int64_t cellKey = GetCellKey(x, y);
+            gridCells[cellKey].push_back(segment.id);
+            cells.push_back(cellKey);
+        }
+    }
+
+    ConnectSegment(segment);
+
+    uint32_t segmentId = segment.id;
+    segments[segmentId] = std::move(segment);
+    blockSegmentIds[blockId].push_back(segmentId);
+    return segmentId;
+}
+
+void RoadNetwork::RemoveBlock(uint32_t blockId)
+{
+    std::lock_guard<std::mutex> lock(networkMutex);
+    if (blockSegmentIds.count(blockId) == 0)
+    {
+        return;
+    }
+
+    for (uint32_t segmentId : blockSegmentIds[blockId])
+    {
+        for (int64_t cellKey : segmentCells[segmentId])
+        {
+            std::vector<uint32_t> &cellSegmentIds = gridCells[cellKey];
+            cellSegmentIds.erase(
+                std::remove(cellSegmentIds.begin(), cellSegmentIds.end(), segmentId),
+                cellSegmentIds.end());
+            if (cellSegmentIds.empty())
+            {
+                gridCells.erase(cellKey);
+            }
+        }
+        segmentCells.erase(segmentId);
+
+        // Connections to roads in the neighbouring blocks are removed as well,
+        // and will be restored once the block is loaded again
+        for (uint32_t connectedSegmentId : segments[segmentId].connectedSegmentIds)
+        {
+            if (segments.count(connectedSegmentId) > 0)
+            {
+                std::vector<uint32_t> &connectedIds = segments[connectedSegmentId].connectedSegmentIds;
+                connectedIds.erase(
+                    std::remove(connectedIds.begin(), connectedIds.end(), segmentId),
+                    connectedIds.end());
+            }
+        }
+        segments.erase(segmentId);
+    }
+    blockSegmentIds.erase(blockId);
+}
+
+bool RoadNetwork::FindNearestLane(const glm::vec3 &position, float maxDistance, RoadLaneQueryResult &result)
+{
+    std::lock_guard<std::mutex> lock(networkMutex);
+    return FindNearestLaneLocked(position, maxDistance, result);
+}
+
+bool RoadNetwork::GetDistanceAlongLane(uint32_t segmentId, uint32_t laneIndex, const glm::vec3 &position, float &distance)
+{
+    std::lock_guard<std::mutex> lock(networkMutex);
+    if (segments.count(segmentId) == 0 || laneIndex >= segments[segmentId].lanes.size())
+    {
+        return false;
+    }
+
+    const RoadSegment &segment = segments[segmentId];
+    const RoadLaneInfo &lane = segment.lanes[laneIndex];
+    SegmentProjection projection = Project(segment.info, { position.x, position.y });
+    float laneLength = GetLaneLength(segment.info, lane.offset);
+    float laneDistance = segment.info.length != 0.0f
+        ? projection.distanceAlong / segment.info.length * laneLength
+        : 0.0f;
+    distance = lane.forward ? laneDistance : laneLength - laneDistance;
+    return true;
+}
+
+bool RoadNetwork::FindPath(const glm::vec3 &from, const glm::vec3 &to, std::vector<uint32_t> &segmentIds)
+{
+    static constexpr float PATH_SEARCH_DISTANCE = 50.0f;
+
+    std::lock_guard<std::mutex> lock(networkMutex);
+    segmentIds.clear();
+
+    RoadLaneQueryResult fromLane{}, toLane{};
+    if (!FindNearestLaneLocked(from, PATH_SEARCH_DISTANCE, fromLane)
+        || !FindNearestLaneLocked(to, PATH_SEARCH_DISTANCE, toLane))
+    {
+        return false;
+    }
+
+    uint32_t startId = fromLane.segmentId,
+             targetId = toLane.segmentId;
+    glm::vec2 target = { to.x, to.y };
+    float targetLength = std::abs(segments[targetId].info.length);
+
+    // A* over the segments, with the segment length as the cost of entering it
+    // and the distance from the closer end of a segment to the target as the heuristic
+    auto heuristic = [&](const RoadSegment &segment)
+    {
+        float endDistance = std::min(
+            glm::distance(segment.startPoint, target),
+            glm::distance(segment.endPoint, target));
+        return std::max(0.0f, endDistance - targetLength);
+    };
+
+    using QueueItem = std::pair<float, uint32_t>;
+    std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>> openQueue;
+    std::unordered_map<uint32_t, float> costs;
+    std::unordered_map<uint32_t, uint32_t> previousIds;
+    std::unordered_set<uint32_t> closedIds;
+
+    costs[startId] = 0.0f;
+    openQueue.push({ heuristic(segments[startId]), startId });
+    while (!openQueue.empty())
+    {
+        uint32_t currentId = openQueue.top().second;
+        openQueue.pop();
+        if (currentId == targetId)
+        {
+            break;
+        }
+        if (!closedIds.insert(currentId).second)
+        {
+            continue;
+        }
+
+        for (uint32_t nextId : segments[currentId].connectedSegmentIds)
+        {
+            const RoadSegment &nextSegment = segments[nextId];
+            float cost = costs[currentId] + std::abs(nextSegment.info.length);
+            if (costs.count(nextId) == 0 || cost < costs[nextId])
+            {
+                costs[nextId] = cost;
+                previousIds[nextId] = currentId;
+                openQueue.push({ cost + heuristic(nextSegment), nextId });
+            }
+        }
+    }
+
+    if (startId != targetId && previousIds.count(targetId) == 0)
+    {
+        return false;
+    }
+
+    for (uint32_t currentId = targetId; currentId != startId; currentId = previousIds[currentId])
+    {
+        segmentIds.push_back(currentId);
+    }
+    segmentIds.push_back(startId);
+    std::reverse(segmentIds.begin(), segmentIds.end());
+    return true;
+}
+
+std::vector<uint32_t> RoadNetwork::GetConnectedSegments(uint32_t segmentId)
+{
+    std::lock_guard<std::mutex> lock(networkMutex);
+    if (segments.count(segmentId) == 0)
+    {
+        return {};
+    }
+    return segments[segmentId].connectedSegmentIds;
+}
+
+size_t RoadNetwork::GetSegmentCount()
+{
+    std::lock_guard<std::mutex> lock(networkMutex);
+    return segments.size();
+}
+
+int64_t RoadNetwork::GetCellKey(int x, int y)
+{
+    return (static_cast<int64_t>(x) << 32) ^ static_cast<uint32_t>(y);
+}
+
+glm::vec2 RoadNetwork::ToLocal(const RoadInfo &info, const glm::vec2 &position)
+{
+    // Inverse of the rotation applied to the road collision meshes
+    float rotationRadians = glm::radians<float>(info.rotationZ);
+    float cosRotation = glm::cos(rotationRadians),
+          sinRotation = glm::sin(rotationRadians);
+    glm::vec2 offset = position - glm::vec2(info.position.x, info.position.y);
+    return
+    {
+        offset.x * cosRotation - offset.y * sinRotation,
+        offset.x * sinRotation + offset.y * cosRotation
+    };
+}
+
+glm::vec2 RoadNetwork::ToWorld(const RoadInfo &info, const glm::vec2 &local)
+{
+    float rotationRadians = glm::radians<float>(info.rotationZ);
+    float cosRotation = glm::cos(-rotationRadians),
+          sinRotation = glm::sin(-rotationRadians);
+    return glm::vec2
+    {
+        local.x * cosRotation - local.y * sinRotation,
+        local.x * sinRotation + local.y * cosRotation
+    } + glm::vec2(info.position.x, info.position.y);
+}
+
+glm::vec2 RoadNetwork::GetLocalPoint(const RoadInfo &info, float lateralOffset, float distanceAlong)
+{
+    // Same parametrization as the road geometry, the curve center is at (radius, 0)
+    const float radius = info.radius;
+    if (radius == 0.0f)
+    {
+        return { lateralOffset, distanceAlong };
+    }
+
+    float angle = distanceAlong / radius;
+    float offsetRadius = radius - lateralOffset;
+    return { radius - offsetRadius * glm::cos(angle), offsetRadius * glm::sin(angle) };
+}
+
+glm::vec2 RoadNetwork::GetLocalDirection(const RoadInfo &info, float distanceAlong)
+{
+    if (info.radius == 0.0f)
+    {
+        return { 0.0f, 1.0f };
+    }
+
+    float angle = distanceAlong / info.radius;
+    return { glm::sin(angle), glm::cos(angle) };
+}
+
+float RoadNetwork::GetLaneLength(const RoadInfo &info, float laneOffset)
+{
+    if (info.radius == 0.0f)
+    {
+        return info.length;
+    }
+    return std::abs(info.length * (info.radius - laneOffset) / info.radius);
+}
+
+RoadNetwork::SegmentProjection RoadNetwork::Project(const RoadInfo &info, const glm::vec2 &position)
+{
+    const float radius = info.radius;
+    const float length = info.length;
+    glm::vec2 local = ToLocal(info, position);
+
+    SegmentProjection projection{};
+    float distanceAlong;
+    if (radius == 0.0f)
+    {
+        distanceAlong = local.y;
+        projection.lateralOffset = local.x;
+    }
+    else
+    {
+        // Curves are assumed to be shorter than half a circle
+        float radiusSign = radius > 0.0f ? 1.0f : -1.0f;
+        glm::vec2 fromCenter = local - glm::vec2(radius, 0.0f);
+        float angle = std::atan2(radiusSign * fromCenter.y, -radiusSign * fromCenter.x);
+        distanceAlong = angle * radius;
+        projection.lateralOffset = radius - radiusSign * glm::length(fromCenter);
+    }
+
+    projection.outsideDistance = std::max(0.0f, -distanceAlong) + std::max(0.0f, distanceAlong - length);
+    projection.distanceAlong = std::clamp(distanceAlong, 0.0f, std::max(0.0f, length));
+    return projection;
+}
+
+void RoadNetwork::ConnectSegment(RoadSegment &segment)
+{
+    std::vector<uint32_t> candidates;
+    GetCandidateSegments(segment.startPoint, CONNECTION_TOLERANCE, candidates);
+    GetCandidateSegments(segment.endPoint, CONNECTION_TOLERANCE, candidates);
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    auto isConnected = [](
+        const glm::vec2 &pointA, const glm::vec2 &directionA,
+        const glm::vec2 &pointB, const glm::vec2 &directionB,
+        float directionSign)
+    {
+        return glm::distance(pointA, pointB) <= CONNECTION_TOLERANCE
+            && directionSign * glm::dot(directionA, directionB) >= CONNECTION_MIN_DIRECTION_COSINE;
+    };
+
+    for (uint32_t candidateId : candidates)
+    {
+        // The segment itself is already registered in the grid
+        if (candidateId == segment.id)
+        {
+            continue;
+        }
+
+        RoadSegment &other = segments[candidateId];
+        // Roads may be laid in either direction, so connect end to start, as well as
+        // start to start and end to end when they are facing each other
+        if (isConnected(segment.endPoint, segment.endDirection, other.startPoint, other.startDirection, 1.0f)
+            || isConnected(segment.startPoint, segment.startDirection, other.endPoint, other.endDirection, 1.0f)
+            || isConnected(segment.startPoint, segment.startDirection, other.startPoint, other.startDirection, -1.0f)
+            || isConnected(segment.endPoint, segment.endDirection, other.endPoint, other.endDirection, -1.0f))
+        {
+            segment.connectedSegmentIds.push_back(candidateId);
+            other.connectedSegmentIds.push_back(segment.id);
+        }
+    }
+}
+
+void RoadNetwork::GetCandidateSegments(const glm::vec2 &position, float radius, std::vector<uint32_t> &candidates) const
+{
+    int minCellX = static_cast<int>(std::floor((position.x - radius) / GRID_CELL_SIZE)),
+        minCellY = static_cast<int>(std::floor((position.y - radius) / GRID_CELL_SIZE));
+    int maxCellX = static_cast<int>(std::floor((position.x + radius) / GRID_CELL_SIZE)),
+        maxCellY = static_cast<int>(std::floor((position.y + radius) / GRID_CELL_SIZE));
+    for (int x = minCellX; x <= maxCellX; x++)
+    {
+        for (int y = minCellY; y <= maxCellY; y++)
+        {
+            auto cell = gridCells.find(GetCellKey(x, y));
+            if (cell != gridCells.end())
+            {
+                candidates.insert(candidates.end(), cell->second.begin(), cell->second.end());
+            }
+        }
+    }
+}
+
+bool RoadNetwork::FindNearestLaneLocked(const glm::vec3 &position, float maxDistance, RoadLaneQueryResult &result) const
+{
+    glm::vec2 planarPosition = { position.x, position.y };
+    std::vector<uint32_t> candidates;
+    GetCandidateSegments(planarPosition, maxDistance, candidates);
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    bool found = false;
+    float nearestDistance = maxDistance;
+    for (uint32_t candidateId : candidates)
+    {
+        const RoadSegment &segment = segments.at(candidateId);
+        SegmentProjection projection = Project(segment.info, planarPosition);
+        for (uint32_t i = 0; i < segment.lanes.size(); i++)
+        {
+            const RoadLaneInfo &lane = segment.lanes[i];
+            float lateralDistance = projection.lateralOffset - lane.offset;
+            float distance = std::sqrt(
+                lateralDistance * lateralDistance + projection.outsideDistance * projection.outsideDistance);
+            if (distance > nearestDistance)
+            {
+                continue;
+            }
+
+            float laneLength = GetLaneLength(segment.info, lane.offset);
+            float laneDistance = segment.info.length != 0.0f
+                ? projection.distanceAlong / segment.info.length * laneLength
+                : 0.0f;
+
+            glm::vec2 origin = { segment.info.position.x, segment.info.position.y };
+            glm::vec2 point = ToWorld(segment.info, GetLocalPoint(segment.info, lane.offset, projection.distanceAlong));
+            glm::vec2 direction = ToWorld(segment.info, GetLocalDirection(segment.info, projection.distanceAlong)) - origin;
+            if (!lane.forward)
+            {
+                direction = -direction;
+            }
+
+            nearestDistance = distance;
+            result.segmentId = segment.id;
+            result.laneIndex = i;
+            result.distance = distance;
+            result.laneLength = laneLength;
+            result.distanceAlongLane = lane.forward ? laneDistance : laneLength - laneDistance;
+            result.point = { point.x, point.y, segment.info.position.z };
+            result.direction = { direction.x, direction.y, 0.0f };
+            found = true;
+        }
+    }
+    return found;
+}
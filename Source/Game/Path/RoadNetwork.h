@@ -0,0 +1,97 @@
+#pragma once
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Road.h"
+
+// A road piece placed in the map, the curve parameters are the same as the ones
+// used to generate the road geometry (see RoadLoader)
+struct RoadSegment
+{
+    uint32_t id;
+    uint32_t blockId;
+    RoadInfo info;
+    std::vector<RoadLaneInfo> lanes;
+
+    glm::vec2 startPoint;
+    glm::vec2 endPoint;
+    glm::vec2 startDirection;
+    glm::vec2 endDirection;
+
+    // Segments sharing an end point with this segment, in either direction
+    std::vector<uint32_t> connectedSegmentIds;
+};
+
+struct RoadLaneQueryResult
+{
+    uint32_t segmentId;
+    uint32_t laneIndex;
+    // Planar distance from the query position to the lane center line
+    float distance;
+    // Distance from the lane start in the driving direction of the lane
+    float distanceAlongLane;
+    float laneLength;
+    glm::vec3 point;
+    glm::vec3 direction;
+};
+
+// Road graph of all loaded blocks, built while the blocks are loaded and queried from the game thread
+// All positions are in map coordinates, the same as the road collision meshes
+class RoadNetwork
+{
+public:
+    RoadNetwork();
+    ~RoadNetwork();
+
+    uint32_t AddRoad(uint32_t blockId, const Road &road);
+    void RemoveBlock(uint32_t blockId);
+
+    bool FindNearestLane(const glm::vec3 &position, float maxDistance, RoadLaneQueryResult &result);
+    bool GetDistanceAlongLane(uint32_t segmentId, uint32_t laneIndex, const glm::vec3 &position, float &distance);
+    bool FindPath(const glm::vec3 &from, const glm::vec3 &to, std::vector<uint32_t> &segmentIds);
+    std::vector<uint32_t> GetConnectedSegments(uint32_t segmentId);
+    size_t GetSegmentCount();
+
+private:
+    // Cell size of the spatial grid in meters
+    static constexpr float GRID_CELL_SIZE = 50.0f;
+    // Maximum gap between two road ends to be treated as connected
+    static constexpr float CONNECTION_TOLERANCE = 0.5f;
+    // Minimum cosine between two road directions to be treated as connected
+    static constexpr float CONNECTION_MIN_DIRECTION_COSINE = 0.95f;
+    static constexpr int BOUNDS_SAMPLES = 8;
+
+    struct SegmentProjection
+    {
+        // Distance along the reference line from the segment start, clamped to the segment
+        float distanceAlong;
+        // Signed offset from the reference line, in the same unit as the lane offsets
+        float lateralOffset;
+        // Distance past either end of the segment, zero if within
+        float outsideDistance;
+    };
+
+    static int64_t GetCellKey(int x, int y);
+    static glm::vec2 ToLocal(const RoadInfo &info, const glm::vec2 &position);
+    static glm::vec2 ToWorld(const RoadInfo &info, const glm::vec2 &local);
+    static glm::vec2 GetLocalPoint(const RoadInfo &info, float lateralOffset, float distanceAlong);
+    static glm::vec2 GetLocalDirection(const RoadInfo &info, float distanceAlong);
+    static float GetLaneLength(const RoadInfo &info, float laneOffset);
+    static SegmentProjection Project(const RoadInfo &info, const glm::vec2 &position);
+
+    void ConnectSegment(RoadSegment &segment);
+    void GetCandidateSegments(const glm::vec2 &position, float radius, std::vector<uint32_t> &candidates) const;
+    bool FindNearestLaneLocked(const glm::vec3 &position, float maxDistance, RoadLaneQueryResult &result) const;
+
+    uint32_t nextSegmentId;
+    std::mutex networkMutex;
+
+    std::unordered_map<uint32_t, RoadSegment> segments;
+    std::unordered_map<uint32_t, std::vector<uint32_t>> blockSegmentIds;
+    std::unordered_map<int64_t, std::vector<uint32_t>> gridCells;
+    std::unordered_map<uint32_t, std::vector<int64_t>> segmentCells;
+};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <vector>
 
 #define GLM_FORCE_RADIANS
@@ -8,7 +9,7 @@
 class btCollisionShape;
 class btMotionState;
 class btRigidBody;
-class btTriangleMesh;
+class btTriangleIndexVertexArray;
 class btVector3;
 
 struct CollisionMesh
@@ -17,11 +18,12 @@ struct CollisionMesh
     std::vector<uint32_t> indices;
 };
 
+// Static collision body, the mesh references the vertices and indices stored in here
 struct CollisionBody
 {
     std::vector<float> vertices;
     std::vector<int> indices;
-    std::unique_ptr<btTriangleMesh> mesh;
+    std::unique_ptr<btTriangleIndexVertexArray> mesh;
     std::unique_ptr<btCollisionShape> shape;
     std::unique_ptr<btMotionState> motionState;
     std::unique_ptr<btRigidBody> body;
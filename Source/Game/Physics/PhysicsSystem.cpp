@@ -1,5 +1,4 @@
-#include <execution>
-#include <mutex>
+#include <chrono>
 #include <btBulletDynamicsCommon.h>
 
 #include "Common/Logger.h"
@@ -7,7 +6,7 @@
 #include "PhysicsSystem.h"
 
 static constexpr int VERTEX_STRIDE = 3 * sizeof(btScalar);
-static constexpr int INDEX_STRIDE = 3 * sizeof(uint32_t);
+static constexpr int INDEX_STRIDE = 3 * sizeof(int);
 
 PhysicsSystem::PhysicsSystem()
 {
@@ -42,61 +41,59 @@ PhysicsSystem::~PhysicsSystem()
     groundCollisionSurfaces.clear();
 }
 
-void PhysicsSystem::AddSurface(uint32_t blockId, const std::vector<CollisionMesh> &collisionMeshes)
+void PhysicsSystem::AddSurface(uint32_t blockId, const std::vector<std::shared_ptr<CollisionBody>> &collisionBodies)
 {
     // Adds surfaces to the physics system that are static
-    Logger::Log(LogLevel::Info, "Loading {} collision surfaces into physics for map block ID {}",
-        collisionMeshes.size(), blockId);
-    
-    std::vector<bool> results;
-    std::mutex updateMutex;
-    std::for_each(
-        std::execution::par_unseq,
-        collisionMeshes.begin(),
-        collisionMeshes.end(),
-        [&](const auto &collisionMesh)
-        {
-            std::unique_ptr<CollisionBody> collisionBody = std::make_unique<CollisionBody>();
-            std::unique_ptr<btTriangleMesh> triangleMesh = std::make_unique<btTriangleMesh>();
-
-            const std::vector<glm::vec3> &vertices = collisionMesh.vertices;
-            const std::vector<uint32_t> &indices = collisionMesh.indices;
-            for (size_t i = 0; i < indices.size(); i += 3)
-            {
-                const glm::vec3 &p1 = vertices[indices[i]];
-                const glm::vec3 &p2 = vertices[indices[i + 1]];
-                const glm::vec3 &p3 = vertices[indices[i + 2]];
-
-                triangleMesh->addTriangle(
-                    btVector3(p1.x, p1.y, p1.z),
-                    btVector3(p2.x, p2.y, p2.z),
-                    btVector3(p3.x, p3.y, p3.z));
-            }
-
-            collisionBody->mesh = std::move(triangleMesh);
-            std::unique_ptr<btCollisionShape> collisionShape = std::make_unique<btBvhTriangleMeshShape>(
-                collisionBody->mesh.get(), true);
-            collisionBody->shape = std::move(collisionShape);
-
-            std::unique_ptr<btMotionState> collisionMotionState = std::make_unique<btDefaultMotionState>();
-            collisionBody->motionState = std::move(collisionMotionState);
-
-            // Mass of zero means the body will never move regardless of the momentum
-            btRigidBody::btRigidBodyConstructionInfo collisionShapeInfo(
-                0, collisionBody->motionState.get(), collisionBody->shape.get());
-            std::unique_ptr<btRigidBody> collisionSurface = std::make_unique<btRigidBody>(collisionShapeInfo);
-            collisionBody->body = std::move(collisionSurface);
-
-            updateMutex.lock();
-            groundCollisionSurfaces[blockId].push_back(std::move(collisionBody));
-            world->addRigidBody(groundCollisionSurfaces[blockId].back()->body.get());
-            updateMutex.unlock();
-
-            return true;
-        }
-    );
+    // The bodies are already built by the map loader, so only the broadphase insertion is done here
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (const std::shared_ptr<CollisionBody> &collisionBody : collisionBodies)
+    {
+        groundCollisionSurfaces[blockId].push_back(collisionBody);
+        world->addRigidBody(collisionBody->body.get());
+    }
 
     RedrawDebuggingWorld();
+
+    float addTimeMs = std::chrono::duration<float, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    Logger::Log(LogLevel::Info,
+        "Loaded {} collision surfaces into physics for map block ID {} in {:.3f} ms, "
+        "{} collision objects and {} broadphase pairs in the world",
+        collisionBodies.size(), blockId, addTimeMs,
+        world->getNumCollisionObjects(),
+        broadPhaseInterface->getOverlappingPairCache()->getNumOverlappingPairs());
+}
+
+std::shared_ptr<CollisionBody> PhysicsSystem::CreateStaticBody(const CollisionMesh &collisionMesh)
+{
+    std::shared_ptr<CollisionBody> collisionBody = std::make_shared<CollisionBody>();
+
+    // Share the vertices between triangles instead of adding each triangle separately
+    collisionBody->vertices.reserve(collisionMesh.vertices.size() * 3);
+    for (const glm::vec3 &vertex : collisionMesh.vertices)
+    {
+        collisionBody->vertices.push_back(vertex.x);
+        collisionBody->vertices.push_back(vertex.y);
+        collisionBody->vertices.push_back(vertex.z);
+    }
+    collisionBody->indices.assign(collisionMesh.indices.begin(), collisionMesh.indices.end());
+
+    collisionBody->mesh = std::make_unique<btTriangleIndexVertexArray>(
+        static_cast<int>(collisionBody->indices.size() / 3),
+        collisionBody->indices.data(),
+        INDEX_STRIDE,
+        static_cast<int>(collisionMesh.vertices.size()),
+        collisionBody->vertices.data(),
+        VERTEX_STRIDE);
+    collisionBody->shape = std::make_unique<btBvhTriangleMeshShape>(collisionBody->mesh.get(), true);
+    collisionBody->motionState = std::make_unique<btDefaultMotionState>();
+
+    // Mass of zero means the body will never move regardless of the momentum
+    btRigidBody::btRigidBodyConstructionInfo collisionShapeInfo(
+        0, collisionBody->motionState.get(), collisionBody->shape.get());
+    collisionBody->body = std::make_unique<btRigidBody>(collisionShapeInfo);
+
+    return collisionBody;
 }
 
 DebugSegments PhysicsSystem::GetDebugDrawing() const
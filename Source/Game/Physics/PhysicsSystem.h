@@ -28,7 +28,7 @@ public:
     btDynamicsWorld *GetDynamicsWorld() const { return world.get(); }
     btIDebugDraw *GetDebugDrawer() const { return debugDrawer.get(); }
 
-    void AddSurface(uint32_t blockId, const std::vector<CollisionMesh> &collisionMeshes);
+    void AddSurface(uint32_t blockId, const std::vector<std::shared_ptr<CollisionBody>> &collisionBodies);
     void RemoveSurface(uint32_t blockId);
 
     bool IsDebugDrawingEnabled() const { return enableDebugDrawing; }
@@ -38,6 +38,10 @@ public:
 
     void StepSimulation(float deltaTime);
 
+    // Builds the triangle mesh and its BVH, which is the expensive part of adding a surface
+    // Can be called from any thread since the body is not added to the world yet
+    static std::shared_ptr<CollisionBody> CreateStaticBody(const CollisionMesh &collisionMesh);
+
 private:
     static constexpr float GRAVITY = -9.81f;
 
@@ -55,5 +59,5 @@ private:
     std::unique_ptr<btIDebugDraw> debugDrawer;
 
     // Map block ID to collision surfaces (ex. terrain, road, etc.)
-    std::unordered_map<uint32_t, std::vector<std::unique_ptr<CollisionBody>>> groundCollisionSurfaces;
+    std::unordered_map<uint32_t, std::vector<std::shared_ptr<CollisionBody>>> groundCollisionSurfaces;
 };
@@ -0,0 +1,56 @@
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "Engine/OcclusionCuller.h"
+#include "TestCheck.h"
+
+// Wall of 20 x 10 units facing the camera, 30 units in front of it
+static std::shared_ptr<OccluderMesh> CreateWall()
+{
+    std::shared_ptr<OccluderMesh> wall = std::make_shared<OccluderMesh>();
+    wall->positions =
+    {
+        { -10.0f, 0.0f, -30.0f },
+        { 10.0f, 0.0f, -30.0f },
+        { 10.0f, 10.0f, -30.0f },
+        { -10.0f, 10.0f, -30.0f }
+    };
+    wall->indices = { 0, 1, 2, 0, 2, 3 };
+    return wall;
+}
+
+int main()
+{
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 2.0f, 0.1f, 1000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 5.0f, 0.0f), glm::vec3(0.0f, 5.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+
+    OcclusionCuller culler;
+    BoundingBox wallBounds = { { -10.0f, 0.0f, -30.0f }, { 10.0f, 10.0f, -30.0f } };
+    culler.AddOccluder(1, CreateWall(), glm::mat4(1.0f), wallBounds);
+    culler.Render(viewProjection, Frustum::ExtractPlanes(viewProjection), glm::vec3(0.0f, 5.0f, 0.0f));
+
+    OcclusionCuller::Stats stats = culler.GetStats();
+    CHECK(stats.occluderCount == 1);
+    CHECK(stats.triangleCount == 2);
+
+    // Behind the middle of the wall
+    CHECK(culler.IsOccluded({ { -2.0f, 2.0f, -50.0f }, { 2.0f, 6.0f, -46.0f } }));
+    // Beside the wall, in view
+    CHECK(!culler.IsOccluded({ { 30.0f, 2.0f, -60.0f }, { 34.0f, 6.0f, -56.0f } }));
+    // Behind the wall but taller than it
+    CHECK(!culler.IsOccluded({ { -2.0f, 2.0f, -50.0f }, { 2.0f, 20.0f, -46.0f } }));
+    // In front of the wall
+    CHECK(!culler.IsOccluded({ { -2.0f, 2.0f, -20.0f }, { 2.0f, 6.0f, -16.0f } }));
+    // Flat and long like a road segment, starting behind the wall and extending past its side
+    CHECK(!culler.IsOccluded({ { -5.0f, 1.0f, -50.0f }, { 25.0f, 1.0f, -45.0f } }));
+
+    // Nothing is hidden once the occluder is removed
+    culler.RemoveOccluder(1);
+    culler.Render(viewProjection, Frustum::ExtractPlanes(viewProjection), glm::vec3(0.0f, 5.0f, 0.0f));
+    CHECK(!culler.HasOccluders());
+    CHECK(!culler.IsOccluded({ { -2.0f, 2.0f, -50.0f }, { 2.0f, 6.0f, -46.0f } }));
+
+    return GetTestResult();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the test executables, which need no test framework.
+// A failed check is reported and the test returns the number of failed checks
+inline int &GetFailedCheckCount()
+{
+    static int failedCheckCount = 0;
+    return failedCheckCount;
+}
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            GetFailedCheckCount()++; \
+        } \
+    } while (false)
+
+inline int GetTestResult()
+{
+    if (GetFailedCheckCount() == 0)
+    {
+        std::printf("All checks passed\n");
+    }
+    return GetFailedCheckCount();
+}
@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+
+#include "Engine/VertexPacker.h"
+#include "TestCheck.h"
+
+// Box with a normal per face, extent and offset vary per test so that the quantization step differs per axis
+static std::vector<Vertex> CreateBox(const glm::vec3 &minPosition, const glm::vec3 &maxPosition)
+{
+    std::vector<Vertex> vertices;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (float side : { -1.0f, 1.0f })
+        {
+            glm::vec3 normal{ 0.0f };
+            normal[axis] = side;
+            for (int corner = 0; corner < 4; corner++)
+            {
+                glm::vec3 position = (corner & 1) ? maxPosition : minPosition;
+                position[(axis + 1) % 3] = (corner & 2) ? maxPosition[(axis + 1) % 3] : minPosition[(axis + 1) % 3];
+                position[axis] = side > 0.0f ? maxPosition[axis] : minPosition[axis];
+                vertices.push_back({ position, normal, glm::vec2((corner & 1) ? 1.0f : 0.0f, (corner & 2) ? 1.0f : 0.0f) });
+            }
+        }
+    }
+    return vertices;
+}
+
+// Sphere with the radial normals, which cover the whole octahedron including its folded lower half
+static std::vector<Vertex> CreateSphere(const glm::vec3 &center, float radius, int rings, int segments)
+{
+    std::vector<Vertex> vertices;
+    for (int ring = 0; ring <= rings; ring++)
+    {
+        float polar = glm::pi<float>() * ring / rings;
+        for (int segment = 0; segment <= segments; segment++)
+        {
+            float azimuth = glm::two_pi<float>() * segment / segments;
+            glm::vec3 normal{ std::sin(polar) * std::cos(azimuth), std::sin(polar) * std::sin(azimuth), std::cos(polar) };
+            glm::vec2 uv{ static_cast<float>(segment) / segments, static_cast<float>(ring) / rings };
+            vertices.push_back({ center + normal * radius, normal, uv });
+        }
+    }
+    return vertices;
+}
+
+static void CheckPackingError(const std::vector<Vertex> &vertices)
+{
+    std::vector<PackedVertex> packedVertices;
+    PackedVertexDecode decode = VertexPacker::Pack(vertices, packedVertices);
+    CHECK(packedVertices.size() == vertices.size());
+
+    glm::vec3 minPosition{ FLT_MAX };
+    glm::vec3 maxPosition{ -FLT_MAX };
+    for (const Vertex &vertex : vertices)
+    {
+        minPosition = glm::min(minPosition, vertex.position);
+        maxPosition = glm::max(maxPosition, vertex.position);
+    }
+    glm::vec3 extent = maxPosition - minPosition;
+    // Half a 16 bit step of the mesh extent, with the float rounding of the decode at the magnitude of the positions
+    glm::vec3 maxPositionError = extent * (0.5f / 65535.0f)
+        + 4.0f * FLT_EPSILON * glm::max(glm::abs(minPosition), glm::abs(maxPosition));
+
+    // Half a 16 bit step along both octahedral axes, the decode stretches the octahedron by at most 3
+    // onto the unit sphere, plus the float rounding of the normalization
+    const double maxNormalError = 3.0 * (std::sqrt(2.0) / 2.0) / 32767.0 + 1e-6;
+
+    double worstNormalError = 0.0;
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const Vertex &vertex = vertices[i];
+        Vertex unpackedVertex = VertexPacker::Unpack(packedVertices[i], decode);
+
+        glm::vec3 positionError = glm::abs(vertex.position - unpackedVertex.position);
+        CHECK(positionError.x <= maxPositionError.x);
+        CHECK(positionError.y <= maxPositionError.y);
+        CHECK(positionError.z <= maxPositionError.z);
+
+        // Angle from the chord in double precision, acos is too imprecise for angles this small
+        glm::dvec3 normal = glm::normalize(glm::dvec3(vertex.normal));
+        double chord = glm::length(normal - glm::dvec3(unpackedVertex.normal));
+        double normalError = 2.0 * std::asin(std::min(chord / 2.0, 1.0));
+        worstNormalError = std::max(worstNormalError, normalError);
+    }
+    CHECK(worstNormalError <= maxNormalError);
+
+    // The error measured for the logs stays within the same bounds
+    VertexPackingError error = VertexPacker::MeasureError(vertices, packedVertices, decode);
+    CHECK(error.maxPositionError <= glm::length(maxPositionError));
+}
+
+int main()
+{
+    CheckPackingError(CreateBox({ -1.0f, -1.0f, -1.0f }, { 1.0f, 1.0f, 1.0f }));
+    // Long and thin, far from the origin, as the road and terrain meshes
+    CheckPackingError(CreateBox({ 5000.0f, -2000.0f, 10.0f }, { 6000.0f, -1999.0f, 10.01f }));
+    CheckPackingError(CreateSphere({ 0.0f, 0.0f, 0.0f }, 1.0f, 64, 128));
+    CheckPackingError(CreateSphere({ 250.0f, -75.0f, 3.0f }, 40.0f, 33, 71));
+
+    return GetTestResult();
+}
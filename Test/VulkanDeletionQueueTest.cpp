@@ -0,0 +1,62 @@
+#include <vector>
+
+#include "Engine/Vulkan/VulkanDeletionQueue.h"
+#include "TestCheck.h"
+
+int main()
+{
+    VulkanDeletionQueue deletionQueue;
+    std::vector<int> destroyed;
+
+    // Released before the first submission, the frame submitted next may still use it
+    deletionQueue.Defer([&destroyed]() { destroyed.push_back(1); });
+    deletionQueue.Defer([&destroyed]() { destroyed.push_back(2); });
+    CHECK(deletionQueue.GetPendingCount() == 2);
+
+    deletionQueue.ReleaseCompleted(0);
+    CHECK(destroyed.empty());
+
+    deletionQueue.OnFrameSubmitted();
+    CHECK(deletionQueue.GetSubmittedFrameCount() == 1);
+
+    // Released during the second frame
+    deletionQueue.Defer([&destroyed]() { destroyed.push_back(3); });
+    deletionQueue.OnFrameSubmitted();
+
+    // Only the first frame is complete, the entries of the second stay queued
+    deletionQueue.ReleaseCompleted(1);
+    CHECK(destroyed == std::vector<int>({ 1, 2 }));
+    CHECK(deletionQueue.GetPendingCount() == 1);
+
+    // A destroy releasing another resource, which is tagged with the frame submitted next
+    deletionQueue.Defer([&deletionQueue, &destroyed]()
+    {
+        destroyed.push_back(4);
+        deletionQueue.Defer([&destroyed]() { destroyed.push_back(5); });
+    });
+    deletionQueue.OnFrameSubmitted();
+
+    // Frame 3 is complete, the resource released by the destroy is tagged with frame 4
+    deletionQueue.ReleaseCompleted(3);
+    CHECK(destroyed == std::vector<int>({ 1, 2, 3, 4 }));
+    CHECK(deletionQueue.GetPendingCount() == 1);
+
+    // Completing frame 4 releases it
+    deletionQueue.OnFrameSubmitted();
+    deletionQueue.ReleaseCompleted(4);
+    CHECK(destroyed == std::vector<int>({ 1, 2, 3, 4, 5 }));
+    CHECK(deletionQueue.GetPendingCount() == 0);
+
+    // Releasing everything also releases what the destroys queue, whatever their frame
+    deletionQueue.Defer([&deletionQueue, &destroyed]()
+    {
+        destroyed.push_back(6);
+        deletionQueue.Defer([&destroyed]() { destroyed.push_back(7); });
+    });
+    deletionQueue.Defer([&destroyed]() { destroyed.push_back(8); });
+    deletionQueue.ReleaseAll();
+    CHECK(destroyed == std::vector<int>({ 1, 2, 3, 4, 5, 6, 8, 7 }));
+    CHECK(deletionQueue.GetPendingCount() == 0);
+
+    return GetTestResult();
+}
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "BlockCompressor.h"
+
+namespace
+{
+    constexpr uint32_t BC1_BLOCK_SIZE = 8;
+    constexpr uint32_t BC3_BLOCK_SIZE = 16;
+    constexpr uint32_t BC5_BLOCK_SIZE = 16;
+    constexpr int POWER_ITERATIONS = 8;
+
+    void WriteLittleEndian(uint8_t *output, uint64_t value, uint32_t byteCount)
+    {
+        for (uint32_t i = 0; i < byteCount; i++)
+        {
+            output[i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    }
+}
+
+std::vector<uint8_t> BlockCompressor::CompressBC1(const uint8_t *pixels, uint32_t width, uint32_t height)
+{
+    uint32_t blocksWide = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    uint32_t blocksHigh = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    std::vector<uint8_t> output(static_cast<size_t>(blocksWide) * blocksHigh * BC1_BLOCK_SIZE);
+
+    uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT];
+    uint8_t *blockOutput = output.data();
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+        {
+            ExtractBlock(pixels, width, height, blockX, blockY, block);
+            EncodeColorBlock(block, blockOutput);
+            blockOutput += BC1_BLOCK_SIZE;
+        }
+    }
+    return output;
+}
+
+std::vector<uint8_t> BlockCompressor::CompressBC3(const uint8_t *pixels, uint32_t width, uint32_t height)
+{
+    uint32_t blocksWide = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    uint32_t blocksHigh = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    std::vector<uint8_t> output(static_cast<size_t>(blocksWide) * blocksHigh * BC3_BLOCK_SIZE);
+
+    uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT];
+    uint8_t *blockOutput = output.data();
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+        {
+            ExtractBlock(pixels, width, height, blockX, blockY, block);
+            // Alpha block first, then a BC1 color block that is always decoded in 4 color mode
+            EncodeChannelBlock(block, 3, blockOutput);
+            EncodeColorBlock(block, blockOutput + 8);
+            blockOutput += BC3_BLOCK_SIZE;
+        }
+    }
+    return output;
+}
+
+std::vector<uint8_t> BlockCompressor::CompressBC5(const uint8_t *pixels, uint32_t width, uint32_t height)
+{
+    uint32_t blocksWide = (width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    uint32_t blocksHigh = (height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+    std::vector<uint8_t> output(static_cast<size_t>(blocksWide) * blocksHigh * BC5_BLOCK_SIZE);
+
+    uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT];
+    uint8_t *blockOutput = output.data();
+    for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+    {
+        for (uint32_t blockX = 0; blockX < blocksWide; blockX++)
+        {
+            ExtractBlock(pixels, width, height, blockX, blockY, block);
+            EncodeChannelBlock(block, 0, blockOutput);
+            EncodeChannelBlock(block, 1, blockOutput + 8);
+            blockOutput += BC5_BLOCK_SIZE;
+        }
+    }
+    return output;
+}
+
+void BlockCompressor::ExtractBlock(
+    const uint8_t *pixels,
+    uint32_t width,
+    uint32_t height,
+    uint32_t blockX,
+    uint32_t blockY,
+    uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT])
+{
+    for (uint32_t y = 0; y < BLOCK_DIMENSION; y++)
+    {
+        uint32_t sourceY = std::min(blockY * BLOCK_DIMENSION + y, height - 1);
+        for (uint32_t x = 0; x < BLOCK_DIMENSION; x++)
+        {
+            uint32_t sourceX = std::min(blockX * BLOCK_DIMENSION + x, width - 1);
+            const uint8_t *source = pixels + (static_cast<size_t>(sourceY) * width + sourceX) * CHANNEL_COUNT;
+            std::copy(source, source + CHANNEL_COUNT, block + (y * BLOCK_DIMENSION + x) * CHANNEL_COUNT);
+        }
+    }
+}
+
+void BlockCompressor::EncodeColorBlock(const uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT], uint8_t *output)
+{
+    // Fit the endpoints to the extent of the colors along their principal axis
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            mean[c] += block[i * CHANNEL_COUNT + c];
+        }
+    }
+    for (int c = 0; c < 3; c++)
+    {
+        mean[c] /= BLOCK_TEXEL_COUNT;
+    }
+
+    float covariance[3][3] = {};
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+    {
+        float difference[3];
+        for (int c = 0; c < 3; c++)
+        {
+            difference[c] = block[i * CHANNEL_COUNT + c] - mean[c];
+        }
+        for (int row = 0; row < 3; row++)
+        {
+            for (int column = 0; column < 3; column++)
+            {
+                covariance[row][column] += difference[row] * difference[column];
+            }
+        }
+    }
+
+    float axis[3] = { 1.0f, 1.0f, 1.0f };
+    for (int iteration = 0; iteration < POWER_ITERATIONS; iteration++)
+    {
+        float next[3];
+        for (int row = 0; row < 3; row++)
+        {
+            next[row] = covariance[row][0] * axis[0] + covariance[row][1] * axis[1] + covariance[row][2] * axis[2];
+        }
+        float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f)
+        {
+            // All the colors are the same
+            break;
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float minProjection = 0.0f, maxProjection = 0.0f;
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+    {
+        float projection = 0.0f;
+        for (int c = 0; c < 3; c++)
+        {
+            projection += (block[i * CHANNEL_COUNT + c] - mean[c]) * axis[c];
+        }
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    float maxEndpoint[3], minEndpoint[3];
+    for (int c = 0; c < 3; c++)
+    {
+        maxEndpoint[c] = std::clamp(mean[c] + axis[c] * maxProjection, 0.0f, 255.0f);
+        minEndpoint[c] = std::clamp(mean[c] + axis[c] * minProjection, 0.0f, 255.0f);
+    }
+
+    uint16_t color0 = PackColor565(maxEndpoint);
+    uint16_t color1 = PackColor565(minEndpoint);
+    // The first color must be the larger one for the 4 color mode without transparency
+    if (color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        float palette[4][3];
+        UnpackColor565(color0, palette[0]);
+        UnpackColor565(color1, palette[1]);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+
+        for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+        {
+            uint32_t bestIndex = 0;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint32_t p = 0; p < 4; p++)
+            {
+                float distance = 0.0f;
+                for (int c = 0; c < 3; c++)
+                {
+                    float difference = block[i * CHANNEL_COUNT + c] - palette[p][c];
+                    distance += difference * difference;
+                }
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = p;
+                }
+            }
+            indices |= bestIndex << (2 * i);
+        }
+    }
+
+    WriteLittleEndian(output, color0, 2);
+    WriteLittleEndian(output + 2, color1, 2);
+    WriteLittleEndian(output + 4, indices, 4);
+}
+
+void BlockCompressor::EncodeChannelBlock(const uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT], uint32_t channel, uint8_t *output)
+{
+    uint8_t maxValue = 0, minValue = 255;
+    for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+    {
+        maxValue = std::max(maxValue, block[i * CHANNEL_COUNT + channel]);
+        minValue = std::min(minValue, block[i * CHANNEL_COUNT + channel]);
+    }
+
+    // The larger value first selects the mode with 6 interpolated values
+    uint64_t indices = 0;
+    if (maxValue != minValue)
+    {
+        float palette[8];
+        palette[0] = maxValue;
+        palette[1] = minValue;
+        for (int p = 2; p < 8; p++)
+        {
+            palette[p] = ((8 - p) * palette[0] + (p - 1) * palette[1]) / 7.0f;
+        }
+
+        for (uint32_t i = 0; i < BLOCK_TEXEL_COUNT; i++)
+        {
+            uint64_t bestIndex = 0;
+            float bestDistance = std::numeric_limits<float>::max();
+            for (uint64_t p = 0; p < 8; p++)
+            {
+                float distance = std::abs(block[i * CHANNEL_COUNT + channel] - palette[p]);
+                if (distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    bestIndex = p;
+                }
+            }
+            indices |= bestIndex << (3 * i);
+        }
+    }
+
+    output[0] = maxValue;
+    output[1] = minValue;
+    WriteLittleEndian(output + 2, indices, 6);
+}
+
+uint16_t BlockCompressor::PackColor565(const float color[3])
+{
+    uint16_t red = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+    uint16_t green = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+    uint16_t blue = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+    return static_cast<uint16_t>((red << 11) | (green << 5) | blue);
+}
+
+void BlockCompressor::UnpackColor565(uint16_t packed, float color[3])
+{
+    color[0] = ((packed >> 11) & 0x1F) * 255.0f / 31.0f;
+    color[1] = ((packed >> 5) & 0x3F) * 255.0f / 63.0f;
+    color[2] = (packed & 0x1F) * 255.0f / 31.0f;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Encodes RGBA pixels into 4x4 texel blocks, texels outside the image repeat the edge texels
+// The endpoints are fitted to the range of the block, which is fast but not the best possible quality
+class BlockCompressor
+{
+public:
+    static std::vector<uint8_t> CompressBC1(const uint8_t *pixels, uint32_t width, uint32_t height);
+    static std::vector<uint8_t> CompressBC3(const uint8_t *pixels, uint32_t width, uint32_t height);
+    // Only the red and green channels are kept, for normal maps
+    static std::vector<uint8_t> CompressBC5(const uint8_t *pixels, uint32_t width, uint32_t height);
+
+private:
+    static constexpr uint32_t BLOCK_DIMENSION = 4;
+    static constexpr uint32_t BLOCK_TEXEL_COUNT = BLOCK_DIMENSION * BLOCK_DIMENSION;
+    static constexpr uint32_t CHANNEL_COUNT = 4;
+
+    static void ExtractBlock(
+        const uint8_t *pixels,
+        uint32_t width,
+        uint32_t height,
+        uint32_t blockX,
+        uint32_t blockY,
+        uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT]);
+    static void EncodeColorBlock(const uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT], uint8_t *output);
+    static void EncodeChannelBlock(const uint8_t block[BLOCK_TEXEL_COUNT * CHANNEL_COUNT], uint32_t channel, uint8_t *output);
+
+    static uint16_t PackColor565(const float color[3]);
+    static void UnpackColor565(uint16_t packed, float color[3]);
+};
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
+
+#include "Engine/DDSFile.h"
+#include "BlockCompressor.h"
+
+// Converts every image in the "textures" directories of the game data into a DDS file next to it,
+// with the whole mip chain compressed in BC1 (opaque) or BC3 (with alpha)
+// Usage: TextureCompressor [--force] <data directory>...
+
+namespace
+{
+    constexpr const char *TEXTURE_DIRECTORY_NAME = "textures";
+    constexpr const char *SOURCE_EXTENSIONS[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp" };
+    constexpr int CHANNEL_COUNT = 4;
+    constexpr int ALPHA_CHANNEL = 3;
+
+    struct CompressionStats
+    {
+        uint32_t convertedCount = 0;
+        uint32_t skippedCount = 0;
+        uint32_t failedCount = 0;
+        // Sizes of all the mip levels, uncompressed in RGBA and compressed
+        uint64_t uncompressedSize = 0;
+        uint64_t compressedSize = 0;
+    };
+
+    bool IsSourceTexture(const std::filesystem::path &path)
+    {
+        if (path.parent_path().filename() != TEXTURE_DIRECTORY_NAME)
+        {
+            return false;
+        }
+
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return std::find(std::begin(SOURCE_EXTENSIONS), std::end(SOURCE_EXTENSIONS), extension)
+            != std::end(SOURCE_EXTENSIONS);
+    }
+
+    bool IsUpToDate(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath)
+    {
+        std::error_code fileError;
+        auto outputModifiedTime = std::filesystem::last_write_time(outputPath, fileError);
+        if (fileError)
+        {
+            return false;
+        }
+        return std::filesystem::last_write_time(sourcePath) <= outputModifiedTime;
+    }
+
+    bool CompressTexture(const std::filesystem::path &sourcePath, const std::filesystem::path &outputPath, CompressionStats &stats)
+    {
+        int width, height, channels;
+        stbi_uc *pixels = stbi_load(sourcePath.string().c_str(), &width, &height, &channels, CHANNEL_COUNT);
+        if (!pixels)
+        {
+            std::cerr << "Failed to load " << sourcePath.string() << ": " << stbi_failure_reason() << std::endl;
+            return false;
+        }
+
+        bool opaque = true;
+        for (size_t i = ALPHA_CHANNEL; i < static_cast<size_t>(width) * height * CHANNEL_COUNT; i += CHANNEL_COUNT)
+        {
+            if (pixels[i] != 255)
+            {
+                opaque = false;
+                break;
+            }
+        }
+        ImageFormat format = opaque ? ImageFormat::BC1 : ImageFormat::BC3;
+
+        std::vector<ImageMipLevel> mipLevels;
+        std::vector<uint8_t> data;
+        std::vector<uint8_t> levelPixels(pixels, pixels + static_cast<size_t>(width) * height * CHANNEL_COUNT);
+        stbi_image_free(pixels);
+
+        uint32_t levelWidth = width, levelHeight = height;
+        while (true)
+        {
+            std::vector<uint8_t> levelData = format == ImageFormat::BC1
+                ? BlockCompressor::CompressBC1(levelPixels.data(), levelWidth, levelHeight)
+                : BlockCompressor::CompressBC3(levelPixels.data(), levelWidth, levelHeight);
+
+            ImageMipLevel mipLevel{};
+            mipLevel.width = levelWidth;
+            mipLevel.height = levelHeight;
+            mipLevel.offset = data.size();
+            mipLevel.size = levelData.size();
+            mipLevels.push_back(mipLevel);
+            data.insert(data.end(), levelData.begin(), levelData.end());
+            stats.uncompressedSize += levelPixels.size();
+
+            if (levelWidth == 1 && levelHeight == 1)
+            {
+                break;
+            }
+
+            // Each level is filtered from the previous one in linear space, like the mipmaps generated at runtime
+            uint32_t nextWidth = std::max(levelWidth / 2, 1U);
+            uint32_t nextHeight = std::max(levelHeight / 2, 1U);
+            std::vector<uint8_t> nextPixels(static_cast<size_t>(nextWidth) * nextHeight * CHANNEL_COUNT);
+            stbir_resize_uint8_srgb(
+                levelPixels.data(), levelWidth, levelHeight, 0,
+                nextPixels.data(), nextWidth, nextHeight, 0,
+                CHANNEL_COUNT, ALPHA_CHANNEL, 0);
+            levelPixels = std::move(nextPixels);
+            levelWidth = nextWidth;
+            levelHeight = nextHeight;
+        }
+
+        if (!DDSFile::Write(outputPath.string(), format, width, height, mipLevels, data))
+        {
+            std::cerr << "Failed to write " << outputPath.string() << std::endl;
+            return false;
+        }
+
+        stats.compressedSize += data.size();
+        std::cout << outputPath.string() << " (" << width << "x" << height << ", "
+            << (format == ImageFormat::BC1 ? "BC1" : "BC3") << ", " << mipLevels.size() << " mip levels)" << std::endl;
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bool force = false;
+    std::vector<std::filesystem::path> dataDirectories;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        if (argument == "--force")
+        {
+            force = true;
+        }
+        else
+        {
+            dataDirectories.push_back(argument);
+        }
+    }
+
+    if (dataDirectories.empty())
+    {
+        std::cerr << "Usage: TextureCompressor [--force] <data directory>..." << std::endl;
+        return 1;
+    }
+
+    CompressionStats stats;
+    for (const auto &dataDirectory : dataDirectories)
+    {
+        std::error_code directoryError;
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(dataDirectory, directoryError))
+        {
+            if (!entry.is_regular_file() || !IsSourceTexture(entry.path()))
+            {
+                continue;
+            }
+
+            std::filesystem::path outputPath = entry.path();
+            outputPath.replace_extension(DDSFile::FILE_EXTENSION);
+            if (!force && IsUpToDate(entry.path(), outputPath))
+            {
+                stats.skippedCount++;
+                continue;
+            }
+
+            if (CompressTexture(entry.path(), outputPath, stats))
+            {
+                stats.convertedCount++;
+            }
+            else
+            {
+                stats.failedCount++;
+            }
+        }
+
+        if (directoryError)
+        {
+            std::cerr << "Failed to read " << dataDirectory.string() << ": " << directoryError.message() << std::endl;
+        }
+    }
+
+    std::cout << "Converted " << stats.convertedCount << " textures, skipped " << stats.skippedCount
+        << " up to date, " << stats.failedCount << " failed" << std::endl;
+    if (stats.compressedSize > 0)
+    {
+        std::cout << "RGBA " << stats.uncompressedSize / 1024 << " KB -> compressed " << stats.compressedSize / 1024
+            << " KB (" << static_cast<double>(stats.uncompressedSize) / stats.compressedSize << "x smaller)" << std::endl;
+    }
+    return stats.failedCount > 0 ? 1 : 0;
+}